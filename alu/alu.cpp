@@ -85,6 +85,61 @@ uint16_t ALU::_xor(uint16_t a, uint16_t b, Flags &flags) {
     return result;
 }
 
+// =========================================
+// MUL (16 x 16 -> low 16 bits)
+// Updates: ZF, CF (product did not fit in 16 bits)
+// =========================================
+uint16_t ALU::mul(uint16_t a, uint16_t b, Flags &flags) {
+
+    uint32_t result32 = (uint32_t)a * (uint32_t)b;
+    uint16_t result = result32 & 0xFFFF;
+
+    flags.CF = (result32 > 0xFFFF);
+    flags.ZF = (result == 0);
+
+    return result;
+}
+
+// =========================================
+// DIV (unsigned quotient)
+// Division by zero yields 0xFFFF and sets CF
+// =========================================
+uint16_t ALU::div(uint16_t a, uint16_t b, Flags &flags) {
+
+    if (b == 0) {
+        flags.CF = true;
+        flags.ZF = false;
+        return 0xFFFF;
+    }
+
+    uint16_t result = a / b;
+
+    flags.CF = false;
+    flags.ZF = (result == 0);
+
+    return result;
+}
+
+// =========================================
+// MOD (unsigned remainder)
+// Modulo by zero leaves the dividend and sets CF
+// =========================================
+uint16_t ALU::mod(uint16_t a, uint16_t b, Flags &flags) {
+
+    if (b == 0) {
+        flags.CF = true;
+        flags.ZF = (a == 0);
+        return a;
+    }
+
+    uint16_t result = a % b;
+
+    flags.CF = false;
+    flags.ZF = (result == 0);
+
+    return result;
+}
+
 // =========================================
 // CMP (compare)
 // Does NOT return value — only sets flags
@@ -26,6 +26,15 @@ public:
     // Perform bitwise XOR
     uint16_t _xor(uint16_t a, uint16_t b, Flags &flags);
 
+    // Perform MUL (low 16 bits of the product)
+    uint16_t mul(uint16_t a, uint16_t b, Flags &flags);
+
+    // Perform unsigned DIV (quotient)
+    uint16_t div(uint16_t a, uint16_t b, Flags &flags);
+
+    // Perform unsigned MOD (remainder)
+    uint16_t mod(uint16_t a, uint16_t b, Flags &flags);
+
     // Compare: sets flags only (ZF, CF)
     void cmp(uint16_t a, uint16_t b, Flags &flags);
 
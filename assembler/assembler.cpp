@@ -1,66 +1,153 @@
 #include "assembler.h"
+#include "object.h"
+#include "../cpu/isa.h"
 #include <fstream>
 #include <iostream>
-#include <sstream>
-#include <algorithm>
-#include <cctype>
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Thrown by fail(); caught in assemble_source()
+struct AsmError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
 
 // ------------------------------------------------------------
-// Trim helper
+// Whitespace / trim helpers (string_view, no copies)
 // ------------------------------------------------------------
-static std::string trim(const std::string &s) {
-    size_t start = s.find_first_not_of(" \t\r\n");
-    if (start == std::string::npos) return "";
-    size_t end = s.find_last_not_of(" \t\r\n");
-    return s.substr(start, end - start + 1);
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && is_space(s.front())) s.remove_prefix(1);
+    while (!s.empty() && is_space(s.back()))  s.remove_suffix(1);
+    return s;
+}
+
+// ------------------------------------------------------------
+// Remove comments (';' outside of a string literal)
+// ------------------------------------------------------------
+static std::string_view remove_comment(std::string_view line) {
+    if (line.find('"') == std::string_view::npos) {
+        size_t p = line.find(';');
+        return p == std::string_view::npos ? line : line.substr(0, p);
+    }
+
+    bool quoted = false;
+    for (size_t p = 0; p < line.size(); p++) {
+        if (line[p] == '"' && (p == 0 || line[p - 1] != '\\')) quoted = !quoted;
+        if (line[p] == ';' && !quoted) return line.substr(0, p);
+    }
+    return line;
 }
 
 // ------------------------------------------------------------
-// Remove comments
+// SPLIT instruction ("MOV R1, R2", "LOAD R0, [R1 + 4]")
+// Tokens are separated by whitespace/commas; a bracketed
+// operand is kept as a single token.
+// Returns the token count (at most max).
 // ------------------------------------------------------------
-static std::string remove_comment(const std::string &line) {
-    size_t p = line.find(';');
-    if (p == std::string::npos) return line;
-    return line.substr(0, p);
+static size_t tokenize(std::string_view line, std::string_view *tokens, size_t max) {
+    size_t n = 0;
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (is_space(c) || c == ',') { i++; continue; }
+
+        size_t start = i;
+        if (c == '[') {
+            size_t close = line.find(']', i);
+            i = (close == std::string_view::npos) ? line.size() : close + 1;
+        } else {
+            while (i < line.size() && !is_space(line[i]) && line[i] != ',') i++;
+        }
+
+        if (n == max) return max + 1;
+        tokens[n++] = line.substr(start, i - start);
+    }
+    return n;
 }
 
 // ------------------------------------------------------------
-// SPLIT instruction safely ("MOV R1, R2")
+// Parse an unsigned/negative decimal or 0x-hex literal
 // ------------------------------------------------------------
-static std::vector<std::string> tokenize(const std::string &line) {
-    std::vector<std::string> out;
-    std::stringstream ss(line);
-    std::string word;
-    while (ss >> word) {
-        if (!word.empty() && word.back() == ',')
-            word.pop_back();
-        out.push_back(word);
+static bool parse_literal(std::string_view s, uint16_t &out) {
+    bool neg = false;
+    if (!s.empty() && s[0] == '-') { neg = true; s.remove_prefix(1); }
+    if (s.empty()) return false;
+
+    uint32_t v = 0;
+    if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        for (char c : s.substr(2)) {
+            int d;
+            if (c >= '0' && c <= '9')      d = c - '0';
+            else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+            else return false;
+            v = v * 16 + d;
+            if (v > 0xFFFF) return false;
+        }
+    } else {
+        for (char c : s) {
+            if (c < '0' || c > '9') return false;
+            v = v * 10 + (c - '0');
+            if (v > 0xFFFF) return false;
+        }
     }
-    return out;
+
+    out = neg ? (uint16_t)(0 - v) : (uint16_t)v;
+    return true;
 }
 
 // ============================================================
-// PASS 1: Collect label addresses
+// Error reporting
+// ============================================================
+void Assembler::fail(const std::string &msg) {
+    throw AsmError("line " + std::to_string(line_no) + ": " + msg);
+}
+
+// ============================================================
+// File → file
 // ============================================================
 bool Assembler::assemble(const std::string &inputFile, const std::string &outputFile)
 {
-    std::ifstream fin(inputFile);
-    if (!fin.is_open()) {
+    int fd = open(inputFile.c_str(), O_RDONLY);
+    if (fd < 0) {
         std::cerr << "Error: Cannot open ASM file.\n";
         return false;
     }
 
-    std::vector<std::string> lines;
-    std::string line;
+    struct stat st;
+    fstat(fd, &st);
+    size_t size = st.st_size;
+
+    const char *text = "";
+    void *mapped = MAP_FAILED;
+    if (size > 0) {
+        mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            std::cerr << "Error: Cannot map ASM file.\n";
+            return false;
+        }
+        text = static_cast<const char*>(mapped);
+    }
+    close(fd);
 
-    while (std::getline(fin, line))
-        lines.push_back(line);
-    fin.close();
+    std::vector<uint8_t> output;
+    bool ok = assemble_source(std::string_view(text, size), output);
 
-    if (!first_pass(lines)) return false;
+    if (mapped != MAP_FAILED)
+        munmap(mapped, size);
 
-    std::vector<uint8_t> output;
-    if (!second_pass(lines, output)) return false;
+    if (!ok) {
+        std::cerr << "Error: " << error_msg << "\n";
+        return false;
+    }
 
     std::ofstream fout(outputFile, std::ios::binary);
     fout.write((char*)output.data(), output.size());
@@ -70,166 +157,459 @@ bool Assembler::assemble(const std::string &inputFile, const std::string &output
     return true;
 }
 
-bool Assembler::first_pass(const std::vector<std::string> &lines)
+// ============================================================
+// One pass over the text (and the optimizer); fixups are left
+// for the caller to resolve or turn into relocations
+// ============================================================
+bool Assembler::parse(std::string_view source, std::vector<uint8_t> &out)
 {
-    labels.clear();
-    uint16_t pc = 0;
+    reset();
+    out.clear();
+    out.reserve(source.size() / 4);
+
+    try {
+        size_t pos = 0;
+        while (pos < source.size()) {
+            size_t nl = source.find('\n', pos);
+            if (nl == std::string_view::npos) nl = source.size();
 
-    for (auto &raw : lines) {
-        std::string line = trim(remove_comment(raw));
-        if (line.empty()) continue;
+            line_no++;
+            assemble_line(source.substr(pos, nl - pos), out);
+            pos = nl + 1;
 
-        // Label
-        if (line.back() == ':') {
-            std::string label = trim(line.substr(0, line.size() - 1));
-            labels[label] = pc;
-            continue;
+            if (out.size() > (size_t)MEM_SIZE)
+                fail("program exceeds 64 KB address space");
         }
 
-        // Real instruction → always 5 bytes
-        pc += 5;
+        if (optimize_enabled) optimize(out);
+    }
+    catch (const AsmError &e) {
+        error_msg = e.what();
+        return false;
     }
     return true;
 }
 
-// ------------------------------------------------------------
-// Convert tokens to opcode
-// ------------------------------------------------------------
-static uint8_t get_opcode(const std::string &m) {
-    if (m == "MOVI") return 0x10;
-    if (m == "MOV")  return 0x11;
+// ============================================================
+// In-memory assembly: one pass over the text, then backpatch
+// ============================================================
+bool Assembler::assemble_source(std::string_view source, std::vector<uint8_t> &out)
+{
+    if (!parse(source, out) || !resolve_fixups(out)) return false;
+
+    for (auto &sym : symbol_table)
+        if (sym.defined) labels.emplace(std::string(sym.name), sym.value);
 
-    if (m == "ADD")  return 0x20;
-    if (m == "SUB")  return 0x21;
-    if (m == "AND")  return 0x22;
-    if (m == "OR")   return 0x23;
-    if (m == "XOR")  return 0x24;
-    if (m == "CMP")  return 0x25;
+    // Views into the caller's buffer must not outlive this call
+    symbol_index.clear();
+    symbol_table.clear();
+    return true;
+}
 
-    if (m == "LOAD")  return 0x30;
-    if (m == "STORE") return 0x31;
+// ============================================================
+// Relocatable assembly: every label reference becomes a
+// relocation, module-relative if the label is defined here,
+// an import otherwise
+// ============================================================
+bool Assembler::assemble_object(std::string_view source, ObjectFile &obj)
+{
+    obj = ObjectFile();
+    if (!parse(source, obj.code)) return false;
+
+    std::vector<uint32_t> import_index(symbol_table.size(), NO_SYMBOL);
+    for (uint32_t s = 0; s < symbol_table.size(); s++) {
+        const Symbol &sym = symbol_table[s];
+        if (sym.global && !sym.defined) {
+            error_msg = "line " + std::to_string(sym.line) +
+                        ": .global label is not defined: " + std::string(sym.name);
+            return false;
+        }
+        if (sym.global) obj.exports.push_back({ std::string(sym.name), sym.value });
+    }
 
-    if (m == "JMP") return 0x40;
-    if (m == "JZ")  return 0x41;
-    if (m == "JNZ") return 0x42;
+    for (const Fixup &f : fixups) {
+        const Symbol &sym = symbol_table[f.symbol];
+        ObjectFile::Reloc r;
+        r.offset = f.offset;
+
+        if (sym.defined) {
+            r.kind = ObjectFile::RelocKind::SECTION;
+            r.addend = sym.value + f.addend;
+        } else {
+            if (import_index[f.symbol] == NO_SYMBOL) {
+                import_index[f.symbol] = obj.imports.size();
+                obj.imports.emplace_back(sym.name);
+            }
+            r.kind = ObjectFile::RelocKind::EXTERN;
+            r.index = import_index[f.symbol];
+            r.addend = f.addend;
+        }
 
-    if (m == "PUSH") return 0x50;
-    if (m == "POP")  return 0x51;
+        // Module-relative value in place, so the object also runs at 0
+        obj.code[f.offset]     = r.addend & 0xFF;
+        obj.code[f.offset + 1] = (r.addend >> 8) & 0xFF;
+        obj.relocs.push_back(r);
+    }
 
-    if (m == "CALL") return 0x60;
-    if (m == "RET")  return 0x61;
+    for (auto &sym : symbol_table)
+        if (sym.defined) labels.emplace(std::string(sym.name), sym.value);
 
-    if (m == "HALT") return 0xFF;
+    symbol_index.clear();
+    symbol_table.clear();
+    return true;
+}
 
-    return 0; // error handled later
+void Assembler::reset()
+{
+    labels.clear();
+    error_msg.clear();
+    symbol_index.clear();
+    symbol_table.clear();
+    fixups.clear();
+    stmts.clear();
+    opt_stats = OptimizerStats();
+    line_no = 0;
 }
 
 // ------------------------------------------------------------
-// Convert register token "R4"
+// One source line: [label:] [instruction | directive]
 // ------------------------------------------------------------
-int Assembler::get_register_index(const std::string &reg) {
-    if (reg.size() < 2 || reg[0] != 'R')
-        throw std::runtime_error("Invalid register: " + reg);
-    return std::stoi(reg.substr(1));
+void Assembler::assemble_line(std::string_view raw, std::vector<uint8_t> &out)
+{
+    std::string_view line = trim(remove_comment(raw));
+    if (line.empty()) return;
+
+    // "label:" alone, or "label: instruction"
+    if (line.back() == ':') {
+        define_label(trim(line.substr(0, line.size() - 1)), out.size());
+        return;
+    }
+
+    size_t word_end = 0;
+    while (word_end < line.size() && !is_space(line[word_end])) word_end++;
+
+    if (line[word_end - 1] == ':' && line[0] != '.') {
+        define_label(line.substr(0, word_end - 1), out.size());
+        line = trim(line.substr(word_end));
+        word_end = 0;
+        while (word_end < line.size() && !is_space(line[word_end])) word_end++;
+    }
+
+    uint32_t start = out.size();
+
+    // Data directive
+    if (line[0] == '.') {
+        emit_directive(line.substr(0, word_end), trim(line.substr(word_end)), out);
+        if (optimize_enabled) stmts.push_back({ start, (uint32_t)(out.size() - start), false });
+        return;
+    }
+
+    std::string_view tokens[5];
+    size_t count = tokenize(line, tokens, 5);
+    if (count > 5) fail("too many operands");
+
+    emit_instruction(tokens, count, out);
+    if (optimize_enabled) stmts.push_back({ start, 5, true });
 }
 
 // ------------------------------------------------------------
-// Parse immediate or label
+// Symbols
 // ------------------------------------------------------------
-uint16_t Assembler::parse_number(const std::string &s)
+uint32_t Assembler::symbol_ref(std::string_view name)
 {
-    if (s.empty()) return 0;
+    auto it = symbol_index.find(name);
+    if (it != symbol_index.end()) return it->second;
+
+    uint32_t id = symbol_table.size();
+    Symbol sym;
+    sym.name = name;
+    sym.line = line_no;
+    symbol_table.push_back(sym);
+    symbol_index.emplace(name, id);
+    return id;
+}
 
-    if (labels.count(s))
-        return labels[s];
+void Assembler::define_label(std::string_view name, uint16_t pc)
+{
+    if (name.empty()) fail("empty label");
 
-    if (s.rfind("0x", 0) == 0)
-        return std::stoi(s, nullptr, 16);
+    Symbol &sym = symbol_table[symbol_ref(name)];
+    if (sym.defined) fail("duplicate label: " + std::string(name));
 
-    return std::stoi(s);
+    sym.defined = true;
+    sym.value = pc;
+    sym.line = line_no;
 }
 
-// ============================================================
-// PASS 2: Encode instructions
-// ============================================================
-bool Assembler::second_pass(const std::vector<std::string> &lines,
-                            std::vector<uint8_t> &out)
+// ------------------------------------------------------------
+// Operand value: literal, label, label+N or label-N
+// ------------------------------------------------------------
+Assembler::Value Assembler::parse_value(std::string_view s)
 {
-    out.clear();
-
-    for (auto &raw : lines) {
+    Value v;
+    if (s.empty()) fail("missing operand");
 
-        std::string clean = trim(remove_comment(raw));
-        if (clean.empty()) continue;
+    if ((s[0] >= '0' && s[0] <= '9') || s[0] == '-') {
+        if (!parse_literal(s, v.number))
+            fail("invalid number: " + std::string(s));
+        return v;
+    }
 
-        if (clean.back() == ':') continue;  // skip label
+    size_t op = s.find_first_of("+-", 1);
+    if (op != std::string_view::npos) {
+        uint16_t addend;
+        if (!parse_literal(s.substr(op + 1), addend))
+            fail("invalid offset: " + std::string(s));
+        v.number = (s[op] == '-') ? (uint16_t)(0 - addend) : addend;
+        s = s.substr(0, op);
+    }
 
-        auto tokens = tokenize(clean);
-        if (tokens.empty()) continue;
+    v.symbol = symbol_ref(s);
+    return v;
+}
 
-        std::string mnemonic = tokens[0];
-        uint8_t opcode = get_opcode(mnemonic);
+// Literal goes straight in; symbol reference becomes a fixup
+uint16_t Assembler::place(const Value &v, uint32_t offset)
+{
+    if (v.symbol == NO_SYMBOL) return v.number;
+    fixups.push_back({ offset, v.symbol, v.number, line_no });
+    return 0;
+}
 
-        if (opcode == 0) {
-            std::cerr << "Unknown instruction: " << mnemonic << "\n";
+bool Assembler::resolve_fixups(std::vector<uint8_t> &out)
+{
+    for (const Fixup &f : fixups) {
+        const Symbol &sym = symbol_table[f.symbol];
+        if (!sym.defined) {
+            error_msg = "line " + std::to_string(f.line) +
+                        ": undefined label: " + std::string(sym.name);
             return false;
         }
+        uint16_t v = sym.value + f.addend;
+        out[f.offset]     = v & 0xFF;
+        out[f.offset + 1] = (v >> 8) & 0xFF;
+    }
+    return true;
+}
 
-        uint16_t op1 = 0, op2 = 0;
+// ------------------------------------------------------------
+// Convert register token "R4"
+// ------------------------------------------------------------
+int Assembler::get_register_index(std::string_view reg)
+{
+    uint16_t idx;
+    if (reg.size() < 2 || reg[0] != 'R' || !parse_literal(reg.substr(1), idx) || idx >= REG_COUNT)
+        fail("invalid register: " + std::string(reg));
+    return idx;
+}
 
-        // ---------------------------- SPECIAL CASES ----------------------------
+// ------------------------------------------------------------
+// Parse memory operand "[R1]", "[R1+4]", "[R1-2]", "[R1+label]"
+// or "[0x8000]" / "[label]".
+// Returns false if the token is not bracketed.
+// base = -1 for an absolute address.
+// ------------------------------------------------------------
+bool Assembler::parse_mem_operand(std::string_view tok, int &base, Value &offset)
+{
+    if (tok.size() < 3 || tok.front() != '[' || tok.back() != ']')
+        return false;
 
-        if (opcode == 0x61) { // RET
-            encode_instruction(opcode, 0, 0, out);
-            continue;
-        }
+    // Split "first [+|- second]", ignoring whitespace; all views
+    // stay inside the source buffer so symbol names remain valid.
+    std::string_view inner = trim(tok.substr(1, tok.size() - 2));
+    if (inner.empty()) fail("empty memory operand");
+
+    size_t sign = inner.find_first_of("+-", 1);
+    std::string_view first = trim(inner.substr(0, sign));
+    std::string_view second;
+    if (sign != std::string_view::npos) {
+        second = trim(inner.substr(sign + 1));
+        if (second.empty()) fail("missing offset: " + std::string(tok));
+    }
 
-        if (opcode == 0x50) { // PUSH Rn
-            if (tokens.size() != 2) throw std::runtime_error("PUSH requires 1 operand");
-            op1 = get_register_index(tokens[1]);
-            op2 = 0;
-            encode_instruction(opcode, op1, op2, out);
-            continue;
+    base = -1;
+    offset = Value();
+
+    bool is_reg = first.size() >= 2 && first[0] == 'R' && first[1] >= '0' && first[1] <= '9';
+    if (!is_reg) {
+        // Absolute address: [0x8000], [label], [label+4]
+        if (!second.empty() && second[0] >= '0' && second[0] <= '9') {
+            offset = parse_value(first);
+            uint16_t add;
+            if (!parse_literal(second, add)) fail("invalid offset: " + std::string(second));
+            offset.number += (inner[sign] == '-') ? (uint16_t)(0 - add) : add;
+        } else if (second.empty()) {
+            offset = parse_value(first);
+        } else {
+            fail("invalid memory operand: " + std::string(tok));
         }
+        return true;
+    }
 
-        if (opcode == 0x51) { // POP Rn
-            if (tokens.size() != 2) throw std::runtime_error("POP requires 1 operand");
-            op1 = get_register_index(tokens[1]);
-            op2 = 0;
-            encode_instruction(opcode, op1, op2, out);
-            continue;
-        }
+    base = get_register_index(first);
+    if (second.empty()) return true;
+
+    if (second[0] >= '0' && second[0] <= '9') {
+        uint16_t off;
+        if (!parse_literal(second, off)) fail("invalid offset: " + std::string(second));
+        offset.number = (inner[sign] == '-') ? (uint16_t)(0 - off) : off;
+    } else {
+        if (inner[sign] == '-') fail("label offsets cannot be negated");
+        offset = parse_value(second);
+    }
+    return true;
+}
 
-        if (opcode == 0x60) { // CALL label
-            if (tokens.size() != 2) throw std::runtime_error("CALL requires 1 operand");
-            op1 = parse_number(tokens[1]);
-            op2 = 0;
-            encode_instruction(opcode, op1, op2, out);
-            continue;
+// ------------------------------------------------------------
+// Data directives
+//   .byte  v, v, ...     8-bit values
+//   .word  v, v, ...     16-bit little-endian values (labels allowed)
+//   .ascii "text"        raw characters
+//   .asciz "text"        characters + NUL terminator
+//   .space n             n zero bytes
+//   .global name, ...    export labels from an object module
+// ------------------------------------------------------------
+void Assembler::emit_directive(std::string_view d, std::string_view args, std::vector<uint8_t> &out)
+{
+    if (d == ".ascii" || d == ".asciz") {
+        if (args.size() < 2 || args.front() != '"' || args.back() != '"')
+            fail("expected string literal");
+
+        for (size_t i = 1; i + 1 < args.size(); i++) {
+            char c = args[i];
+            if (c == '\\' && i + 2 < args.size()) {
+                char e = args[++i];
+                switch (e) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case '0': c = '\0'; break;
+                    default:  c = e;    break;
+                }
+            }
+            out.push_back(c);
         }
+        if (d == ".asciz") out.push_back(0);
+        return;
+    }
 
-        // ---------------------- GENERAL 2-OPERAND INSTRUCTIONS ----------------------
+    std::string_view tokens[64];
+    size_t count = tokenize(args, tokens, 64);
+    if (count > 64) fail("too many values in " + std::string(d));
 
-        if (tokens.size() == 2) {
-            // Rn, imm OR Rn, Rm
-            op1 = (tokens[1][0] == 'R') ?
-                get_register_index(tokens[1]) :
-                parse_number(tokens[1]);
+    if (d == ".byte") {
+        for (size_t i = 0; i < count; i++) {
+            Value v = parse_value(tokens[i]);
+            if (v.symbol != NO_SYMBOL) fail(".byte does not take labels");
+            out.push_back(v.number & 0xFF);
         }
-        else if (tokens.size() == 3) {
-            op1 = (tokens[1][0] == 'R') ?
-                get_register_index(tokens[1]) :
-                parse_number(tokens[1]);
-
-            op2 = (tokens[2][0] == 'R') ?
-                get_register_index(tokens[2]) :
-                parse_number(tokens[2]);
+    }
+    else if (d == ".word") {
+        for (size_t i = 0; i < count; i++) {
+            uint16_t v = place(parse_value(tokens[i]), out.size());
+            out.push_back(v & 0xFF);
+            out.push_back((v >> 8) & 0xFF);
         }
+    }
+    else if (d == ".global") {
+        if (count == 0) fail(".global requires a label");
+        for (size_t i = 0; i < count; i++)
+            symbol_table[symbol_ref(tokens[i])].global = true;
+    }
+    else if (d == ".space") {
+        uint16_t n;
+        if (count != 1 || !parse_literal(tokens[0], n)) fail(".space requires a size");
+        out.insert(out.end(), n, 0);
+    }
+    else {
+        fail("unknown directive: " + std::string(d));
+    }
+}
 
-        encode_instruction(opcode, op1, op2, out);
+// ------------------------------------------------------------
+// Instructions: operand layout comes from the ISA table
+// ------------------------------------------------------------
+void Assembler::emit_instruction(std::string_view *tokens, size_t count, std::vector<uint8_t> &out)
+{
+    std::string_view mnemonic = tokens[0];
+    const InstrInfo *info = find_instruction(mnemonic);
+
+    if (!info)
+        fail("unknown instruction: " + std::string(mnemonic));
+
+    // LOAD/STORE with a [Rb+off] operand use the indexed opcode;
+    // nothing else takes a memory operand
+    int base = -1;
+    Value offset;
+    bool mem_operand = count == 3 && parse_mem_operand(tokens[2], base, offset);
+
+    bool memory_instr = info->type == InstrType::LOAD_WORD || info->type == InstrType::STORE_WORD ||
+                        info->type == InstrType::LOAD_INDEXED || info->type == InstrType::STORE_INDEXED;
+    for (size_t i = 1; i < count; i++)
+        if (!memory_instr && !tokens[i].empty() && tokens[i].front() == '[')
+            fail(std::string(mnemonic) + " does not take a memory operand");
+
+    if (mem_operand && base >= 0) {
+        if (info->type == InstrType::LOAD_WORD)  info = find_instruction(OP_LOADX);
+        if (info->type == InstrType::STORE_WORD) info = find_instruction(OP_STOREX);
     }
 
-    return true;
+    // Operand count is fixed by the encoding
+    size_t expected = 0;
+    switch (info->enc) {
+        case Encoding::NONE:     expected = 0; break;
+        case Encoding::RD:
+        case Encoding::RS:
+        case Encoding::ADDR:     expected = 1; break;
+        case Encoding::RD_RS_RC: expected = 3; break;
+        default:                 expected = 2; break;
+    }
+    if (count != expected + 1)
+        fail(std::string(mnemonic) + " requires " + std::to_string(expected) + " operand(s)");
+
+    // Byte offsets of op1/op2 within the output (for fixups)
+    uint32_t at1 = out.size() + 1;
+    uint32_t at2 = out.size() + 3;
+    uint16_t op1 = 0, op2 = 0;
+
+    switch (info->enc) {
+        case Encoding::NONE:
+            break;
+
+        case Encoding::RD:
+        case Encoding::RS:
+            op1 = get_register_index(tokens[1]);
+            break;
+
+        case Encoding::ADDR:
+            op1 = place(parse_value(tokens[1]), at1);
+            break;
+
+        case Encoding::RD_IMM:
+        case Encoding::RS_IMM:
+            op1 = get_register_index(tokens[1]);
+            op2 = place(mem_operand ? offset : parse_value(tokens[2]), at2);
+            break;
+
+        case Encoding::RD_RS:
+            op1 = get_register_index(tokens[1]);
+            op2 = get_register_index(tokens[2]);
+            break;
+
+        case Encoding::RD_MEM:
+        case Encoding::RS_MEM:
+            if (!mem_operand || base < 0)
+                fail(std::string(mnemonic) + " requires a [Rb+off] operand");
+            op1 = get_register_index(tokens[1]) | (base << 8);
+            op2 = place(offset, at2);
+            break;
+
+        case Encoding::RD_RS_RC:
+            op1 = get_register_index(tokens[1]) | (get_register_index(tokens[2]) << 8);
+            op2 = get_register_index(tokens[3]);
+            break;
+    }
+
+    encode_instruction(info->opcode, op1, op2, out);
 }
 
 // ============================================================
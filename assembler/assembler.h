@@ -1,23 +1,139 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
 
+struct ObjectFile;
+
+// ============================================================
+// Assembler
+// Turns assembly source into 5-byte-per-instruction machine code.
+//
+// The source is parsed in a single pass over the text using
+// string_view tokens (no per-line or per-token allocation).
+// References to labels that are not yet defined are emitted as
+// zero and recorded as fixups, which are patched once the whole
+// source has been read.
+// ============================================================
 class Assembler {
 public:
+    // --------------------------------------------------------
+    // File to file. The input is mmap'd, not copied.
+    // --------------------------------------------------------
     bool assemble(const std::string &inputFile, const std::string &outputFile);
 
+    // --------------------------------------------------------
+    // In-memory: source text → machine code.
+    // Returns false on error; error() then holds "line N: ...".
+    // --------------------------------------------------------
+    bool assemble_source(std::string_view source, std::vector<uint8_t> &code);
+
+    // --------------------------------------------------------
+    // Relocatable: source text → object module for the linker.
+    // Labels named by ".global" are exported; labels that are
+    // never defined become imports instead of errors.
+    // --------------------------------------------------------
+    bool assemble_object(std::string_view source, ObjectFile &obj);
+
+    // Label → address map from the last successful assembly
+    const std::unordered_map<std::string, uint16_t> &symbols() const { return labels; }
+
+    // Error message from the last failed assembly
+    const std::string &error() const { return error_msg; }
+
+    // --------------------------------------------------------
+    // Peephole optimizer (off by default, "-O" in the CLI).
+    // Runs after parsing, before fixups are resolved:
+    //   - constant register propagation (reg operands → immediates,
+    //     reloads of a constant already held)
+    //   - redundant CMP elimination when ZF is already set and CF
+    //     is not read afterwards
+    //   - jump threading (jumps to unconditional jumps, jumps to
+    //     the next instruction)
+    //   - dead code removal after HALT/JMP/RET
+    // Labels are then re-laid out over the surviving code.
+    // --------------------------------------------------------
+    struct OptimizerStats {
+        int instructions_before = 0;
+        int instructions_after  = 0;
+        int cmp_removed         = 0;
+        int jumps_threaded      = 0;
+        int jumps_removed       = 0;
+        int dead_removed        = 0;
+        int constants_folded    = 0;
+        int constant_loads_removed = 0;
+        std::string skipped;     // reason if the program was left untouched
+    };
+
+    void set_optimize(bool on) { optimize_enabled = on; }
+    const OptimizerStats &optimizer_stats() const { return opt_stats; }
+
 private:
+    static constexpr uint32_t NO_SYMBOL = 0xFFFFFFFF;
+
+    struct Symbol {
+        std::string_view name;
+        uint16_t value = 0;
+        bool defined = false;
+        bool global = false;   // named by .global
+        int line = 0;          // first reference or definition
+    };
+
+    // 16-bit field at code[offset] that needs symbol + addend
+    struct Fixup {
+        uint32_t offset;
+        uint32_t symbol;
+        uint16_t addend;
+        int line;
+    };
+
+    // One instruction or data directive, in source order
+    struct Stmt {
+        uint32_t offset;
+        uint32_t size;
+        bool instr;
+    };
+
+    // A parsed operand value: number, or symbol (+/- addend)
+    struct Value {
+        uint32_t symbol = NO_SYMBOL;
+        uint16_t number = 0;
+    };
+
     std::unordered_map<std::string, uint16_t> labels;
+    std::string error_msg;
 
-    bool first_pass(const std::vector<std::string> &lines);
-    bool second_pass(const std::vector<std::string> &lines, std::vector<uint8_t> &output);
+    // Per-assembly state (views point into the source buffer)
+    std::unordered_map<std::string_view, uint32_t> symbol_index;
+    std::vector<Symbol> symbol_table;
+    std::vector<Fixup> fixups;
+    std::vector<Stmt> stmts;          // recorded only when optimizing
+    int line_no = 0;
 
-    void encode_instruction(uint8_t opcode, uint16_t op1, uint16_t op2,
-                            std::vector<uint8_t> &out);
+    bool optimize_enabled = false;
+    OptimizerStats opt_stats;
+
+    void reset();
+    bool parse(std::string_view source, std::vector<uint8_t> &out);
+    void assemble_line(std::string_view line, std::vector<uint8_t> &out);
+    void emit_directive(std::string_view name, std::string_view args, std::vector<uint8_t> &out);
+    void emit_instruction(std::string_view *tokens, size_t count, std::vector<uint8_t> &out);
+    bool resolve_fixups(std::vector<uint8_t> &out);
+    void optimize(std::vector<uint8_t> &out);     // optimizer.cpp
+
+    void define_label(std::string_view name, uint16_t pc);
+    uint32_t symbol_ref(std::string_view name);
 
     // Helpers
-    uint16_t parse_number(const std::string &s);
-    int get_register_index(const std::string &reg);
+    Value parse_value(std::string_view s);
+    uint16_t place(const Value &v, uint32_t offset);
+    int get_register_index(std::string_view reg);
+    bool parse_mem_operand(std::string_view tok, int &base, Value &offset);
+
+    [[noreturn]] void fail(const std::string &msg);
+
+    void encode_instruction(uint8_t opcode, uint16_t op1, uint16_t op2,
+                            std::vector<uint8_t> &out);
 };
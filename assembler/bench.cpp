@@ -0,0 +1,104 @@
+// ========================================================
+// bench.cpp – Assembler throughput benchmark
+// Generates a corpus of large assembly programs in memory
+// (each close to the 64 KB limit, with forward and backward
+// label references, comments and data) and measures how fast
+// Assembler::assemble_source() gets through it.
+//
+// Usage: ./asm_bench [total_megabytes] [repeats]
+// ========================================================
+
+#include "assembler.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ========================================================
+// generate_program()
+// One program of `blocks` loop bodies, ~60 KB of code.
+// ========================================================
+static std::string generate_program(int blocks, unsigned seed)
+{
+    static const char *alu[] = { "ADD", "SUB", "AND", "OR", "XOR", "MUL" };
+    static const char *imm[] = { "ADDI", "SUBI", "ANDI", "ORI", "CMPI", "MULI" };
+
+    std::string s;
+    s.reserve(blocks * 400);
+    s += "; generated benchmark program\n";
+    s += "        MOVI R0, 0\n        MOVI R5, table\n";
+
+    for (int b = 0; b < blocks; b++) {
+        seed = seed * 1103515245u + 12345u;
+        std::string n = std::to_string(b);
+
+        s += "block_" + n + ":\n";
+        s += "        MOVI R1, " + std::to_string(seed % 1000) + "      ; loop count\n";
+        s += "loop_" + n + ":\n";
+        s += "        " + std::string(alu[seed % 6]) + "  R0, R1\n";
+        s += "        " + std::string(imm[(seed >> 8) % 6]) + " R2, 0x" + std::to_string(seed % 9000) + "\n";
+        s += "        LOAD R3, [R5 + " + std::to_string((seed >> 4) % 32 * 2) + "]\n";
+        s += "        STORE R3, [R5+2]\n";
+        s += "        SUBI R1, 1\n";
+        s += "        JNZ  loop_" + n + "\n";
+        s += "        CALL helper_" + std::to_string((b + 7) % blocks) + "   ; forward or backward\n";
+        s += "        JMP  block_" + std::to_string(b + 1) + "\n";
+        s += "helper_" + n + ": RET\n";
+    }
+
+    s += "block_" + std::to_string(blocks) + ":\n        HALT\n";
+    s += "table:\n        .word 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16\n";
+    s += "        .word 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32\n";
+    s += "msg:    .asciz \"benchmark; done\\n\"\n";
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    double target_mb = argc > 1 ? std::atof(argv[1]) : 32.0;
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    // 10 instructions per block, 5 bytes each → ~1300 blocks fit in 64 KB
+    const int blocks = 1300;
+
+    std::vector<std::string> corpus;
+    size_t total = 0;
+    unsigned seed = 1;
+    while (total < target_mb * 1024 * 1024) {
+        corpus.push_back(generate_program(blocks, seed++));
+        total += corpus.back().size();
+    }
+
+    size_t lines = 0;
+    for (auto &p : corpus)
+        for (char c : p) lines += (c == '\n');
+
+    std::cout << "Corpus: " << corpus.size() << " programs, "
+              << total / (1024.0 * 1024.0) << " MB, " << lines << " lines\n";
+
+    Assembler as;
+    std::vector<uint8_t> code;
+    double best = 1e30;
+    size_t out_bytes = 0;
+
+    for (int r = 0; r < repeats; r++) {
+        out_bytes = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (auto &p : corpus) {
+            if (!as.assemble_source(p, code)) {
+                std::cerr << "Assembly failed: " << as.error() << "\n";
+                return 1;
+            }
+            out_bytes += code.size();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    std::cout << "Output: " << out_bytes << " bytes of machine code\n";
+    std::cout << "Best of " << repeats << ": " << best * 1000.0 << " ms, "
+              << (total / (1024.0 * 1024.0)) / best << " MB/s, "
+              << (lines / best) / 1e6 << " Mlines/s\n";
+    return 0;
+}
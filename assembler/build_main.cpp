@@ -0,0 +1,176 @@
+// ========================================================
+// build_main.cpp – Incremental parallel build driver
+// Assembles every module to a relocatable object in objdir,
+// reusing objects whose source hash has not changed, then
+// links them (in command-line order) into one .bin.
+//
+// Usage: ./asmbuild [-O] [-j N] [-d objdir] <output.bin> <module.asm> [...]
+// ========================================================
+
+#include "assembler.h"
+#include "linker.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <sys/stat.h>
+
+// One module of the build
+struct Unit {
+    std::string source_path;
+    std::string object_path;
+    ObjectFile obj;
+    bool rebuilt = false;
+    std::string error;
+};
+
+// ========================================================
+// object_name()
+// "fw/drivers/uart.asm" → "uart-<hash>.o", the hash taken over
+// the absolute, normalized source path: modules with the same
+// file name in different directories (or paths that only
+// differ in '/' vs '_') never share an object, and one module
+// named two ways ("./a.asm", "a.asm") keeps one.
+// ========================================================
+static std::string object_name(const std::string &source)
+{
+    std::filesystem::path path(source);
+    std::error_code ec;
+    std::filesystem::path full = std::filesystem::absolute(path, ec);
+    if (ec) full = path;
+    std::string key = full.lexically_normal().generic_string();
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)content_hash(key));
+    return path.stem().string() + "-" + hex + ".o";
+}
+
+// ========================================================
+// build_unit()
+// Reuse the object if it was built from the same source with
+// the same flags; otherwise assemble and write it.
+// ========================================================
+static void build_unit(Unit &u, bool optimize, uint64_t flags_hash)
+{
+    std::ifstream in(u.source_path, std::ios::binary);
+    if (!in) {
+        u.error = "cannot open";
+        return;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string source = text.str();
+
+    uint64_t hash = content_hash(source, flags_hash);
+    if (read_object(u.object_path, u.obj) && u.obj.source_hash == hash)
+        return;
+
+    Assembler as;
+    as.set_optimize(optimize);
+    if (!as.assemble_object(source, u.obj)) {
+        u.error = as.error();
+        return;
+    }
+    u.obj.source_hash = hash;
+    if (!write_object(u.object_path, u.obj)) {
+        u.error = "cannot write " + u.object_path;
+        return;
+    }
+    u.rebuilt = true;
+}
+
+int main(int argc, char** argv) {
+    bool optimize = false;
+    unsigned jobs = std::thread::hardware_concurrency();
+    std::string objdir = "obj";
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        std::string flag = argv[arg];
+        if (flag == "-O") optimize = true;
+        else if (flag == "-j" && arg + 1 < argc) jobs = std::stoul(argv[++arg]);
+        else if (flag == "-d" && arg + 1 < argc) objdir = argv[++arg];
+        else break;
+    }
+
+    if (argc - arg < 2) {
+        std::cout << "Usage: asmbuild [-O] [-j N] [-d objdir] <output.bin> <module.asm> [...]\n";
+        return 1;
+    }
+    if (jobs == 0) jobs = 1;
+
+    if (mkdir(objdir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Error: cannot create " << objdir << "\n";
+        return 1;
+    }
+
+    std::string outputFile = argv[arg++];
+    std::vector<Unit> units;
+    for (; arg < argc; arg++) {
+        Unit u;
+        u.source_path = argv[arg];
+        u.object_path = objdir + "/" + object_name(u.source_path);
+        units.push_back(std::move(u));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // ----------------------------------------------------
+    // Assemble: workers pull the next module index
+    // ----------------------------------------------------
+    uint64_t flags_hash = content_hash(optimize ? "-O" : "");
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i; (i = next++) < units.size(); )
+            build_unit(units[i], optimize, flags_hash);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < jobs && t < units.size(); t++) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+
+    int rebuilt = 0;
+    bool failed = false;
+    for (const Unit &u : units) {
+        if (!u.error.empty()) {
+            std::cerr << u.source_path << ": " << u.error << "\n";
+            failed = true;
+        }
+        if (u.rebuilt) rebuilt++;
+    }
+    if (failed) {
+        std::cerr << "Build failed.\n";
+        return 1;
+    }
+
+    // ----------------------------------------------------
+    // Link
+    // ----------------------------------------------------
+    Linker linker;
+    for (Unit &u : units) linker.add(u.source_path, std::move(u.obj));
+
+    std::vector<uint8_t> image;
+    if (!linker.link(image)) {
+        std::cerr << "Error: " << linker.error() << "\n";
+        std::cerr << "Build failed.\n";
+        return 1;
+    }
+
+    std::ofstream fout(outputFile, std::ios::binary);
+    fout.write((char*)image.data(), image.size());
+    fout.close();
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Built " << outputFile << " (" << image.size() << " bytes) from "
+              << units.size() << " module(s): " << rebuilt << " assembled, "
+              << units.size() - rebuilt << " up to date, " << ms << " ms\n";
+    return 0;
+}
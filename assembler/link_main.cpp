@@ -0,0 +1,69 @@
+#include "linker.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+// ------------------------------------------------------------
+// Write "address  symbol" lines, sorted by address
+// ------------------------------------------------------------
+static bool write_map(const std::string &path, const Linker &linker)
+{
+    std::ofstream out(path);
+    if (!out) return false;
+
+    std::multimap<uint16_t, std::string> sorted;
+    for (const auto &s : linker.symbols()) sorted.emplace(s.second, s.first);
+
+    char addr[8];
+    for (const auto &s : sorted) {
+        snprintf(addr, sizeof(addr), "0x%04X", s.first);
+        out << addr << "  " << s.second << "\n";
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string mapFile;
+    int arg = 1;
+    if (argc > 2 && std::string(argv[1]) == "-m") {
+        mapFile = argv[2];
+        arg += 2;
+    }
+
+    if (argc - arg < 2) {
+        std::cout << "Usage: linker [-m map.txt] <output.bin> <module.o> [module.o ...]\n";
+        return 1;
+    }
+
+    std::string outputFile = argv[arg++];
+
+    Linker linker;
+    for (; arg < argc; arg++) {
+        ObjectFile obj;
+        if (!read_object(argv[arg], obj)) {
+            std::cerr << "Error: " << argv[arg] << ": not a valid object file\n";
+            return 1;
+        }
+        linker.add(argv[arg], std::move(obj));
+    }
+
+    std::vector<uint8_t> image;
+    if (!linker.link(image)) {
+        std::cerr << "Error: " << linker.error() << "\n";
+        std::cerr << "Link failed.\n";
+        return 1;
+    }
+
+    std::ofstream fout(outputFile, std::ios::binary);
+    fout.write((char*)image.data(), image.size());
+    fout.close();
+
+    if (!mapFile.empty() && !write_map(mapFile, linker)) {
+        std::cerr << "Error: cannot write " << mapFile << "\n";
+        return 1;
+    }
+
+    std::cout << "Link successful! " << image.size() << " bytes written to: " << outputFile << "\n";
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "linker.h"
+#include "../cpu/common.h"
+
+void Linker::add(const std::string &name, ObjectFile obj)
+{
+    modules.push_back({ name, std::move(obj) });
+}
+
+// ============================================================
+// Layout → symbol table → relocation
+// ============================================================
+bool Linker::link(std::vector<uint8_t> &image)
+{
+    image.clear();
+    module_base.clear();
+    globals.clear();
+    owner.clear();
+    error_msg.clear();
+
+    // ---- layout ----
+    size_t total = 0;
+    for (const Module &m : modules) {
+        module_base.push_back(total);
+        total += m.obj.code.size();
+        if (total > (size_t)MEM_SIZE) {
+            error_msg = m.name + ": program exceeds 64 KB address space";
+            return false;
+        }
+    }
+
+    // ---- exports ----
+    for (size_t i = 0; i < modules.size(); i++) {
+        for (const auto &e : modules[i].obj.exports) {
+            auto ins = owner.emplace(e.name, i);
+            if (!ins.second) {
+                error_msg = modules[i].name + ": duplicate symbol " + e.name +
+                            " (also defined in " + modules[ins.first->second].name + ")";
+                return false;
+            }
+            globals[e.name] = module_base[i] + e.value;
+        }
+    }
+
+    // ---- copy + patch ----
+    image.reserve(total);
+    for (size_t i = 0; i < modules.size(); i++) {
+        const ObjectFile &obj = modules[i].obj;
+        size_t at = image.size();
+        image.insert(image.end(), obj.code.begin(), obj.code.end());
+
+        // Imports resolved once per module, not per relocation
+        std::vector<uint16_t> resolved(obj.imports.size());
+        for (size_t k = 0; k < obj.imports.size(); k++) {
+            auto it = globals.find(obj.imports[k]);
+            if (it == globals.end()) {
+                error_msg = modules[i].name + ": undefined symbol " + obj.imports[k];
+                return false;
+            }
+            resolved[k] = it->second;
+        }
+
+        for (const ObjectFile::Reloc &r : obj.relocs) {
+            uint16_t v = r.addend;
+            v += (r.kind == ObjectFile::RelocKind::SECTION) ? module_base[i] : resolved[r.index];
+            image[at + r.offset]     = v & 0xFF;
+            image[at + r.offset + 1] = (v >> 8) & 0xFF;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "object.h"
+
+// ============================================================
+// Linker
+// Lays object modules out back to back from address 0 in the
+// order they were added (the first module holds the entry
+// point), resolves imports against exports and patches every
+// relocation.
+// ============================================================
+class Linker {
+public:
+    // name is only used in error messages
+    void add(const std::string &name, ObjectFile obj);
+
+    // Returns false on error; error() then names the module
+    bool link(std::vector<uint8_t> &image);
+
+    // Exported symbol → absolute address after a successful link
+    const std::unordered_map<std::string, uint16_t> &symbols() const { return globals; }
+
+    // Load address of every module, in link order
+    const std::vector<uint16_t> &bases() const { return module_base; }
+
+    const std::string &error() const { return error_msg; }
+
+private:
+    struct Module {
+        std::string name;
+        ObjectFile obj;
+    };
+
+    std::vector<Module> modules;
+    std::vector<uint16_t> module_base;
+    std::unordered_map<std::string, uint16_t> globals;
+    std::unordered_map<std::string, size_t> owner;    // export → module
+    std::string error_msg;
+};
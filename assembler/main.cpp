@@ -1,20 +1,86 @@
 #include "assembler.h"
+#include "object.h"
+#include <fstream>
 #include <iostream>
+#include <sstream>
+
+// ------------------------------------------------------------
+// Print what the -O pass did
+// ------------------------------------------------------------
+static void print_report(const Assembler::OptimizerStats &s) {
+    if (!s.skipped.empty()) {
+        std::cout << "Optimizer skipped: " << s.skipped << "\n";
+        return;
+    }
+
+    std::cout << "Optimizer: " << s.instructions_before << " -> "
+              << s.instructions_after << " instructions ("
+              << s.instructions_before - s.instructions_after << " removed)\n"
+              << "  redundant CMP removed:     " << s.cmp_removed << "\n"
+              << "  jumps threaded:            " << s.jumps_threaded << "\n"
+              << "  jumps to next removed:     " << s.jumps_removed << "\n"
+              << "  dead instructions removed: " << s.dead_removed << "\n"
+              << "  constant operands folded:  " << s.constants_folded << "\n"
+              << "  constant reloads removed:  " << s.constant_loads_removed << "\n";
+}
+
+// ------------------------------------------------------------
+// -c: assemble to a relocatable object for the linker
+// ------------------------------------------------------------
+static bool assemble_to_object(Assembler &assembler, const std::string &inputFile,
+                               const std::string &outputFile) {
+    std::ifstream in(inputFile, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Cannot open ASM file.\n";
+        return false;
+    }
+    std::stringstream source;
+    source << in.rdbuf();
+
+    ObjectFile obj;
+    if (!assembler.assemble_object(source.str(), obj)) {
+        std::cerr << "Error: " << assembler.error() << "\n";
+        return false;
+    }
+    if (!write_object(outputFile, obj)) {
+        std::cerr << "Error: Cannot write " << outputFile << "\n";
+        return false;
+    }
+
+    std::cout << "Assembly successful! Object written to: " << outputFile << "\n";
+    return true;
+}
 
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        std::cout << "Usage: assembler <input.asm> <output.bin>\n";
+    bool optimize = false;
+    bool object = false;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        std::string flag = argv[arg];
+        if (flag == "-O") optimize = true;
+        else if (flag == "-c") object = true;
+        else break;
+    }
+
+    if (argc - arg != 2) {
+        std::cout << "Usage: assembler [-O] [-c] <input.asm> <output.bin|output.o>\n";
         return 1;
     }
 
-    std::string inputFile  = argv[1];
-    std::string outputFile = argv[2];
+    std::string inputFile  = argv[arg];
+    std::string outputFile = argv[arg + 1];
 
     Assembler assembler;
-    if (!assembler.assemble(inputFile, outputFile)) {
+    assembler.set_optimize(optimize);
+    bool ok = object ? assemble_to_object(assembler, inputFile, outputFile)
+                     : assembler.assemble(inputFile, outputFile);
+    if (!ok) {
         std::cerr << "Assembly failed.\n";
         return 1;
     }
 
+    if (optimize)
+        print_report(assembler.optimizer_stats());
+
     return 0;
 }
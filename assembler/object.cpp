@@ -0,0 +1,162 @@
+#include "object.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+static const char MAGIC[5] = { 'S', 'C', 'O', 'B', 'J' };
+static const uint8_t VERSION = 1;
+
+// ------------------------------------------------------------
+// Little-endian writer / bounds-checked reader
+// ------------------------------------------------------------
+namespace {
+
+struct Writer {
+    std::vector<uint8_t> buf;
+
+    void u8(uint8_t v)   { buf.push_back(v); }
+    void u16(uint16_t v) { u8(v & 0xFF); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; i++) u8((v >> (8 * i)) & 0xFF); }
+    void name(const std::string &s) {
+        u16(s.size());
+        buf.insert(buf.end(), s.begin(), s.end());
+    }
+};
+
+struct Reader {
+    const std::vector<uint8_t> &buf;
+    size_t pos = 0;
+    bool ok = true;
+
+    bool need(size_t n) {
+        if (pos + n > buf.size()) ok = false;
+        return ok;
+    }
+    uint8_t u8() { return need(1) ? buf[pos++] : 0; }
+    uint16_t u16() {
+        if (!need(2)) return 0;
+        uint16_t v = buf[pos] | (buf[pos + 1] << 8);
+        pos += 2;
+        return v;
+    }
+    uint32_t u32() {
+        uint32_t lo = u16();
+        return lo | ((uint32_t)u16() << 16);
+    }
+    uint64_t u64() {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++) v |= (uint64_t)u8() << (8 * i);
+        return v;
+    }
+    std::string name() {
+        uint16_t n = u16();
+        if (!need(n)) return {};
+        std::string s(buf.begin() + pos, buf.begin() + pos + n);
+        pos += n;
+        return s;
+    }
+};
+
+} // namespace
+
+// ============================================================
+// Serialize
+// ============================================================
+bool write_object(const std::string &path, const ObjectFile &obj)
+{
+    Writer w;
+    w.buf.insert(w.buf.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    w.u8(VERSION);
+    w.u64(obj.source_hash);
+
+    w.u32(obj.code.size());
+    w.buf.insert(w.buf.end(), obj.code.begin(), obj.code.end());
+
+    w.u16(obj.exports.size());
+    for (const auto &e : obj.exports) {
+        w.name(e.name);
+        w.u16(e.value);
+    }
+
+    w.u16(obj.imports.size());
+    for (const auto &name : obj.imports) w.name(name);
+
+    w.u16(obj.relocs.size());
+    for (const auto &r : obj.relocs) {
+        w.u16(r.offset);
+        w.u8((uint8_t)r.kind);
+        w.u16(r.index);
+        w.u16(r.addend);
+    }
+
+    // Write to a temporary and rename, so a parallel or interrupted
+    // build never leaves a half-written object behind
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if (!out) return false;
+        out.write((const char*)w.buf.data(), w.buf.size());
+        if (!out) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// ============================================================
+// Deserialize
+// ============================================================
+bool read_object(const std::string &path, ObjectFile &obj)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Reader r{ buf };
+    for (char c : MAGIC)
+        if (r.u8() != (uint8_t)c) return false;
+    if (r.u8() != VERSION) return false;
+
+    obj = ObjectFile();
+    obj.source_hash = r.u64();
+
+    uint32_t size = r.u32();
+    if (size > 0x10000 || !r.need(size)) return false;
+    obj.code.assign(buf.begin() + r.pos, buf.begin() + r.pos + size);
+    r.pos += size;
+
+    obj.exports.resize(r.u16());
+    for (auto &e : obj.exports) {
+        e.name = r.name();
+        e.value = r.u16();
+    }
+
+    obj.imports.resize(r.u16());
+    for (auto &name : obj.imports) name = r.name();
+
+    obj.relocs.resize(r.u16());
+    for (auto &rel : obj.relocs) {
+        rel.offset = r.u16();
+        rel.kind = (ObjectFile::RelocKind)r.u8();
+        rel.index = r.u16();
+        rel.addend = r.u16();
+
+        if (rel.offset + 2u > obj.code.size() || rel.kind > ObjectFile::RelocKind::EXTERN ||
+            (rel.kind == ObjectFile::RelocKind::EXTERN && rel.index >= obj.imports.size()))
+            return false;
+    }
+
+    return r.ok && r.pos == buf.size();
+}
+
+// ============================================================
+// FNV-1a
+// ============================================================
+uint64_t content_hash(std::string_view data, uint64_t seed)
+{
+    uint64_t h = seed;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ============================================================
+// Relocatable object file
+// One assembled module whose code starts at address 0. The
+// linker places it at some base and patches every 16-bit
+// operand that holds an address.
+//
+// On disk (all integers little-endian):
+//   "SCOBJ" version:u8 source_hash:u64
+//   code_size:u32 code[code_size]
+//   n:u16 { name export_value:u16 }        exports
+//   n:u16 { name }                         imports
+//   n:u16 { offset:u16 kind:u8 index:u16 addend:u16 }
+// where name = len:u16 chars[len].
+// ============================================================
+struct ObjectFile {
+    enum class RelocKind : uint8_t {
+        SECTION,    // module-relative address: base + addend
+        EXTERN,     // imported symbol: imports[index] + addend
+    };
+
+    struct Export {
+        std::string name;
+        uint16_t value = 0;        // module-relative
+    };
+
+    struct Reloc {
+        uint16_t offset = 0;       // byte offset of the 16-bit field
+        RelocKind kind = RelocKind::SECTION;
+        uint16_t index = 0;        // into imports (EXTERN only)
+        uint16_t addend = 0;
+    };
+
+    uint64_t source_hash = 0;      // set by the build driver
+    std::vector<uint8_t> code;
+    std::vector<Export> exports;
+    std::vector<std::string> imports;
+    std::vector<Reloc> relocs;
+};
+
+bool write_object(const std::string &path, const ObjectFile &obj);
+
+// Returns false on a missing, truncated or foreign file
+bool read_object(const std::string &path, ObjectFile &obj);
+
+// 64-bit FNV-1a over a byte string (build cache keys)
+uint64_t content_hash(std::string_view data, uint64_t seed = 0xcbf29ce484222325ULL);
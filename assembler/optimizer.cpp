@@ -0,0 +1,550 @@
+#include "assembler.h"
+#include "../cpu/isa.h"
+#include <cstring>
+
+// ============================================================
+// Peephole optimizer
+// Works on the parsed program (statements + fixups + labels)
+// before fixups are resolved, so every label reference is still
+// symbolic and the code can be re-laid out freely afterwards.
+// ============================================================
+
+namespace {
+
+const uint32_t NONE = 0xFFFFFFFF;
+
+enum FlagBit : uint8_t { FLAG_ZF = 1, FLAG_CF = 2 };
+
+// One instruction or data statement
+struct Node {
+    bool instr = false;
+    bool removed = false;
+    uint32_t offset = 0;     // original byte offset
+    uint32_t size = 0;
+    uint8_t opcode = 0;
+    uint16_t op1 = 0, op2 = 0;
+    uint32_t ref = NONE;     // label operand of an instruction (index into refs)
+};
+
+// A label reference, relative to the node that contains it
+struct Ref {
+    uint32_t node;
+    uint32_t rel;            // byte offset inside the node
+    uint32_t symbol;
+    uint16_t addend;
+    int line;
+};
+
+// Known register constants at a program point
+struct ConstState {
+    bool reached = false;
+    bool known[REG_COUNT] = {};
+    uint16_t value[REG_COUNT] = {};
+
+    // Merge another incoming state; true if this one changed
+    bool meet(const ConstState &in) {
+        if (!in.reached) return false;
+        if (!reached) { *this = in; return true; }
+        bool changed = false;
+        for (int r = 0; r < REG_COUNT; r++) {
+            if (known[r] && (!in.known[r] || in.value[r] != value[r])) {
+                known[r] = false;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    static ConstState unknown() {
+        ConstState s;
+        s.reached = true;
+        return s;
+    }
+};
+
+// ALU result for constant folding (matches ALU semantics)
+bool fold(ALUOp op, uint16_t a, uint16_t b, uint16_t &r) {
+    switch (op) {
+        case ALUOp::ADD:  r = a + b; return true;
+        case ALUOp::SUB:  r = a - b; return true;
+        case ALUOp::AND_: r = a & b; return true;
+        case ALUOp::OR_:  r = a | b; return true;
+        case ALUOp::XOR_: r = a ^ b; return true;
+        case ALUOp::MUL:  r = a * b; return true;
+        case ALUOp::DIV:  r = b ? a / b : 0xFFFF; return true;
+        case ALUOp::MOD:  r = b ? a % b : a; return true;
+        default: return false;
+    }
+}
+
+// Immediate-operand opcode for an ALU operation
+uint8_t immediate_form(ALUOp op) {
+    for (const InstrInfo &info : ISA_TABLE)
+        if (info.type == InstrType::ALU_REG_IMM && info.alu_op == op)
+            return info.opcode;
+    return 0;
+}
+
+class Peephole {
+public:
+    std::vector<Node> nodes;
+    std::vector<Ref> refs;
+    std::vector<uint32_t> sym_node;   // node each label is attached to (nodes.size() = end,
+                                      // NONE = imported from another module)
+    std::vector<bool> sym_global;     // exported: callable from other modules
+
+    int cmp_removed = 0, jumps_threaded = 0, jumps_removed = 0;
+    int dead_removed = 0, constants_folded = 0, constant_loads_removed = 0;
+
+    void run() {
+        for (int round = 0; round < 8; round++) {
+            int before = total();
+            compute_labels();
+            propagate_constants();
+            compute_labels();
+            remove_redundant_cmp();
+            compute_labels();
+            thread_jumps();
+            compute_labels();
+            remove_dead_code();
+            if (total() == before) break;
+        }
+    }
+
+private:
+    std::vector<bool> labeled;   // a label resolves to this node
+    std::vector<bool> entry;     // reachable other than by fallthrough/jump (CALL target, address taken)
+
+    int total() const {
+        return cmp_removed + jumps_threaded + jumps_removed + dead_removed +
+               constants_folded + constant_loads_removed;
+    }
+
+    const DecodeEntry &info(const Node &n) const { return DECODE_TABLE[n.opcode]; }
+
+    size_t end() const { return nodes.size(); }
+
+    // First surviving node at or after i
+    size_t live(size_t i) const {
+        while (i < end() && nodes[i].removed) i++;
+        return i;
+    }
+
+    // First surviving node before i, or NONE
+    uint32_t prev_live(size_t i) const {
+        while (i > 0) {
+            i--;
+            if (!nodes[i].removed) return i;
+        }
+        return NONE;
+    }
+
+    // Branch/call target node, or NONE for an absolute address
+    // or an imported label
+    size_t target(const Node &n) const {
+        if (n.ref == NONE || sym_node[refs[n.ref].symbol] == NONE) return NONE;
+        return live(sym_node[refs[n.ref].symbol]);
+    }
+
+    void compute_labels() {
+        labeled.assign(end() + 1, false);
+        entry.assign(end() + 1, false);
+        for (uint32_t s = 0; s < sym_node.size(); s++) {
+            if (sym_node[s] == NONE) continue;
+            labeled[live(sym_node[s])] = true;
+            if (sym_global[s]) entry[live(sym_node[s])] = true;
+        }
+
+        entry[live(0)] = true;
+        for (const Ref &r : refs) {
+            if (nodes[r.node].removed || sym_node[r.symbol] == NONE) continue;
+            const Node &n = nodes[r.node];
+            InstrType t = info(n).type;
+            bool branch = n.instr && (t == InstrType::JUMP || t == InstrType::JUMP_COND);
+            if (!branch) entry[live(sym_node[r.symbol])] = true;
+        }
+    }
+
+    // --------------------------------------------------------
+    // Is `flag` read before being overwritten, starting at node i?
+    // Conservative: anything unknown counts as a read.
+    // --------------------------------------------------------
+    bool flag_live(uint8_t flag, size_t i, int depth = 0) const {
+        for (;;) {
+            i = live(i);
+            if (depth > 24 || i >= end()) return true;
+
+            const Node &n = nodes[i];
+            if (!n.instr) return true;
+
+            const DecodeEntry &e = info(n);
+            if (e.type == InstrType::JUMP_COND) {
+                uint8_t reads = (e.cond == Cond::Z || e.cond == Cond::NZ) ? FLAG_ZF : FLAG_CF;
+                if (reads & flag) return true;
+            }
+
+            uint8_t writes = 0;
+            if (e.type == InstrType::ALU_REG_REG || e.type == InstrType::ALU_REG_IMM)
+                writes = FLAG_ZF | FLAG_CF;
+            if (e.type == InstrType::REG_IMM || e.type == InstrType::REG_REG)
+                writes = FLAG_ZF;
+            if (writes & flag) return false;
+
+            switch (e.type) {
+                case InstrType::HALT:
+                    return false;
+                case InstrType::RET:
+                case InstrType::IRET:
+                case InstrType::CALL:
+                case InstrType::NONE:
+                    return true;
+                case InstrType::JUMP: {
+                    size_t t = target(n);
+                    if (t == NONE) return true;
+                    i = t;
+                    depth++;
+                    continue;
+                }
+                case InstrType::JUMP_COND: {
+                    size_t t = target(n);
+                    if (t == NONE || flag_live(flag, t, depth + 1)) return true;
+                    i++;
+                    depth++;
+                    continue;
+                }
+                default:
+                    i++;
+                    continue;
+            }
+        }
+    }
+
+    // --------------------------------------------------------
+    // Forward dataflow of register constants, then rewrite
+    //   ALU Rd, Rs  (Rs known)  → ALUI Rd, k
+    //   MOV Rd, Rs  (Rs known)  → MOVI Rd, k
+    //   MOVI Rd, k  (Rd == k already, ZF dead) → removed
+    // --------------------------------------------------------
+    void transfer(const Node &n, ConstState &s) const {
+        const DecodeEntry &e = info(n);
+        switch (e.type) {
+            case InstrType::REG_IMM:
+                s.known[n.op1] = (n.ref == NONE);
+                s.value[n.op1] = n.op2;
+                break;
+            case InstrType::REG_REG:
+                s.known[n.op1] = s.known[n.op2];
+                s.value[n.op1] = s.value[n.op2];
+                break;
+            case InstrType::ALU_REG_REG:
+            case InstrType::ALU_REG_IMM: {
+                if (e.alu_op == ALUOp::CMP) break;
+                bool imm = e.type == InstrType::ALU_REG_IMM;
+                bool b_known = imm ? (n.ref == NONE) : s.known[n.op2];
+                uint16_t b = imm ? n.op2 : s.value[n.op2];
+                uint16_t r;
+                s.known[n.op1] = s.known[n.op1] && b_known && fold(e.alu_op, s.value[n.op1], b, r);
+                if (s.known[n.op1]) s.value[n.op1] = r;
+                break;
+            }
+            case InstrType::LOAD_WORD:
+            case InstrType::POP_REG:
+            case InstrType::READ_SP:
+                s.known[n.op1] = false;
+                break;
+            case InstrType::LOAD_INDEXED:
+                s.known[n.op1 & 0xFF] = false;
+                break;
+            case InstrType::CALL:
+                s = ConstState::unknown();
+                break;
+            default:
+                break;
+        }
+    }
+
+    void propagate_constants() {
+        std::vector<ConstState> in(end() + 1);
+        std::vector<size_t> work;
+
+        for (size_t i = 0; i < end(); i++) {
+            if (!nodes[i].removed && entry[i]) {
+                in[i] = ConstState::unknown();
+                work.push_back(i);
+            }
+        }
+
+        auto flow = [&](size_t to, const ConstState &s) {
+            to = live(to);
+            if (to < end() && in[to].meet(s)) work.push_back(to);
+        };
+
+        while (!work.empty()) {
+            size_t i = work.back();
+            work.pop_back();
+
+            const Node &n = nodes[i];
+            if (!n.instr) continue;
+
+            ConstState s = in[i];
+            transfer(n, s);
+
+            switch (info(n).type) {
+                case InstrType::HALT:
+                case InstrType::RET:
+                case InstrType::IRET:
+                case InstrType::NONE:
+                    break;
+                case InstrType::JUMP:
+                    if (target(n) != NONE) flow(target(n), s);
+                    break;
+                case InstrType::JUMP_COND:
+                    if (target(n) != NONE) flow(target(n), s);
+                    flow(i + 1, s);
+                    break;
+                default:
+                    flow(i + 1, s);
+                    break;
+            }
+        }
+
+        for (size_t i = 0; i < end(); i++) {
+            Node &n = nodes[i];
+            if (n.removed || !n.instr || !in[i].reached) continue;
+
+            const ConstState &s = in[i];
+            const DecodeEntry &e = info(n);
+
+            if (e.type == InstrType::ALU_REG_REG && s.known[n.op2]) {
+                n.opcode = immediate_form(e.alu_op);
+                n.op2 = s.value[n.op2];
+                constants_folded++;
+            }
+            else if (e.type == InstrType::REG_REG && s.known[n.op2]) {
+                n.opcode = OP_MOVI;
+                n.op2 = s.value[n.op2];
+                constants_folded++;
+            }
+            else if (e.type == InstrType::REG_IMM && n.ref == NONE &&
+                     s.known[n.op1] && s.value[n.op1] == n.op2 &&
+                     !flag_live(FLAG_ZF, i + 1)) {
+                n.removed = true;
+                constant_loads_removed++;
+            }
+        }
+    }
+
+    // --------------------------------------------------------
+    // CMPI Rx, 0 right after an instruction that already set
+    // ZF from Rx, when nobody reads the CF it would clear
+    // --------------------------------------------------------
+    void remove_redundant_cmp() {
+        for (size_t i = 0; i < end(); i++) {
+            Node &n = nodes[i];
+            if (n.removed || !n.instr || labeled[i] || entry[i]) continue;
+            if (n.opcode != OP_CMPI || n.op2 != 0 || n.ref != NONE) continue;
+
+            uint32_t p = prev_live(i);
+            if (p == NONE || !nodes[p].instr) continue;
+
+            const Node &pn = nodes[p];
+            const DecodeEntry &pe = info(pn);
+            bool sets_zf_from_rd =
+                ((pe.type == InstrType::ALU_REG_REG || pe.type == InstrType::ALU_REG_IMM) &&
+                 pe.alu_op != ALUOp::CMP) ||
+                pe.type == InstrType::REG_IMM || pe.type == InstrType::REG_REG;
+
+            if (!sets_zf_from_rd || pn.op1 != n.op1) continue;
+            if (flag_live(FLAG_CF, i + 1)) continue;
+
+            n.removed = true;
+            cmp_removed++;
+        }
+    }
+
+    // --------------------------------------------------------
+    // Jumps to unconditional jumps go straight to the final
+    // target; jumps to the next instruction disappear.
+    // --------------------------------------------------------
+    void thread_jumps() {
+        for (size_t i = 0; i < end(); i++) {
+            Node &n = nodes[i];
+            if (n.removed || !n.instr || n.ref == NONE || refs[n.ref].addend != 0) continue;
+
+            InstrType t = info(n).type;
+            if (t != InstrType::JUMP && t != InstrType::JUMP_COND && t != InstrType::CALL) continue;
+
+            for (int hops = 0; hops < 16; hops++) {
+                size_t to = target(n);
+                if (to >= end() || to == i) break;
+
+                const Node &tn = nodes[to];
+                if (!tn.instr || info(tn).type != InstrType::JUMP || tn.ref == NONE ||
+                    refs[tn.ref].addend != 0 || target(tn) == to)
+                    break;
+
+                refs[n.ref].symbol = refs[tn.ref].symbol;
+                jumps_threaded++;
+            }
+
+            if (t != InstrType::CALL && target(n) == live(i + 1)) {
+                n.removed = true;
+                jumps_removed++;
+            }
+        }
+    }
+
+    // --------------------------------------------------------
+    // Unlabeled instructions after HALT/JMP/RET/IRET can never run
+    // --------------------------------------------------------
+    void remove_dead_code() {
+        for (size_t i = 0; i < end(); i++) {
+            const Node &n = nodes[i];
+            if (n.removed || !n.instr) continue;
+
+            InstrType t = info(n).type;
+            if (t != InstrType::HALT && t != InstrType::JUMP && t != InstrType::RET &&
+                t != InstrType::IRET) continue;
+
+            for (size_t j = live(i + 1); j < end(); j = live(j + 1)) {
+                if (!nodes[j].instr || labeled[j] || entry[j]) break;
+                nodes[j].removed = true;
+                dead_removed++;
+            }
+        }
+    }
+};
+
+} // namespace
+
+// ============================================================
+// Assembler::optimize()
+// Build the node list, check it is safe to move code, run the
+// passes, then re-emit code, labels and fixups.
+// ============================================================
+void Assembler::optimize(std::vector<uint8_t> &out)
+{
+    Peephole p;
+
+    // ---- statements → nodes ----
+    for (const Stmt &st : stmts) {
+        Node n;
+        n.instr = st.instr;
+        n.offset = st.offset;
+        n.size = st.size;
+        if (st.instr) {
+            n.opcode = out[st.offset];
+            n.op1 = out[st.offset + 1] | (out[st.offset + 2] << 8);
+            n.op2 = out[st.offset + 3] | (out[st.offset + 4] << 8);
+            opt_stats.instructions_before++;
+        }
+        p.nodes.push_back(n);
+    }
+    opt_stats.instructions_after = opt_stats.instructions_before;
+
+    // Node containing a byte offset (nodes are sorted by offset)
+    auto node_at = [&](uint32_t offset) -> uint32_t {
+        size_t lo = 0, hi = p.nodes.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (p.nodes[mid].offset + p.nodes[mid].size <= offset) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    };
+
+    // Labels attach to the first statement at or after their address
+    // (undefined ones are imports of an object module; in a flat
+    // program resolve_fixups reports them afterwards)
+    p.sym_node.assign(symbol_table.size(), NONE);
+    p.sym_global.assign(symbol_table.size(), false);
+    for (uint32_t s = 0; s < symbol_table.size(); s++) {
+        p.sym_global[s] = symbol_table[s].global;
+        if (!symbol_table[s].defined) continue;
+        uint32_t at = symbol_table[s].value;
+        size_t lo = 0, hi = p.nodes.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (p.nodes[mid].offset < at) lo = mid + 1; else hi = mid;
+        }
+        p.sym_node[s] = lo;
+    }
+
+    for (const Fixup &f : fixups) {
+        uint32_t k = node_at(f.offset);
+        Node &n = p.nodes[k];
+        uint32_t target = p.sym_node[f.symbol];
+        bool into_code = target < p.nodes.size() && p.nodes[target].instr;
+
+        if (f.addend != 0 && into_code) {
+            opt_stats.skipped = "label arithmetic into code";
+            return;
+        }
+        if (n.instr) {
+            InstrType t = DECODE_TABLE[n.opcode].type;
+            bool writes = t == InstrType::STORE_WORD || t == InstrType::STORE_INDEXED;
+            if (writes && into_code) {
+                opt_stats.skipped = "code is written as data";
+                return;
+            }
+            n.ref = p.refs.size();
+        }
+        p.refs.push_back({ k, f.offset - n.offset, f.symbol, f.addend, f.line });
+    }
+
+    for (const Node &n : p.nodes) {
+        InstrType t = DECODE_TABLE[n.opcode].type;
+        bool branch = t == InstrType::JUMP || t == InstrType::JUMP_COND || t == InstrType::CALL;
+        if (n.instr && branch && n.ref == NONE) {
+            opt_stats.skipped = "absolute jump target";
+            return;
+        }
+    }
+
+    p.run();
+
+    // ---- re-layout ----
+    std::vector<uint32_t> new_offset(p.nodes.size() + 1);
+    std::vector<uint8_t> code;
+    code.reserve(out.size());
+
+    for (size_t i = 0; i < p.nodes.size(); i++) {
+        const Node &n = p.nodes[i];
+        new_offset[i] = code.size();
+        if (n.removed) continue;
+
+        if (n.instr) {
+            uint16_t op1 = n.op1, op2 = n.op2;
+            if (n.ref != NONE) {
+                if (p.refs[n.ref].rel == 1) op1 = 0; else op2 = 0;
+            }
+            encode_instruction(n.opcode, op1, op2, code);
+        } else {
+            code.insert(code.end(), out.begin() + n.offset, out.begin() + n.offset + n.size);
+        }
+    }
+    new_offset[p.nodes.size()] = code.size();
+
+    for (uint32_t s = 0; s < symbol_table.size(); s++)
+        if (p.sym_node[s] != NONE) symbol_table[s].value = new_offset[p.sym_node[s]];
+
+    fixups.clear();
+    for (const Ref &r : p.refs) {
+        if (p.nodes[r.node].removed) continue;
+        fixups.push_back({ new_offset[r.node] + r.rel, r.symbol, r.addend, r.line });
+    }
+
+    out.swap(code);
+
+    int removed = 0;
+    for (const Node &n : p.nodes)
+        if (n.instr && n.removed) removed++;
+
+    opt_stats.instructions_after = opt_stats.instructions_before - removed;
+    opt_stats.cmp_removed = p.cmp_removed;
+    opt_stats.jumps_threaded = p.jumps_threaded;
+    opt_stats.jumps_removed = p.jumps_removed;
+    opt_stats.dead_removed = p.dead_removed;
+    opt_stats.constants_folded = p.constants_folded;
+    opt_stats.constant_loads_removed = p.constant_loads_removed;
+}
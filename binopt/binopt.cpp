@@ -0,0 +1,801 @@
+#include "binopt.h"
+#include "control.h"
+#include "isa.h"
+#include "pmu.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+// ============================================================
+// Profiles
+// ============================================================
+bool read_profile(const std::string &path, BranchProfile &profile, std::string &err) {
+    std::ifstream in(path);
+    if (!in) {
+        err = "cannot open " + path;
+        return false;
+    }
+    std::string addr;
+    BranchCounts c;
+    int line = 0;
+    while (in >> addr >> c.taken >> c.fallthrough) {
+        line++;
+        char *end = nullptr;
+        unsigned long a = std::strtoul(addr.c_str(), &end, 0);
+        if (*end != '\0' || a > 0xFFFF) {
+            err = path + ": bad address on entry " + std::to_string(line) + ": " + addr;
+            return false;
+        }
+        BranchCounts &total = profile[static_cast<uint16_t>(a)];
+        total.taken += c.taken;
+        total.fallthrough += c.fallthrough;
+    }
+    if (!in.eof()) {
+        err = path + ": malformed entry " + std::to_string(line + 1);
+        return false;
+    }
+    return true;
+}
+
+bool write_profile(const std::string &path, const BranchProfile &profile) {
+    std::vector<uint16_t> addrs;
+    for (const auto &p : profile) addrs.push_back(p.first);
+    std::sort(addrs.begin(), addrs.end());
+
+    std::ofstream out(path);
+    char buf[64];
+    for (uint16_t a : addrs) {
+        const BranchCounts &c = profile.at(a);
+        snprintf(buf, sizeof(buf), "0x%04X %llu %llu\n", a,
+                 (unsigned long long)c.taken, (unsigned long long)c.fallthrough);
+        out << buf;
+    }
+    return static_cast<bool>(out);
+}
+
+// ============================================================
+// Optimizer
+// ============================================================
+namespace {
+
+const int NONE = -1;
+
+struct Insn {
+    uint16_t addr;            // in the input image
+    uint8_t opcode;
+    uint16_t op1, op2;
+    InstrType type;
+};
+
+// How a basic block ends
+enum class Exit {
+    FALL,                     // runs into the next block (fall)
+    JUMP,                     // JMP taken
+    COND,                     // Jcc taken, else fall
+    CALL,                     // CALL taken, returns to fall
+    STOP                      // RET / IRET / HALT
+};
+
+struct Block {
+    uint16_t start;
+    std::vector<int> body;    // instructions other than the exit
+    Exit exit = Exit::FALL;
+    int term = NONE;          // exit instruction (not FALL)
+    int taken = NONE;         // blocks
+    int fall = NONE;
+    bool reachable = false;
+};
+
+// One instruction of the output, before addresses are known
+struct Item {
+    uint8_t opcode;
+    uint16_t op1 = 0, op2 = 0;
+    int target = NONE;        // block whose address goes in op1
+    int origin = NONE;        // input instruction this is the home copy of
+};
+
+uint8_t inverted(uint8_t opcode) {
+    switch (opcode) {
+        case OP_JZ:  return OP_JNZ;
+        case OP_JNZ: return OP_JZ;
+        case OP_JC:  return OP_JNC;
+        case OP_JNC: return OP_JC;
+        default:     return opcode;
+    }
+}
+
+bool ends_block(InstrType t) {
+    switch (t) {
+        case InstrType::JUMP:
+        case InstrType::JUMP_COND:
+        case InstrType::CALL:
+        case InstrType::RET:
+        case InstrType::IRET:
+        case InstrType::HALT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool in_range(uint32_t v, uint32_t lo, uint32_t len) {
+    return v >= lo && v < lo + len;
+}
+
+std::string hex(uint32_t v) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), "0x%04X", v);
+    return buf;
+}
+
+class BinaryOptimizer {
+public:
+    BinaryOptimizer(const std::vector<uint8_t> &image, const BranchProfile *profile,
+                    BinoptStats &stats)
+        : image(image), profile(profile), stats(stats) {}
+
+    std::vector<uint8_t> run() {
+        stats = BinoptStats();
+        if (!decode_reachable()) return image;
+
+        BinoptStats::Mode mode = check_references();
+        if (mode == BinoptStats::UNCHANGED) return image;
+
+        build_blocks();
+        if (!check_returns()) return image;
+        if (mode == BinoptStats::IN_PLACE) return thread_in_place();
+
+        // Each try gives up something; the last one never grows
+        std::vector<uint8_t> out;
+        if (relayout(true, true, out) || relayout(true, false, out) || relayout(false, false, out))
+            return out;
+
+        stats.reason = "the new layout does not fit the code span";
+        return thread_in_place();
+    }
+
+private:
+    const std::vector<uint8_t> &image;
+    const BranchProfile *profile;
+    BinoptStats &stats;
+    ControlUnit cu;
+
+    std::vector<Insn> insns;
+    std::vector<int> insn_at;         // per address: instruction starting there
+    std::vector<int> owner;           // per address: instruction covering the byte
+    std::vector<int> load_ref;        // per instruction: instruction its LOAD reads
+    uint32_t span_end = 0;            // code span is [0, span_end)
+    uint32_t limit = 0;               // the new code must end by here
+
+    std::vector<Block> blocks;        // in address order
+    std::vector<int> block_at;        // per address: block starting there
+    std::vector<bool> falls_in;       // per block: a FALL or CALL exit leads to it
+
+    bool fail(const std::string &why) {
+        stats.mode = BinoptStats::UNCHANGED;
+        stats.reason = why;
+        return false;
+    }
+
+    // ------------------------------------------------------------
+    // Recursive descent from address 0, like CPU::validate
+    // ------------------------------------------------------------
+    bool decode_reachable() {
+        if (image.empty()) return fail("empty image");
+        insn_at.assign(MEM_SIZE, NONE);
+        owner.assign(MEM_SIZE, NONE);
+
+        std::vector<uint32_t> work{0};
+        while (!work.empty()) {
+            uint32_t pc = work.back();
+            work.pop_back();
+            if (pc < MEM_SIZE && insn_at[pc] != NONE) continue;
+
+            if (pc + 5 > image.size())
+                return fail("execution reaches " + hex(pc) + ", past the end of the image");
+            for (uint32_t i = 0; i < 5; i++)
+                if (owner[pc + i] != NONE)
+                    return fail("instructions overlap at " + hex(pc));
+
+            Insn in;
+            in.addr = static_cast<uint16_t>(pc);
+            in.opcode = image[pc];
+            in.op1 = image[pc + 1] | (image[pc + 2] << 8);
+            in.op2 = image[pc + 3] | (image[pc + 4] << 8);
+            in.type = cu.decode(in.opcode, in.op1, in.op2).type;
+            if (in.type == InstrType::NONE)
+                return fail("invalid instruction at " + hex(pc));
+
+            int idx = static_cast<int>(insns.size());
+            insns.push_back(in);
+            insn_at[pc] = idx;
+            for (uint32_t i = 0; i < 5; i++) owner[pc + i] = idx;
+            span_end = std::max(span_end, pc + 5);
+
+            switch (in.type) {
+                case InstrType::JUMP:
+                    work.push_back(in.op1);
+                    break;
+                case InstrType::JUMP_COND:
+                case InstrType::CALL:
+                    work.push_back(in.op1);
+                    work.push_back(pc + 5);
+                    break;
+                case InstrType::RET:
+                case InstrType::IRET:
+                case InstrType::HALT:
+                    break;
+                default:
+                    work.push_back(pc + 5);
+                    break;
+            }
+        }
+
+        stats.instructions = static_cast<int>(insns.size());
+        stats.code_before = span_end;
+        return true;
+    }
+
+    // ------------------------------------------------------------
+    // Immediates that may be addresses decide how much can move
+    // ------------------------------------------------------------
+    BinoptStats::Mode check_references() {
+        load_ref.assign(insns.size(), NONE);
+        std::string in_place;
+
+        auto vector_slot = [](uint32_t v) {
+            return in_range(v, IO_FAULT_VECTOR, 2) || in_range(v, IO_IRQ_VECTORS, 2 * IRQ_LINES);
+        };
+        auto counter = [](uint32_t v) {
+            return v == IO_TIMER || in_range(v, IO_PMU_COUNTERS, 4 * PMU_EVENTS) || v == IO_PMU_CTRL;
+        };
+
+        for (size_t i = 0; i < insns.size(); i++) {
+            const Insn &in = insns[i];
+            uint32_t v = in.op2;
+
+            switch (in.type) {
+                case InstrType::STORE_WORD:
+                    if (owner[v] != NONE || owner[(v + 1) & 0xFFFF] != NONE) {
+                        fail("stores into its own code at " + hex(v) + " (from " + hex(in.addr) + ")");
+                        return BinoptStats::UNCHANGED;
+                    }
+                    if (vector_slot(v) && in_place.empty())
+                        in_place = "installs an interrupt or fault handler (" + hex(in.addr) + ")";
+                    break;
+
+                case InstrType::LOAD_WORD: {
+                    if (counter(v)) stats.reads_counters = true;
+                    int j = owner[v];
+                    if (j == NONE) break;
+                    if (ends_block(insns[j].type) || owner[(v + 1) & 0xFFFF] != j) {
+                        fail("reads the branch or instruction boundary at " + hex(v) +
+                             " (from " + hex(in.addr) + ")");
+                        return BinoptStats::UNCHANGED;
+                    }
+                    load_ref[i] = j;
+                    break;
+                }
+
+                // MOVI, ALU immediates and indexed offsets may be
+                // addresses too
+                case InstrType::REG_IMM:
+                case InstrType::ALU_REG_IMM:
+                case InstrType::LOAD_INDEXED:
+                case InstrType::STORE_INDEXED:
+                    break;
+
+                default:
+                    continue;
+            }
+
+            if (in.type == InstrType::REG_IMM || in.type == InstrType::STORE_INDEXED) {
+                if (vector_slot(v) && in_place.empty())
+                    in_place = "installs an interrupt or fault handler (" + hex(in.addr) + ")";
+                if (counter(v)) stats.reads_counters = true;
+            }
+
+            // Bytes in the code span no reachable instruction covers
+            // are data or code reached some other way: they cannot
+            // be overwritten
+            if (v < span_end && owner[v] == NONE && in_place.empty())
+                in_place = "refers to " + hex(v) + " between code blocks (from " + hex(in.addr) + ")";
+        }
+
+        for (uint32_t a = 0; a < span_end; a++)
+            if (owner[a] == NONE) stats.dead_bytes++;
+
+        // With nothing after the code the image may grow, up to the
+        // first address past it that the program refers to (a
+        // buffer after the image) and well clear of the stack
+        limit = span_end;
+        if (span_end >= image.size()) {
+            limit = STACK_TOP / 2;
+            for (const Insn &in : insns)
+                if (in.op2 >= span_end && in.op2 < limit && in.type != InstrType::JUMP &&
+                    in.type != InstrType::JUMP_COND && in.type != InstrType::CALL)
+                    limit = in.op2;
+        }
+
+        if (!in_place.empty()) {
+            stats.mode = BinoptStats::IN_PLACE;
+            stats.reason = in_place;
+            stats.dead_bytes = 0;
+            return BinoptStats::IN_PLACE;
+        }
+        return BinoptStats::RELAYOUT;
+    }
+
+    // ------------------------------------------------------------
+    // Basic blocks over the reachable instructions
+    // ------------------------------------------------------------
+    void build_blocks() {
+        std::vector<bool> leader(MEM_SIZE, false);
+        leader[0] = true;
+        for (const Insn &in : insns) {
+            if (in.type == InstrType::JUMP || in.type == InstrType::JUMP_COND ||
+                in.type == InstrType::CALL)
+                leader[in.op1] = true;
+            if (ends_block(in.type) && in.addr + 5u < MEM_SIZE)
+                leader[in.addr + 5] = true;
+        }
+
+        block_at.assign(MEM_SIZE, NONE);
+        for (uint32_t a = 0; a < span_end; a++) {
+            int i = insn_at[a];
+            if (i == NONE) continue;
+            if (leader[a] || blocks.empty()) {
+                block_at[a] = static_cast<int>(blocks.size());
+                blocks.push_back(Block());
+                blocks.back().start = static_cast<uint16_t>(a);
+            }
+            Block &b = blocks.back();
+            if (ends_block(insns[i].type)) b.term = i;
+            else b.body.push_back(i);
+        }
+
+        for (Block &b : blocks) {
+            uint32_t end = b.term != NONE ? insns[b.term].addr + 5
+                                          : insns[b.body.back()].addr + 5;
+            int next = end < MEM_SIZE ? block_at[end] : NONE;
+            if (b.term == NONE) {
+                b.exit = Exit::FALL;
+                b.fall = next;
+                continue;
+            }
+            const Insn &t = insns[b.term];
+            switch (t.type) {
+                case InstrType::JUMP:      b.exit = Exit::JUMP; b.taken = block_at[t.op1]; break;
+                case InstrType::JUMP_COND: b.exit = Exit::COND; b.taken = block_at[t.op1]; b.fall = next; break;
+                case InstrType::CALL:      b.exit = Exit::CALL; b.taken = block_at[t.op1]; b.fall = next; break;
+                default:                   b.exit = Exit::STOP; break;
+            }
+        }
+        stats.blocks = static_cast<int>(blocks.size());
+    }
+
+    // ------------------------------------------------------------
+    // A RET must pop what a CALL pushed. Two ways it visibly does
+    // not: the entry code reaches a RET without being called, or
+    // a block pushes a value and returns to it (a computed jump)
+    // ------------------------------------------------------------
+    bool check_returns() {
+        std::vector<bool> seen(blocks.size(), false);
+        std::vector<int> work{block_at[0]};
+        seen[block_at[0]] = true;
+        while (!work.empty()) {
+            const Block &b = blocks[work.back()];
+            work.pop_back();
+            if (b.exit == Exit::STOP && insns[b.term].type == InstrType::RET)
+                return fail("returns at " + hex(insns[b.term].addr) + " without a CALL");
+            // Through CALLs to their return, not into the callee
+            int succ[2] = { b.exit == Exit::CALL ? NONE : b.taken, b.fall };
+            for (int s : succ) {
+                if (s != NONE && !seen[s]) {
+                    seen[s] = true;
+                    work.push_back(s);
+                }
+            }
+        }
+
+        for (const Block &b : blocks) {
+            if (b.exit != Exit::STOP || insns[b.term].type != InstrType::RET) continue;
+            int depth = 0;
+            for (int i : b.body) {
+                if (insns[i].type == InstrType::PUSH_REG) depth++;
+                else if (insns[i].type == InstrType::POP_REG) depth = std::max(depth - 1, 0);
+            }
+            if (depth > 0)
+                return fail("returns to a pushed value at " + hex(insns[b.term].addr));
+        }
+        return true;
+    }
+
+    // Final destination of a jump to b, past blocks that are a lone JMP
+    int final_block(int b) const {
+        for (size_t steps = 0; steps < blocks.size(); steps++) {
+            const Block &x = blocks[b];
+            if (!x.body.empty() || x.exit != Exit::JUMP || x.taken == b) break;
+            b = x.taken;
+        }
+        return b;
+    }
+
+    bool lone_stop(int b) const {
+        return blocks[b].body.empty() && blocks[b].exit == Exit::STOP;
+    }
+
+    // ------------------------------------------------------------
+    // Nothing may move: retarget branches where they are
+    // ------------------------------------------------------------
+    std::vector<uint8_t> thread_in_place() {
+        std::vector<uint8_t> out = image;
+        stats.mode = BinoptStats::IN_PLACE;
+        stats.code_after = span_end;
+        stats.dead_bytes = 0;
+        stats.jumps_removed = stats.jumps_added = stats.branches_inverted = 0;
+        stats.loops_rotated = stats.operands_relocated = 0;
+        stats.jumps_threaded = stats.returns_copied = 0;
+
+        for (const Insn &in : insns) {
+            if (in.type != InstrType::JUMP && in.type != InstrType::JUMP_COND &&
+                in.type != InstrType::CALL)
+                continue;
+
+            int b = final_block(block_at[in.op1]);
+            uint16_t target = blocks[b].start;
+            if (target != in.op1) {
+                out[in.addr + 1] = target & 0xFF;
+                out[in.addr + 2] = target >> 8;
+                stats.jumps_threaded++;
+            }
+            if (in.type == InstrType::JUMP && lone_stop(b)) {
+                const Insn &stop = insns[blocks[b].term];
+                for (int k = 0; k < 5; k++) out[in.addr + k] = image[stop.addr + k];
+                stats.returns_copied++;
+            }
+        }
+        return out;
+    }
+
+    // ------------------------------------------------------------
+    // Relayout
+    // ------------------------------------------------------------
+    const BranchCounts *counts(const Block &b) const {
+        if (!profile || b.exit != Exit::COND) return nullptr;
+        auto it = profile->find(insns[b.term].addr);
+        if (it == profile->end() || it->second.taken + it->second.fallthrough == 0) return nullptr;
+        return &it->second;
+    }
+
+    BranchCounts counts_at(int insn) const {
+        auto it = profile->find(insns[insn].addr);
+        return it == profile->end() ? BranchCounts() : it->second;
+    }
+
+    // ------------------------------------------------------------
+    // Profile-guided order (Pettis-Hansen): merge chains of blocks
+    // along the heaviest edges first. Every instruction costs one
+    // dispatch, taken or not, so an edge weighs what laying it out
+    // as a fallthrough saves: the JMP it would otherwise need.
+    // A conditional branch needs one of its two successors next
+    // and then costs nothing, else a JMP on its colder side.
+    // ------------------------------------------------------------
+    std::vector<int> chain_order() const {
+        struct Edge {
+            uint64_t weight;
+            bool adjacent;         // laid out like this in the input
+            int from, to;
+        };
+        std::vector<Edge> edges;
+        auto add = [&](int from, int to, uint64_t w) {
+            uint32_t end = blocks[from].term != NONE ? insns[blocks[from].term].addr + 5
+                                                      : insns[blocks[from].body.back()].addr + 5;
+            edges.push_back({ w, blocks[to].start == end, from, to });
+        };
+
+        for (size_t i = 0; i < blocks.size(); i++) {
+            const Block &b = blocks[i];
+            int from = static_cast<int>(i);
+            if (!b.reachable) continue;
+            switch (b.exit) {
+                case Exit::FALL:
+                    add(from, b.fall, b.body.empty() ? 0 : counts_at(b.body.back()).fallthrough);
+                    break;
+                case Exit::CALL:
+                    add(from, b.fall, counts_at(b.term).fallthrough);
+                    break;
+                case Exit::JUMP:
+                    add(from, b.taken, counts_at(b.term).taken);
+                    break;
+                case Exit::COND: {
+                    BranchCounts c = counts_at(b.term);
+                    uint64_t w = std::min(c.taken, c.fallthrough);
+                    add(from, b.fall, w);
+                    add(from, b.taken, w);
+                    break;
+                }
+                case Exit::STOP:
+                    break;
+            }
+        }
+        std::stable_sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) {
+            if (a.weight != b.weight) return a.weight > b.weight;
+            return a.adjacent && !b.adjacent;
+        });
+
+        int entry = block_at[0];
+        std::vector<int> next(blocks.size(), NONE), prev(blocks.size(), NONE);
+        auto head = [&](int b) {
+            while (prev[b] != NONE) b = prev[b];
+            return b;
+        };
+        for (const Edge &e : edges) {
+            if (e.from == e.to || e.to == entry) continue;
+            if (next[e.from] != NONE || prev[e.to] != NONE) continue;
+            if (head(e.from) == e.to) continue;          // would close a cycle
+            next[e.from] = e.to;
+            prev[e.to] = e.from;
+        }
+
+        // The entry's chain first, then the rest in input order
+        std::vector<int> order;
+        for (int b = entry; b != NONE; b = next[b]) order.push_back(b);
+        for (size_t b = 0; b < blocks.size(); b++) {
+            if (!blocks[b].reachable || prev[b] != NONE || static_cast<int>(b) == entry) continue;
+            for (int x = static_cast<int>(b); x != NONE; x = next[x]) order.push_back(x);
+        }
+        return order;
+    }
+
+    // ------------------------------------------------------------
+    // Without a profile: the successor that should come right
+    // after b. A block another one has to fall into (the test at
+    // the bottom of a loop) is left to that one.
+    // ------------------------------------------------------------
+    int preferred_next(int b, const std::vector<bool> &placed) const {
+        const Block &x = blocks[b];
+        auto free = [&](int s) { return s != NONE && !placed[s] && !falls_in[s]; };
+
+        switch (x.exit) {
+            case Exit::FALL:
+            case Exit::CALL:
+                return x.fall != NONE && !placed[x.fall] ? x.fall : NONE;
+            case Exit::JUMP:
+                return free(x.taken) ? x.taken : NONE;
+            case Exit::STOP:
+                return NONE;
+            case Exit::COND:
+                break;
+        }
+
+        // Whichever came first after b in the input
+        auto distance = [&](int s) {
+            return blocks[s].start > x.start ? blocks[s].start - x.start : MEM_SIZE;
+        };
+        int first = distance(x.fall) <= distance(x.taken) ? x.fall : x.taken;
+        int second = first == x.taken ? x.fall : x.taken;
+        if (free(first)) return first;
+        return free(second) ? second : NONE;
+    }
+
+    bool relayout(bool reorder, bool rotate, std::vector<uint8_t> &out) {
+        BinoptStats counts_before = stats;
+
+        // Thread every edge
+        std::vector<Block> saved = blocks;
+        for (Block &b : blocks) {
+            for (int *edge : { &b.taken, &b.fall }) {
+                if (*edge == NONE) continue;
+                int f = final_block(*edge);
+                if (f != *edge) {
+                    *edge = f;
+                    stats.jumps_threaded++;
+                }
+            }
+            if (b.exit == Exit::COND && b.taken == b.fall) {
+                b.exit = Exit::FALL;
+                b.term = NONE;
+                b.taken = NONE;
+                stats.jumps_removed++;
+            }
+        }
+
+        // What is still reachable
+        std::vector<int> work{block_at[0]};
+        for (Block &b : blocks) b.reachable = false;
+        blocks[block_at[0]].reachable = true;
+        while (!work.empty()) {
+            const Block &b = blocks[work.back()];
+            work.pop_back();
+            for (int s : { b.taken, b.fall }) {
+                if (s != NONE && !blocks[s].reachable) {
+                    blocks[s].reachable = true;
+                    work.push_back(s);
+                }
+            }
+        }
+
+        falls_in.assign(blocks.size(), false);
+        for (const Block &b : blocks)
+            if (b.reachable && (b.exit == Exit::FALL || b.exit == Exit::CALL)) falls_in[b.fall] = true;
+
+        // Order: by profile, else follow preferred successors and
+        // the next block in input order
+        std::vector<int> order;
+        std::vector<bool> placed(blocks.size(), false);
+        if (reorder && profile) order = chain_order();
+        for (int cur = order.empty() ? block_at[0] : NONE; cur != NONE;) {
+            placed[cur] = true;
+            order.push_back(cur);
+            int next = reorder ? preferred_next(cur, placed) : NONE;
+            if (next == NONE) {
+                for (size_t b = 0; b < blocks.size(); b++) {
+                    if (blocks[b].reachable && !placed[b]) {
+                        next = static_cast<int>(b);
+                        break;
+                    }
+                }
+            }
+            cur = next;
+        }
+
+        std::vector<Item> items;
+        std::vector<int> first_item(blocks.size(), NONE);
+        for (size_t k = 0; k < order.size(); k++) {
+            int b = order[k];
+            int next = k + 1 < order.size() ? order[k + 1] : NONE;
+            first_item[b] = static_cast<int>(items.size());
+            emit_block(b, next, rotate, items);
+        }
+
+        bool fits = items.size() * 5 <= limit;
+        std::vector<int> new_addr(insns.size(), NONE);
+        if (fits) {
+            for (size_t k = 0; k < items.size(); k++)
+                if (items[k].origin != NONE) new_addr[items[k].origin] = static_cast<int>(k * 5);
+            for (size_t i = 0; i < insns.size(); i++)
+                if (load_ref[i] != NONE && new_addr[load_ref[i]] == NONE) fits = false;
+        }
+        if (!fits) {
+            blocks = saved;
+            stats = counts_before;
+            return false;
+        }
+
+        // Addresses are known: resolve and write
+        out = image;
+        if (out.size() < items.size() * 5) out.resize(items.size() * 5);
+        for (size_t k = 0; k < items.size(); k++) {
+            Item &it = items[k];
+            if (it.target != NONE) it.op1 = static_cast<uint16_t>(first_item[it.target] * 5);
+            if (it.origin != NONE && load_ref[it.origin] != NONE) {
+                const Insn &in = insns[it.origin];
+                int j = load_ref[it.origin];
+                uint16_t moved = static_cast<uint16_t>(new_addr[j] + (in.op2 - insns[j].addr));
+                if (moved != in.op2) stats.operands_relocated++;
+                it.op2 = moved;
+            }
+            uint8_t *p = &out[k * 5];
+            p[0] = it.opcode;
+            p[1] = it.op1 & 0xFF;
+            p[2] = it.op1 >> 8;
+            p[3] = it.op2 & 0xFF;
+            p[4] = it.op2 >> 8;
+        }
+
+        size_t end = items.size() * 5;
+        if (span_end >= image.size()) out.resize(end);
+        else std::fill(out.begin() + end, out.begin() + span_end, 0);
+
+        stats.mode = BinoptStats::RELAYOUT;
+        stats.code_after = end;
+        blocks = saved;
+        return true;
+    }
+
+    Item copy_of(int i, bool home) const {
+        Item it;
+        it.opcode = insns[i].opcode;
+        it.op1 = insns[i].op1;
+        it.op2 = insns[i].op2;
+        if (home) it.origin = i;
+        return it;
+    }
+
+    Item branch(uint8_t opcode, int target) const {
+        Item it;
+        it.opcode = opcode;
+        it.target = target;
+        return it;
+    }
+
+    void emit_block(int b, int next, bool rotate, std::vector<Item> &items) {
+        const Block &x = blocks[b];
+        for (int i : x.body) items.push_back(copy_of(i, true));
+
+        switch (x.exit) {
+            case Exit::FALL:
+                go_to(x.fall, b, next, rotate, items);
+                break;
+
+            case Exit::JUMP:
+                if (x.taken == next) stats.jumps_removed++;
+                go_to(x.taken, b, next, rotate, items);
+                break;
+
+            case Exit::CALL: {
+                Item call = copy_of(x.term, true);
+                call.target = x.taken;
+                items.push_back(call);
+                go_to(x.fall, b, next, rotate, items);
+                break;
+            }
+
+            case Exit::STOP:
+                items.push_back(copy_of(x.term, true));
+                break;
+
+            case Exit::COND: {
+                uint8_t op = insns[x.term].opcode;
+                const BranchCounts *c = counts(x);
+                bool fall_hot = c && c->fallthrough > c->taken;
+                if (x.fall == next) {
+                    items.push_back(branch(op, x.taken));
+                } else if (x.taken == next || fall_hot) {
+                    // The branch goes where it used to fall
+                    items.push_back(branch(inverted(op), x.fall));
+                    stats.branches_inverted++;
+                    go_to(x.taken, b, next, rotate, items);
+                } else {
+                    items.push_back(branch(op, x.taken));
+                    go_to(x.fall, b, next, rotate, items);
+                }
+                break;
+            }
+        }
+    }
+
+    // Continue at block target from the end of block from
+    void go_to(int target, int from, int next, bool rotate, std::vector<Item> &items) {
+        if (target == NONE || target == next) return;
+        const Block &t = blocks[target];
+
+        if (lone_stop(target)) {
+            items.push_back(copy_of(t.term, false));
+            stats.returns_copied++;
+            return;
+        }
+
+        // A back edge to a short test: repeat the test here so the
+        // loop continues with one taken branch
+        if (rotate && t.exit == Exit::COND && t.body.size() <= 2 &&
+            target != from && t.start <= blocks[from].start) {
+            for (int i : t.body) items.push_back(copy_of(i, false));
+            uint8_t op = insns[t.term].opcode;
+            if (t.fall == next) {
+                items.push_back(branch(op, t.taken));
+            } else if (t.taken == next) {
+                items.push_back(branch(inverted(op), t.fall));
+            } else {
+                items.push_back(branch(op, t.taken));
+                items.push_back(branch(OP_JMP, t.fall));
+            }
+            stats.loops_rotated++;
+            return;
+        }
+
+        items.push_back(branch(OP_JMP, target));
+        if (blocks[from].exit != Exit::JUMP) stats.jumps_added++;
+    }
+};
+
+} // namespace
+
+std::vector<uint8_t> optimize_binary(const std::vector<uint8_t> &image,
+                                     const BranchProfile *profile,
+                                     BinoptStats &stats) {
+    BinaryOptimizer opt(image, profile, stats);
+    return opt.run();
+}
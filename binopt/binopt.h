@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ================================================================
+// Binary optimizer – rewrites an assembled .bin image
+// Works from the encoded instructions alone (no labels or source):
+// decodes the code reachable from address 0 with
+// ControlUnit::decode semantics, builds basic blocks and lays them
+// out again:
+//   - jump threading: branches to unconditional jumps go straight
+//     to the final target; a jump to RET/IRET/HALT becomes a copy
+//   - block placement: with a profile, blocks are chained along
+//     the edges whose JMPs would run most often (Pettis-Hansen),
+//     inverting conditional branches as needed; without one the
+//     input order is kept where it already falls through. Jumps
+//     to the next block disappear
+//   - loop rotation: a back edge jumping to a short compare-and-
+//     branch block gets its own copy of the test
+//   - unreachable code between reachable code is dropped
+// Branch, CALL and direct LOAD operands that point into moved
+// code are relocated.
+//
+// Data keeps its address: bytes after the last reachable
+// instruction stay where they were, so pointers to data held in
+// MOVI immediates, globals and strings remain valid. The new code
+// must fit in the old code's span (it never grows otherwise).
+//
+// Assumptions the tool cannot check from the image and must hold
+// for the result to be equivalent: code addresses reach the CPU
+// only through branch and CALL operands and the return addresses
+// CALL pushes (no computed jumps through PUSH/RET), and code is not
+// written through computed addresses. What it can see, it handles
+// conservatively:
+//   - direct STOREs into code (self-modifying): image unchanged
+//   - interrupt or fault vectors referenced (handler addresses
+//     would be stale), data referenced between code blocks, or
+//     LOADs of branch instructions: branches are threaded in
+//     place, nothing moves
+//   - code running off the image, overlapping or invalid
+//     reachable instructions: image unchanged
+//   - a RET the entry code reaches without a CALL, or one right
+//     after a PUSH in its block: image unchanged
+//
+// Fewer instructions retire, so a guest reading the timer
+// register or PMU counters sees smaller counts.
+// ================================================================
+
+// Where execution went after one instruction, keyed by its
+// address in the original image: taken = to the operand's target
+// (Jcc taken, JMP, CALL), fallthrough = on to the next address
+// (Jcc not taken, ordinary instructions, returns from a CALL)
+struct BranchCounts {
+    uint64_t taken = 0;
+    uint64_t fallthrough = 0;
+};
+using BranchProfile = std::unordered_map<uint16_t, BranchCounts>;
+
+// "0x0123 taken fallthrough" lines
+bool read_profile(const std::string &path, BranchProfile &profile, std::string &err);
+bool write_profile(const std::string &path, const BranchProfile &profile);
+
+struct BinoptStats {
+    enum Mode { RELAYOUT, IN_PLACE, UNCHANGED };
+    Mode mode = UNCHANGED;
+    std::string reason;              // why not RELAYOUT
+
+    int instructions = 0;            // reachable in the input
+    int blocks = 0;
+    int jumps_threaded = 0;          // edges retargeted past jumps
+    int jumps_removed = 0;           // JMPs to the next block dropped
+    int jumps_added = 0;             // fallthroughs that needed a JMP
+    int branches_inverted = 0;
+    int returns_copied = 0;          // JMP → RET/IRET/HALT
+    int loops_rotated = 0;
+    int dead_bytes = 0;              // unreachable code dropped
+    int operands_relocated = 0;      // LOAD operands into moved code
+    size_t code_before = 0;          // bytes in the code span
+    size_t code_after = 0;
+    bool reads_counters = false;     // guest reads the timer or PMU
+};
+
+// The rewritten image (a copy of the input if nothing could be
+// done; see stats.mode). profile may be null.
+std::vector<uint8_t> optimize_binary(const std::vector<uint8_t> &image,
+                                     const BranchProfile *profile,
+                                     BinoptStats &stats);
@@ -0,0 +1,214 @@
+// ========================================================
+// main.cpp – binopt, rewrite an assembled .bin for speed
+// (binopt.h says what it does and when it holds back)
+//
+// A branch profile can come from a file (-p) or from a
+// training run of the input image (-t, bounded by -n); -w
+// saves the profile used. -c runs the input and output
+// images and compares guest output, registers and how each
+// stopped. -i attaches an input file for those runs.
+//
+// Usage: ./binopt [-p profile] [-t] [-w profile] [-c]
+//                 [-n max_steps] [-i input] <in.bin> <out.bin>
+// ========================================================
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "binopt.h"
+#include "cpu_exec.h"
+#include "isa.h"
+
+// Counts where each instruction went (see BranchCounts)
+struct ProfileHooks {
+    BranchProfile *profile = nullptr;
+
+    void fetch(uint16_t) {}
+    void load(uint16_t, uint16_t) {}
+    void store(uint16_t, uint16_t) {}
+
+    void branch(uint16_t pc, InstrType type, bool taken, uint16_t) {
+        BranchCounts &c = (*profile)[pc];
+        switch (type) {
+            case InstrType::JUMP_COND: (taken ? c.taken : c.fallthrough)++; break;
+            case InstrType::JUMP:      c.taken++; break;
+            case InstrType::CALL:      c.taken++; c.fallthrough++; break;   // and its return
+            default: break;
+        }
+    }
+
+    void retire(uint16_t pc, uint8_t opcode) {
+        switch (DECODE_TABLE[opcode].type) {
+            case InstrType::JUMP:
+            case InstrType::JUMP_COND:
+            case InstrType::CALL:
+            case InstrType::RET:
+            case InstrType::IRET:
+            case InstrType::HALT:
+                break;
+            default:
+                (*profile)[pc].fallthrough++;
+                break;
+        }
+    }
+};
+
+template uint64_t CPU::run_with<ProfileHooks>(ProfileHooks &, uint64_t);
+
+// What a run left behind, for -c
+struct RunResult {
+    std::string output;
+    uint64_t steps = 0;
+    bool halted = false;
+    FaultCause fault = FAULT_NONE;
+    uint16_t R[REG_COUNT] = {};
+    uint16_t SP = 0;
+    bool ZF = false, CF = false;
+};
+
+static bool attach_input(CPU &cpu, const std::string &path) {
+    if (path.empty()) return true;
+    std::string err;
+    if (cpu.memory.input.open(path, err)) return true;
+    std::cerr << "ERROR: " << err << "\n";
+    return false;
+}
+
+static RunResult run_image(const std::vector<uint8_t> &image, uint64_t max_steps,
+                           const std::string &input, BranchProfile *profile) {
+    RunResult r;
+    std::ostringstream out;
+    CPU cpu;
+    cpu.memory.set_output(out);
+    cpu.memory.irq.use_virtual_timer(true);
+    if (!attach_input(cpu, input)) exit(1);
+    cpu.load_program(image, 0x0000);
+
+    BranchProfile scratch;
+    ProfileHooks hooks;
+    hooks.profile = profile ? profile : &scratch;
+    r.steps = cpu.run_with(hooks, max_steps);
+
+    r.output = out.str();
+    r.halted = cpu.halted;
+    r.fault = cpu.fault;
+    for (int i = 0; i < REG_COUNT; i++) r.R[i] = cpu.regs.R[i];
+    r.SP = cpu.regs.SP;
+    r.ZF = cpu.regs.flags.ZF;
+    r.CF = cpu.regs.flags.CF;
+    return r;
+}
+
+static bool read_image(const std::string &path, std::vector<uint8_t> &image) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static void print_report(const BinoptStats &s) {
+    static const char *MODES[] = { "relayout", "branches threaded in place", "unchanged" };
+    std::cout << "binopt: " << MODES[s.mode];
+    if (!s.reason.empty()) std::cout << " (" << s.reason << ")";
+    std::cout << "\n";
+    if (s.mode == BinoptStats::UNCHANGED) return;
+
+    std::cout << "  code bytes:               " << s.code_before << " -> " << s.code_after << "\n"
+              << "  instructions / blocks:    " << s.instructions << " / " << s.blocks << "\n"
+              << "  jumps threaded:           " << s.jumps_threaded << "\n"
+              << "  jumps to next removed:    " << s.jumps_removed << "\n"
+              << "  jumps added:              " << s.jumps_added << "\n"
+              << "  branches inverted:        " << s.branches_inverted << "\n"
+              << "  returns copied:           " << s.returns_copied << "\n"
+              << "  loops rotated:            " << s.loops_rotated << "\n"
+              << "  dead code bytes removed:  " << s.dead_bytes << "\n"
+              << "  LOAD operands relocated:  " << s.operands_relocated << "\n";
+    if (s.reads_counters)
+        std::cout << "  note: the program reads the timer or PMU counters, which"
+                     " will show fewer instructions\n";
+}
+
+int main(int argc, char** argv) {
+    std::string profile_in, profile_out, input;
+    bool train = false, check = false;
+    uint64_t max_steps = 100000000;
+
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        std::string flag = argv[arg];
+        if (flag == "-t") train = true;
+        else if (flag == "-c") check = true;
+        else if (arg + 1 < argc && flag == "-p") profile_in = argv[++arg];
+        else if (arg + 1 < argc && flag == "-w") profile_out = argv[++arg];
+        else if (arg + 1 < argc && flag == "-i") input = argv[++arg];
+        else if (arg + 1 < argc && flag == "-n") max_steps = std::stoull(argv[++arg]);
+        else break;
+        arg++;
+    }
+    if (argc - arg != 2) {
+        std::cerr << "Usage: ./binopt [-p profile] [-t] [-w profile] [-c]\n"
+                     "               [-n max_steps] [-i input] <in.bin> <out.bin>\n";
+        return 1;
+    }
+    std::string in_path = argv[arg], out_path = argv[arg + 1];
+
+    std::vector<uint8_t> image;
+    if (!read_image(in_path, image)) {
+        std::cerr << "ERROR: cannot read " << in_path << "\n";
+        return 1;
+    }
+
+    BranchProfile profile;
+    std::string err;
+    if (!profile_in.empty() && !read_profile(profile_in, profile, err)) {
+        std::cerr << "ERROR: " << err << "\n";
+        return 1;
+    }
+    if (train) {
+        RunResult r = run_image(image, max_steps, input, &profile);
+        std::cout << "training run: " << r.steps << " instructions, "
+                  << profile.size() << " addresses profiled\n";
+    }
+    if (!profile_out.empty() && !write_profile(profile_out, profile)) {
+        std::cerr << "ERROR: cannot write " << profile_out << "\n";
+        return 1;
+    }
+
+    BinoptStats stats;
+    std::vector<uint8_t> out = optimize_binary(image, profile.empty() ? nullptr : &profile, stats);
+
+    std::ofstream file(out_path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(out.data()), out.size());
+    if (!file) {
+        std::cerr << "ERROR: cannot write " << out_path << "\n";
+        return 1;
+    }
+    print_report(stats);
+
+    if (check) {
+        RunResult a = run_image(image, max_steps, input, nullptr);
+        RunResult b = run_image(out, max_steps, input, nullptr);
+
+        // Cut off by the step limit the faster image is further
+        // along: only its output can be compared
+        bool same;
+        if (!a.halted) {
+            same = b.output.compare(0, a.output.size(), a.output) == 0;
+        } else {
+            same = a.output == b.output && a.halted == b.halted && a.fault == b.fault &&
+                   a.SP == b.SP && a.ZF == b.ZF && a.CF == b.CF;
+            for (int i = 0; i < REG_COUNT; i++) same = same && a.R[i] == b.R[i];
+        }
+
+        std::cout << "check: " << a.steps << " -> " << b.steps << " instructions";
+        if (!a.halted) std::cout << " (stopped at the step limit)";
+        std::cout << (same ? ", same output and final state\n" : ", DIFFERENT output or final state\n");
+        if (!same) return 1;
+    }
+    return 0;
+}
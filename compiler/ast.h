@@ -0,0 +1,132 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ============================================================
+// C-subset syntax tree
+//
+// One integer type (16-bit), signed ("int"/"char") or unsigned.
+// Scalars may be locals, parameters or globals; arrays may be
+// globals or locals (not parameters). Names are resolved while parsing, so every
+// VAR/INDEX node already points at its Var.
+// ============================================================
+
+struct CompileError : std::runtime_error {
+    int line;
+    CompileError(int line, const std::string &msg)
+        : std::runtime_error("line " + std::to_string(line) + ": " + msg), line(line) {}
+};
+
+// ------------------------------------------------------------
+// Variable (global, parameter, local or compiler temporary)
+// ------------------------------------------------------------
+struct Var {
+    std::string name;
+    bool global      = false;
+    bool is_array    = false;
+    bool is_unsigned = false;
+    int  size        = 1;            // elements (arrays)
+    std::vector<int> init;           // global initializer
+    int  param_index = -1;
+
+    // Filled by analysis
+    double weight = 0;               // uses, weighted by loop depth
+    bool nonneg   = false;           // provably never negative
+
+    // Filled by register allocation
+    int reg  = -1;                   // home register, or -1
+    int slot = -1;                   // frame slot if not in a register
+};
+
+// ------------------------------------------------------------
+// Expressions
+// ------------------------------------------------------------
+enum class Ex {
+    NUM,        // value
+    STR,        // text (printf format only)
+    VAR,        // var
+    INDEX,      // var[a]
+    CALL,       // name(args)
+    UNARY,      // op a          "-", "!", "~"
+    BINARY,     // a op b        arithmetic, comparison, "&&", "||"
+    ASSIGN,     // a op b        "=", "+=", ... (a is VAR or INDEX)
+    INCDEC,     // ++a, a--, ... (a is VAR or INDEX)
+};
+
+struct Expr {
+    Ex kind;
+    int line;
+    int value = 0;
+    std::string name;
+    std::string op;
+    bool postfix = false;
+    std::unique_ptr<Expr> a, b;
+    std::vector<std::unique_ptr<Expr>> args;
+    Var *var = nullptr;
+    bool is_unsigned = false;        // type of the result
+
+    Expr(Ex kind, int line) : kind(kind), line(line) {}
+};
+
+using ExprPtr = std::unique_ptr<Expr>;
+
+// ------------------------------------------------------------
+// Statements
+// ------------------------------------------------------------
+enum class St {
+    EXPR,       // e;
+    DECL,       // var [= e];
+    IF,         // if (e) body [else else_body]
+    WHILE,      // while (e) body
+    DO,         // do body while (e);
+    FOR,        // for (init; e; step) body
+    RETURN,     // return [e];
+    BREAK,
+    CONTINUE,
+    BLOCK,      // { list }
+};
+
+struct Stmt {
+    St kind;
+    int line;
+    ExprPtr e;
+    ExprPtr step;
+    Var *var = nullptr;
+    std::unique_ptr<Stmt> init, body, else_body;
+    std::vector<std::unique_ptr<Stmt>> list;
+
+    Stmt(St kind, int line) : kind(kind), line(line) {}
+};
+
+using StmtPtr = std::unique_ptr<Stmt>;
+
+// ------------------------------------------------------------
+// Functions and the whole translation unit
+// ------------------------------------------------------------
+struct Function {
+    std::string name;
+    int line = 0;
+    bool returns_value = true;
+    bool returns_unsigned = false;
+    bool defined = false;
+    std::vector<Var*> params;
+    std::vector<std::unique_ptr<Var>> vars;     // owns params, locals, temporaries
+    StmtPtr body;
+
+    // Filled by analysis
+    bool has_calls = false;
+};
+
+struct Program {
+    std::vector<std::unique_ptr<Var>> globals;
+    std::vector<std::unique_ptr<Function>> functions;
+
+    Function *find_function(const std::string &name) const {
+        for (const auto &f : functions)
+            if (f->name == name) return f.get();
+        return nullptr;
+    }
+};
@@ -0,0 +1,1358 @@
+#include "codegen.h"
+#include "optimize.h"
+
+#include "common.h"
+#include "hypercall.h"
+
+#include <algorithm>
+#include <sstream>
+
+static const int ARG_REGS = 3;          // R0..R2 carry the first arguments
+static const int CALL_NEED = 3;         // calls are evaluated before their siblings
+
+static std::string reg_name(int r) { return "R" + std::to_string(r); }
+
+static std::string hex(int v) {
+    std::ostringstream s;
+    s << "0x" << std::uppercase << std::hex << (v & 0xFFFF);
+    return s.str();
+}
+
+static std::string mem(int base, const std::string &offset) {
+    return "[" + reg_name(base) + (offset.empty() || offset == "0" ? "" : "+" + offset) + "]";
+}
+
+static std::string global_label(const Var *v) { return "g_" + v->name; }
+
+static bool is_comparison(const std::string &op) {
+    return op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=";
+}
+
+static int log2_exact(int v) {
+    for (int k = 0; k < 16; k++)
+        if (v == (1 << k)) return k;
+    return -1;
+}
+
+// Comparison that can skip the signed bias
+static bool unsigned_compare(const Expr &e) {
+    const Expr &a = *e.a, &b = *e.b;
+    return a.is_unsigned || b.is_unsigned || (nonneg(a) && nonneg(b));
+}
+
+// Does e read or write variable v?
+static bool references(const Expr &e, const Var *v) {
+    if (e.var == v) return true;
+    if (e.a && references(*e.a, v)) return true;
+    if (e.b && references(*e.b, v)) return true;
+    for (const auto &arg : e.args)
+        if (references(*arg, v)) return true;
+    return false;
+}
+
+// ============================================================
+// Output
+// ============================================================
+void CodeGen::emit(const std::string &ins) {
+    lines.push_back("        " + ins);
+    st.instructions++;
+    zf_reg = -1;
+}
+
+void CodeGen::label(const std::string &name) {
+    lines.push_back(name + ":");
+    zf_reg = -1;
+}
+
+std::string CodeGen::new_label() {
+    return "L" + std::to_string(label_count++);
+}
+
+void CodeGen::push(int reg) {
+    emit("PUSH " + reg_name(reg));
+    push_depth++;
+}
+
+void CodeGen::pop(int reg) {
+    emit("POP " + reg_name(reg));
+    push_depth--;
+}
+
+// ============================================================
+// Registers
+// ============================================================
+int CodeGen::alloc() {
+    for (int r : temps) {
+        if (free_mask & (1 << r)) {
+            free_mask &= ~(1 << r);
+            return r;
+        }
+    }
+    throw CompileError(fn ? fn->line : 0,
+                       "expression too complex in '" + (fn ? fn->name : std::string("?")) +
+                       "' (out of registers); split it into smaller statements");
+}
+
+void CodeGen::release(Val v) {
+    if (v.owned) free_mask |= (1 << v.reg);
+}
+
+int CodeGen::free_count() const {
+    int n = 0;
+    for (int r : temps)
+        if (free_mask & (1 << r)) n++;
+    return n;
+}
+
+void CodeGen::reserve(int reg) {
+    free_mask &= ~(1 << reg);
+}
+
+// Make a value modifiable (copy out of a variable's home register)
+CodeGen::Val CodeGen::own(Val v) {
+    if (v.owned) return v;
+    int t = alloc();
+    emit("MOV " + reg_name(t) + ", " + reg_name(v.reg));
+    zf_reg = t;
+    return {t, true};
+}
+
+// ============================================================
+// Register allocation
+// ============================================================
+void CodeGen::allocate_registers(const Function &f) {
+    std::vector<Var*> vars, arrays;
+    for (const auto &v : f.vars) {
+        v->reg = -1;
+        v->slot = -1;
+        if (v->weight > 0) (v->is_array ? arrays : vars).push_back(v.get());
+    }
+    std::stable_sort(vars.begin(), vars.end(),
+                     [](const Var *a, const Var *b) { return a->weight > b->weight; });
+
+    uint8_t homes = 0;
+    size_t next = 0;
+    saved.clear();
+
+    // A leaf can keep its hottest variable in a caller-saved register
+    // (its own argument register if it is a parameter): no save needed.
+    if (!f.has_calls && !vars.empty()) {
+        Var *v = vars[next++];
+        v->reg = (v->param_index >= 0 && v->param_index < ARG_REGS) ? v->param_index : 2;
+        homes |= 1 << v->reg;
+    }
+    for (int r = 3; r < REG_COUNT && next < vars.size(); r++) {
+        vars[next++]->reg = r;
+        saved.push_back(r);
+    }
+
+    temps.clear();
+    for (int r = 0; r < ARG_REGS; r++)
+        if (!(homes & (1 << r))) temps.push_back(r);
+    free_mask = 0;
+    for (int r : temps) free_mask |= 1 << r;
+
+    // Frame slots: spilled register parameters first (pushed in the
+    // prologue), then locals. Stack parameters stay where the caller put them.
+    frame_slots = 0;
+    for (Var *p : f.params)
+        if (p->reg < 0 && p->weight > 0 && p->param_index < ARG_REGS) p->slot = frame_slots++;
+    for (size_t i = next; i < vars.size(); i++)
+        if (vars[i]->param_index < 0) vars[i]->slot = frame_slots++;
+    for (Var *a : arrays) {
+        a->slot = frame_slots;
+        frame_slots += a->size;
+    }
+
+    st.vars_in_registers += (int)std::min(next, vars.size());
+    st.vars_in_frame += (int)(vars.size() - std::min(next, vars.size()) + arrays.size());
+}
+
+// ============================================================
+// Functions
+// ============================================================
+void CodeGen::adjust_sp(int words, int scratch) {
+    if (words == 0) return;
+    if (words <= 2) {
+        for (int i = 0; i < words; i++) emit("POP " + reg_name(scratch));
+    }
+    else {
+        emit("MOVSP " + reg_name(scratch));
+        emit("ADDI " + reg_name(scratch) + ", " + std::to_string(2 * words));
+        emit("SETSP " + reg_name(scratch));
+    }
+}
+
+void CodeGen::emit_prologue(const Function &f) {
+    for (int r : saved) emit("PUSH " + reg_name(r));
+
+    // Register parameters without a register home become the first slots
+    int pushed = 0;
+    for (const Var *p : f.params) {
+        if (p->slot >= 0) {
+            emit("PUSH " + reg_name(p->param_index));
+            pushed++;
+        }
+    }
+
+    // Register parameters → home registers. Sources are R0..R2 and only
+    // one home can be among them, so ordering the moves is enough.
+    std::vector<std::pair<int, int>> moves;       // src, dst
+    for (const Var *p : f.params)
+        if (p->reg >= 0 && p->param_index < ARG_REGS && p->reg != p->param_index)
+            moves.push_back({p->param_index, p->reg});
+    while (!moves.empty()) {
+        auto ready = std::find_if(moves.begin(), moves.end(), [&](const std::pair<int, int> &m) {
+            return std::none_of(moves.begin(), moves.end(),
+                                [&](const std::pair<int, int> &o) { return o.first == m.second; });
+        });
+        if (ready == moves.end()) throw CompileError(f.line, "internal: cyclic parameter moves");
+        emit("MOV " + reg_name(ready->second) + ", " + reg_name(ready->first));
+        moves.erase(ready);
+    }
+
+    // Remaining locals: contents are undefined, so any register will do
+    int rest = frame_slots - pushed;
+    if (rest > 0 && rest <= 3) {
+        for (int i = 0; i < rest; i++) emit("PUSH " + reg_name(temps[0]));
+    }
+    else if (rest > 3) {
+        std::string t = reg_name(temps[0]);
+        emit("MOVSP " + t);
+        emit("SUBI " + t + ", " + std::to_string(2 * rest));
+        emit("SETSP " + t);
+    }
+
+    // Stack parameters with a register home
+    for (const Var *p : f.params) {
+        if (p->reg >= 0 && p->param_index >= ARG_REGS) {
+            emit("MOVSP " + reg_name(p->reg));
+            emit("LOAD " + reg_name(p->reg) + ", " + mem(p->reg, std::to_string(var_offset(p))));
+        }
+    }
+}
+
+void CodeGen::emit_epilogue() {
+    adjust_sp(frame_slots, 1);      // R0 holds the result; R1 is dead here
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it)
+        emit("POP " + reg_name(*it));
+    emit("RET");
+}
+
+void CodeGen::gen_function(const Function &f) {
+    fn = &f;
+    allocate_registers(f);
+    push_depth = 0;
+    loops.clear();
+    ret_label = new_label();
+    inline_epilogue = frame_slots == 0 && saved.size() <= 1;
+    st.functions++;
+
+    // ; int name(int a, int b)   a=R3 b=[slot 0]
+    std::string sig = "; " + std::string(f.returns_value ? "int " : "void ") + f.name + "(";
+    std::string where;
+    for (size_t i = 0; i < f.params.size(); i++) sig += (i ? ", " : "") + f.params[i]->name;
+    sig += ")";
+    for (const auto &v : f.vars) {
+        if (v->reg >= 0) where += " " + v->name + "=" + reg_name(v->reg);
+        else if (v->slot >= 0) where += " " + v->name + "=slot" + std::to_string(v->slot);
+    }
+    lines.push_back("");
+    lines.push_back(sig + (where.empty() ? "" : "   ;" + where));
+    label("f_" + f.name);
+
+    emit_prologue(f);
+    gen_stmt(*f.body);
+
+    if (lines.back() == "        JMP " + ret_label) {
+        lines.pop_back();
+        st.instructions--;
+    }
+    if (!inline_epilogue) {
+        label(ret_label);
+        emit_epilogue();
+    }
+    else if (lines.back() != "        RET") {
+        emit_epilogue();
+    }
+}
+
+// ============================================================
+// Variables
+// ============================================================
+
+// Byte offset of a frame variable (element 0 of an array) from the current SP
+int CodeGen::var_offset(const Var *v) const {
+    if (v->slot >= 0) {
+        int lowest = v->slot + (v->is_array ? v->size - 1 : 0);
+        return 2 * (push_depth + frame_slots - 1 - lowest);
+    }
+    return 2 * (push_depth + frame_slots + (int)saved.size() + 1 + (v->param_index - ARG_REGS));
+}
+
+// NUM, scalar VAR, or array element at a constant index
+bool CodeGen::trivial(const Expr &e) {
+    return e.kind == Ex::NUM || e.kind == Ex::VAR ||
+           (e.kind == Ex::INDEX && e.a->kind == Ex::NUM);
+}
+
+// Load a trivial expression straight into reg (no temporaries)
+void CodeGen::load_into(const Expr &e, int reg) {
+    std::string r = reg_name(reg);
+
+    if (e.kind == Ex::NUM) {
+        emit("MOVI " + r + ", " + std::to_string(e.value));
+        zf_reg = reg;
+        return;
+    }
+    if (e.kind == Ex::INDEX) {
+        int k = 2 * e.a->value;
+        if (e.var->global) {
+            emit("LOAD " + r + ", " + global_label(e.var) + (k ? "+" + std::to_string(k) : ""));
+        }
+        else {
+            emit("MOVSP " + r);
+            emit("LOAD " + r + ", " + mem(reg, std::to_string(var_offset(e.var) + k)));
+        }
+        return;
+    }
+
+    const Var *v = e.var;
+    if (v->reg >= 0) {
+        if (v->reg != reg) {
+            emit("MOV " + r + ", " + reg_name(v->reg));
+            zf_reg = reg;
+        }
+    }
+    else if (v->global) {
+        emit("LOAD " + r + ", " + global_label(v));
+    }
+    else {
+        emit("MOVSP " + r);
+        emit("LOAD " + r + ", " + mem(reg, std::to_string(var_offset(v))));
+    }
+}
+
+void CodeGen::store_var(const Var *v, int reg) {
+    if (v->reg >= 0) {
+        if (v->reg != reg) {
+            emit("MOV " + reg_name(v->reg) + ", " + reg_name(reg));
+            zf_reg = v->reg;
+        }
+    }
+    else if (v->global) {
+        emit("STORE " + reg_name(reg) + ", " + global_label(v));
+    }
+    else {
+        int a = alloc();
+        emit("MOVSP " + reg_name(a));
+        emit("STORE " + reg_name(reg) + ", " + mem(a, std::to_string(var_offset(v))));
+        release({a, true});
+    }
+}
+
+// ============================================================
+// Statements
+// ============================================================
+void CodeGen::gen_stmt(const Stmt &s) {
+    auto ends_in_jump = [&]() {
+        const std::string &l = lines.back();
+        return l.compare(0, 12, "        JMP ") == 0 || l == "        RET";
+    };
+
+    switch (s.kind) {
+        case St::EXPR:
+            release(gen(*s.e, false));
+            break;
+
+        case St::DECL:
+            if (!s.e) break;
+            if (s.var->reg >= 0) {
+                gen_to(*s.e, s.var->reg);
+            }
+            else {
+                Val v = gen(*s.e);
+                store_var(s.var, v.reg);
+                release(v);
+            }
+            break;
+
+        case St::IF: {
+            std::string end = new_label();
+            if (!s.else_body) {
+                gen_branch(*s.e, end, false);
+                gen_stmt(*s.body);
+            }
+            else {
+                std::string other = new_label();
+                gen_branch(*s.e, other, false);
+                gen_stmt(*s.body);
+                if (!ends_in_jump()) emit("JMP " + end);
+                label(other);
+                gen_stmt(*s.else_body);
+            }
+            label(end);
+            break;
+        }
+
+        // Loops are rotated: the condition is tested at the bottom,
+        // so each iteration costs one conditional jump.
+        case St::WHILE:
+        case St::FOR: {
+            if (s.init) gen_stmt(*s.init);
+            if (s.e && s.e->kind == Ex::NUM && s.e->value == 0) break;
+
+            std::string top = new_label(), cont = new_label(), cond = new_label(), brk = new_label();
+            bool test = s.e && s.e->kind != Ex::NUM;
+
+            if (test) emit("JMP " + cond);
+            label(top);
+            loops.push_back({brk, s.step ? cont : cond});
+            gen_stmt(*s.body);
+            loops.pop_back();
+            label(cont);
+            if (s.step) release(gen(*s.step, false));
+            label(cond);
+            if (test) gen_branch(*s.e, top, true);
+            else emit("JMP " + top);
+            label(brk);
+            break;
+        }
+
+        case St::DO: {
+            std::string top = new_label(), cont = new_label(), brk = new_label();
+            label(top);
+            loops.push_back({brk, cont});
+            gen_stmt(*s.body);
+            loops.pop_back();
+            label(cont);
+            gen_branch(*s.e, top, true);
+            label(brk);
+            break;
+        }
+
+        case St::RETURN:
+            if (s.e) {
+                Val v = gen(*s.e);
+                if (v.reg != 0) emit("MOV R0, " + reg_name(v.reg));
+                release(v);
+            }
+            if (inline_epilogue) emit_epilogue();
+            else emit("JMP " + ret_label);
+            break;
+
+        case St::BREAK:
+            emit("JMP " + loops.back().first);
+            break;
+
+        case St::CONTINUE:
+            emit("JMP " + loops.back().second);
+            break;
+
+        case St::BLOCK:
+            for (const auto &c : s.list) gen_stmt(*c);
+            break;
+    }
+
+    if (push_depth != 0 || free_count() != (int)temps.size())
+        throw CompileError(s.line, "internal: unbalanced registers after statement");
+}
+
+// ============================================================
+// Expressions
+// ============================================================
+
+// Registers needed to evaluate e (Sethi-Ullman number)
+int CodeGen::need(const Expr &e) const {
+    switch (e.kind) {
+        case Ex::NUM:
+            return 1;
+        case Ex::VAR:
+            return e.var->reg >= 0 ? 0 : 1;
+        case Ex::INDEX:
+            if (e.a->kind == Ex::NUM) return 1;
+            return std::max(need(*e.a), 1) + (e.var->global ? 0 : 1);
+        case Ex::UNARY:
+            return std::max(need(*e.a), 1);
+        case Ex::BINARY: {
+            if (needs_signed_divide(e)) return CALL_NEED;
+            if (e.op == "&&" || e.op == "||") return std::max(need(*e.a), need(*e.b));
+
+            int n;
+            if (e.b->kind == Ex::NUM) {
+                n = std::max(need(*e.a), 1);
+            }
+            else {
+                int a = need(*e.a), b = need(*e.b);
+                n = std::max(a == b ? a + 1 : std::max(a, b), 1);
+                // signed compare copies both sides to flip their sign bits
+                if (is_comparison(e.op) && e.op != "==" && e.op != "!=" && !unsigned_compare(e))
+                    n = std::max(n, 2);
+            }
+            return n;
+        }
+        case Ex::ASSIGN:
+        case Ex::INCDEC: {
+            int n = e.b ? std::max(need(*e.b), 1) : 1;
+            return e.a->kind == Ex::INDEX ? n + 1 : n;
+        }
+        case Ex::CALL:
+            return CALL_NEED;
+        default:
+            return 1;
+    }
+}
+
+CodeGen::Val CodeGen::gen(const Expr &e, bool want) {
+    switch (e.kind) {
+        case Ex::NUM: {
+            int t = alloc();
+            load_into(e, t);
+            return {t, true};
+        }
+
+        case Ex::STR:
+            throw CompileError(e.line, "string literals are only supported as a printf format");
+
+        case Ex::VAR: {
+            if (e.var->reg >= 0) return {e.var->reg, false};
+            int t = alloc();
+            load_into(e, t);
+            return {t, true};
+        }
+
+        case Ex::INDEX: {
+            if (trivial(e)) {
+                int t = alloc();
+                load_into(e, t);
+                return {t, true};
+            }
+            Addr a = gen_element(e);
+            emit("LOAD " + reg_name(a.reg.reg) + ", " + operand(a));
+            return a.reg;
+        }
+
+        case Ex::UNARY:
+            return gen_unary(e);
+
+        case Ex::BINARY:
+            return gen_binary(e);
+
+        case Ex::ASSIGN:
+            return gen_assign(e, want);
+
+        case Ex::INCDEC:
+            return gen_incdec(e, want);
+
+        case Ex::CALL: {
+            if (is_builtin(e.name)) return gen_builtin(e, want);
+            std::vector<const Expr*> args;
+            for (const auto &a : e.args) args.push_back(a.get());
+            return gen_call("f_" + e.name, args, want);
+        }
+    }
+    return {};
+}
+
+// Evaluate e while other values are held; spills the held values
+// to the stack if e would otherwise run out of registers.
+CodeGen::Val CodeGen::gen_held(const Expr &e, std::initializer_list<Val*> held) {
+    int n = std::min(need(e), (int)temps.size());
+    if (free_count() >= n) return gen(e);
+
+    std::vector<Val*> spilled;
+    for (Val *h : held) {
+        if (!h->owned) continue;
+        push(h->reg);
+        release(*h);
+        spilled.push_back(h);
+        st.spills++;
+    }
+
+    Val v = gen(e);
+    for (auto it = spilled.rbegin(); it != spilled.rend(); ++it) {
+        int r = alloc();
+        pop(r);
+        **it = {r, true};
+    }
+    return v;
+}
+
+// Evaluate e directly into a variable's home register
+void CodeGen::gen_to(const Expr &e, int reg) {
+    if (trivial(e)) {
+        load_into(e, reg);
+        return;
+    }
+    if (e.kind == Ex::INDEX) {
+        Addr a = gen_element(e);
+        emit("LOAD " + reg_name(reg) + ", " + operand(a));
+        release(a.reg);
+        return;
+    }
+
+    // x = a op b: build a in place, then apply b, as long as b does not
+    // read the variable that is being overwritten
+    const Var *target = nullptr;
+    for (const auto &v : fn->vars)
+        if (v->reg == reg) target = v.get();
+
+    if (e.kind == Ex::BINARY && !is_comparison(e.op) && e.op != "&&" && e.op != "||" &&
+        !needs_signed_divide(e) && target && !references(*e.b, target) &&
+        (e.b->kind == Ex::NUM || (e.op != "<<" && e.op != ">>"))) {
+        gen_to(*e.a, reg);
+        if (e.b->kind == Ex::NUM) {
+            emit_alu_imm(e.op, reg, e.b->value, e);
+        }
+        else {
+            Val r = gen(*e.b);
+            emit_alu(e.op, reg, r.reg, e.is_unsigned);
+            release(r);
+        }
+        return;
+    }
+
+    Val v = gen(e);
+    if (v.reg != reg) {
+        emit("MOV " + reg_name(reg) + ", " + reg_name(v.reg));
+        zf_reg = reg;
+    }
+    release(v);
+}
+
+void CodeGen::emit_alu(const std::string &op, int rd, int rs, bool) {
+    static const std::pair<const char*, const char*> OPS[] = {
+        {"+", "ADD"}, {"-", "SUB"}, {"&", "AND"}, {"|", "OR"}, {"^", "XOR"},
+        {"*", "MUL"}, {"/", "DIV"}, {"%", "MOD"},
+    };
+    for (const auto &o : OPS) {
+        if (op == o.first) {
+            emit(std::string(o.second) + " " + reg_name(rd) + ", " + reg_name(rs));
+            zf_reg = rd;
+            return;
+        }
+    }
+    throw CompileError(fn->line, "shift amount must be a constant");
+}
+
+void CodeGen::emit_alu_imm(const std::string &op, int rd, int imm, const Expr &e) {
+    std::string r = reg_name(rd);
+    imm &= 0xFFFF;
+
+    if (op == "<<") {
+        if (imm >= 16)     emit("MOVI " + r + ", 0");
+        else if (imm == 1) emit("ADD " + r + ", " + r);
+        else               emit("MULI " + r + ", " + std::to_string(1 << imm));
+    }
+    else if (op == ">>") {
+        if (imm >= 16) emit("MOVI " + r + ", 0");
+        else           emit("DIVI " + r + ", " + std::to_string(1 << imm));
+    }
+    else if (op == "%" && log2_exact(imm) >= 0 && (e.is_unsigned || nonneg(*e.a))) {
+        emit("ANDI " + r + ", " + std::to_string(imm - 1));
+    }
+    else if (op == "+" && imm >= 0x8000) {
+        emit("SUBI " + r + ", " + std::to_string(0x10000 - imm));
+    }
+    else if (op == "-" && imm >= 0x8000) {
+        emit("ADDI " + r + ", " + std::to_string(0x10000 - imm));
+    }
+    else {
+        static const std::pair<const char*, const char*> OPS[] = {
+            {"+", "ADDI"}, {"-", "SUBI"}, {"&", "ANDI"}, {"|", "ORI"}, {"^", "XORI"},
+            {"*", "MULI"}, {"/", "DIVI"}, {"%", "MODI"},
+        };
+        for (const auto &o : OPS) {
+            if (op == o.first) {
+                bool bits = op == "&" || op == "|" || op == "^";
+                emit(std::string(o.second) + " " + r + ", " + (bits ? hex(imm) : std::to_string(imm)));
+                zf_reg = rd;
+                return;
+            }
+        }
+        throw CompileError(e.line, "internal: no immediate form for '" + op + "'");
+    }
+    zf_reg = rd;
+}
+
+CodeGen::Val CodeGen::gen_binary(const Expr &e) {
+    const std::string &op = e.op;
+
+    if (is_comparison(op) || op == "&&" || op == "||") return gen_bool(e);
+
+    if (needs_signed_divide(e)) {
+        use_divs |= op == "/";
+        use_mods |= op == "%";
+        return gen_call(op == "/" ? "__divs" : "__mods", {e.a.get(), e.b.get()}, true);
+    }
+
+    if (e.b->kind == Ex::NUM) {
+        Val l = own(gen(*e.a));
+        emit_alu_imm(op, l.reg, e.b->value, e);
+        return l;
+    }
+    if (op == "<<" || op == ">>") throw CompileError(e.line, "shift amount must be a constant");
+
+    // Larger subtree first, so the smaller one has registers to spare
+    Val l, r;
+    if (need(*e.b) > need(*e.a)) {
+        r = gen(*e.b);
+        l = gen_held(*e.a, {&r});
+    }
+    else {
+        l = gen(*e.a);
+        r = gen_held(*e.b, {&l});
+    }
+
+    bool commutes = op == "+" || op == "*" || op == "&" || op == "|" || op == "^";
+    if (commutes && !l.owned && r.owned) std::swap(l, r);
+
+    l = own(l);
+    emit_alu(op, l.reg, r.reg, e.is_unsigned);
+    release(r);
+    return l;
+}
+
+CodeGen::Val CodeGen::gen_unary(const Expr &e) {
+    if (e.op == "!") return gen_bool(e);
+
+    Val a = gen(*e.a);
+    if (e.op == "~") {
+        a = own(a);
+        emit("XORI " + reg_name(a.reg) + ", 0xFFFF");
+        zf_reg = a.reg;
+        return a;
+    }
+
+    // Negate: 0 - a for a variable, ~a + 1 for a temporary
+    if (!a.owned) {
+        int t = alloc();
+        emit("MOVI " + reg_name(t) + ", 0");
+        emit("SUB " + reg_name(t) + ", " + reg_name(a.reg));
+        zf_reg = t;
+        return {t, true};
+    }
+    emit("XORI " + reg_name(a.reg) + ", 0xFFFF");
+    emit("ADDI " + reg_name(a.reg) + ", 1");
+    zf_reg = a.reg;
+    return a;
+}
+
+// Comparison / logical operator as a 0 or 1 value
+CodeGen::Val CodeGen::gen_bool(const Expr &e) {
+    std::string f = new_label();
+
+    if (free_count() > need(e)) {
+        int t = alloc();
+        emit("MOVI " + reg_name(t) + ", 0");
+        gen_branch(e, f, false);
+        emit("MOVI " + reg_name(t) + ", 1");
+        label(f);
+        return {t, true};
+    }
+
+    std::string end = new_label();
+    gen_branch(e, f, false);
+    int t = alloc();
+    emit("MOVI " + reg_name(t) + ", 1");
+    emit("JMP " + end);
+    label(f);
+    emit("MOVI " + reg_name(t) + ", 0");
+    label(end);
+    return {t, true};
+}
+
+// Address of an array element. Globals use the label as the
+// displacement; frame arrays add SP (taken now, so later pushes
+// do not move the element).
+CodeGen::Addr CodeGen::gen_element(const Expr &e) {
+    const Var *v = e.var;
+    const Expr &index = *e.a;
+
+    if (index.kind == Ex::NUM) {
+        int k = 2 * index.value;
+        if (v->global) return {{}, global_label(v) + (k ? "+" + std::to_string(k) : "")};
+        int u = alloc();
+        emit("MOVSP " + reg_name(u));
+        return {{u, true}, std::to_string(var_offset(v) + k)};
+    }
+
+    Val i = own(gen(index));
+    emit("ADD " + reg_name(i.reg) + ", " + reg_name(i.reg));
+    if (v->global) return {i, global_label(v)};
+
+    int u = alloc();
+    emit("MOVSP " + reg_name(u));
+    emit("ADD " + reg_name(i.reg) + ", " + reg_name(u));
+    release({u, true});
+    return {i, std::to_string(var_offset(v))};
+}
+
+std::string CodeGen::operand(const Addr &a) {
+    return a.reg.reg < 0 ? a.disp : mem(a.reg.reg, a.disp);
+}
+
+CodeGen::Val CodeGen::gen_assign(const Expr &e, bool want) {
+    const Expr &t = *e.a;
+
+    // Scalars (compound forms were rewritten to x = x op y by the parser)
+    if (t.kind == Ex::VAR) {
+        const Var *v = t.var;
+        if (v->reg >= 0) {
+            gen_to(*e.b, v->reg);
+            return {v->reg, false};
+        }
+        Val x = gen(*e.b);
+        store_var(v, x.reg);
+        if (want) return x;
+        release(x);
+        return {};
+    }
+
+    // Array element
+    std::string op = e.op.substr(0, e.op.size() - 1);
+
+    Addr a = gen_element(t);
+
+    Val x;
+    if (op.empty()) {
+        x = gen_held(*e.b, {&a.reg});
+    }
+    else {
+        x = {alloc(), true};
+        emit("LOAD " + reg_name(x.reg) + ", " + operand(a));
+        if (needs_signed_divide(e)) {
+            use_divs |= op == "/";
+            use_mods |= op == "%";
+            x = call_divide(op == "/" ? "__divs" : "__mods", x, *e.b);
+        }
+        else if (e.b->kind == Ex::NUM) {
+            emit_alu_imm(op, x.reg, e.b->value, e);
+        }
+        else {
+            Val r = gen_held(*e.b, {&a.reg, &x});
+            emit_alu(op, x.reg, r.reg, e.is_unsigned);
+            release(r);
+        }
+    }
+
+    emit("STORE " + reg_name(x.reg) + ", " + operand(a));
+    release(a.reg);
+    if (want) return x;
+    release(x);
+    return {};
+}
+
+CodeGen::Val CodeGen::gen_incdec(const Expr &e, bool want) {
+    const Expr &t = *e.a;
+    std::string step = e.op == "++" ? "ADDI " : "SUBI ";
+    bool old_value = e.postfix && want;
+
+    if (t.kind == Ex::VAR && t.var->reg >= 0) {
+        int h = t.var->reg;
+        Val old;
+        if (old_value) {
+            old = {alloc(), true};
+            emit("MOV " + reg_name(old.reg) + ", " + reg_name(h));
+        }
+        emit(step + reg_name(h) + ", 1");
+        zf_reg = h;
+        return old_value ? old : Val{h, false};
+    }
+
+    Addr a;
+    if (t.kind == Ex::INDEX) a = gen_element(t);
+    Val x = {alloc(), true};
+    if (t.kind == Ex::VAR) load_into(t, x.reg);
+    else emit("LOAD " + reg_name(x.reg) + ", " + operand(a));
+
+    Val old;
+    if (old_value) {
+        old = {alloc(), true};
+        emit("MOV " + reg_name(old.reg) + ", " + reg_name(x.reg));
+    }
+    emit(step + reg_name(x.reg) + ", 1");
+
+    if (t.kind == Ex::VAR) store_var(t.var, x.reg);
+    else emit("STORE " + reg_name(x.reg) + ", " + operand(a));
+    release(a.reg);
+
+    if (old_value) {
+        release(x);
+        return old;
+    }
+    if (want) return x;
+    release(x);
+    return {};
+}
+
+// ------------------------------------------------------------
+// Calls
+// Live temporaries are pushed first, then stack arguments,
+// then R0..R2 are loaded; the result comes back in R0.
+// ------------------------------------------------------------
+CodeGen::Val CodeGen::gen_call(const std::string &target, const std::vector<const Expr*> &args,
+                               bool want) {
+    std::vector<int> live;
+    for (int r : temps) {
+        if (!(free_mask & (1 << r))) {
+            push(r);
+            free_mask |= 1 << r;
+            live.push_back(r);
+        }
+    }
+
+    int n = (int)args.size();
+    for (int j = n - 1; j >= ARG_REGS; j--) {
+        Val v = gen(*args[j]);
+        push(v.reg);
+        release(v);
+    }
+
+    int m = std::min(n, ARG_REGS);
+    std::vector<int> complex;
+    for (int i = 0; i < m; i++)
+        if (!trivial(*args[i])) complex.push_back(i);
+
+    if (complex.size() == 1) {
+        int i = complex[0];
+        Val v = gen(*args[i]);
+        if (v.reg != i) emit("MOV " + reg_name(i) + ", " + reg_name(v.reg));
+        release(v);
+        reserve(i);
+    }
+    else if (complex.size() > 1) {
+        for (int i : complex) {
+            Val v = gen(*args[i]);
+            push(v.reg);
+            release(v);
+        }
+        for (auto it = complex.rbegin(); it != complex.rend(); ++it) {
+            pop(*it);
+            reserve(*it);
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        if (trivial(*args[i])) {
+            load_into(*args[i], i);
+            reserve(i);
+        }
+    }
+
+    emit("CALL " + target);
+    for (int r : temps) free_mask |= 1 << r;
+
+    if (n > ARG_REGS) {
+        adjust_sp(n - ARG_REGS, 1);
+        push_depth -= n - ARG_REGS;
+    }
+
+    Val res;
+    if (want) {
+        if (std::find(live.begin(), live.end(), 0) == live.end()) {
+            res = {0, true};
+        }
+        else {
+            for (int r : temps)
+                if (r != 0 && std::find(live.begin(), live.end(), r) == live.end()) res = {r, true};
+            if (res.reg < 0)
+                throw CompileError(fn->line, "expression too complex around call to '" + target + "'");
+            emit("MOV " + reg_name(res.reg) + ", R0");
+        }
+        reserve(res.reg);
+    }
+
+    for (auto it = live.rbegin(); it != live.rend(); ++it) {
+        pop(*it);
+        reserve(*it);
+    }
+    return res;
+}
+
+// Helper call whose dividend is already in a register (a[i] /= y):
+// it waits on the stack while the divisor is evaluated.
+CodeGen::Val CodeGen::call_divide(const std::string &helper, Val x, const Expr &divisor) {
+    release(x);
+    std::vector<int> live;
+    for (int r : temps) {
+        if (!(free_mask & (1 << r))) {
+            push(r);
+            free_mask |= 1 << r;
+            live.push_back(r);
+        }
+    }
+
+    push(x.reg);
+    Val v = gen(divisor);
+    if (v.reg != 1) emit("MOV R1, " + reg_name(v.reg));
+    release(v);
+    pop(0);
+    emit("CALL " + helper);
+
+    Val res{0, true};
+    if (std::find(live.begin(), live.end(), 0) != live.end()) {
+        res.reg = -1;
+        for (int r : temps)
+            if (r != 0 && std::find(live.begin(), live.end(), r) == live.end()) res.reg = r;
+        if (res.reg < 0) throw CompileError(divisor.line, "expression too complex around division");
+        emit("MOV " + reg_name(res.reg) + ", R0");
+    }
+    reserve(res.reg);
+    for (auto it = live.rbegin(); it != live.rend(); ++it) {
+        pop(*it);
+        reserve(*it);
+    }
+    return res;
+}
+
+// putchar(c), print(n), printf("fmt", ...)
+CodeGen::Val CodeGen::gen_builtin(const Expr &e, bool want) {
+    if (e.name == "putchar" || e.name == "print") {
+        Val v = gen(*e.args[0]);
+        emit("STORE " + reg_name(v.reg) + ", " + hex(e.name == "putchar" ? IO_OUTPUT_CHAR : IO_OUTPUT_NUM));
+        if (want) return v;
+        release(v);
+        return {};
+    }
+
+    // printf: literal text → STRPRINT, %c → character port,
+    // %d/%u/%x → runtime helpers
+    const std::string &fmt = e.args[0]->name;
+    size_t arg = 1;
+    std::string text;
+
+    auto flush = [&]() {
+        if (text.empty()) return;
+        int t = alloc();
+        if (text.size() == 1) {
+            emit("MOVI " + reg_name(t) + ", " + std::to_string((unsigned char)text[0]));
+            emit("STORE " + reg_name(t) + ", " + hex(IO_OUTPUT_CHAR));
+        }
+        else {
+            auto it = std::find(strings.begin(), strings.end(), text);
+            size_t id = it - strings.begin();
+            if (it == strings.end()) strings.push_back(text);
+            emit("MOVI " + reg_name(t) + ", s_" + std::to_string(id));
+            emit("STRPRINT " + reg_name(t));
+        }
+        release({t, true});
+        text.clear();
+    };
+
+    for (size_t i = 0; i < fmt.size(); i++) {
+        if (fmt[i] != '%' || i + 1 >= fmt.size()) { text += fmt[i]; continue; }
+        char c = fmt[++i];
+        if (c == '%') { text += '%'; continue; }
+
+        flush();
+        const Expr &a = *e.args[arg++];
+        if (c == 'c') {
+            Val v = gen(a);
+            emit("STORE " + reg_name(v.reg) + ", " + hex(IO_OUTPUT_CHAR));
+            release(v);
+        }
+        else {
+            use_print = true;
+            const char *helper = c == 'd' ? "__printd" : c == 'u' ? "__printu" : "__printx";
+            gen_call(helper, {&a}, false);
+        }
+    }
+    flush();
+
+    if (!want) return {};
+    int t = alloc();
+    emit("MOVI " + reg_name(t) + ", 0");
+    return {t, true};
+}
+
+// ============================================================
+// Conditions
+// ============================================================
+void CodeGen::gen_branch(const Expr &e, const std::string &target, bool jump_if) {
+    if (e.kind == Ex::NUM) {
+        if ((e.value != 0) == jump_if) emit("JMP " + target);
+        return;
+    }
+    if (e.kind == Ex::UNARY && e.op == "!") {
+        gen_branch(*e.a, target, !jump_if);
+        return;
+    }
+    if (e.kind == Ex::BINARY && (e.op == "&&" || e.op == "||")) {
+        bool is_and = e.op == "&&";
+        if (is_and != jump_if) {
+            // && jumping when false / || jumping when true: either side decides
+            gen_branch(*e.a, target, jump_if);
+            gen_branch(*e.b, target, jump_if);
+        }
+        else {
+            std::string skip = new_label();
+            gen_branch(*e.a, skip, !jump_if);
+            gen_branch(*e.b, target, jump_if);
+            label(skip);
+        }
+        return;
+    }
+    if (e.kind == Ex::BINARY && is_comparison(e.op)) {
+        gen_compare(e, target, jump_if);
+        return;
+    }
+
+    Val v = gen(e);
+    if (zf_reg != v.reg) emit("CMPI " + reg_name(v.reg) + ", 0");
+    release(v);
+    emit(std::string(jump_if ? "JNZ " : "JZ ") + target);
+}
+
+// Signed comparisons flip the sign bit of both sides (x ^ 0x8000)
+// and compare unsigned; skipped when both sides are known to be
+// non-negative.
+void CodeGen::gen_compare(const Expr &e, const std::string &target, bool jump_if) {
+    const std::string &op = e.op;
+    const Expr &a = *e.a, &b = *e.b;
+    bool uns = unsigned_compare(e);
+
+    auto jump = [&](const std::string &when_true) {
+        static const std::pair<const char*, const char*> INV[] = {
+            {"JZ", "JNZ"}, {"JNZ", "JZ"}, {"JC", "JNC"}, {"JNC", "JC"},
+        };
+        std::string j = when_true;
+        if (!jump_if)
+            for (const auto &p : INV)
+                if (when_true == p.first) j = p.second;
+        emit(j + " " + target);
+    };
+    auto always = [&](bool value) {
+        if (value == jump_if) emit("JMP " + target);
+    };
+
+    Val l = gen(a);
+
+    if (op == "==" || op == "!=") {
+        if (b.kind == Ex::NUM) {
+            if (!(b.value == 0 && zf_reg == l.reg))
+                emit("CMPI " + reg_name(l.reg) + ", " + std::to_string(b.value));
+        }
+        else {
+            Val r = gen_held(b, {&l});
+            emit("CMP " + reg_name(l.reg) + ", " + reg_name(r.reg));
+            release(r);
+        }
+        release(l);
+        jump(op == "==" ? "JZ" : "JNZ");
+        return;
+    }
+
+    // x < 0 / x >= 0: just the sign bit
+    if (!uns && b.kind == Ex::NUM && b.value == 0 && (op == "<" || op == ">=")) {
+        emit("CMPI " + reg_name(l.reg) + ", 0x8000");
+        release(l);
+        jump(op == "<" ? "JNC" : "JC");
+        return;
+    }
+
+    if (!uns) {
+        l = own(l);
+        emit("XORI " + reg_name(l.reg) + ", 0x8000");
+    }
+
+    if (b.kind == Ex::NUM) {
+        int c = b.value ^ (uns ? 0 : 0x8000);
+        std::string r = reg_name(l.reg);
+        release(l);
+        if (op == "<")  { emit("CMPI " + r + ", " + std::to_string(c)); jump("JC"); }
+        if (op == ">=") { emit("CMPI " + r + ", " + std::to_string(c)); jump("JNC"); }
+        if (op == ">") {
+            if (c == 0xFFFF) { always(false); return; }
+            emit("CMPI " + r + ", " + std::to_string(c + 1));
+            jump("JNC");
+        }
+        if (op == "<=") {
+            if (c == 0xFFFF) { always(true); return; }
+            emit("CMPI " + r + ", " + std::to_string(c + 1));
+            jump("JC");
+        }
+        return;
+    }
+
+    Val r = gen_held(b, {&l});
+    if (!uns) {
+        r = own(r);
+        emit("XORI " + reg_name(r.reg) + ", 0x8000");
+    }
+    std::string x = reg_name(l.reg), y = reg_name(r.reg);
+    release(l);
+    release(r);
+    if (op == "<")  { emit("CMP " + x + ", " + y); jump("JC"); }
+    if (op == ">=") { emit("CMP " + x + ", " + y); jump("JNC"); }
+    if (op == ">")  { emit("CMP " + y + ", " + x); jump("JC"); }
+    if (op == "<=") { emit("CMP " + y + ", " + x); jump("JNC"); }
+}
+
+// ============================================================
+// Runtime helpers and data
+// ============================================================
+void CodeGen::emit_helpers() {
+    auto raw = [&](const char *const *text) {
+        lines.push_back("");
+        for (; *text; text++) lines.push_back(*text);
+    };
+
+    // Signed divide / remainder: R0 = R0 op R1, truncating toward zero
+    static const char *const DIVS[] = {
+        "; signed R0 / R1 (clobbers R1, R2)",
+        "__divs:",
+        "        MOVI R2, 0",
+        "        CMPI R0, 0x8000",
+        "        JC __divs_a",
+        "        XORI R0, 0xFFFF",
+        "        ADDI R0, 1",
+        "        MOVI R2, 1",
+        "__divs_a:",
+        "        CMPI R1, 0x8000",
+        "        JC __divs_b",
+        "        XORI R1, 0xFFFF",
+        "        ADDI R1, 1",
+        "        XORI R2, 1",
+        "__divs_b:",
+        "        DIV R0, R1",
+        "        CMPI R2, 0",
+        "        JZ __divs_end",
+        "        XORI R0, 0xFFFF",
+        "        ADDI R0, 1",
+        "__divs_end:",
+        "        RET",
+        nullptr,
+    };
+    static const char *const MODS[] = {
+        "; signed R0 % R1, sign of the dividend (clobbers R1, R2)",
+        "__mods:",
+        "        MOVI R2, 0",
+        "        CMPI R0, 0x8000",
+        "        JC __mods_a",
+        "        XORI R0, 0xFFFF",
+        "        ADDI R0, 1",
+        "        MOVI R2, 1",
+        "__mods_a:",
+        "        CMPI R1, 0x8000",
+        "        JC __mods_b",
+        "        XORI R1, 0xFFFF",
+        "        ADDI R1, 1",
+        "__mods_b:",
+        "        MOD R0, R1",
+        "        CMPI R2, 0",
+        "        JZ __mods_end",
+        "        XORI R0, 0xFFFF",
+        "        ADDI R0, 1",
+        "__mods_end:",
+        "        RET",
+        nullptr,
+    };
+
+    if (use_divs) raw(DIVS);
+    if (use_mods) raw(MODS);
+
+    if (use_print) {
+        // Number → text through the FORMAT hypercall, then STRPRINT
+        const std::vector<std::string> print = {
+            "",
+            "; printf %d / %u / %x of R0 (clobbers R0, R1)",
+            "__printd:",
+            "        CMPI R0, 0x8000",
+            "        JC __printu",
+            "        MOVI R1, 45",
+            "        STORE R1, " + hex(IO_OUTPUT_CHAR),
+            "        XORI R0, 0xFFFF",
+            "        ADDI R0, 1",
+            "__printu:",
+            "        MOVI R1, 10",
+            "__printnum:",
+            "        STORE R0, " + hex(IO_HCALL_ARG0),
+            "        STORE R1, " + hex(IO_HCALL_ARG0 + 2),
+            "        MOVI R1, __numbuf",
+            "        STORE R1, " + hex(IO_HCALL_ARG0 + 4),
+            "        MOVI R1, " + std::to_string(HCALL_FORMAT),
+            "        STORE R1, " + hex(IO_HCALL_CALL),
+            "        MOVI R1, __numbuf",
+            "        STRPRINT R1",
+            "        RET",
+            "__printx:",
+            "        MOVI R1, 16",
+            "        JMP __printnum",
+        };
+        lines.insert(lines.end(), print.begin(), print.end());
+    }
+}
+
+// .asciz for plain text, .byte otherwise
+static std::string string_directive(const std::string &s) {
+    bool plain = true;
+    for (char c : s)
+        if ((c < 0x20 || c > 0x7E) && c != '\n' && c != '\t') plain = false;
+
+    if (plain) {
+        std::string out = ".asciz \"";
+        for (char c : s) {
+            if (c == '\n') out += "\\n";
+            else if (c == '\t') out += "\\t";
+            else if (c == '"' || c == '\\') { out += '\\'; out += c; }
+            else out += c;
+        }
+        return out + "\"";
+    }
+
+    std::string out = ".byte ";
+    for (char c : s) out += std::to_string((unsigned char)c) + ", ";
+    return out + "0";
+}
+
+void CodeGen::emit_data() {
+    if (prog.globals.empty() && strings.empty() && !use_print) return;
+
+    lines.push_back("");
+    lines.push_back("; ---------------- data ----------------");
+
+    for (const auto &g : prog.globals) {
+        std::string name = global_label(g.get());
+        std::vector<int> init = g->init;
+        if (!g->is_array && init.empty()) init.push_back(0);
+
+        if (init.empty()) {
+            lines.push_back(name + ":");
+        }
+        for (size_t i = 0; i < init.size(); i += 8) {
+            std::string l = i == 0 ? name + ": .word " : "        .word ";
+            for (size_t j = i; j < init.size() && j < i + 8; j++)
+                l += (j > i ? ", " : "") + std::to_string(init[j] & 0xFFFF);
+            lines.push_back(l);
+        }
+        int rest = g->size - (int)init.size();
+        if (rest > 0) lines.push_back("        .space " + std::to_string(2 * rest));
+    }
+
+    for (size_t i = 0; i < strings.size(); i++)
+        lines.push_back("s_" + std::to_string(i) + ": " + string_directive(strings[i]));
+
+    if (use_print) lines.push_back("__numbuf: .space 8");
+}
+
+// ============================================================
+// Whole program
+// ============================================================
+std::string CodeGen::generate(const std::string &source_name) {
+    const Function *main_fn = prog.find_function("main");
+    if (!main_fn) throw CompileError(1, "no main() function");
+    if (!main_fn->params.empty()) throw CompileError(main_fn->line, "main() must take no parameters");
+
+    lines.push_back("; compiled from " + source_name);
+    lines.push_back("        CALL f_main");
+    lines.push_back("        HALT");
+    st.instructions += 2;
+
+    for (const auto &f : prog.functions) gen_function(*f);
+    emit_helpers();
+    emit_data();
+
+    std::string out;
+    for (const auto &l : lines) out += l + "\n";
+    return out;
+}
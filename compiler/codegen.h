@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+
+// ============================================================
+// CodeGen
+// Emits assembler source for the whole program.
+//
+// Calling convention
+//   - arguments 0..2 in R0..R2, further ones pushed right to
+//     left (caller pops them)
+//   - result in R0
+//   - R0..R2 caller-saved, R3..R5 callee-saved
+//
+// Register allocation (per function)
+//   Variables are ranked by loop-weighted use count. Leaf
+//   functions may keep the top variable in a caller-saved
+//   register; after that variables go to R3..R5 (saved in the
+//   prologue) and the rest to SP-relative frame slots. The
+//   remaining caller-saved registers evaluate expressions,
+//   spilling to the stack when an expression runs out.
+//
+// Frame (high → low):  stack args | return PC | saved R3..R5 |
+//                      slot 0 .. slot n-1 | expression pushes
+// There is no frame pointer: the generator tracks its own
+// pushes and addresses slots with MOVSP + indexed LOAD/STORE.
+// ============================================================
+class CodeGen {
+public:
+    explicit CodeGen(const Program &prog) : prog(prog) {}
+
+    // Throws CompileError
+    std::string generate(const std::string &source_name);
+
+    struct Stats {
+        int functions          = 0;
+        int instructions       = 0;
+        int vars_in_registers  = 0;
+        int vars_in_frame      = 0;
+        int spills             = 0;    // expression temporaries pushed
+    };
+    const Stats &stats() const { return st; }
+
+private:
+    // A value in a register. Borrowed values live in a variable's
+    // home register and must not be modified.
+    struct Val {
+        int reg = -1;
+        bool owned = false;
+    };
+
+    const Program &prog;
+    Stats st;
+    std::vector<std::string> lines;
+    int label_count = 0;
+    int zf_reg = -1;                  // register ZF currently reflects
+
+    // Runtime helpers and data referenced by the program
+    bool use_divs = false, use_mods = false, use_print = false;
+    std::vector<std::string> strings;
+
+    // Per-function state
+    const Function *fn = nullptr;
+    std::vector<int> temps;           // registers for expression evaluation
+    uint8_t free_mask = 0;            // temps not currently holding a value
+    std::vector<int> saved;           // callee-saved registers in use
+    int frame_slots = 0;
+    int push_depth = 0;               // words pushed since the prologue
+    std::string ret_label;
+    bool inline_epilogue = false;
+    std::vector<std::pair<std::string, std::string>> loops;   // break, continue
+
+    // Output
+    void emit(const std::string &ins);
+    void label(const std::string &name);
+    std::string new_label();
+    void push(int reg);
+    void pop(int reg);
+
+    // Registers
+    int  alloc();
+    void release(Val v);
+    int  free_count() const;
+    Val  own(Val v);
+    void reserve(int reg);
+
+    // Functions
+    void allocate_registers(const Function &f);
+    void gen_function(const Function &f);
+    void emit_prologue(const Function &f);
+    void emit_epilogue();
+    void adjust_sp(int words, int scratch);
+
+    // Variables
+    int  var_offset(const Var *v) const;
+    void load_into(const Expr &e, int reg);
+    void store_var(const Var *v, int reg);
+    static bool trivial(const Expr &e);
+
+    // Statements
+    void gen_stmt(const Stmt &s);
+
+    // Expressions
+    int need(const Expr &e) const;
+    Val gen(const Expr &e, bool want = true);
+    Val gen_held(const Expr &e, std::initializer_list<Val*> held);
+    void gen_to(const Expr &e, int reg);
+    Val gen_binary(const Expr &e);
+    Val gen_unary(const Expr &e);
+    Val gen_bool(const Expr &e);
+    Val gen_assign(const Expr &e, bool want);
+    Val gen_incdec(const Expr &e, bool want);
+
+    // Array element operand: absolute "label+k", or [Rx+disp] with
+    // Rx holding an address computed by gen_element
+    struct Addr {
+        Val reg;
+        std::string disp;
+    };
+    Addr gen_element(const Expr &e);
+    static std::string operand(const Addr &a);
+
+    Val gen_call(const std::string &target, const std::vector<const Expr*> &args, bool want);
+    Val call_divide(const std::string &helper, Val x, const Expr &divisor);
+    Val gen_builtin(const Expr &e, bool want);
+    void emit_alu(const std::string &op, int rd, int rs, bool is_unsigned);
+    void emit_alu_imm(const std::string &op, int rd, int imm, const Expr &e);
+
+    // Conditions
+    void gen_branch(const Expr &e, const std::string &target, bool jump_if);
+    void gen_compare(const Expr &e, const std::string &target, bool jump_if);
+
+    // Trailer
+    void emit_helpers();
+    void emit_data();
+};
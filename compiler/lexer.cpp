@@ -0,0 +1,134 @@
+#include "lexer.h"
+#include "ast.h"
+
+#include <cctype>
+
+// Longest first, so "<=" wins over "<"
+static const char *const PUNCTUATORS[] = {
+    "<<=", ">>=",
+    "==", "!=", "<=", ">=", "&&", "||", "++", "--",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "<<", ">>",
+    "+", "-", "*", "/", "%", "&", "|", "^", "!", "~", "<", ">", "=",
+    "(", ")", "{", "}", "[", "]", ";", ",",
+};
+
+// ------------------------------------------------------------
+// Escape after a backslash in a char or string literal
+// ------------------------------------------------------------
+static char unescape(char c, int line) {
+    switch (c) {
+        case 'n':  return '\n';
+        case 't':  return '\t';
+        case 'r':  return '\r';
+        case '0':  return '\0';
+        case '\\': return '\\';
+        case '\'': return '\'';
+        case '"':  return '"';
+        default:
+            throw CompileError(line, std::string("unknown escape \\") + c);
+    }
+}
+
+std::vector<Token> tokenize(std::string_view src) {
+    std::vector<Token> toks;
+    int line = 1;
+    size_t i = 0;
+    bool line_start = true;
+
+    while (i < src.size()) {
+        char c = src[i];
+
+        if (c == '\n') { line++; i++; line_start = true; continue; }
+        if (std::isspace((unsigned char)c)) { i++; continue; }
+
+        // Preprocessor directive: ignored to end of line
+        if (c == '#' && line_start) {
+            while (i < src.size() && src[i] != '\n') i++;
+            continue;
+        }
+        line_start = false;
+
+        // Comments
+        if (src.compare(i, 2, "//") == 0) {
+            while (i < src.size() && src[i] != '\n') i++;
+            continue;
+        }
+        if (src.compare(i, 2, "/*") == 0) {
+            size_t end = src.find("*/", i + 2);
+            if (end == std::string_view::npos)
+                throw CompileError(line, "unterminated comment");
+            for (size_t k = i; k < end; k++)
+                if (src[k] == '\n') line++;
+            i = end + 2;
+            continue;
+        }
+
+        Token t;
+        t.line = line;
+
+        if (std::isalpha((unsigned char)c) || c == '_') {
+            size_t s = i;
+            while (i < src.size() && (std::isalnum((unsigned char)src[i]) || src[i] == '_')) i++;
+            t.kind = Tok::IDENT;
+            t.text = std::string(src.substr(s, i - s));
+        }
+        else if (std::isdigit((unsigned char)c)) {
+            size_t s = i;
+            while (i < src.size() && std::isalnum((unsigned char)src[i])) i++;
+            std::string text(src.substr(s, i - s));
+            while (!text.empty() && (text.back() == 'u' || text.back() == 'U'))
+                text.pop_back();
+
+            size_t used = 0;
+            unsigned long v = 0;
+            try { v = std::stoul(text, &used, 0); } catch (...) { used = 0; }
+            if (used != text.size() || v > 0xFFFF)
+                throw CompileError(line, "bad number '" + std::string(src.substr(s, i - s)) + "'");
+            t.kind = Tok::NUM;
+            t.value = (int)v;
+        }
+        else if (c == '\'') {
+            i++;
+            if (i >= src.size()) throw CompileError(line, "unterminated character literal");
+            char v = src[i++];
+            if (v == '\\' && i < src.size()) v = unescape(src[i++], line);
+            if (i >= src.size() || src[i] != '\'')
+                throw CompileError(line, "unterminated character literal");
+            i++;
+            t.kind = Tok::NUM;
+            t.value = (unsigned char)v;
+        }
+        else if (c == '"') {
+            i++;
+            t.kind = Tok::STR;
+            while (i < src.size() && src[i] != '"') {
+                if (src[i] == '\n') throw CompileError(line, "unterminated string literal");
+                char v = src[i++];
+                if (v == '\\' && i < src.size()) v = unescape(src[i++], line);
+                t.text += v;
+            }
+            if (i >= src.size()) throw CompileError(line, "unterminated string literal");
+            i++;
+        }
+        else {
+            t.kind = Tok::PUNCT;
+            for (const char *p : PUNCTUATORS) {
+                if (src.compare(i, std::char_traits<char>::length(p), p) == 0) {
+                    t.text = p;
+                    break;
+                }
+            }
+            if (t.text.empty())
+                throw CompileError(line, std::string("unexpected character '") + c + "'");
+            i += t.text.size();
+        }
+
+        toks.push_back(std::move(t));
+    }
+
+    Token end;
+    end.kind = Tok::END;
+    end.line = line;
+    toks.push_back(end);
+    return toks;
+}
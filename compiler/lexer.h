@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ============================================================
+// Lexer
+// Splits C source into tokens. Preprocessor lines (#include
+// etc.) and comments are skipped; character literals become
+// numbers.
+// ============================================================
+
+enum class Tok { IDENT, NUM, STR, PUNCT, END };
+
+struct Token {
+    Tok kind;
+    std::string text;     // identifier, punctuator, or string contents
+    int value = 0;        // NUM
+    int line  = 0;
+};
+
+// Throws CompileError on malformed input
+std::vector<Token> tokenize(std::string_view source);
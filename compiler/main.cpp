@@ -0,0 +1,82 @@
+#include "codegen.h"
+#include "lexer.h"
+#include "optimize.h"
+#include "parser.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// ------------------------------------------------------------
+// Print what the optimizer and allocator did
+// ------------------------------------------------------------
+static void print_report(const OptStats &o, const CodeGen::Stats &g) {
+    std::cout << "Compiled " << g.functions << " function(s), "
+              << g.instructions << " instructions\n"
+              << "  constants folded:          " << o.folded << "\n"
+              << "  strength reductions:       " << o.strength_reduced << "\n"
+              << "  loop invariants hoisted:   " << o.hoisted << "\n"
+              << "  variables in registers:    " << g.vars_in_registers << "\n"
+              << "  variables in stack frame:  " << g.vars_in_frame << "\n"
+              << "  expression spills:         " << g.spills << "\n";
+}
+
+int main(int argc, char** argv) {
+    bool optimize = true;
+    bool verbose = false;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        std::string flag = argv[arg];
+        if (flag == "-O0") optimize = false;
+        else if (flag == "-v") verbose = true;
+        else break;
+    }
+
+    if (argc - arg != 2) {
+        std::cout << "Usage: compiler [-O0] [-v] <input.c> <output.asm>\n";
+        return 1;
+    }
+
+    std::string inputFile  = argv[arg];
+    std::string outputFile = argv[arg + 1];
+
+    std::ifstream in(inputFile);
+    if (!in) {
+        std::cerr << "Cannot open " << inputFile << "\n";
+        return 1;
+    }
+    std::stringstream source;
+    source << in.rdbuf();
+
+    OptStats opt;
+    std::string text;
+    CodeGen::Stats gen_stats;
+    try {
+        Program prog;
+        Parser(tokenize(source.str())).parse(prog);
+
+        for (auto &f : prog.functions) {
+            if (optimize) optimize_function(*f, opt);
+            analyze(*f, prog);
+        }
+
+        CodeGen gen(prog);
+        text = gen.generate(inputFile);
+        gen_stats = gen.stats();
+    }
+    catch (const CompileError &e) {
+        std::cerr << inputFile << ":" << e.what() << "\n";
+        std::cerr << "Compilation failed.\n";
+        return 1;
+    }
+
+    std::ofstream out(outputFile);
+    if (!out) {
+        std::cerr << "Cannot write " << outputFile << "\n";
+        return 1;
+    }
+    out << text;
+
+    if (verbose) print_report(opt, gen_stats);
+    return 0;
+}
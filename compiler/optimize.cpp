@@ -0,0 +1,665 @@
+#include "optimize.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+static int wrap(long v) { return (int)(v & 0xFFFF); }
+static int to_signed(int v) { return (int16_t)(uint16_t)v; }
+
+static int log2_exact(int v) {
+    for (int k = 0; k < 16; k++)
+        if (v == (1 << k)) return k;
+    return -1;
+}
+
+// No calls, assignments or increments anywhere inside
+static bool pure(const Expr &e) {
+    if (e.kind == Ex::CALL || e.kind == Ex::ASSIGN || e.kind == Ex::INCDEC) return false;
+    if (e.a && !pure(*e.a)) return false;
+    if (e.b && !pure(*e.b)) return false;
+    return true;
+}
+
+static bool is_comparison(const std::string &op) {
+    return op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=";
+}
+
+static bool commutative(const std::string &op) {
+    return op == "+" || op == "*" || op == "&" || op == "|" || op == "^" ||
+           op == "==" || op == "!=";
+}
+
+// %d, %u and %x are printed by runtime helpers (see codegen)
+static bool printf_needs_helper(const std::string &fmt) {
+    for (size_t i = 0; i + 1 < fmt.size(); i++) {
+        if (fmt[i] != '%') continue;
+        char c = fmt[++i];
+        if (c == 'd' || c == 'u' || c == 'x') return true;
+    }
+    return false;
+}
+
+bool is_builtin(const std::string &name) {
+    return name == "putchar" || name == "print" || name == "printf";
+}
+
+// Evaluate a binary operator on two 16-bit constants.
+// Returns false when the result must be left to run time
+// (division by zero keeps the CPU's defined behaviour).
+static bool eval_binary(const std::string &op, int a, int b, bool uns, int &r) {
+    int sa = uns ? a : to_signed(a);
+    int sb = uns ? b : to_signed(b);
+
+    if (op == "+")  { r = wrap(a + b); return true; }
+    if (op == "-")  { r = wrap(a - b); return true; }
+    if (op == "*")  { r = wrap((long)a * b); return true; }
+    if (op == "&")  { r = a & b; return true; }
+    if (op == "|")  { r = a | b; return true; }
+    if (op == "^")  { r = a ^ b; return true; }
+    if (op == "<<") { r = b < 16 ? wrap((long)a << b) : 0; return true; }
+    if (op == ">>") { r = b < 16 ? a >> b : 0; return true; }
+    if (op == "/" || op == "%") {
+        if (b == 0) return false;
+        r = wrap(op == "/" ? sa / sb : sa % sb);
+        return true;
+    }
+    if (op == "==") { r = a == b; return true; }
+    if (op == "!=") { r = a != b; return true; }
+    if (op == "<")  { r = sa <  sb; return true; }
+    if (op == "<=") { r = sa <= sb; return true; }
+    if (op == ">")  { r = sa >  sb; return true; }
+    if (op == ">=") { r = sa >= sb; return true; }
+    if (op == "&&") { r = a && b; return true; }
+    if (op == "||") { r = a || b; return true; }
+    return false;
+}
+
+static void make_num(ExprPtr &e, int v, OptStats *stats) {
+    auto n = std::make_unique<Expr>(Ex::NUM, e->line);
+    n->value = wrap(v);
+    e = std::move(n);
+    if (stats) stats->folded++;
+}
+
+// Replace e by one of its operands, keeping e's result type
+static void replace_by(ExprPtr &e, ExprPtr &child, OptStats *stats) {
+    bool uns = e->is_unsigned;
+    ExprPtr c = std::move(child);
+    c->is_unsigned = c->is_unsigned || uns;
+    e = std::move(c);
+    if (stats) stats->folded++;
+}
+
+// ============================================================
+// Constant folding / algebraic simplification
+// ============================================================
+void fold_constants(ExprPtr &e, OptStats *stats) {
+    if (!e) return;
+    if (e->a) fold_constants(e->a, stats);
+    if (e->b) fold_constants(e->b, stats);
+    for (auto &arg : e->args) fold_constants(arg, stats);
+
+    if (e->kind == Ex::UNARY && e->a->kind == Ex::NUM) {
+        int v = e->a->value;
+        if (e->op == "-") make_num(e, -v, stats);
+        else if (e->op == "~") make_num(e, ~v, stats);
+        else if (e->op == "!") make_num(e, v == 0, stats);
+        return;
+    }
+
+    if (e->kind != Ex::BINARY) return;
+
+    const std::string op = e->op;
+    bool uns = e->a->is_unsigned || e->b->is_unsigned;
+
+    if (e->a->kind == Ex::NUM && e->b->kind == Ex::NUM) {
+        int r;
+        if (eval_binary(op, e->a->value, e->b->value, uns, r)) make_num(e, r, stats);
+        return;
+    }
+
+    // Short-circuit operators with a constant left side
+    if ((op == "&&" || op == "||") && e->a->kind == Ex::NUM) {
+        bool a = e->a->value != 0;
+        if (op == "&&" && !a) { make_num(e, 0, stats); return; }
+        if (op == "||" &&  a) { make_num(e, 1, stats); return; }
+        // (1 && x) / (0 || x) → x != 0
+        auto cmp = std::make_unique<Expr>(Ex::BINARY, e->line);
+        cmp->op = "!=";
+        cmp->a = std::move(e->b);
+        cmp->b = std::make_unique<Expr>(Ex::NUM, e->line);
+        e = std::move(cmp);
+        if (stats) stats->folded++;
+        return;
+    }
+
+    // Constant operand on the right, so codegen can use the immediate form
+    if (e->a->kind == Ex::NUM && e->b->kind != Ex::NUM) {
+        if (commutative(op)) {
+            std::swap(e->a, e->b);
+        }
+        else if (is_comparison(op)) {
+            std::swap(e->a, e->b);
+            e->op = op == "<" ? ">" : op == ">" ? "<" : op == "<=" ? ">=" : "<=";
+        }
+    }
+    if (e->b->kind != Ex::NUM) return;
+
+    ExprPtr &x = e->a;
+    int c = e->b->value;
+
+    // (x + c1) + c2, (x - c1) + c2, ... → x + c
+    if ((op == "+" || op == "-") && x->kind == Ex::BINARY &&
+        (x->op == "+" || x->op == "-") && x->b->kind == Ex::NUM) {
+        int total = (x->op == "+" ? x->b->value : -x->b->value) + (op == "+" ? c : -c);
+        ExprPtr inner = std::move(x->a);
+        e->a = std::move(inner);
+        e->op = to_signed(wrap(total)) < 0 ? "-" : "+";
+        e->b->value = wrap(e->op == "+" ? total : -total);
+        if (stats) stats->folded++;
+        fold_constants(e, stats);
+        return;
+    }
+
+    // Identities
+    if ((c == 0 && (op == "+" || op == "-" || op == "|" || op == "^" || op == "<<" || op == ">>")) ||
+        (c == 1 && (op == "*" || op == "/"))) {
+        replace_by(e, e->a, stats);
+        return;
+    }
+    if ((c == 0 && (op == "*" || op == "&")) && pure(*x)) {
+        make_num(e, 0, stats);
+        return;
+    }
+
+    // Strength reduction
+    if (op == "*") {
+        int k = log2_exact(c);
+        if (k > 0) {
+            e->op = "<<";
+            e->b->value = k;
+            if (stats) stats->strength_reduced++;
+        }
+        else if (c == 0xFFFF) {
+            auto neg = std::make_unique<Expr>(Ex::UNARY, e->line);
+            neg->op = "-";
+            neg->is_unsigned = e->is_unsigned;
+            neg->a = std::move(e->a);
+            e = std::move(neg);
+            if (stats) stats->strength_reduced++;
+        }
+        return;
+    }
+    if (op == "%" && uns && log2_exact(c) >= 0) {
+        e->op = "&";
+        e->b->value = c - 1;
+        if (stats) stats->strength_reduced++;
+        return;
+    }
+}
+
+// ============================================================
+// Sign analysis
+// ============================================================
+bool nonneg(const Expr &e) {
+    switch (e.kind) {
+        case Ex::NUM:
+            return e.value < 0x8000;
+        case Ex::VAR:
+            return !e.var->is_unsigned && e.var->nonneg;
+        case Ex::UNARY:
+            return e.op == "!";
+        case Ex::BINARY: {
+            const std::string &op = e.op;
+            if (is_comparison(op) || op == "&&" || op == "||") return true;
+            if (e.is_unsigned) return false;
+            if (op == "&")  return nonneg(*e.a) || nonneg(*e.b);
+            if (op == ">>") return e.b->kind == Ex::NUM ? (e.b->value > 0 || nonneg(*e.a)) : false;
+            if (op == "+" || op == "*" || op == "/" || op == "%" || op == "|" || op == "^")
+                return nonneg(*e.a) && nonneg(*e.b);
+            return false;
+        }
+        case Ex::ASSIGN:
+            return e.op == "=" && !e.is_unsigned && nonneg(*e.b);
+        default:
+            return false;
+    }
+}
+
+bool needs_signed_divide(const Expr &e) {
+    bool div = (e.kind == Ex::BINARY && (e.op == "/" || e.op == "%")) ||
+               (e.kind == Ex::ASSIGN && (e.op == "/=" || e.op == "%="));
+    if (!div || e.is_unsigned || e.a->is_unsigned || e.b->is_unsigned) return false;
+    return !(nonneg(*e.a) && nonneg(*e.b));
+}
+
+// Does this assignment keep a nonneg variable nonneg?
+static bool keeps_nonneg(const Expr &e) {
+    if (e.kind == Ex::INCDEC) return e.op == "++";
+    const std::string &op = e.op;
+    if (op == "&=" || op == ">>=") return true;
+    if (op == "-=" || op == "<<=") return false;
+    return nonneg(*e.b);
+}
+
+// ============================================================
+// Tree walking
+// ============================================================
+template <typename F>
+static void for_each_expr(Expr &e, F &&fn) {
+    fn(e);
+    if (e.a) for_each_expr(*e.a, fn);
+    if (e.b) for_each_expr(*e.b, fn);
+    for (auto &arg : e.args) for_each_expr(*arg, fn);
+}
+
+// fn(expr, loop_depth) for every expression under s
+template <typename F>
+static void for_each_expr(Stmt &s, F &&fn, int depth = 0) {
+    int inner = depth;
+    if (s.kind == St::WHILE || s.kind == St::DO || s.kind == St::FOR) inner = depth + 1;
+
+    auto visit = [&](ExprPtr &e, int d) {
+        if (e) for_each_expr(*e, [&](Expr &x) { fn(x, d); });
+    };
+
+    if (s.init) for_each_expr(*s.init, fn, depth);
+    visit(s.e, s.kind == St::DO || s.kind == St::WHILE || s.kind == St::FOR ? inner : depth);
+    visit(s.step, inner);
+    if (s.body) for_each_expr(*s.body, fn, inner);
+    if (s.else_body) for_each_expr(*s.else_body, fn, depth);
+    for (auto &c : s.list) for_each_expr(*c, fn, depth);
+}
+
+static void fold_stmt(Stmt &s, OptStats &stats) {
+    fold_constants(s.e, &stats);
+    fold_constants(s.step, &stats);
+    if (s.init) fold_stmt(*s.init, stats);
+    if (s.body) fold_stmt(*s.body, stats);
+    if (s.else_body) fold_stmt(*s.else_body, stats);
+    for (auto &c : s.list) fold_stmt(*c, stats);
+}
+
+// ============================================================
+// Loop-invariant code motion
+// ============================================================
+namespace {
+
+struct LoopEffects {
+    std::set<const Var*> written;      // scalars assigned or declared in the loop
+    std::set<const Var*> stored;       // arrays stored to in the loop
+    bool calls = false;                // may write any global
+};
+
+void collect_effects(Expr &e, LoopEffects &fx) {
+    for_each_expr(e, [&](Expr &x) {
+        if (x.kind == Ex::CALL && !is_builtin(x.name)) fx.calls = true;
+        if (x.kind == Ex::ASSIGN || x.kind == Ex::INCDEC) {
+            if (x.a->kind == Ex::VAR) fx.written.insert(x.a->var);
+            else fx.stored.insert(x.a->var);
+        }
+    });
+}
+
+void collect_effects(Stmt &s, LoopEffects &fx) {
+    if (s.kind == St::DECL) fx.written.insert(s.var);
+    if (s.e) collect_effects(*s.e, fx);
+    if (s.step) collect_effects(*s.step, fx);
+    if (s.init) collect_effects(*s.init, fx);
+    if (s.body) collect_effects(*s.body, fx);
+    if (s.else_body) collect_effects(*s.else_body, fx);
+    for (auto &c : s.list) collect_effects(*c, fx);
+}
+
+class Hoister {
+public:
+    Hoister(Function &f, OptStats &stats) : f(f), stats(stats) {}
+
+    void run(StmtPtr &s) {
+        if (!s) return;
+        run(s->init);
+        run(s->body);
+        run(s->else_body);
+        for (auto &c : s->list) run(c);
+
+        if (s->kind != St::WHILE && s->kind != St::DO && s->kind != St::FOR) return;
+
+        // Whole assignments first: each one moved out can make the
+        // variables it wrote invariant for the next
+        std::vector<StmtPtr> decls;
+        while (hoist_assignment(*s, decls)) {}
+
+        LoopEffects fx;
+        collect_effects(*s, fx);
+
+        auto hoist_in = [&](ExprPtr &e) { if (e) hoist(e, fx, decls); };
+        hoist_in(s->e);
+        hoist_in(s->step);
+        hoist_stmt(s->body, fx, decls);
+        if (decls.empty()) return;
+
+        // { temps = ...; loop }
+        auto block = std::make_unique<Stmt>(St::BLOCK, s->line);
+        for (auto &d : decls) block->list.push_back(std::move(d));
+        block->list.push_back(std::move(s));
+        s = std::move(block);
+    }
+
+private:
+    Function &f;
+    OptStats &stats;
+    int temp_count = 0;
+
+    bool invariant(const Expr &e, const LoopEffects &fx) const {
+        switch (e.kind) {
+            case Ex::NUM:
+                return true;
+            case Ex::VAR:
+                return !fx.written.count(e.var) && !(e.var->global && fx.calls);
+            case Ex::INDEX:
+                return !fx.stored.count(e.var) && !(e.var->global && fx.calls) &&
+                       invariant(*e.a, fx);
+            case Ex::UNARY:
+                return invariant(*e.a, fx);
+            case Ex::BINARY:
+                return invariant(*e.a, fx) && invariant(*e.b, fx);
+            default:
+                return false;
+        }
+    }
+
+    // Worth a register: real work, and not a condition better left as a branch
+    static bool worth_hoisting(const Expr &e) {
+        if (e.kind == Ex::INDEX) return true;
+        if (e.kind == Ex::UNARY) return e.op != "!";
+        if (e.kind != Ex::BINARY) return false;
+        return !is_comparison(e.op) && e.op != "&&" && e.op != "||";
+    }
+
+    void hoist(ExprPtr &e, const LoopEffects &fx, std::vector<StmtPtr> &decls) {
+        if (worth_hoisting(*e) && invariant(*e, fx)) {
+            auto v = std::make_unique<Var>();
+            v->name = "inv" + std::to_string(temp_count++);
+            v->is_unsigned = e->is_unsigned;
+
+            auto d = std::make_unique<Stmt>(St::DECL, e->line);
+            d->var = v.get();
+
+            auto ref = std::make_unique<Expr>(Ex::VAR, e->line);
+            ref->var = v.get();
+            ref->name = v->name;
+            ref->is_unsigned = v->is_unsigned;
+
+            d->e = std::move(e);
+            e = std::move(ref);
+            decls.push_back(std::move(d));
+            f.vars.push_back(std::move(v));
+            stats.hoisted++;
+            return;
+        }
+        if (e->a) hoist(e->a, fx, decls);
+        if (e->b) hoist(e->b, fx, decls);
+        for (auto &arg : e->args) hoist(arg, fx, decls);
+    }
+
+    // ----------------------------------------------------------
+    // Invariant assignments: "x = e;" or "int x = e;" run on every
+    // trip through the body, with e invariant. Moved in front of
+    // the loop when x is a local written nowhere else in the loop,
+    // not read in it before the assignment, and (for an existing
+    // variable) not read outside it — a loop that runs zero times
+    // or breaks early then cannot expose the early write.
+    // ----------------------------------------------------------
+    static int count_uses(Expr &e, const Var *v, bool writes) {
+        int n = 0;
+        std::function<void(Expr &)> walk = [&](Expr &x) {
+            bool target = (x.kind == Ex::ASSIGN || x.kind == Ex::INCDEC) && x.a->kind == Ex::VAR;
+            if (target && x.a->var == v) {
+                if (writes) n++;
+                else if (x.kind == Ex::INCDEC || x.op != "=") n++;
+            }
+            if (!writes && !target && x.kind == Ex::VAR && x.var == v) n++;
+            if (x.a && !target) walk(*x.a);
+            if (x.b) walk(*x.b);
+            for (auto &arg : x.args) walk(*arg);
+        };
+        walk(e);
+        return n;
+    }
+
+    static int count_uses(Stmt &s, const Var *v, bool writes) {
+        int n = writes && s.kind == St::DECL && s.var == v;
+        if (s.e) n += count_uses(*s.e, v, writes);
+        if (s.step) n += count_uses(*s.step, v, writes);
+        if (s.init) n += count_uses(*s.init, v, writes);
+        if (s.body) n += count_uses(*s.body, v, writes);
+        if (s.else_body) n += count_uses(*s.else_body, v, writes);
+        for (auto &c : s.list) n += count_uses(*c, v, writes);
+        return n;
+    }
+
+    // Statements the body always starts with, in order ({ } opened)
+    static void straight_line(StmtPtr &s, std::vector<StmtPtr*> &out) {
+        if (s->kind != St::BLOCK) { out.push_back(&s); return; }
+        for (auto &c : s->list) straight_line(c, out);
+    }
+
+    bool hoist_assignment(Stmt &loop, std::vector<StmtPtr> &decls) {
+        LoopEffects fx;
+        collect_effects(loop, fx);
+
+        std::vector<StmtPtr*> body;
+        straight_line(loop.body, body);
+
+        for (size_t i = 0; i < body.size(); i++) {
+            Stmt &c = **body[i];
+            Var *v = nullptr;
+            Expr *value = nullptr;
+            if (c.kind == St::DECL && c.e) {
+                v = c.var;
+                value = c.e.get();
+            }
+            else if (c.kind == St::EXPR && c.e->kind == Ex::ASSIGN && c.e->op == "=" &&
+                     c.e->a->kind == Ex::VAR) {
+                v = c.e->a->var;
+                value = c.e->b.get();
+            }
+            if (!v || v->global || v->is_array || !invariant(*value, fx)) continue;
+            if (count_uses(loop, v, true) != 1) continue;
+
+            int reads_before = 0;
+            for (ExprPtr *e : {&loop.e, &loop.step})
+                if (*e) reads_before += count_uses(**e, v, false);
+            if (loop.init) reads_before += count_uses(*loop.init, v, false);
+            for (size_t j = 0; j < i; j++) reads_before += count_uses(**body[j], v, false);
+            if (reads_before) continue;
+
+            if (c.kind == St::EXPR && count_uses(*f.body, v, false) != count_uses(loop, v, false))
+                continue;
+
+            decls.push_back(std::move(*body[i]));
+            *body[i] = std::make_unique<Stmt>(St::BLOCK, c.line);
+            stats.hoisted++;
+            return true;
+        }
+        return false;
+    }
+
+    void hoist_stmt(StmtPtr &s, const LoopEffects &fx, std::vector<StmtPtr> &decls) {
+        if (!s) return;
+        if (s->e) hoist(s->e, fx, decls);
+        if (s->step) hoist(s->step, fx, decls);
+        hoist_stmt(s->init, fx, decls);
+        hoist_stmt(s->body, fx, decls);
+        hoist_stmt(s->else_body, fx, decls);
+        for (auto &c : s->list) hoist_stmt(c, fx, decls);
+    }
+};
+
+} // namespace
+
+// ============================================================
+// Constant locals: written once, by a constant initializer
+// ============================================================
+static bool propagate_constants(Function &f, OptStats &stats) {
+    std::map<const Var*, int> writes;
+    std::map<const Var*, int> value;
+
+    std::function<void(Stmt &)> scan = [&](Stmt &s) {
+        if (s.kind == St::DECL) {
+            writes[s.var]++;
+            if (s.e && s.e->kind == Ex::NUM) value[s.var] = s.e->value;
+        }
+        if (s.init) scan(*s.init);
+        if (s.body) scan(*s.body);
+        if (s.else_body) scan(*s.else_body);
+        for (auto &c : s.list) scan(*c);
+    };
+    scan(*f.body);
+    for_each_expr(*f.body, [&](Expr &x, int) {
+        if ((x.kind == Ex::ASSIGN || x.kind == Ex::INCDEC) && x.a->kind == Ex::VAR)
+            writes[x.a->var]++;
+    });
+
+    bool changed = false;
+    std::function<void(ExprPtr &)> subst = [&](ExprPtr &e) {
+        if (!e) return;
+        if (e->kind == Ex::VAR && writes[e->var] == 1 && value.count(e->var)) {
+            auto n = std::make_unique<Expr>(Ex::NUM, e->line);
+            n->value = value[e->var];
+            n->is_unsigned = e->is_unsigned;
+            e = std::move(n);
+            stats.folded++;
+            changed = true;
+            return;
+        }
+        // Keep assignment targets as variables
+        if ((e->kind == Ex::ASSIGN || e->kind == Ex::INCDEC) && e->a->kind == Ex::VAR) {
+            subst(e->b);
+            return;
+        }
+        subst(e->a);
+        subst(e->b);
+        for (auto &arg : e->args) subst(arg);
+    };
+    std::function<void(Stmt &)> walk = [&](Stmt &s) {
+        // The initializer itself becomes a dead store
+        if (s.kind == St::DECL && writes[s.var] == 1 && value.count(s.var)) s.e.reset();
+        subst(s.e);
+        subst(s.step);
+        if (s.init) walk(*s.init);
+        if (s.body) walk(*s.body);
+        if (s.else_body) walk(*s.else_body);
+        for (auto &c : s.list) walk(*c);
+    };
+    walk(*f.body);
+    return changed;
+}
+
+void optimize_function(Function &f, OptStats &stats) {
+    fold_stmt(*f.body, stats);
+    if (propagate_constants(f, stats)) fold_stmt(*f.body, stats);
+    Hoister(f, stats).run(f.body);
+}
+
+// ============================================================
+// Analysis
+// ============================================================
+static void check_call(const Expr &e, const Program &prog) {
+    if (e.name == "putchar" || e.name == "print") {
+        if (e.args.size() != 1)
+            throw CompileError(e.line, e.name + "() takes one argument");
+        return;
+    }
+    if (e.name == "printf") {
+        if (e.args.empty() || e.args[0]->kind != Ex::STR)
+            throw CompileError(e.line, "printf() needs a string literal format");
+
+        size_t needed = 0;
+        const std::string &fmt = e.args[0]->name;
+        for (size_t i = 0; i < fmt.size(); i++) {
+            if (fmt[i] != '%') continue;
+            char c = i + 1 < fmt.size() ? fmt[++i] : 0;
+            if (c == 'd' || c == 'u' || c == 'c' || c == 'x') needed++;
+            else if (c != '%')
+                throw CompileError(e.line, std::string("unsupported printf conversion '%") + c + "'");
+        }
+        if (e.args.size() - 1 != needed)
+            throw CompileError(e.line, "printf() format expects " + std::to_string(needed) +
+                                       " argument(s)");
+        return;
+    }
+
+    const Function *callee = prog.find_function(e.name);
+    if (!callee) throw CompileError(e.line, "call to undeclared function '" + e.name + "'");
+    if (callee->params.size() != e.args.size())
+        throw CompileError(e.line, "'" + e.name + "' expects " +
+                                   std::to_string(callee->params.size()) + " argument(s)");
+}
+
+void analyze(Function &f, const Program &prog) {
+    for (auto &v : f.vars) {
+        v->weight = 0;
+        // Optimistic start for locals; parameters come from callers
+        v->nonneg = !v->is_unsigned && v->param_index < 0;
+    }
+
+    // Sign analysis: drop variables until every assignment keeps the rest nonneg
+    for (bool changed = true; changed;) {
+        changed = false;
+        auto drop = [&](Var *v) {
+            if (v && v->nonneg && !v->global) { v->nonneg = false; changed = true; }
+        };
+        // DECLs are statements, so visit them separately from expressions
+        std::function<void(Stmt &)> decls = [&](Stmt &s) {
+            if (s.kind == St::DECL && s.e && !nonneg(*s.e)) drop(s.var);
+            if (s.init) decls(*s.init);
+            if (s.body) decls(*s.body);
+            if (s.else_body) decls(*s.else_body);
+            for (auto &c : s.list) decls(*c);
+        };
+        decls(*f.body);
+        for_each_expr(*f.body, [&](Expr &x, int) {
+            if ((x.kind == Ex::ASSIGN || x.kind == Ex::INCDEC) && x.a->kind == Ex::VAR &&
+                !keeps_nonneg(x))
+                drop(x.a->var);
+        });
+    }
+
+    // Use counts, calls
+    f.has_calls = false;
+    for_each_expr(*f.body, [&](Expr &x, int depth) {
+        if (x.kind == Ex::VAR || x.kind == Ex::INDEX) {
+            double w = 1;
+            for (int i = 0; i < depth && i < 4; i++) w *= 8;
+            x.var->weight += w;
+        }
+        if (x.kind == Ex::CALL) {
+            check_call(x, prog);
+            if (!is_builtin(x.name)) f.has_calls = true;
+            if (x.name == "printf" && printf_needs_helper(x.args[0]->name))
+                f.has_calls = true;
+        }
+        if (needs_signed_divide(x)) f.has_calls = true;
+    });
+
+    // A declaration's initializer counts as a write the register has to absorb
+    std::function<void(Stmt &, int)> decl_weight = [&](Stmt &s, int depth) {
+        int inner = (s.kind == St::WHILE || s.kind == St::DO || s.kind == St::FOR) ? depth + 1 : depth;
+        if (s.kind == St::DECL && s.e) {
+            double w = 1;
+            for (int i = 0; i < depth && i < 4; i++) w *= 8;
+            s.var->weight += w;
+        }
+        if (s.init) decl_weight(*s.init, depth);
+        if (s.body) decl_weight(*s.body, inner);
+        if (s.else_body) decl_weight(*s.else_body, depth);
+        for (auto &c : s.list) decl_weight(*c, depth);
+    };
+    decl_weight(*f.body, 0);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ast.h"
+
+// ============================================================
+// Tree-level optimization and analysis
+//
+//   fold_constants      constant folding, algebraic identities,
+//                       constants moved to the right-hand side
+//                       (so codegen can use immediate forms),
+//                       x * 2^k → x << k, unsigned x % 2^k → x & m
+//   hoist_invariants    loop-invariant expressions are computed
+//                       once into a temporary before the loop;
+//                       invariant assignments the body always
+//                       runs are moved in front of it
+//   analyze             loop-weighted use counts (for register
+//                       allocation), sign analysis, call checks
+// ============================================================
+
+struct OptStats {
+    int folded           = 0;     // nodes replaced by a constant or operand
+    int strength_reduced = 0;     // mul/mod replaced by shift/and
+    int hoisted          = 0;     // loop-invariant expressions moved out
+};
+
+void fold_constants(ExprPtr &e, OptStats *stats = nullptr);
+void optimize_function(Function &f, OptStats &stats);
+
+// Must run (after optimize_function, if at all) before codegen.
+// Throws CompileError for calls to unknown functions or with
+// the wrong number of arguments.
+void analyze(Function &f, const Program &prog);
+
+// Value is provably in 0..0x7FFF (needs analyze() for variables)
+bool nonneg(const Expr &e);
+
+// Signed '/' or '%' that must go through the runtime helper
+bool needs_signed_divide(const Expr &e);
+
+// putchar, print, printf
+bool is_builtin(const std::string &name);
@@ -0,0 +1,589 @@
+#include "parser.h"
+#include "optimize.h"
+
+// ------------------------------------------------------------
+// Token helpers
+// ------------------------------------------------------------
+const Token &Parser::peek(size_t ahead) const {
+    size_t i = pos + ahead;
+    return i < toks.size() ? toks[i] : toks.back();
+}
+
+const Token &Parser::next() {
+    const Token &t = peek();
+    if (pos < toks.size() - 1) pos++;
+    return t;
+}
+
+bool Parser::is(const char *punct) const {
+    return peek().kind == Tok::PUNCT && peek().text == punct;
+}
+
+bool Parser::accept(const char *punct) {
+    if (!is(punct)) return false;
+    next();
+    return true;
+}
+
+void Parser::expect(const char *punct) {
+    if (!accept(punct)) {
+        const Token &t = peek();
+        std::string got = t.kind == Tok::END ? "end of file" : "'" + t.text + "'";
+        if (t.kind == Tok::NUM) got = "number";
+        if (t.kind == Tok::STR) got = "string";
+        throw CompileError(t.line, std::string("expected '") + punct + "' before " + got);
+    }
+}
+
+std::string Parser::expect_ident() {
+    const Token &t = peek();
+    if (t.kind != Tok::IDENT) throw CompileError(t.line, "expected identifier");
+    next();
+    return t.text;
+}
+
+bool Parser::at_type() const {
+    const Token &t = peek();
+    return t.kind == Tok::IDENT &&
+           (t.text == "int" || t.text == "char" || t.text == "unsigned" ||
+            t.text == "signed" || t.text == "void" || t.text == "const");
+}
+
+// int, char, void, [un]signed [int|char]; const is accepted and ignored
+Parser::Type Parser::parse_type() {
+    Type type;
+    bool any = false;
+    while (at_type()) {
+        std::string w = next().text;
+        if (w == "void") type.is_void = true;
+        if (w == "unsigned") type.is_unsigned = true;
+        any = true;
+    }
+    if (!any) throw CompileError(peek().line, "expected type");
+    return type;
+}
+
+// ============================================================
+// Translation unit
+// ============================================================
+void Parser::parse(Program &p) {
+    prog = &p;
+    scopes.assign(1, {});
+
+    while (peek().kind != Tok::END) {
+        int line = peek().line;
+        Type type = parse_type();
+        std::string name = expect_ident();
+
+        if (is("(")) parse_function(type, name, line);
+        else parse_global(type, name, line);
+    }
+
+    for (const auto &f : prog->functions)
+        if (!f->defined)
+            throw CompileError(f->line, "function '" + f->name + "' declared but never defined");
+}
+
+void Parser::parse_function(const Type &ret, const std::string &name, int line) {
+    if (scopes[0].count(name))
+        throw CompileError(line, "'" + name + "' already declared as a variable");
+
+    Function *f = prog->find_function(name);
+    if (!f) {
+        prog->functions.push_back(std::make_unique<Function>());
+        f = prog->functions.back().get();
+        f->name = name;
+    }
+
+    // Parameters (a definition replaces a prototype's list)
+    std::vector<std::unique_ptr<Var>> vars;
+    std::vector<Var*> params;
+    expect("(");
+    if (!(peek().kind == Tok::IDENT && peek().text == "void" && peek(1).text == ")")) {
+        while (!is(")")) {
+            Type t = parse_type();
+            if (t.is_void) throw CompileError(peek().line, "parameter cannot be void");
+            auto v = std::make_unique<Var>();
+            v->is_unsigned = t.is_unsigned;
+            v->param_index = (int)params.size();
+            if (peek().kind == Tok::IDENT) v->name = next().text;
+            if (is("[")) throw CompileError(peek().line, "array parameters are not supported");
+            params.push_back(v.get());
+            vars.push_back(std::move(v));
+            if (!accept(",")) break;
+        }
+    }
+    else {
+        next();
+    }
+    expect(")");
+
+    if (f->line && f->params.size() != params.size())
+        throw CompileError(line, "conflicting parameter count for '" + name + "'");
+    f->line = line;
+    f->returns_value = !ret.is_void;
+    f->returns_unsigned = ret.is_unsigned;
+
+    if (accept(";")) {
+        if (!f->defined) {
+            f->params = params;
+            f->vars = std::move(vars);
+        }
+        return;
+    }
+
+    if (f->defined) throw CompileError(line, "redefinition of '" + name + "'");
+    f->defined = true;
+    f->params = params;
+    f->vars = std::move(vars);
+
+    fn = f;
+    scopes.emplace_back();
+    for (Var *p : f->params) {
+        if (p->name.empty()) throw CompileError(line, "parameter name missing");
+        if (scopes.back().count(p->name))
+            throw CompileError(line, "duplicate parameter '" + p->name + "'");
+        scopes.back()[p->name] = p;
+    }
+
+    if (!is("{")) throw CompileError(peek().line, "expected function body");
+    f->body = parse_block();
+
+    scopes.pop_back();
+    fn = nullptr;
+}
+
+void Parser::parse_global(const Type &type, const std::string &first, int line) {
+    if (type.is_void) throw CompileError(line, "variable cannot be void");
+
+    std::string name = first;
+    for (;;) {
+        if (scopes[0].count(name) || prog->find_function(name))
+            throw CompileError(line, "redefinition of '" + name + "'");
+
+        auto v = std::make_unique<Var>();
+        v->name = name;
+        v->global = true;
+        v->is_unsigned = type.is_unsigned;
+
+        if (accept("[")) {
+            v->is_array = true;
+            v->size = is("]") ? 0 : constant_expr();
+            expect("]");
+        }
+
+        if (accept("=")) {
+            if (v->is_array && peek().kind == Tok::STR) {
+                for (char c : next().text) v->init.push_back((unsigned char)c);
+                v->init.push_back(0);
+            }
+            else if (v->is_array) {
+                expect("{");
+                while (!is("}")) {
+                    v->init.push_back(constant_expr());
+                    if (!accept(",")) break;
+                }
+                expect("}");
+            }
+            else {
+                v->init.push_back(constant_expr());
+            }
+        }
+
+        if (v->is_array) {
+            if (v->size == 0) v->size = (int)v->init.size();
+            if (v->size <= 0) throw CompileError(line, "array '" + name + "' has no size");
+            if ((int)v->init.size() > v->size)
+                throw CompileError(line, "too many initializers for '" + name + "'");
+        }
+
+        scopes[0][name] = v.get();
+        prog->globals.push_back(std::move(v));
+
+        if (!accept(",")) break;
+        line = peek().line;
+        name = expect_ident();
+    }
+    expect(";");
+}
+
+int Parser::constant_expr() {
+    int line = peek().line;
+    ExprPtr e = parse_assign();
+    fold_constants(e);
+    if (e->kind != Ex::NUM) throw CompileError(line, "constant expression required");
+    return e->value;
+}
+
+Var *Parser::declare_local(const std::string &name, const Type &type, int line) {
+    if (type.is_void) throw CompileError(line, "variable cannot be void");
+    if (scopes.back().count(name))
+        throw CompileError(line, "redefinition of '" + name + "'");
+
+    auto v = std::make_unique<Var>();
+    v->name = name;
+    v->is_unsigned = type.is_unsigned;
+    Var *p = v.get();
+    fn->vars.push_back(std::move(v));
+    scopes.back()[name] = p;
+    return p;
+}
+
+Var *Parser::lookup(const std::string &name, int line) const {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto f = it->find(name);
+        if (f != it->end()) return f->second;
+    }
+    throw CompileError(line, "'" + name + "' undeclared");
+}
+
+// ============================================================
+// Statements
+// ============================================================
+StmtPtr Parser::parse_block() {
+    auto s = std::make_unique<Stmt>(St::BLOCK, peek().line);
+    expect("{");
+    scopes.emplace_back();
+    while (!is("}")) {
+        if (peek().kind == Tok::END) throw CompileError(peek().line, "missing '}'");
+        s->list.push_back(parse_statement());
+    }
+    next();
+    scopes.pop_back();
+    return s;
+}
+
+// int a = 1, b;  →  BLOCK of DECLs in the current scope
+StmtPtr Parser::parse_declaration() {
+    int line = peek().line;
+    Type type = parse_type();
+    auto s = std::make_unique<Stmt>(St::BLOCK, line);
+
+    do {
+        int l = peek().line;
+        std::string name = expect_ident();
+        int size = 0;
+        if (accept("[")) {
+            size = constant_expr();
+            expect("]");
+            if (size <= 0) throw CompileError(l, "array '" + name + "' needs a positive size");
+            if (is("=")) throw CompileError(l, "local array initializers are not supported");
+        }
+
+        // Initializer is parsed before the name comes into scope
+        ExprPtr init;
+        if (accept("=")) init = parse_assign();
+
+        auto d = std::make_unique<Stmt>(St::DECL, l);
+        d->var = declare_local(name, type, l);
+        d->var->is_array = size > 0;
+        d->var->size = size > 0 ? size : 1;
+        d->e = std::move(init);
+        s->list.push_back(std::move(d));
+    } while (accept(","));
+    expect(";");
+
+    return s;
+}
+
+StmtPtr Parser::parse_statement() {
+    const Token &t = peek();
+    int line = t.line;
+
+    if (is("{")) return parse_block();
+    if (accept(";")) return std::make_unique<Stmt>(St::BLOCK, line);
+    if (at_type()) return parse_declaration();
+
+    if (t.kind == Tok::IDENT) {
+        const std::string kw = t.text;
+
+        if (kw == "if") {
+            next();
+            auto s = std::make_unique<Stmt>(St::IF, line);
+            expect("(");
+            s->e = parse_expr();
+            expect(")");
+            s->body = parse_statement();
+            if (peek().kind == Tok::IDENT && peek().text == "else") {
+                next();
+                s->else_body = parse_statement();
+            }
+            return s;
+        }
+
+        if (kw == "while") {
+            next();
+            auto s = std::make_unique<Stmt>(St::WHILE, line);
+            expect("(");
+            s->e = parse_expr();
+            expect(")");
+            loop_depth++;
+            s->body = parse_statement();
+            loop_depth--;
+            return s;
+        }
+
+        if (kw == "do") {
+            next();
+            auto s = std::make_unique<Stmt>(St::DO, line);
+            loop_depth++;
+            s->body = parse_statement();
+            loop_depth--;
+            if (!(peek().kind == Tok::IDENT && peek().text == "while"))
+                throw CompileError(peek().line, "expected 'while' after do body");
+            next();
+            expect("(");
+            s->e = parse_expr();
+            expect(")");
+            expect(";");
+            return s;
+        }
+
+        if (kw == "for") {
+            next();
+            auto s = std::make_unique<Stmt>(St::FOR, line);
+            scopes.emplace_back();
+            expect("(");
+            if (at_type()) {
+                s->init = parse_declaration();
+            }
+            else if (!accept(";")) {
+                s->init = std::make_unique<Stmt>(St::EXPR, line);
+                s->init->e = parse_expr();
+                expect(";");
+            }
+            if (!is(";")) s->e = parse_expr();
+            expect(";");
+            if (!is(")")) s->step = parse_expr();
+            expect(")");
+            loop_depth++;
+            s->body = parse_statement();
+            loop_depth--;
+            scopes.pop_back();
+            return s;
+        }
+
+        if (kw == "return") {
+            next();
+            auto s = std::make_unique<Stmt>(St::RETURN, line);
+            if (!is(";")) s->e = parse_expr();
+            expect(";");
+            if (s->e && !fn->returns_value)
+                throw CompileError(line, "void function '" + fn->name + "' returns a value");
+            return s;
+        }
+
+        if (kw == "break" || kw == "continue") {
+            next();
+            if (loop_depth == 0) throw CompileError(line, "'" + kw + "' outside a loop");
+            expect(";");
+            return std::make_unique<Stmt>(kw == "break" ? St::BREAK : St::CONTINUE, line);
+        }
+    }
+
+    auto s = std::make_unique<Stmt>(St::EXPR, line);
+    s->e = parse_expr();
+    expect(";");
+    return s;
+}
+
+// ============================================================
+// Expressions
+// ============================================================
+bool Parser::is_lvalue(const Expr &e) {
+    return e.kind == Ex::INDEX || (e.kind == Ex::VAR && !e.var->is_array);
+}
+
+ExprPtr Parser::parse_expr() {
+    return parse_assign();
+}
+
+ExprPtr Parser::parse_assign() {
+    ExprPtr lhs = parse_binary(1);
+
+    static const char *const OPS[] = { "=", "+=", "-=", "*=", "/=", "%=",
+                                       "&=", "|=", "^=", "<<=", ">>=" };
+    for (const char *op : OPS) {
+        if (!is(op)) continue;
+        int line = next().line;
+        if (!is_lvalue(*lhs)) throw CompileError(line, "left side of assignment is not assignable");
+
+        auto e = std::make_unique<Expr>(Ex::ASSIGN, line);
+        e->op = op;
+        e->is_unsigned = lhs->is_unsigned;
+        e->b = parse_assign();
+
+        // x op= y  →  x = x op y  (array elements keep the compound
+        // form so the index is evaluated once)
+        if (lhs->kind == Ex::VAR && e->op != "=") {
+            auto x = std::make_unique<Expr>(Ex::VAR, line);
+            x->var = lhs->var;
+            x->name = lhs->name;
+            x->is_unsigned = lhs->is_unsigned;
+
+            auto bin = std::make_unique<Expr>(Ex::BINARY, line);
+            bin->op = e->op.substr(0, e->op.size() - 1);
+            bin->is_unsigned = bin->op == "<<" || bin->op == ">>"
+                                   ? x->is_unsigned
+                                   : x->is_unsigned || e->b->is_unsigned;
+            bin->a = std::move(x);
+            bin->b = std::move(e->b);
+            e->b = std::move(bin);
+            e->op = "=";
+        }
+
+        e->a = std::move(lhs);
+        return e;
+    }
+    return lhs;
+}
+
+static int precedence(const Token &t) {
+    if (t.kind != Tok::PUNCT) return 0;
+    const std::string &s = t.text;
+    if (s == "||") return 1;
+    if (s == "&&") return 2;
+    if (s == "|")  return 3;
+    if (s == "^")  return 4;
+    if (s == "&")  return 5;
+    if (s == "==" || s == "!=") return 6;
+    if (s == "<" || s == "<=" || s == ">" || s == ">=") return 7;
+    if (s == "<<" || s == ">>") return 8;
+    if (s == "+" || s == "-") return 9;
+    if (s == "*" || s == "/" || s == "%") return 10;
+    return 0;
+}
+
+// Precedence climbing; all binary operators are left-associative
+ExprPtr Parser::parse_binary(int min_prec) {
+    ExprPtr lhs = parse_unary();
+
+    for (;;) {
+        int prec = precedence(peek());
+        if (prec < min_prec || prec == 0) return lhs;
+
+        const Token &t = next();
+        auto e = std::make_unique<Expr>(Ex::BINARY, t.line);
+        e->op = t.text;
+        e->a = std::move(lhs);
+        e->b = parse_binary(prec + 1);
+
+        bool logical = prec <= 2 || prec == 6 || prec == 7;
+        if (e->op == "<<" || e->op == ">>") e->is_unsigned = e->a->is_unsigned;
+        else if (!logical) e->is_unsigned = e->a->is_unsigned || e->b->is_unsigned;
+        lhs = std::move(e);
+    }
+}
+
+ExprPtr Parser::parse_unary() {
+    const Token &t = peek();
+    int line = t.line;
+
+    if (is("++") || is("--")) {
+        std::string op = next().text;
+        auto e = std::make_unique<Expr>(Ex::INCDEC, line);
+        e->op = op;
+        e->a = parse_unary();
+        if (!is_lvalue(*e->a)) throw CompileError(line, "operand of " + op + " is not assignable");
+        e->is_unsigned = e->a->is_unsigned;
+        return e;
+    }
+
+    if (is("-") || is("!") || is("~") || is("+")) {
+        std::string op = next().text;
+        ExprPtr a = parse_unary();
+        if (op == "+") return a;
+
+        auto e = std::make_unique<Expr>(Ex::UNARY, line);
+        e->op = op;
+        e->is_unsigned = op != "!" && a->is_unsigned;
+        e->a = std::move(a);
+        return e;
+    }
+
+    return parse_postfix();
+}
+
+ExprPtr Parser::parse_postfix() {
+    ExprPtr e = parse_primary();
+
+    while (is("++") || is("--")) {
+        const Token &t = next();
+        if (!is_lvalue(*e)) throw CompileError(t.line, "operand of " + t.text + " is not assignable");
+        auto p = std::make_unique<Expr>(Ex::INCDEC, t.line);
+        p->op = t.text;
+        p->postfix = true;
+        p->is_unsigned = e->is_unsigned;
+        p->a = std::move(e);
+        e = std::move(p);
+    }
+    return e;
+}
+
+ExprPtr Parser::parse_primary() {
+    const Token &t = next();
+    int line = t.line;
+
+    switch (t.kind) {
+        case Tok::NUM: {
+            auto e = std::make_unique<Expr>(Ex::NUM, line);
+            e->value = t.value;
+            return e;
+        }
+
+        case Tok::STR: {
+            auto e = std::make_unique<Expr>(Ex::STR, line);
+            e->name = t.text;
+            return e;
+        }
+
+        case Tok::IDENT: {
+            std::string name = t.text;
+
+            if (accept("(")) {
+                auto e = std::make_unique<Expr>(Ex::CALL, line);
+                e->name = name;
+                while (!is(")")) {
+                    e->args.push_back(parse_assign());
+                    if (!accept(",")) break;
+                }
+                expect(")");
+                if (Function *f = prog->find_function(name))
+                    e->is_unsigned = f->returns_unsigned;
+                return e;
+            }
+
+            Var *v = lookup(name, line);
+            if (accept("[")) {
+                if (!v->is_array) throw CompileError(line, "'" + name + "' is not an array");
+                auto e = std::make_unique<Expr>(Ex::INDEX, line);
+                e->var = v;
+                e->name = name;
+                e->is_unsigned = v->is_unsigned;
+                e->a = parse_expr();
+                expect("]");
+                return e;
+            }
+
+            if (v->is_array)
+                throw CompileError(line, "array '" + name + "' used without an index");
+            auto e = std::make_unique<Expr>(Ex::VAR, line);
+            e->var = v;
+            e->name = name;
+            e->is_unsigned = v->is_unsigned;
+            return e;
+        }
+
+        case Tok::PUNCT:
+            if (t.text == "(") {
+                ExprPtr e = parse_expr();
+                expect(")");
+                return e;
+            }
+            throw CompileError(line, "unexpected '" + t.text + "'");
+
+        case Tok::END:
+            break;
+    }
+    throw CompileError(line, "unexpected end of file");
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "lexer.h"
+
+// ============================================================
+// Parser
+// Recursive descent over the token stream, building the AST
+// and resolving names against nested scopes as it goes.
+// Throws CompileError on the first syntax or name error.
+// ============================================================
+class Parser {
+public:
+    explicit Parser(std::vector<Token> tokens) : toks(std::move(tokens)) {}
+
+    // Parse the whole translation unit into prog
+    void parse(Program &prog);
+
+private:
+    struct Type {
+        bool is_void = false;
+        bool is_unsigned = false;
+    };
+
+    std::vector<Token> toks;
+    size_t pos = 0;
+
+    Program *prog = nullptr;
+    Function *fn = nullptr;                                  // function being parsed
+    std::vector<std::unordered_map<std::string, Var*>> scopes;
+    int loop_depth = 0;
+
+    // Token helpers
+    const Token &peek(size_t ahead = 0) const;
+    const Token &next();
+    bool is(const char *punct) const;
+    bool accept(const char *punct);
+    void expect(const char *punct);
+    std::string expect_ident();
+    bool at_type() const;
+    Type parse_type();
+
+    // Declarations
+    void parse_function(const Type &ret, const std::string &name, int line);
+    void parse_global(const Type &type, const std::string &name, int line);
+    int  constant_expr();
+    Var *declare_local(const std::string &name, const Type &type, int line);
+    Var *lookup(const std::string &name, int line) const;
+
+    // Statements
+    StmtPtr parse_statement();
+    StmtPtr parse_block();
+    StmtPtr parse_declaration();
+
+    // Expressions (lowest to highest precedence)
+    ExprPtr parse_expr();
+    ExprPtr parse_assign();
+    ExprPtr parse_binary(int min_prec);
+    ExprPtr parse_unary();
+    ExprPtr parse_postfix();
+    ExprPtr parse_primary();
+
+    static bool is_lvalue(const Expr &e);
+};
@@ -1,121 +1,90 @@
 #include "control.h"
+#include "isa.h"
 
 // ================================================
 // decode()
-// Maps opcode + operands into a structured format
+// Maps opcode + operands into a structured format.
+// The opcode selects a precomputed DecodeEntry
+// (type, ALU op, condition, operand encoding);
+// the encoding says where op1/op2 go.
+// Unused opcodes and out-of-range registers decode to
+// InstrType::NONE, which the CPU raises as a fault.
 // ================================================
-DecodedInstr ControlUnit::decode(uint8_t opcode, uint16_t op1, uint16_t op2)
+DecodedInstr ControlUnit::decode(uint8_t opcode, uint16_t op1, uint16_t op2, int reg_count)
 {
+    const DecodeEntry &e = DECODE_TABLE[opcode];
+
     DecodedInstr d{};
-    d.type = InstrType::NONE;
-    d.alu_op = ALUOp::NONE;
+    d.type = e.type;
+    d.alu_op = e.alu_op;
+    d.cond = e.cond;
+    d.opcode = opcode;
 
-    // ============================
-    // MOV Rn, imm
-    // ============================
-    if (opcode == 0x10) {
-        d.type = InstrType::REG_IMM;
-        d.rd = op1;
-        d.imm = op2;
-        d.alu_op = ALUOp::MOV;
-        return d;
-    }
+    switch (e.enc)
+    {
+        case Encoding::NONE:
+            break;
 
-    // ============================
-    // MOV Rn, Rm
-    // ============================
-    if (opcode == 0x11) {
-        d.type = InstrType::REG_REG;
-        d.rd = op1;
-        d.rs = op2;
-        d.alu_op = ALUOp::MOV;
-        return d;
-    }
+        // POP Rn
+        case Encoding::RD:
+            d.rd = op1;
+            break;
 
-    // ============================
-    // ALU OPS
-    // ============================
-    if (opcode == 0x20) { d.type = InstrType::ALU_REG_REG; d.alu_op = ALUOp::ADD; d.rd = op1; d.rs = op2; return d; }
-    if (opcode == 0x21) { d.type = InstrType::ALU_REG_REG; d.alu_op = ALUOp::SUB; d.rd = op1; d.rs = op2; return d; }
-    if (opcode == 0x22) { d.type = InstrType::ALU_REG_REG; d.alu_op = ALUOp::AND_; d.rd = op1; d.rs = op2; return d; }
-    if (opcode == 0x23) { d.type = InstrType::ALU_REG_REG; d.alu_op = ALUOp::OR_; d.rd = op1; d.rs = op2; return d; }
-    if (opcode == 0x24) { d.type = InstrType::ALU_REG_REG; d.alu_op = ALUOp::XOR_; d.rd = op1; d.rs = op2; return d; }
-    if (opcode == 0x25) { d.type = InstrType::ALU_REG_REG; d.alu_op = ALUOp::CMP; d.rd = op1; d.rs = op2; return d; }
+        // PUSH Rn, STRPRINT Rn
+        case Encoding::RS:
+            d.rs = op1;
+            break;
 
-    // ============================
-    // LOAD / STORE
-    // ============================
-    if (opcode == 0x30) {
-        d.type = InstrType::LOAD_WORD;
-        d.rd = op1;
-        d.imm = op2;
-        return d;
-    }
+        // JMP / Jcc / CALL label
+        case Encoding::ADDR:
+            d.imm = op1;
+            break;
 
-    if (opcode == 0x31) {
-        d.type = InstrType::STORE_WORD;
-        d.rs = op1;
-        d.imm = op2;
-        return d;
-    }
+        // MOVI, ALU immediate, LOAD
+        case Encoding::RD_IMM:
+            d.rd = op1;
+            d.imm = op2;
+            break;
 
-    // ============================
-    // JMP
-    // ============================
-    if (opcode == 0x40) {
-        d.type = InstrType::JUMP;
-        d.imm = op1;
-        return d;
-    }
+        // STORE Rs, addr
+        case Encoding::RS_IMM:
+            d.rs = op1;
+            d.imm = op2;
+            break;
 
-    // ============================
-    // JZ / JNZ
-    // ============================
-    if (opcode == 0x41) { d.type = InstrType::JUMP_COND; d.imm = op1; return d; }
-    if (opcode == 0x42) { d.type = InstrType::JUMP_COND; d.imm = op1; return d; }
+        // MOV, ALU register
+        case Encoding::RD_RS:
+            d.rd = op1;
+            d.rs = op2;
+            break;
 
-    // ============================
-    // PUSH Rn
-    // ============================
-    if (opcode == 0x50) {
-        d.type = InstrType::PUSH_REG;
-        d.rs = op1;
-        return d;
-    }
+        // LOAD Rd, [Rb+off]
+        case Encoding::RD_MEM:
+            d.rd = op1 & 0xFF;
+            d.rb = op1 >> 8;
+            d.imm = op2;
+            break;
 
-    // ============================
-    // POP Rn
-    // ============================
-    if (opcode == 0x51) {
-        d.type = InstrType::POP_REG;
-        d.rd = op1;
-        return d;
-    }
+        // STORE Rs, [Rb+off]
+        case Encoding::RS_MEM:
+            d.rs = op1 & 0xFF;
+            d.rb = op1 >> 8;
+            d.imm = op2;
+            break;
 
-    // ============================
-    // CALL label
-    // ============================
-    if (opcode == 0x60) {
-        d.type = InstrType::CALL;
-        d.imm = op1;
-        return d;
+        // MEMCPY / MEMSET
+        case Encoding::RD_RS_RC:
+            d.rd = op1 & 0xFF;
+            d.rs = op1 >> 8;
+            d.rc = op2;
+            break;
     }
 
-    // ============================
-    // RET
-    // ============================
-    if (opcode == 0x61) {
-        d.type = InstrType::RET;
-        return d;
-    }
-
-    // ============================
-    // HALT
-    // ============================
-    if (opcode == 0xFF) {
-        d.type = InstrType::HALT;
-        return d;
-    }
+    // A register field past the last register (R5) makes the
+    // instruction invalid, the same as an unused opcode (arbitrary
+    // binaries must not index outside the register file)
+    if (d.rd >= reg_count || d.rs >= reg_count || d.rb >= reg_count || d.rc >= reg_count)
+        d.type = InstrType::NONE;
 
     return d;
 }
@@ -18,6 +18,7 @@
 // ========================================================================
 class ControlUnit {
 public:
-    // Decode instruction into DecodedInstr structure
-    DecodedInstr decode(uint8_t opcode, uint16_t op1, uint16_t op2);
+    // Decode instruction into DecodedInstr structure; register
+    // fields from reg_count up make it invalid
+    DecodedInstr decode(uint8_t opcode, uint16_t op1, uint16_t op2, int reg_count = REG_COUNT);
 };
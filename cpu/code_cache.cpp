@@ -0,0 +1,125 @@
+#include "code_cache.h"
+#include "control.h"
+#include <algorithm>
+
+// ================================================================
+// DecodedImage
+// The same worklist as CPU::validate(), over the image bytes
+// instead of guest memory
+// ================================================================
+DecodedImage::DecodedImage(const std::vector<uint8_t> &program, uint16_t start,
+                           const CodeGeometry &geometry)
+    : start(start), geometry(geometry), bytes(program), table(geometry.mem_size)
+{
+    ControlUnit cu;
+    uint16_t mask = static_cast<uint16_t>(geometry.mem_size - 1);
+    uint32_t end = std::min<uint32_t>(start + program.size(), geometry.io_page);
+    auto at = [&](uint32_t addr) -> uint16_t { return program[addr - start]; };
+
+    std::vector<uint8_t> seen(geometry.mem_size, 0);
+    std::vector<uint16_t> work{start};
+    while (!work.empty()) {
+        uint16_t pc = work.back() & mask;
+        work.pop_back();
+        if (seen[pc]) continue;
+        seen[pc] = 1;
+        if (pc < start || (uint32_t)pc + 5 > end) continue;   // decoded on demand
+
+        DecodedInstr &d = table[pc];
+        d = cu.decode(at(pc), at(pc + 1) | at(pc + 2) << 8, at(pc + 3) | at(pc + 4) << 8,
+                      geometry.reg_count);
+        switch (d.type) {
+            case InstrType::NONE:
+                continue;
+            case InstrType::JUMP:
+                valid.push_back(pc);
+                work.push_back(d.imm);
+                continue;
+            case InstrType::JUMP_COND:
+            case InstrType::CALL:
+                work.push_back(d.imm);
+                break;
+            case InstrType::RET:
+            case InstrType::IRET:
+            case InstrType::HALT:
+                valid.push_back(pc);
+                continue;
+            default:
+                break;
+        }
+        valid.push_back(pc);
+        work.push_back(pc + 5);
+    }
+    std::sort(valid.begin(), valid.end());
+}
+
+// ================================================================
+// CodeCache
+// ================================================================
+CodeCache &CodeCache::shared()
+{
+    static CodeCache cache;
+    return cache;
+}
+
+// FNV-1a over the load address and the bytes
+static uint64_t image_hash(const std::vector<uint8_t> &program, uint16_t start)
+{
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&](uint8_t b) {
+        h ^= b;
+        h *= 1099511628211ull;
+    };
+    mix(start & 0xFF);
+    mix(start >> 8);
+    for (uint8_t b : program) mix(b);
+    return h;
+}
+
+std::shared_ptr<const DecodedImage> CodeCache::get(const std::vector<uint8_t> &program, uint16_t start,
+                                                   const CodeGeometry &geometry)
+{
+    if (program.empty() || start + program.size() > geometry.mem_size) return nullptr;
+    uint64_t h = image_hash(program, start);
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::shared_ptr<const DecodedImage> image;
+    auto range = images.equal_range(h);
+    for (auto it = range.first; it != range.second;) {
+        std::shared_ptr<const DecodedImage> candidate = it->second.lock();
+        if (!candidate) {
+            it = images.erase(it);
+            continue;
+        }
+        if (candidate->start == start && candidate->geometry == geometry && candidate->bytes == program)
+            image = candidate;
+        ++it;
+    }
+
+    if (image) {
+        hit_count++;
+    } else {
+        image = std::make_shared<const DecodedImage>(program, start, geometry);
+        images.emplace(h, image);
+        build_count++;
+    }
+
+    // Most recent at the front
+    auto old = std::find(recent.begin(), recent.end(), image);
+    if (old != recent.end()) recent.erase(old);
+    recent.push_front(image);
+    if (recent.size() > RECENT) recent.pop_back();
+    return image;
+}
+
+uint64_t CodeCache::hits() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return hit_count;
+}
+
+uint64_t CodeCache::builds() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return build_count;
+}
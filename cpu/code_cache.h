@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+
+// ================================================================
+// SHARED DECODED CODE
+// Every CPU keeps a decoded copy of its validated instructions,
+// one DecodedInstr per address (1.5 MB for 64 KB). Batch and
+// server setups run the same image in many CPUs, so
+// CPU::load_program() takes that table from a process-wide cache
+// instead: the first load of an image decodes it, later loads of
+// the same bytes at the same address reference the same
+// read-only table.
+//
+// A CPU keeps the shared table until it has to decode something
+// itself (self-modified code, code the load-time walk did not
+// reach); it then copies the table into its own and carries on
+// with that. The predecode marks in Memory are per CPU, so a
+// write to code only ever stales the writer's view.
+// ================================================================
+
+// ----------------------------------------------------------------
+// CodeGeometry: what decoding depends on in a machine layout
+// (common.h). Images decoded for one layout are not shared with
+// CPUs of another.
+// ----------------------------------------------------------------
+struct CodeGeometry {
+    uint32_t mem_size = MEM_SIZE;
+    uint16_t io_page = IO_PAGE;
+    int reg_count = REG_COUNT;
+
+    template <class Layout> static CodeGeometry of() {
+        return { Layout::MEM_SIZE, Layout::IO_PAGE, Layout::REG_COUNT };
+    }
+    bool operator==(const CodeGeometry &o) const {
+        return mem_size == o.mem_size && io_page == o.io_page && reg_count == o.reg_count;
+    }
+};
+
+// ----------------------------------------------------------------
+// DecodedImage: one image's decoded code, immutable once built.
+// Holds what CPU::validate() would decode from the image alone:
+// instructions reachable from start whose five bytes lie inside
+// the image and below the I/O page.
+// ----------------------------------------------------------------
+struct DecodedImage {
+    uint16_t start = 0;
+    CodeGeometry geometry;
+    std::vector<uint8_t> bytes;             // the image, to confirm hits
+    std::vector<DecodedInstr> table;        // mem_size entries, by address
+    std::vector<uint16_t> valid;            // addresses to mark decoded
+
+    DecodedImage(const std::vector<uint8_t> &program, uint16_t start, const CodeGeometry &geometry);
+};
+
+// ----------------------------------------------------------------
+// CodeCache: images by content hash. Thread-safe; CPUs on any
+// thread share it. An image lives while a CPU references it, and
+// the RECENT most recently loaded stay built between runs (a
+// warm CPU resets between requests).
+// ----------------------------------------------------------------
+class CodeCache {
+public:
+    static constexpr size_t RECENT = 8;
+
+    static CodeCache &shared();
+
+    // The decoded image of program loaded at start, built on the
+    // first request. nullptr if it does not fit in RAM.
+    std::shared_ptr<const DecodedImage> get(const std::vector<uint8_t> &program, uint16_t start,
+                                            const CodeGeometry &geometry = CodeGeometry());
+
+    uint64_t hits() const;
+    uint64_t builds() const;
+
+private:
+    mutable std::mutex lock;
+    std::unordered_multimap<uint64_t, std::weak_ptr<const DecodedImage>> images;
+    std::deque<std::shared_ptr<const DecodedImage>> recent;
+    uint64_t hit_count = 0, build_count = 0;
+};
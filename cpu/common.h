@@ -12,20 +12,178 @@ static const int MEM_SIZE = 65536;
 // Total register count NOW includes SP (R4) and BP (R5)
 static const int REG_COUNT = 6;
 
+// Initial SP; the stack grows down from here
+static const uint16_t STACK_TOP = 0x8000;
+
 // Memory-mapped I/O
+// Everything from IO_PAGE up is device space
+static const uint16_t IO_PAGE        = 0xFF00;
+
 // I/O mapped addresses
 static const uint16_t IO_OUTPUT_NUM  = 0xFF00;  // print integer numbers
 static const uint16_t IO_TIMER       = 0xFF01;  // timer
 static const uint16_t IO_OUTPUT_CHAR = 0xFF10;  // print ASCII characters
 
+// Hypercall device: guest stores arguments into ARG0..ARG3, then
+// writes a function ID to HCALL_CALL. The registered host routine
+// runs immediately; results come back in ARG0..ARG3 and STATUS.
+static const uint16_t IO_HCALL_ARG0   = 0xFF20;  // 4 x 16-bit arg/result slots
+static const uint16_t IO_HCALL_STATUS = 0xFF28;  // 0 = ok, 0xFFFF = no such call
+static const uint16_t IO_HCALL_CALL   = 0xFF2A;  // write function ID to invoke
+static const int HCALL_ARGS = 4;
+static const int HCALL_MAX  = 256;
+
+// Performance monitoring unit (memory/pmu.h). Counters are read by
+// writing PMU_CTRL_LATCH to CTRL, which copies the low 32 bits of
+// every counter into the window at PMU_COUNTERS as LO, HI word
+// pairs (instructions, branches, loads, stores, calls, MMIO writes).
+// Writing a region ID (low byte) to BEGIN/END starts/stops a
+// measurement region; a 16-bit store of a string address to NAME
+// names the region most recently begun.
+static const uint16_t IO_PMU_CTRL     = 0xFF30;  // 1 = latch, 2 = clear
+static const uint16_t IO_PMU_BEGIN    = 0xFF32;
+static const uint16_t IO_PMU_END      = 0xFF34;
+static const uint16_t IO_PMU_NAME     = 0xFF36;
+static const uint16_t IO_PMU_COUNTERS = 0xFF40;  // 6 x 32-bit, to 0xFF57
+static const uint8_t PMU_CTRL_LATCH = 1;
+static const uint8_t PMU_CTRL_CLEAR = 2;
+
+// Interrupt controller (memory/interrupts.h). A pending line whose
+// MASK bit is set interrupts the CPU between instructions while
+// interrupts are enabled (EI): PC and the flags word are pushed,
+// interrupts are disabled and PC jumps to the line's VECTORS entry
+// (0 = no handler, the interrupt is dropped). IRET returns.
+// Line 0 is the timer: a 32-bit period in microseconds written as
+// TIMER_LO then TIMER_HI (a 16-bit store to TIMER_HI arms it,
+// period 0 stops it) raises line 0 periodically in wall-clock time.
+static const uint16_t IO_IRQ_PENDING  = 0xFF60;  // read: pending lines; write: 1 bits clear
+static const uint16_t IO_IRQ_MASK     = 0xFF62;  // enabled lines
+static const uint16_t IO_IRQ_RAISE    = 0xFF64;  // write a line number to raise it
+static const uint16_t IO_IRQ_TIMER_LO = 0xFF66;
+static const uint16_t IO_IRQ_TIMER_HI = 0xFF68;
+static const uint16_t IO_IRQ_VECTORS  = 0xFF70;  // 8 x 16-bit handler addresses
+static const int IRQ_LINES = 8;
+static const int IRQ_TIMER = 0;
+
+// Guest faults. An instruction that cannot run (unused opcode, or a
+// register field past R5) is not executed: FAULT_PC and FAULT_CAUSE
+// are set, and if FAULT_VECTOR is non-zero the CPU enters it like an
+// interrupt, with the faulting instruction's PC pushed as the return
+// address. With no vector (or a fault in the handler's first
+// instruction) the CPU halts and the host sees CPU::fault.
+static const uint16_t IO_FAULT_VECTOR = 0xFF6A;
+static const uint16_t IO_FAULT_PC     = 0xFF6C;
+static const uint16_t IO_FAULT_CAUSE  = 0xFF6E;
+static const uint16_t IO_FAULT_ADDR   = 0xFF58;  // data address of an access fault
+enum FaultCause : uint16_t {
+    FAULT_NONE,
+    FAULT_OPCODE,      // unused opcode
+    FAULT_REGISTER,    // register operand >= REG_COUNT
+    FAULT_ACCESS,      // unmapped page (guarded memory only)
+    FAULT_STACK        // stack guard page (guarded memory only)
+};
+
+// Input device (memory/input.h): a host file, pipe or stdin read
+// ahead into a large buffer. Writing a command to CTRL performs
+// it at once (blocking until the data is there or the stream
+// ends) and updates COUNT and STATUS:
+//   READ8 / READ16 → DATA (0xFFFF with COUNT 0 at end of input;
+//                    a lone last byte is returned with COUNT 1)
+//   BULK           → up to LEN bytes to guest memory at ADDR
+//                    (clipped at the I/O page)
+//   POLL           → only refresh STATUS
+static const uint16_t IO_IN_CTRL   = 0xFF80;
+static const uint16_t IO_IN_DATA   = 0xFF82;
+static const uint16_t IO_IN_ADDR   = 0xFF84;
+static const uint16_t IO_IN_LEN    = 0xFF86;
+static const uint16_t IO_IN_COUNT  = 0xFF88;  // bytes moved by the last command
+static const uint16_t IO_IN_STATUS = 0xFF8A;
+static const uint8_t IN_CMD_READ8  = 1;
+static const uint8_t IN_CMD_READ16 = 2;
+static const uint8_t IN_CMD_BULK   = 3;
+static const uint8_t IN_CMD_POLL   = 4;
+static const uint16_t IN_READY = 1;           // STATUS: bytes buffered now
+static const uint16_t IN_EOF   = 2;           // STATUS: input exhausted
+static const uint16_t IN_ERROR = 4;           // STATUS: host read failed
+
+// Extended memory (memory/banks.h): a host region, anonymous or
+// a mapped file, seen one bank at a time through a fixed window.
+// A 16-bit store to BANK_LO maps bank BANK_HI:BANK_LO into the
+// window; BANK_HI alone only latches. COUNT is read-only.
+static const uint16_t IO_BANK_LO       = 0xFF90;
+static const uint16_t IO_BANK_HI       = 0xFF92;
+static const uint16_t IO_BANK_COUNT_LO = 0xFF94;  // banks available
+static const uint16_t IO_BANK_COUNT_HI = 0xFF96;
+static const uint16_t IO_BANK_STATUS   = 0xFF98;
+static const uint16_t BANK_WINDOW      = 0xA000;
+static const uint16_t BANK_SIZE        = 0x4000;  // 16 KB per bank
+static const uint16_t BANK_OK     = 0;            // STATUS: bank mapped
+static const uint16_t BANK_RANGE  = 1;            // STATUS: no such bank, window unchanged
+static const uint16_t BANK_NONE   = 2;            // STATUS: no extended memory attached
+static const uint16_t BANK_FAILED = 3;            // STATUS: host mapping failed, window zeroed
+
+// What the code relies on about the layout above
+static_assert(BANK_WINDOW >= STACK_TOP && BANK_WINDOW + BANK_SIZE <= IO_PAGE,
+              "the bank window is plain RAM above the stack");
+static_assert(IO_IRQ_VECTORS + 2 * IRQ_LINES <= IO_IN_CTRL && IO_IN_STATUS < IO_BANK_LO,
+              "device registers overlap");
+
+// ================================================================
+// MACHINE LAYOUT
+// CPU, RegisterFile and Memory are templates over a layout (their
+// BasicCPU / BasicRegisterFile / BasicMemory names); the plain
+// names are Layout64K, the machine the constants above describe.
+//
+// Guest addresses stay 16 bits. A smaller RAM is mirrored through
+// the address space (addresses are masked with MEM_MASK), and the
+// device registers keep their offsets within the 256-byte I/O page
+// at IO_PAGE: io(IO_TIMER) is the timer on any layout. Guarded and
+// extended memory need Layout64K.
+//
+// The cpu library instantiates the layouts below; a new one needs
+// its own explicit instantiations at the end of registers.cpp,
+// memory.cpp, hypercall.cpp and cpu.cpp.
+// ================================================================
+template <int Regs, uint32_t MemSize, uint16_t IoPage, uint16_t StackTop>
+struct MachineLayout {
+    static constexpr int REG_COUNT = Regs;
+    static constexpr uint32_t MEM_SIZE = MemSize;
+    static constexpr uint16_t MEM_MASK = static_cast<uint16_t>(MemSize - 1);
+    static constexpr uint16_t IO_PAGE = IoPage;
+    static constexpr uint16_t STACK_TOP = StackTop;
+
+    // A device register (its Layout64K address) on this layout
+    static constexpr uint16_t io(uint16_t reg) {
+        return static_cast<uint16_t>(IoPage + (reg - ::IO_PAGE));
+    }
+
+    static_assert(Regs >= 1 && Regs <= 256, "register fields are one byte");
+    static_assert(MemSize >= 0x1000 && MemSize <= 0x10000 && (MemSize & (MemSize - 1)) == 0,
+                  "RAM is a power of two from 4 KB to 64 KB; addresses wrap at MEM_SIZE");
+    static_assert(IoPage % 0x100 == 0 && IoPage + 0x100u <= MemSize,
+                  "the I/O page is a whole 256-byte page inside RAM");
+    static_assert(StackTop <= IoPage, "the stack starts in RAM");
+};
+
+using Layout64K = MachineLayout<REG_COUNT, MEM_SIZE, IO_PAGE, STACK_TOP>;
+
+// 4 KB RAM, devices at 0x0F00, stack from 0x0800, R0-R3
+using Layout4K = MachineLayout<4, 0x1000, 0x0F00, 0x0800>;
+
 // ================================================================
 // CPU FLAGS
 // ================================================================
 struct Flags {
     bool ZF = false;   // Zero Flag
     bool CF = false;   // Carry Flag
+    bool IF = false;   // Interrupts enabled (EI / DI)
 };
 
+// Flags as pushed on interrupt entry and popped by IRET
+static const uint16_t FLAGS_ZF = 1;
+static const uint16_t FLAGS_CF = 2;
+static const uint16_t FLAGS_IF = 4;
+
 // ================================================================
 // INSTRUCTION OPCODES
 // ================================================================
@@ -40,21 +198,60 @@ static const uint8_t OP_AND  = 0x22;
 static const uint8_t OP_OR   = 0x23;
 static const uint8_t OP_XOR  = 0x24;
 static const uint8_t OP_CMP  = 0x25;
+static const uint8_t OP_MUL  = 0x26;
+static const uint8_t OP_DIV  = 0x27;
+static const uint8_t OP_MOD  = 0x28;
+
+// Immediate ALU forms: Rd = Rd <op> imm16
+// Low nibble matches the register form (0x20 + n <-> 0x70 + n)
+static const uint8_t OP_ADDI = 0x70;
+static const uint8_t OP_SUBI = 0x71;
+static const uint8_t OP_ANDI = 0x72;
+static const uint8_t OP_ORI  = 0x73;
+static const uint8_t OP_XORI = 0x74;
+static const uint8_t OP_CMPI = 0x75;
+static const uint8_t OP_MULI = 0x76;
+static const uint8_t OP_DIVI = 0x77;
+static const uint8_t OP_MODI = 0x78;
 
 // Load/store
 static const uint8_t OP_LOAD  = 0x30;
 static const uint8_t OP_STORE = 0x31;
 
+// Register-indirect / base+offset load/store
+//   op1 = value register (low byte) | base register (high byte)
+//   op2 = signed 16-bit offset added to the base register
+static const uint8_t OP_LOADX  = 0x32;
+static const uint8_t OP_STOREX = 0x33;
+
+// Block memory operations (executed with host memcpy/memset)
+//   op1 = first register (low byte) | second register (high byte)
+//   op2 = byte-count register
+static const uint8_t OP_MEMCPY    = 0x34;  // MEMCPY Rd, Rs, Rn
+static const uint8_t OP_MEMSET    = 0x35;  // MEMSET Rd, Rv, Rn
+static const uint8_t OP_STRPRINT  = 0x36;  // STRPRINT Rs   (NUL-terminated)
+static const uint8_t OP_STRPRINTL = 0x37;  // STRPRINTL Rs  (16-bit length prefix)
+
 // Jumps
 static const uint8_t OP_JMP = 0x40;
 static const uint8_t OP_JZ  = 0x41;
 static const uint8_t OP_JNZ = 0x42;
+static const uint8_t OP_JC  = 0x43;
+static const uint8_t OP_JNC = 0x44;
 
 // NEW: Stack + function calls
 static const uint8_t OP_PUSH = 0x50;
 static const uint8_t OP_POP  = 0x51;
-static const uint8_t OP_CALL = 0x52;
-static const uint8_t OP_RET  = 0x53;
+static const uint8_t OP_MOVSP = 0x54;  // Rd = SP
+static const uint8_t OP_SETSP = 0x55;  // SP = Rs
+static const uint8_t OP_CALL = 0x60;
+static const uint8_t OP_RET  = 0x61;
+static const uint8_t OP_IRET = 0x62;   // pop flags, pop PC
+
+// Interrupts
+static const uint8_t OP_EI  = 0x80;    // enable interrupts
+static const uint8_t OP_DI  = 0x81;    // disable interrupts
+static const uint8_t OP_WFI = 0x82;    // sleep until an interrupt is pending
 
 // HALT
 static const uint8_t OP_HALT = 0xFF;
@@ -70,7 +267,10 @@ enum class ALUOp {
     AND_,
     OR_,
     XOR_,
-    CMP
+    CMP,
+    MUL,
+    DIV,
+    MOD
 };
 
 // ================================================================
@@ -81,17 +281,41 @@ enum class InstrType {
     REG_IMM,         // MOVI
     REG_REG,         // MOV
     ALU_REG_REG,     // ADD, SUB...
+    ALU_REG_IMM,     // ADDI, SUBI...
     LOAD_WORD,       // LOAD
     STORE_WORD,      // STORE
+    LOAD_INDEXED,    // LOAD Rd, [Rb+off]
+    STORE_INDEXED,   // STORE Rs, [Rb+off]
+    BLOCK_COPY,      // MEMCPY
+    BLOCK_FILL,      // MEMSET
+    PRINT_STR,       // STRPRINT
+    PRINT_COUNTED,   // STRPRINTL
     JUMP,            // JMP
-    JUMP_COND,       // JZ, JNZ
+    JUMP_COND,       // JZ, JNZ, JC, JNC
     PUSH_REG,        // PUSH
     POP_REG,         // POP
+    READ_SP,         // MOVSP
+    WRITE_SP,        // SETSP
     CALL,            // CALL
     RET,             // RET
+    IRET,            // IRET
+    INT_ENABLE,      // EI
+    INT_DISABLE,     // DI
+    WAIT,            // WFI
     HALT             // HALT
 };
 
+// ================================================================
+// Branch conditions (JUMP_COND)
+// ================================================================
+enum class Cond : uint8_t {
+    ALWAYS,
+    Z,     // ZF = 1
+    NZ,    // ZF = 0
+    C,     // CF = 1
+    NC     // CF = 0
+};
+
 // ================================================================
 // Decoded Instruction Structure
 // ================================================================
@@ -100,7 +324,11 @@ struct DecodedInstr {
 
     uint16_t rd = 0;   // destination register
     uint16_t rs = 0;   // source register
-    uint16_t imm = 0;  // immediate or address
+    uint16_t rb = 0;   // base register (indexed LOAD/STORE)
+    uint16_t rc = 0;   // byte-count register (block ops)
+    uint16_t imm = 0;  // immediate, address or offset
 
     ALUOp alu_op = ALUOp::NONE;  // ALU operation
+    Cond cond = Cond::ALWAYS;    // branch condition
+    uint8_t opcode = 0;          // raw opcode byte
 };
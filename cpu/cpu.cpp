@@ -1,193 +1,301 @@
 #include "cpu.h"
-#include <iostream>
-#include <iomanip>
+#include "cpu_exec.h"
+#include "hypercall.h"
+#include "isa.h"
+#include <algorithm>
+#include <cstdio>
 
 // =======================================
 // Constructor
 // =======================================
 
-CPU::CPU() {
-    regs.PC = 0;
-    regs.SP = 0x8000;      // <--- THIS FIXES THE FACTORIAL BUG
-    for (int i = 0; i < 8; i++) regs.R[i] = 0;
-    regs.flags = {0,0};
+template <class Layout>
+BasicCPU<Layout>::BasicCPU() {
+    register_default_hypercalls(memory);
+}
+
+// =======================================
+// Reset to the state the constructor leaves
+// =======================================
+template <class Layout>
+void BasicCPU<Layout>::reset()
+{
+    regs = BasicRegisterFile<Layout>();
+    halted = false;
+    fault = FAULT_NONE;
+    fault_pc = 0;
+    fault_addr = 0;
+    entering_handler = false;
+    coverage_prev = 0;
+    memory.reset();
+    shared_code.reset();
+    table = decoded.data();
+}
+
+// =======================================
+// Hypercall registration
+// =======================================
+template <class Layout>
+void BasicCPU<Layout>::register_hypercall(uint8_t id, typename BasicMemory<Layout>::HyperCall fn)
+{
+    memory.register_hypercall(id, std::move(fn));
 }
 
 
 // =======================================
 // Load program into memory and set PC
 // =======================================
-void CPU::load_program(const std::vector<uint8_t> &program, uint16_t start)
+template <class Layout>
+void BasicCPU<Layout>::load_program(const std::vector<uint8_t> &program, uint16_t start)
 {
     for (size_t i = 0; i < program.size(); i++)
         memory.write8(start + i, program[i]);
 
     regs.PC = start;
+
+    std::shared_ptr<const DecodedImage> image =
+        CodeCache::shared().get(program, start, CodeGeometry::of<Layout>());
+    if (!image) {
+        validate(start);
+        return;
+    }
+
+    // Marks left from earlier code refer to the old table
+    memory.forget_decoded();
+    shared_code = image;
+    table = image->table.data();
+    for (uint16_t pc : image->valid)
+        if (memory.accessible(pc, 5)) memory.mark_decoded(pc);
+}
+
+// =======================================
+// Load-time validation
+// Worklist over reachable code. Each address is
+// decoded once; marked addresses are done.
+// =======================================
+template <class Layout>
+std::vector<uint16_t> BasicCPU<Layout>::validate(uint16_t entry)
+{
+    std::vector<uint16_t> invalid;
+    std::vector<uint8_t> seen(Layout::MEM_SIZE, 0);
+    std::vector<uint16_t> work{entry};
+
+    while (!work.empty()) {
+        uint16_t pc = work.back() & Layout::MEM_MASK;
+        work.pop_back();
+        if (seen[pc]) continue;
+        seen[pc] = 1;
+        if (!memory.accessible(pc, 5)) continue;   // faults if reached
+
+        predecode(pc);
+        const DecodedInstr &d = decoded[pc];
+        switch (d.type) {
+            case InstrType::NONE:
+                invalid.push_back(pc);
+                continue;                       // faults; nothing after it runs
+            case InstrType::JUMP:
+                work.push_back(d.imm);
+                continue;
+            case InstrType::JUMP_COND:
+            case InstrType::CALL:
+                work.push_back(d.imm);
+                break;
+            case InstrType::RET:
+            case InstrType::IRET:
+            case InstrType::HALT:
+                continue;
+            default:
+                break;
+        }
+        work.push_back(pc + 5);
+    }
+
+    std::sort(invalid.begin(), invalid.end());
+    return invalid;
+}
+
+// =======================================
+// Decode pc from memory into decoded[pc];
+// mark it for the fast path if it is valid
+// =======================================
+template <class Layout>
+void BasicCPU<Layout>::predecode(uint16_t pc)
+{
+    if (shared_code || decoded.empty()) own_code();
+    // A fetch from a guard page faults at its first byte
+    memory.probe(pc, 5);
+    uint8_t opcode = memory.read8(pc);
+    uint16_t op1 = memory.read16(pc + 1);
+    uint16_t op2 = memory.read16(pc + 3);
+
+    DecodedInstr &d = decoded[pc & Layout::MEM_MASK];
+    d = cu.decode(opcode, op1, op2, Layout::REG_COUNT);
+    if (d.type != InstrType::NONE)
+        memory.mark_decoded(pc);
+}
+
+// =======================================
+// Switch to a private decoded table, starting
+// from the shared one: its marked entries stay
+// current, the rest is decoded on demand
+// =======================================
+template <class Layout>
+void BasicCPU<Layout>::own_code()
+{
+    if (shared_code)
+        decoded.assign(shared_code->table.begin(), shared_code->table.end());
+    else
+        decoded.resize(Layout::MEM_SIZE);
+    shared_code.reset();
+    table = decoded.data();
 }
 
 // =======================================
 // Main execution loop
 // =======================================
-void CPU::run() {
-    while (true) {
-        step();
+template <class Layout>
+void BasicCPU<Layout>::run() {
+    NoHooks hooks;
+    if (memory.guarded()) {
+        while (!halted) run_guarded(hooks, UINT64_MAX);
+        return;
+    }
+    while (!halted) {
+        step_predecoded(hooks);
         memory.tick_timer();
+        poll_interrupt();
     }
 }
 
+template <class Layout>
+uint64_t BasicCPU<Layout>::run_for(uint64_t max_steps) {
+    NoHooks hooks;
+    return run_with(hooks, max_steps);
+}
+
 // =======================================
-// Execute a single instruction
-// Fetch → Decode → Execute → Update PC
+// Handler entry (interrupts and faults): push
+// the return PC, then the flags word; clear IF
+// and jump to the vector
 // =======================================
-void CPU::step()
+template <class Layout>
+void BasicCPU<Layout>::enter_handler(uint16_t vector, uint16_t return_pc)
 {
-    // -------- FETCH OPCODE --------
-    uint16_t pc = regs.PC;
-    uint8_t opcode = memory.read8(pc);
-    regs.PC++;
-
-    // -------- FETCH OPERANDS --------
-    uint16_t op1 = memory.read16(regs.PC);
-    regs.PC += 2;
-
-    uint16_t op2 = memory.read16(regs.PC);
-    regs.PC += 2;
-
-    // -------- DECODE --------
-    DecodedInstr instr = cu.decode(opcode, op1, op2);
-
-    // -------- EXECUTE --------
-    switch (instr.type)
-    {
-        // =============================
-        // MOV Rn, imm
-        // =============================
-        case InstrType::REG_IMM:
-            regs.R[instr.rd] = instr.imm;
-            regs.flags.ZF = (instr.imm == 0);
-            break;
-
-        // =============================
-        // MOV Rn, Rm
-        // =============================
-        case InstrType::REG_REG:
-        {
-            uint16_t val = regs.R[instr.rs];
-            regs.R[instr.rd] = val;
-            regs.flags.ZF = (val == 0);
-            break;
-        }
+    uint16_t f = (regs.flags.ZF ? FLAGS_ZF : 0) |
+                 (regs.flags.CF ? FLAGS_CF : 0) |
+                 (regs.flags.IF ? FLAGS_IF : 0);
+    entering_handler = true;
+    handler_return = return_pc;
+    memory.probe(regs.SP - 4, 4);
+    memory.write16(regs.SP - 2, return_pc);
+    memory.write16(regs.SP - 4, f);
+    entering_handler = false;
 
-        // =============================
-        // ALU ops: ADD, SUB, CMP, etc.
-        // =============================
-        case InstrType::ALU_REG_REG:
-        {
-            uint16_t a = regs.R[instr.rd];
-            uint16_t b = regs.R[instr.rs];
-            uint16_t result = 0;
-
-            switch (instr.alu_op)
-            {
-                case ALUOp::ADD: result = alu.add(a, b, regs.flags); break;
-                case ALUOp::SUB: result = alu.sub(a, b, regs.flags); break;
-                case ALUOp::AND_: result = alu._and(a, b, regs.flags); break;
-                case ALUOp::OR_:  result = alu._or(a, b, regs.flags); break;
-                case ALUOp::XOR_: result = alu._xor(a, b, regs.flags); break;
-                case ALUOp::CMP:
-                    alu.cmp(a, b, regs.flags);
-                    break;
-                default: break;
-            }
-
-            if (instr.alu_op != ALUOp::CMP)
-                regs.R[instr.rd] = result;
-
-            break;
-        }
+    regs.SP -= 4;
+    regs.flags.IF = false;
+    regs.PC = vector;
+}
 
-        // =============================
-        // LOAD / STORE
-        // =============================
-        case InstrType::LOAD_WORD:
-            regs.R[instr.rd] = memory.read16(instr.imm);
-            break;
-
-        case InstrType::STORE_WORD:
-            memory.write16(instr.imm, regs.R[instr.rs]);
-            break;
-
-        // =============================
-        // JUMP
-        // =============================
-        case InstrType::JUMP:
-            regs.PC = instr.imm;
-            break;
-
-        // =============================
-        // JZ / JNZ
-        // =============================
-        case InstrType::JUMP_COND:
-            if (opcode == 0x41 && regs.flags.ZF)  // JZ
-                regs.PC = instr.imm;
-            else if (opcode == 0x42 && !regs.flags.ZF)  // JNZ
-                regs.PC = instr.imm;
-            break;
-
-        // =============================
-        // PUSH Rn
-        // =============================
-        case InstrType::PUSH_REG:
-        {
-            regs.SP -= 2;
-            memory.write16(regs.SP, regs.R[instr.rs]);
-            break;
-        }
+// =======================================
+// Interrupt entry. A line with a zero vector
+// is dropped.
+// =======================================
+template <class Layout>
+bool BasicCPU<Layout>::take_interrupt()
+{
+    int line = memory.acknowledge_interrupt();
+    if (line < 0) return false;
 
-        // =============================
-        // POP Rn
-        // =============================
-        case InstrType::POP_REG:
-        {
-            regs.R[instr.rd] = memory.read16(regs.SP);
-            regs.SP += 2;
-            break;
-        }
+    uint16_t vector = memory.read16(Layout::io(IO_IRQ_VECTORS) + 2 * line);
+    if (vector == 0) return false;
 
-        // =============================
-        // CALL address
-        // =============================
-        case InstrType::CALL:
-        {
-            regs.SP -= 2;
-            memory.write16(regs.SP, regs.PC);  // push return PC
-            regs.PC = instr.imm;               // jump to function
-            break;
-        }
+    enter_handler(vector, regs.PC);
+    return true;
+}
 
-        // =============================
-        // RET
-        // =============================
-        case InstrType::RET:
-        {
-            uint16_t retAddr = memory.read16(regs.SP); // pop PC
-            regs.SP += 2;
-            regs.PC = retAddr;
-            break;
-        }
+// =======================================
+// Invalid instruction at pc
+// =======================================
+template <class Layout>
+bool BasicCPU<Layout>::raise_fault(uint16_t pc, const DecodedInstr &instr)
+{
+    return deliver_fault(pc, DECODE_TABLE[instr.opcode].type == InstrType::NONE
+                      ? FAULT_OPCODE : FAULT_REGISTER);
+}
 
+// =======================================
+// Access fault on guarded memory (run_guarded
+// landed here). The trapped instruction had not
+// touched the registers yet. A trap while
+// entering a handler is a double fault: halt.
+// =======================================
+template <class Layout>
+bool BasicCPU<Layout>::access_fault()
+{
+    const GuardedRam &g = *memory.guarded();
+    memory.write16(Layout::io(IO_FAULT_ADDR), g.fault_addr);
 
-        
-        // =============================
-        // HALT
-        // =============================
-        case InstrType::HALT:
-            std::cout << "\nCPU HALTED.\n";
-            regs.dump();
-            memory.dump(0, 0x0060);
-            exit(0);
+    if (entering_handler) {
+        entering_handler = false;
+        fault = g.fault_cause;
+        fault_pc = handler_return;
+        fault_addr = g.fault_addr;
+        regs.PC = handler_return;
+        halted = true;
+        return false;
+    }
+    fault_addr = g.fault_addr;
+    return deliver_fault(regs.PC - 5, g.fault_cause);
+}
+
+// =======================================
+// Guest fault at pc. The instruction did not
+// execute; the handler returns to it with IRET
+// (after fixing it) or must skip it itself.
+// =======================================
+template <class Layout>
+bool BasicCPU<Layout>::deliver_fault(uint16_t pc, FaultCause cause)
+{
+    memory.write16(Layout::io(IO_FAULT_PC), pc);
+    memory.write16(Layout::io(IO_FAULT_CAUSE), cause);
 
-        default:
-            break;
+    uint16_t vector = memory.read16(Layout::io(IO_FAULT_VECTOR));
+    if (vector == 0 || vector == pc) {
+        fault = cause;
+        fault_pc = pc;
+        regs.PC = pc;
+        halted = true;
+        return false;
     }
+    enter_handler(vector, pc);
+    return true;
 }
+
+template <class Layout>
+std::string BasicCPU<Layout>::fault_message() const
+{
+    char buf[64];
+    if (fault == FAULT_OPCODE)
+        snprintf(buf, sizeof(buf), "invalid opcode 0x%02x at PC 0x%04x",
+                 memory.read8(fault_pc), fault_pc);
+    else if (fault == FAULT_REGISTER)
+        snprintf(buf, sizeof(buf), "invalid register operand at PC 0x%04x", fault_pc);
+    else if (fault == FAULT_STACK)
+        snprintf(buf, sizeof(buf), "stack overflow (0x%04x) at PC 0x%04x", fault_addr, fault_pc);
+    else
+        snprintf(buf, sizeof(buf), "unmapped access to 0x%04x at PC 0x%04x", fault_addr, fault_pc);
+    return buf;
+}
+
+// =======================================
+// Execute a single instruction (no hooks)
+// =======================================
+template <class Layout>
+void BasicCPU<Layout>::step()
+{
+    NoHooks hooks;
+    step_with(hooks);
+}
+
+template class BasicCPU<Layout64K>;
+template class BasicCPU<Layout4K>;
@@ -1,24 +1,138 @@
 #pragma once
 
+#include <memory>
+#include <string>
 #include <vector>
 #include <cstdint>
+#include "code_cache.h"
 #include "registers.h"
 #include "memory.h"
 #include "alu.h"
 #include "control.h"
 
-class CPU {
+// ================================================================
+// Execution hooks
+// step_with() reports what each instruction does to a Hooks object
+// chosen at compile time (the timing model in timing.h is one).
+// NoHooks is the default: every call is an empty inline function,
+// so step()/run() compile to the plain interpreter.
+// ================================================================
+struct NoHooks {
+    void fetch(uint16_t /*pc*/) {}                          // 5-byte instruction fetch
+    void load(uint16_t /*addr*/, uint16_t /*len*/) {}       // data read
+    void store(uint16_t /*addr*/, uint16_t /*len*/) {}      // data write
+    // JMP, Jcc, CALL and RET, with the resolved target
+    void branch(uint16_t /*pc*/, InstrType /*type*/, bool /*taken*/, uint16_t /*target*/) {}
+    void retire(uint16_t /*pc*/, uint8_t /*opcode*/) {}     // end of the instruction
+};
+
+// ================================================================
+// CPU over a machine layout (common.h); CPU is the 64 KB machine
+// ================================================================
+template <class Layout>
+class BasicCPU {
 public:
-    RegisterFile regs;
-    Memory memory;
+    BasicRegisterFile<Layout> regs;
+    BasicMemory<Layout> memory;
     ALU alu;
     ControlUnit cu;
 
-    CPU();
+    // Set by HALT; run() and run_for() return once it is true
+    bool halted = false;
+
+    // Why and where the CPU stopped on an unhandled guest fault
+    // (FAULT_NONE after a plain HALT)
+    FaultCause fault = FAULT_NONE;
+    uint16_t fault_pc = 0;
+    uint16_t fault_addr = 0;      // FAULT_ACCESS / FAULT_STACK
+
+    // "invalid opcode 0x99 at PC 0x0014", for host diagnostics
+    std::string fault_message() const;
+
+    // Edge coverage (fuzzing). While a map is installed, step()
+    // bumps map[(pc ^ prev_pc >> 1) % COVERAGE_SIZE] for every
+    // instruction; nullptr turns it off.
+    static constexpr size_t COVERAGE_SIZE = 1 << 16;
+    uint8_t *coverage = nullptr;
+    uint16_t coverage_prev = 0;
 
+    BasicCPU();
+
+    // Install a host routine callable through the hypercall device
+    void register_hypercall(uint8_t id, typename BasicMemory<Layout>::HyperCall fn);
+
+    // Copies the image to start, sets PC and validates the code
+    // reachable from it (see validate()). The decoded code comes
+    // from CodeCache::shared(), so CPUs loading the same image
+    // share one read-only copy.
     void load_program(const std::vector<uint8_t> &program,
                       uint16_t start);
 
+    // Load-time validation: decodes every instruction reachable
+    // from entry (following fallthrough, jump and call targets,
+    // so targets are checked at their real boundaries) and keeps
+    // the decoded copies of those that are valid for the fast
+    // path. Returns the addresses of reachable invalid ones;
+    // they fault if executed.
+    std::vector<uint16_t> validate(uint16_t entry);
+
+    // Back to power-on state (registers, RAM, devices) without
+    // reallocating; registered hypercalls and the output sink stay
+    void reset();
+
+    // run() and run_for() execute predecoded instructions;
+    // step() fetches and decodes every time (the reference)
     void run();
+
+    // Run at most max_steps instructions; returns how many ran
+    uint64_t run_for(uint64_t max_steps);
+
     void step();
+
+    // Take a pending interrupt if IF is set. The run loops call it
+    // between instructions; callers of step() call it themselves.
+    // The hooks overload reports the handler-entry push (flags and
+    // return PC, 4 bytes at the new SP) as a store.
+    void poll_interrupt() {
+        if (regs.flags.IF && memory.irq.deliverable()) take_interrupt();
+    }
+    template <class Hooks> void poll_interrupt(Hooks &hooks) {
+        if (regs.flags.IF && memory.irq.deliverable() && take_interrupt())
+            hooks.store(regs.SP, 4);
+    }
+    bool take_interrupt();                 // true: a handler was entered
+
+    // step() / run_for() reporting to hooks. The bodies live in
+    // cpu_exec.h; a hooks type needs an explicit instantiation there.
+    template <class Hooks> void step_with(Hooks &hooks);
+    template <class Hooks> uint64_t run_with(Hooks &hooks, uint64_t max_steps);
+
+private:
+    // Decoded copies of validated instructions, indexed by address;
+    // table[pc] is current while memory.is_decoded(pc). table is
+    // the shared image's until this CPU decodes anything itself,
+    // then decoded (allocated on first use) holds a private copy.
+    const DecodedInstr *table = nullptr;
+    std::shared_ptr<const DecodedImage> shared_code;
+    std::vector<DecodedInstr> decoded;
+
+    // Interrupt/fault entry in progress: a trapped push belongs
+    // to it, not to the instruction before regs.PC
+    bool entering_handler = false;
+    uint16_t handler_return = 0;
+    uint64_t guarded_steps = 0;
+
+    void predecode(uint16_t pc);
+    void own_code();
+    // True when a handler was entered (not halted)
+    bool raise_fault(uint16_t pc, const DecodedInstr &instr);
+    bool deliver_fault(uint16_t pc, FaultCause cause);
+    bool access_fault();
+    void enter_handler(uint16_t vector, uint16_t return_pc);
+
+    template <class Hooks> void step_predecoded(Hooks &hooks);
+    template <class Hooks> uint64_t run_guarded(Hooks &hooks, uint64_t max_steps);
+    template <class Hooks> void execute(Hooks &hooks, uint16_t pc, const DecodedInstr &instr);
 };
+
+using CPU = BasicCPU<Layout64K>;
@@ -0,0 +1,417 @@
+#pragma once
+
+// ================================================================
+// cpu_exec.h – Body of CPU::step_with() / CPU::run_with()
+// Include only from a translation unit that instantiates them
+// with its own Hooks type (cpu.cpp does NoHooks; timing.cpp does
+// the timing model):
+//
+//     #include "cpu_exec.h"
+//     template void CPU::step_with<MyHooks>(MyHooks &);
+//
+// (BasicCPU<Layout>::step_with for a CPU of another layout)
+// ================================================================
+
+#include "cpu.h"
+
+// =======================================
+// Execute a single instruction (reference path)
+// Fetch → Decode → Execute → Update PC
+// =======================================
+template <class Layout>
+template <class Hooks>
+void BasicCPU<Layout>::step_with(Hooks &hooks)
+{
+    // -------- FETCH --------
+    uint16_t pc = regs.PC;
+    hooks.fetch(pc);
+    uint8_t opcode = memory.read8(pc);
+    uint16_t op1 = memory.read16(pc + 1);
+    uint16_t op2 = memory.read16(pc + 3);
+    regs.PC = pc + 5;
+
+    if (coverage) {
+        coverage[(pc ^ coverage_prev) & (COVERAGE_SIZE - 1)]++;
+        coverage_prev = pc >> 1;
+    }
+
+    // -------- DECODE --------
+    DecodedInstr instr = cu.decode(opcode, op1, op2, Layout::REG_COUNT);
+
+    execute(hooks, pc, instr);
+}
+
+// =======================================
+// Execute a single instruction (fast path)
+// Same as step_with(), but runs the decoded
+// copy of pc when it is current. Otherwise pc
+// is decoded and validated once here, and
+// again only after a write to its bytes.
+// =======================================
+template <class Layout>
+template <class Hooks>
+void BasicCPU<Layout>::step_predecoded(Hooks &hooks)
+{
+    uint16_t pc = regs.PC;
+    hooks.fetch(pc);
+    regs.PC = pc + 5;
+    if (!memory.is_decoded(pc)) predecode(pc);
+
+    if (coverage) {
+        coverage[(pc ^ coverage_prev) & (COVERAGE_SIZE - 1)]++;
+        coverage_prev = pc >> 1;
+    }
+
+    execute(hooks, pc, table[pc & Layout::MEM_MASK]);
+}
+
+// =======================================
+// Execute a decoded instruction. regs.PC
+// already points past it. Register fields are
+// in range: decode() turns anything else into
+// InstrType::NONE, which faults.
+//
+// Every memory access comes before any register
+// update, so an access that traps on guarded
+// memory (run_guarded) leaves the registers as
+// they were and regs.PC - 5 names the instruction.
+// =======================================
+template <class Layout>
+template <class Hooks>
+void BasicCPU<Layout>::execute(Hooks &hooks, uint16_t pc, const DecodedInstr &instr)
+{
+    // -------- EXECUTE --------
+    // PMU event counts are bumped inline; retired instructions
+    // are counted by memory.tick_timer(). Store events are counted
+    // after the write, so a region includes the store that begins
+    // it and not the one that ends it, like the instruction count.
+    uint64_t *pmu = memory.pmu.events;
+
+    switch (instr.type)
+    {
+        // =============================
+        // MOV Rn, imm
+        // =============================
+        case InstrType::REG_IMM:
+            regs.R[instr.rd] = instr.imm;
+            regs.flags.ZF = (instr.imm == 0);
+            break;
+
+        // =============================
+        // MOV Rn, Rm
+        // =============================
+        case InstrType::REG_REG:
+        {
+            uint16_t val = regs.R[instr.rs];
+            regs.R[instr.rd] = val;
+            regs.flags.ZF = (val == 0);
+            break;
+        }
+
+        // =============================
+        // ALU ops: ADD, SUB, CMP, etc.
+        // Rd <op> Rs  or  Rd <op> imm
+        // =============================
+        case InstrType::ALU_REG_REG:
+        case InstrType::ALU_REG_IMM:
+        {
+            uint16_t a = regs.R[instr.rd];
+            uint16_t b = (instr.type == InstrType::ALU_REG_IMM)
+                       ? instr.imm
+                       : regs.R[instr.rs];
+            uint16_t result = 0;
+
+            switch (instr.alu_op)
+            {
+                case ALUOp::ADD: result = alu.add(a, b, regs.flags); break;
+                case ALUOp::SUB: result = alu.sub(a, b, regs.flags); break;
+                case ALUOp::AND_: result = alu._and(a, b, regs.flags); break;
+                case ALUOp::OR_:  result = alu._or(a, b, regs.flags); break;
+                case ALUOp::XOR_: result = alu._xor(a, b, regs.flags); break;
+                case ALUOp::MUL:  result = alu.mul(a, b, regs.flags); break;
+                case ALUOp::DIV:  result = alu.div(a, b, regs.flags); break;
+                case ALUOp::MOD:  result = alu.mod(a, b, regs.flags); break;
+                case ALUOp::CMP:
+                    alu.cmp(a, b, regs.flags);
+                    break;
+                default: break;
+            }
+
+            if (instr.alu_op != ALUOp::CMP)
+                regs.R[instr.rd] = result;
+
+            break;
+        }
+
+        // =============================
+        // LOAD / STORE
+        // =============================
+        case InstrType::LOAD_WORD:
+            hooks.load(instr.imm, 2);
+            pmu[PMU_LOADS]++;
+            regs.R[instr.rd] = memory.read16(instr.imm);
+            break;
+
+        case InstrType::STORE_WORD:
+            hooks.store(instr.imm, 2);
+            memory.write16(instr.imm, regs.R[instr.rs]);
+            pmu[PMU_STORES]++;
+            pmu[PMU_MMIO_WRITES] += ((instr.imm & Layout::MEM_MASK) >= Layout::IO_PAGE);
+            break;
+
+        // =============================
+        // LOAD / STORE [Rb + offset]
+        // =============================
+        case InstrType::LOAD_INDEXED:
+        {
+            uint16_t addr = regs.R[instr.rb] + instr.imm;
+            hooks.load(addr, 2);
+            pmu[PMU_LOADS]++;
+            regs.R[instr.rd] = memory.read16(addr);
+            break;
+        }
+
+        case InstrType::STORE_INDEXED:
+        {
+            uint16_t addr = regs.R[instr.rb] + instr.imm;
+            hooks.store(addr, 2);
+            memory.write16(addr, regs.R[instr.rs]);
+            pmu[PMU_STORES]++;
+            pmu[PMU_MMIO_WRITES] += ((addr & Layout::MEM_MASK) >= Layout::IO_PAGE);
+            break;
+        }
+
+        // =============================
+        // MEMCPY / MEMSET / STRPRINT
+        // =============================
+        case InstrType::BLOCK_COPY:
+            hooks.load(regs.R[instr.rs], regs.R[instr.rc]);
+            hooks.store(regs.R[instr.rd], regs.R[instr.rc]);
+            memory.copy_block(regs.R[instr.rd], regs.R[instr.rs], regs.R[instr.rc]);
+            break;
+
+        case InstrType::BLOCK_FILL:
+            hooks.store(regs.R[instr.rd], regs.R[instr.rc]);
+            memory.fill_block(regs.R[instr.rd], regs.R[instr.rs] & 0xFF, regs.R[instr.rc]);
+            break;
+
+        // The string's extent is only known once it is printed
+        case InstrType::PRINT_STR:
+        {
+            uint16_t addr = regs.R[instr.rs];
+            hooks.load(addr, memory.print_string(addr));
+            break;
+        }
+
+        case InstrType::PRINT_COUNTED:
+        {
+            uint16_t addr = regs.R[instr.rs];
+            hooks.load(addr, 2);
+            uint16_t len = memory.print_counted(addr);
+            if (len) hooks.load(addr + 2, len);
+            break;
+        }
+
+        // =============================
+        // JUMP
+        // =============================
+        case InstrType::JUMP:
+            hooks.branch(pc, instr.type, true, instr.imm);
+            pmu[PMU_BRANCHES]++;
+            regs.PC = instr.imm;
+            break;
+
+        // =============================
+        // JZ / JNZ / JC / JNC
+        // =============================
+        case InstrType::JUMP_COND:
+        {
+            bool taken = false;
+            switch (instr.cond)
+            {
+                case Cond::Z:  taken = regs.flags.ZF;  break;
+                case Cond::NZ: taken = !regs.flags.ZF; break;
+                case Cond::C:  taken = regs.flags.CF;  break;
+                case Cond::NC: taken = !regs.flags.CF; break;
+                default:       taken = true;           break;
+            }
+            hooks.branch(pc, instr.type, taken, instr.imm);
+            pmu[PMU_BRANCHES] += taken;
+            if (taken)
+                regs.PC = instr.imm;
+            break;
+        }
+
+        // =============================
+        // PUSH Rn
+        // =============================
+        case InstrType::PUSH_REG:
+        {
+            uint16_t sp = regs.SP - 2;
+            hooks.store(sp, 2);
+            memory.write16(sp, regs.R[instr.rs]);
+            regs.SP = sp;
+            pmu[PMU_STORES]++;
+            pmu[PMU_MMIO_WRITES] += ((sp & Layout::MEM_MASK) >= Layout::IO_PAGE);
+            break;
+        }
+
+        // =============================
+        // POP Rn
+        // =============================
+        case InstrType::POP_REG:
+        {
+            hooks.load(regs.SP, 2);
+            pmu[PMU_LOADS]++;
+            regs.R[instr.rd] = memory.read16(regs.SP);
+            regs.SP += 2;
+            break;
+        }
+
+        // =============================
+        // MOVSP Rd / SETSP Rs
+        // =============================
+        case InstrType::READ_SP:
+            regs.R[instr.rd] = regs.SP;
+            break;
+
+        case InstrType::WRITE_SP:
+            regs.SP = regs.R[instr.rs];
+            break;
+
+        // =============================
+        // CALL address
+        // =============================
+        case InstrType::CALL:
+        {
+            uint16_t sp = regs.SP - 2;
+            hooks.store(sp, 2);
+            hooks.branch(pc, instr.type, true, instr.imm);
+            pmu[PMU_BRANCHES]++;
+            pmu[PMU_CALLS]++;
+            memory.write16(sp, regs.PC);       // push return PC
+            regs.SP = sp;
+            regs.PC = instr.imm;               // jump to function
+            break;
+        }
+
+        // =============================
+        // RET
+        // =============================
+        case InstrType::RET:
+        {
+            hooks.load(regs.SP, 2);
+            uint16_t retAddr = memory.read16(regs.SP); // pop PC
+            regs.SP += 2;
+            hooks.branch(pc, instr.type, true, retAddr);
+            pmu[PMU_BRANCHES]++;
+            regs.PC = retAddr;
+            break;
+        }
+
+        // =============================
+        // IRET: pop flags word, then PC
+        // =============================
+        case InstrType::IRET:
+        {
+            hooks.load(regs.SP, 4);
+            uint16_t f = memory.read16(regs.SP);
+            uint16_t retAddr = memory.read16(regs.SP + 2);
+            regs.SP += 4;
+            regs.flags.ZF = f & FLAGS_ZF;
+            regs.flags.CF = f & FLAGS_CF;
+            regs.flags.IF = f & FLAGS_IF;
+            hooks.branch(pc, instr.type, true, retAddr);
+            pmu[PMU_BRANCHES]++;
+            regs.PC = retAddr;
+            break;
+        }
+
+        // =============================
+        // EI / DI
+        // =============================
+        case InstrType::INT_ENABLE:
+            regs.flags.IF = true;
+            break;
+
+        case InstrType::INT_DISABLE:
+            regs.flags.IF = false;
+            break;
+
+        // =============================
+        // WFI: park the host thread until an enabled line is
+        // pending (taken by the run loop if IF is set)
+        // =============================
+        case InstrType::WAIT:
+            memory.wait_for_interrupt();
+            break;
+
+        // =============================
+        // HALT
+        // =============================
+        case InstrType::HALT:
+            halted = true;
+            break;
+
+        // =============================
+        // Invalid instruction
+        // =============================
+        case InstrType::NONE:
+            if (raise_fault(pc, instr)) hooks.store(regs.SP, 4);
+            break;
+    }
+
+    hooks.retire(pc, instr.opcode);
+}
+
+// =======================================
+// run() with hooks; same contract as run_for()
+// Runs on the predecoded fast path
+// =======================================
+template <class Layout>
+template <class Hooks>
+uint64_t BasicCPU<Layout>::run_with(Hooks &hooks, uint64_t max_steps)
+{
+    if (memory.guarded()) return run_guarded(hooks, max_steps);
+
+    uint64_t n = 0;
+    while (!halted && n < max_steps) {
+        step_predecoded(hooks);
+        memory.tick_timer();
+        poll_interrupt(hooks);
+        n++;
+    }
+    return n;
+}
+
+// =======================================
+// run_with() on guarded memory. Accesses to a
+// guard page land back here through the signal
+// handler and become guest faults; the count
+// lives in a member since locals do not survive
+// the jump.
+// =======================================
+template <class Layout>
+template <class Hooks>
+uint64_t BasicCPU<Layout>::run_guarded(Hooks &hooks, uint64_t max_steps)
+{
+    GuardedRam::Landing pad;
+    GuardedRam::enter(pad);
+    guarded_steps = 0;
+
+    if (sigsetjmp(pad.env, 0)) {
+        if (access_fault()) hooks.store(regs.SP, 4);
+        memory.tick_timer();
+        guarded_steps++;
+    }
+
+    while (!halted && guarded_steps < max_steps) {
+        step_predecoded(hooks);
+        memory.tick_timer();
+        poll_interrupt(hooks);
+        guarded_steps++;
+    }
+
+    GuardedRam::leave(pad);
+    return guarded_steps;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "common.h"
+
+// ================================================================
+// ISA TABLE
+// Single source of truth for every instruction: mnemonic, opcode,
+// operand encoding and the InstrType the CPU executes it as.
+//
+// From this table we build, at compile time:
+//   - DECODE_TABLE   : 256-entry opcode -> DecodeEntry (ControlUnit)
+//   - MNEMONIC_HASH  : perfect hash mnemonic -> table index (Assembler)
+//   - disassemble()  : text form of an encoded instruction
+//
+// To add an instruction, add an OP_* constant in common.h and one
+// row below.
+// ================================================================
+
+// ----------------------------------------------------------------
+// Operand encodings
+// Every instruction is 5 bytes: opcode, op1 (16-bit), op2 (16-bit).
+// The encoding says which DecodedInstr field each operand fills.
+// "lo/hi" = low/high byte of op1.
+// ----------------------------------------------------------------
+enum class Encoding : uint8_t {
+    NONE,        //                            RET, HALT
+    RD,          // op1 = Rd                   POP
+    RS,          // op1 = Rs                   PUSH, STRPRINT
+    ADDR,        // op1 = address              JMP, JZ, CALL
+    RD_IMM,      // op1 = Rd, op2 = imm        MOVI, ADDI, LOAD
+    RS_IMM,      // op1 = Rs, op2 = address    STORE
+    RD_RS,       // op1 = Rd, op2 = Rs         MOV, ADD
+    RD_MEM,      // lo = Rd, hi = Rb, op2 = offset     LOADX
+    RS_MEM,      // lo = Rs, hi = Rb, op2 = offset     STOREX
+    RD_RS_RC     // lo = Rd, hi = Rs, op2 = Rc         MEMCPY, MEMSET
+};
+
+struct InstrInfo {
+    std::string_view mnemonic;
+    uint8_t   opcode;
+    Encoding  enc;
+    InstrType type;
+    ALUOp     alu_op;
+    Cond      cond;
+};
+
+static constexpr InstrInfo ISA_TABLE[] = {
+    // mnemonic     opcode        encoding            type                       alu op        cond
+    { "MOVI",      OP_MOVI,      Encoding::RD_IMM,   InstrType::REG_IMM,        ALUOp::MOV,   Cond::ALWAYS },
+    { "MOV",       OP_MOV,       Encoding::RD_RS,    InstrType::REG_REG,        ALUOp::MOV,   Cond::ALWAYS },
+
+    { "ADD",       OP_ADD,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::ADD,   Cond::ALWAYS },
+    { "SUB",       OP_SUB,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::SUB,   Cond::ALWAYS },
+    { "AND",       OP_AND,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::AND_,  Cond::ALWAYS },
+    { "OR",        OP_OR,        Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::OR_,   Cond::ALWAYS },
+    { "XOR",       OP_XOR,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::XOR_,  Cond::ALWAYS },
+    { "CMP",       OP_CMP,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::CMP,   Cond::ALWAYS },
+    { "MUL",       OP_MUL,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::MUL,   Cond::ALWAYS },
+    { "DIV",       OP_DIV,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::DIV,   Cond::ALWAYS },
+    { "MOD",       OP_MOD,       Encoding::RD_RS,    InstrType::ALU_REG_REG,    ALUOp::MOD,   Cond::ALWAYS },
+
+    { "ADDI",      OP_ADDI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::ADD,   Cond::ALWAYS },
+    { "SUBI",      OP_SUBI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::SUB,   Cond::ALWAYS },
+    { "ANDI",      OP_ANDI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::AND_,  Cond::ALWAYS },
+    { "ORI",       OP_ORI,       Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::OR_,   Cond::ALWAYS },
+    { "XORI",      OP_XORI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::XOR_,  Cond::ALWAYS },
+    { "CMPI",      OP_CMPI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::CMP,   Cond::ALWAYS },
+    { "MULI",      OP_MULI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::MUL,   Cond::ALWAYS },
+    { "DIVI",      OP_DIVI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::DIV,   Cond::ALWAYS },
+    { "MODI",      OP_MODI,      Encoding::RD_IMM,   InstrType::ALU_REG_IMM,    ALUOp::MOD,   Cond::ALWAYS },
+
+    { "LOAD",      OP_LOAD,      Encoding::RD_IMM,   InstrType::LOAD_WORD,      ALUOp::NONE,  Cond::ALWAYS },
+    { "STORE",     OP_STORE,     Encoding::RS_IMM,   InstrType::STORE_WORD,     ALUOp::NONE,  Cond::ALWAYS },
+    { "LOADX",     OP_LOADX,     Encoding::RD_MEM,   InstrType::LOAD_INDEXED,   ALUOp::NONE,  Cond::ALWAYS },
+    { "STOREX",    OP_STOREX,    Encoding::RS_MEM,   InstrType::STORE_INDEXED,  ALUOp::NONE,  Cond::ALWAYS },
+
+    { "MEMCPY",    OP_MEMCPY,    Encoding::RD_RS_RC, InstrType::BLOCK_COPY,     ALUOp::NONE,  Cond::ALWAYS },
+    { "MEMSET",    OP_MEMSET,    Encoding::RD_RS_RC, InstrType::BLOCK_FILL,     ALUOp::NONE,  Cond::ALWAYS },
+    { "STRPRINT",  OP_STRPRINT,  Encoding::RS,       InstrType::PRINT_STR,      ALUOp::NONE,  Cond::ALWAYS },
+    { "STRPRINTL", OP_STRPRINTL, Encoding::RS,       InstrType::PRINT_COUNTED,  ALUOp::NONE,  Cond::ALWAYS },
+
+    { "JMP",       OP_JMP,       Encoding::ADDR,     InstrType::JUMP,           ALUOp::NONE,  Cond::ALWAYS },
+    { "JZ",        OP_JZ,        Encoding::ADDR,     InstrType::JUMP_COND,      ALUOp::NONE,  Cond::Z      },
+    { "JNZ",       OP_JNZ,       Encoding::ADDR,     InstrType::JUMP_COND,      ALUOp::NONE,  Cond::NZ     },
+    { "JC",        OP_JC,        Encoding::ADDR,     InstrType::JUMP_COND,      ALUOp::NONE,  Cond::C      },
+    { "JNC",       OP_JNC,       Encoding::ADDR,     InstrType::JUMP_COND,      ALUOp::NONE,  Cond::NC     },
+
+    { "PUSH",      OP_PUSH,      Encoding::RS,       InstrType::PUSH_REG,       ALUOp::NONE,  Cond::ALWAYS },
+    { "POP",       OP_POP,       Encoding::RD,       InstrType::POP_REG,        ALUOp::NONE,  Cond::ALWAYS },
+    { "MOVSP",     OP_MOVSP,     Encoding::RD,       InstrType::READ_SP,        ALUOp::NONE,  Cond::ALWAYS },
+    { "SETSP",     OP_SETSP,     Encoding::RS,       InstrType::WRITE_SP,       ALUOp::NONE,  Cond::ALWAYS },
+    { "CALL",      OP_CALL,      Encoding::ADDR,     InstrType::CALL,           ALUOp::NONE,  Cond::ALWAYS },
+    { "RET",       OP_RET,       Encoding::NONE,     InstrType::RET,            ALUOp::NONE,  Cond::ALWAYS },
+    { "IRET",      OP_IRET,      Encoding::NONE,     InstrType::IRET,           ALUOp::NONE,  Cond::ALWAYS },
+
+    { "EI",        OP_EI,        Encoding::NONE,     InstrType::INT_ENABLE,     ALUOp::NONE,  Cond::ALWAYS },
+    { "DI",        OP_DI,        Encoding::NONE,     InstrType::INT_DISABLE,    ALUOp::NONE,  Cond::ALWAYS },
+    { "WFI",       OP_WFI,       Encoding::NONE,     InstrType::WAIT,           ALUOp::NONE,  Cond::ALWAYS },
+
+    { "HALT",      OP_HALT,      Encoding::NONE,     InstrType::HALT,           ALUOp::NONE,  Cond::ALWAYS },
+};
+
+static constexpr size_t ISA_SIZE = sizeof(ISA_TABLE) / sizeof(ISA_TABLE[0]);
+static constexpr uint8_t ISA_NONE = 0xFF;   // "no instruction" index
+
+// ================================================================
+// DECODE TABLE
+// One entry per opcode byte. Unused opcodes decode to
+// InstrType::NONE with index ISA_NONE.
+// ================================================================
+struct DecodeEntry {
+    InstrType type   = InstrType::NONE;
+    ALUOp     alu_op = ALUOp::NONE;
+    Cond      cond   = Cond::ALWAYS;
+    Encoding  enc    = Encoding::NONE;
+    uint8_t   index  = ISA_NONE;      // row in ISA_TABLE
+};
+
+constexpr std::array<DecodeEntry, 256> build_decode_table() {
+    std::array<DecodeEntry, 256> t{};
+    for (size_t i = 0; i < ISA_SIZE; i++) {
+        const InstrInfo &info = ISA_TABLE[i];
+        t[info.opcode] = { info.type, info.alu_op, info.cond, info.enc,
+                           static_cast<uint8_t>(i) };
+    }
+    return t;
+}
+
+static constexpr std::array<DecodeEntry, 256> DECODE_TABLE = build_decode_table();
+
+// Every opcode must appear exactly once
+constexpr bool opcodes_unique() {
+    for (size_t i = 0; i < ISA_SIZE; i++)
+        for (size_t j = i + 1; j < ISA_SIZE; j++)
+            if (ISA_TABLE[i].opcode == ISA_TABLE[j].opcode) return false;
+    return true;
+}
+static_assert(opcodes_unique(), "duplicate opcode in ISA_TABLE");
+
+// ================================================================
+// MNEMONIC PERFECT HASH
+// FNV-1a seeded with a value searched at compile time so that all
+// mnemonics land in distinct slots of a 256-entry table. A lookup
+// is one hash, one table load and one string compare.
+// ================================================================
+static constexpr size_t MNEMONIC_SLOTS = 256;
+
+constexpr uint32_t mnemonic_hash(uint32_t seed, std::string_view s) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : s) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 16);
+}
+
+constexpr uint32_t find_mnemonic_seed() {
+    for (uint32_t seed = 0; seed < 100000; seed++) {
+        bool used[MNEMONIC_SLOTS] = {};
+        bool ok = true;
+        for (size_t i = 0; i < ISA_SIZE && ok; i++) {
+            size_t slot = mnemonic_hash(seed, ISA_TABLE[i].mnemonic) % MNEMONIC_SLOTS;
+            ok = !used[slot];
+            used[slot] = true;
+        }
+        if (ok) return seed;
+    }
+    return 0xFFFFFFFFu;
+}
+
+static constexpr uint32_t MNEMONIC_SEED = find_mnemonic_seed();
+static_assert(MNEMONIC_SEED != 0xFFFFFFFFu, "no perfect hash seed for ISA_TABLE");
+
+constexpr std::array<uint8_t, MNEMONIC_SLOTS> build_mnemonic_hash() {
+    std::array<uint8_t, MNEMONIC_SLOTS> t{};
+    for (auto &e : t) e = ISA_NONE;
+    for (size_t i = 0; i < ISA_SIZE; i++)
+        t[mnemonic_hash(MNEMONIC_SEED, ISA_TABLE[i].mnemonic) % MNEMONIC_SLOTS] =
+            static_cast<uint8_t>(i);
+    return t;
+}
+
+static constexpr std::array<uint8_t, MNEMONIC_SLOTS> MNEMONIC_HASH = build_mnemonic_hash();
+
+// Look up a mnemonic; nullptr if unknown
+constexpr const InstrInfo *find_instruction(std::string_view mnemonic) {
+    uint8_t i = MNEMONIC_HASH[mnemonic_hash(MNEMONIC_SEED, mnemonic) % MNEMONIC_SLOTS];
+    if (i == ISA_NONE || ISA_TABLE[i].mnemonic != mnemonic) return nullptr;
+    return &ISA_TABLE[i];
+}
+
+// Look up an opcode; nullptr if unused
+constexpr const InstrInfo *find_instruction(uint8_t opcode) {
+    uint8_t i = DECODE_TABLE[opcode].index;
+    return i == ISA_NONE ? nullptr : &ISA_TABLE[i];
+}
+
+static_assert(find_instruction("CALL")->opcode == OP_CALL, "mnemonic hash broken");
+static_assert(find_instruction("NOPE") == nullptr, "mnemonic hash broken");
+
+// ================================================================
+// DISASSEMBLER
+// Text form of one encoded instruction, e.g. "LOADX R0, [R1+4]"
+// ================================================================
+inline std::string disassemble(uint8_t opcode, uint16_t op1, uint16_t op2) {
+    const InstrInfo *info = find_instruction(opcode);
+    if (!info) {
+        static const char hex[] = "0123456789ABCDEF";
+        return std::string(".byte 0x") + hex[opcode >> 4] + hex[opcode & 0xF];
+    }
+
+    auto reg = [](unsigned r) { return "R" + std::to_string(r); };
+    auto num = [](uint16_t v) {
+        static const char hex[] = "0123456789ABCDEF";
+        std::string s = "0x";
+        for (int shift = 12; shift >= 0; shift -= 4) s += hex[(v >> shift) & 0xF];
+        return s;
+    };
+    auto mem = [&](unsigned base, uint16_t off) {
+        if (off == 0) return "[" + reg(base) + "]";
+        if (off & 0x8000) return "[" + reg(base) + "-" + std::to_string(0x10000 - off) + "]";
+        return "[" + reg(base) + "+" + std::to_string(off) + "]";
+    };
+
+    std::string s(info->mnemonic);
+    switch (info->enc) {
+        case Encoding::NONE:     break;
+        case Encoding::RD:
+        case Encoding::RS:       s += " " + reg(op1); break;
+        case Encoding::ADDR:     s += " " + num(op1); break;
+        case Encoding::RD_IMM:
+        case Encoding::RS_IMM:   s += " " + reg(op1) + ", " + num(op2); break;
+        case Encoding::RD_RS:    s += " " + reg(op1) + ", " + reg(op2); break;
+        case Encoding::RD_MEM:
+        case Encoding::RS_MEM:   s += " " + reg(op1 & 0xFF) + ", " + mem(op1 >> 8, op2); break;
+        case Encoding::RD_RS_RC: s += " " + reg(op1 & 0xFF) + ", " + reg(op1 >> 8) + ", " + reg(op2); break;
+    }
+    return s;
+}
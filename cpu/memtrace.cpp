@@ -0,0 +1,217 @@
+#include "memtrace.h"
+#include "cpu_exec.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+template void CPU::step_with<MemTrace>(MemTrace &);
+template uint64_t CPU::run_with<MemTrace>(MemTrace &, uint64_t);
+
+// ================================================================
+// MemTrace
+// ================================================================
+MemTrace::MemTrace(const RegisterFile &regs, uint32_t line, uint32_t window)
+    : regs(regs)
+{
+    while ((1u << shift) < line) shift++;
+    data.line = 1u << shift;
+    data.window = std::max<uint32_t>(window, 1);
+    counts.resize(MEM_SIZE >> shift);
+}
+
+void MemTrace::touch_line(uint32_t line, Kind kind)
+{
+    Counts &c = counts[line];
+    uint64_t now = data.instructions;
+    if (c.n[READ] + c.n[WRITE] + c.n[FETCH] == 0) c.first = now;
+    c.last = now;
+    c.n[kind]++;
+
+    if (kind == FETCH) {
+        if (c.seen_code != window_id) {
+            c.seen_code = window_id;
+            current.code_lines++;
+        }
+        return;
+    }
+    if (c.seen_data != window_id) {
+        c.seen_data = window_id;
+        current.data_lines++;
+    }
+    current.heat[(line << shift) / MemTraceData::HEAT_REGION]++;
+}
+
+// [addr, addr + len) wraps at the top of memory like the CPU's
+// accesses do
+void MemTrace::touch(uint16_t addr, uint32_t len, Kind kind)
+{
+    if (len == 0) return;
+    uint32_t lines = MEM_SIZE >> shift;
+    uint32_t first = addr >> shift;
+    uint32_t last = (addr + len - 1) >> shift;
+    for (uint32_t l = first; l <= last; l++) touch_line(l % lines, kind);
+}
+
+void MemTrace::fetch(uint16_t pc)
+{
+    touch(pc, 5, FETCH);
+}
+
+void MemTrace::retire(uint16_t, uint8_t)
+{
+    data.instructions++;
+
+    uint16_t depth = regs.SP <= STACK_TOP ? STACK_TOP - regs.SP : 0;
+    current.max_stack = std::max(current.max_stack, depth);
+    current.end_stack = depth;
+
+    if (++in_window == data.window) close_window();
+}
+
+void MemTrace::close_window()
+{
+    data.windows.push_back(current);
+    current = MemTraceData::Window();
+    current.max_stack = current.end_stack = data.windows.back().end_stack;
+    window_id++;
+    in_window = 0;
+}
+
+const MemTraceData &MemTrace::finish()
+{
+    if (in_window) close_window();
+
+    data.lines.clear();
+    for (uint32_t l = 0; l < counts.size(); l++) {
+        const Counts &c = counts[l];
+        if (c.n[READ] + c.n[WRITE] + c.n[FETCH] == 0) continue;
+        MemTraceData::Line line;
+        line.addr = l << shift;
+        line.reads = c.n[READ];
+        line.writes = c.n[WRITE];
+        line.fetches = c.n[FETCH];
+        line.first = c.first;
+        line.last = c.last;
+        data.lines.push_back(line);
+    }
+    return data;
+}
+
+// ================================================================
+// .mtrc files
+// ================================================================
+namespace {
+
+struct Writer {
+    std::ofstream &out;
+    void u16(uint16_t v) { bytes(v, 2); }
+    void u32(uint32_t v) { bytes(v, 4); }
+    void u64(uint64_t v) { bytes(v, 8); }
+    void bytes(uint64_t v, int n) {
+        char b[8];
+        for (int i = 0; i < n; i++) b[i] = static_cast<char>(v >> (8 * i));
+        out.write(b, n);
+    }
+};
+
+struct Reader {
+    std::ifstream &in;
+    uint16_t u16() { return static_cast<uint16_t>(bytes(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(bytes(4)); }
+    uint64_t u64() { return bytes(8); }
+    uint64_t bytes(int n) {
+        unsigned char b[8] = {};
+        in.read(reinterpret_cast<char *>(b), n);
+        uint64_t v = 0;
+        for (int i = 0; i < n; i++) v |= static_cast<uint64_t>(b[i]) << (8 * i);
+        return v;
+    }
+};
+
+} // namespace
+
+bool MemTraceData::save(const std::string &path, std::string &err) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        err = "cannot write " + path;
+        return false;
+    }
+    Writer w{out};
+    out.write("MTRC", 4);
+    w.u32(VERSION);
+    w.u32(line);
+    w.u32(window);
+    w.u64(instructions);
+    w.u32(static_cast<uint32_t>(lines.size()));
+    w.u32(static_cast<uint32_t>(windows.size()));
+
+    for (const Line &l : lines) {
+        w.u32(l.addr);
+        w.u64(l.reads);
+        w.u64(l.writes);
+        w.u64(l.fetches);
+        w.u64(l.first);
+        w.u64(l.last);
+    }
+    for (const Window &win : windows) {
+        w.u32(win.data_lines);
+        w.u32(win.code_lines);
+        w.u16(win.max_stack);
+        w.u16(win.end_stack);
+        for (uint32_t h : win.heat) w.u32(h);
+    }
+    if (!out) {
+        err = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool MemTraceData::load(const std::string &path, std::string &err)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    if (!in || !in.read(magic, 4) || std::memcmp(magic, "MTRC", 4) != 0) {
+        err = path + ": not a memory trace";
+        return false;
+    }
+    Reader r{in};
+    if (r.u32() != VERSION) {
+        err = path + ": unsupported trace version";
+        return false;
+    }
+    line = r.u32();
+    window = r.u32();
+    instructions = r.u64();
+    uint32_t nlines = r.u32(), nwindows = r.u32();
+    if (!in || line == 0 || nlines > MEM_SIZE) {
+        err = path + ": corrupt header";
+        return false;
+    }
+
+    lines.resize(nlines);
+    for (Line &l : lines) {
+        l.addr = r.u32();
+        l.reads = r.u64();
+        l.writes = r.u64();
+        l.fetches = r.u64();
+        l.first = r.u64();
+        l.last = r.u64();
+    }
+    windows.clear();
+    for (uint32_t i = 0; i < nwindows && in; i++) {
+        Window win;
+        win.data_lines = r.u32();
+        win.code_lines = r.u32();
+        win.max_stack = r.u16();
+        win.end_stack = r.u16();
+        for (uint32_t &h : win.heat) h = r.u32();
+        windows.push_back(win);
+    }
+    if (!in) {
+        err = path + ": truncated";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "isa.h"
+#include "registers.h"
+
+// ================================================================
+// MEMORY TRACE
+// Records how a guest uses its address space: per cache line,
+// read, write and fetch counts with the first and last retired
+// instruction that touched it; per window of instructions, the
+// working set (distinct data and code lines), the stack depth
+// (STACK_TOP - SP, sampled after every instruction) and a coarse
+// heatmap of data accesses per 1 KB region.
+//
+// MemTrace is a hooks type for CPU::run_with() like TimingModel,
+// so only tools that ask for it pay for it; ./emulator is built
+// without any of this. It sees what the hooks report: LOAD/STORE
+// (direct and indexed), PUSH/POP, CALL/RET/IRET stack traffic,
+// MEMCPY/MEMSET ranges, STRPRINT/STRPRINTL strings (NUL and length
+// word included) and the 4-byte push on interrupt and fault entry.
+// Not reported, so missing from the trace:
+//   - guest buffers read or written by hypercalls (SORT16, HASH32,
+//     FORMAT); only the store to the call register shows
+//   - bytes the input device writes into guest RAM (BULK reads)
+//   - accesses by the host: image loading, emud pokes, debuggers
+//
+//     MemTrace trace(cpu.regs, 64, 10000);
+//     cpu.run_with(trace, max_steps);
+//     trace.finish().save("run.mtrc", err);
+// ================================================================
+
+// ----------------------------------------------------------------
+// What a trace holds; save()/load() use the .mtrc format:
+//   header  "MTRC", u32 version, u32 line, u32 window,
+//           u64 instructions, u32 lines, u32 windows
+//   lines   u32 addr, u64 reads, writes, fetches, first, last
+//           (touched lines only, by address)
+//   windows u32 data_lines, code_lines, u16 max_stack,
+//           end_stack, u32 heat[HEAT_REGIONS]
+// all little-endian.
+// ----------------------------------------------------------------
+struct MemTraceData {
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t HEAT_REGION = 1024;                  // bytes
+    static constexpr uint32_t HEAT_REGIONS = MEM_SIZE / HEAT_REGION;
+
+    struct Line {
+        uint32_t addr = 0;
+        uint64_t reads = 0, writes = 0, fetches = 0;
+        uint64_t first = 0, last = 0;    // retired instructions before the touch
+    };
+
+    struct Window {
+        uint32_t data_lines = 0;         // distinct lines loaded or stored
+        uint32_t code_lines = 0;         // distinct lines fetched
+        uint16_t max_stack = 0;          // deepest, in bytes
+        uint16_t end_stack = 0;
+        uint32_t heat[HEAT_REGIONS] = {};  // data accesses per region
+    };
+
+    uint32_t line = 64;                  // bytes, power of two
+    uint32_t window = 10000;             // instructions
+    uint64_t instructions = 0;
+    std::vector<Line> lines;
+    std::vector<Window> windows;
+
+    bool save(const std::string &path, std::string &err) const;
+    bool load(const std::string &path, std::string &err);
+};
+
+// ----------------------------------------------------------------
+// MemTrace: the CPU hooks that build a MemTraceData
+// ----------------------------------------------------------------
+class MemTrace {
+public:
+    // regs: the traced CPU's registers (for SP). line: bytes per
+    // line, a power of two (1 = per address); window: instructions
+    // per working-set window
+    MemTrace(const RegisterFile &regs, uint32_t line, uint32_t window);
+
+    // ---- CPU hooks ----
+    void fetch(uint16_t pc);
+    void load(uint16_t addr, uint16_t len) { touch(addr, len, READ); }
+    void store(uint16_t addr, uint16_t len) { touch(addr, len, WRITE); }
+    void branch(uint16_t, InstrType, bool, uint16_t) {}
+    void retire(uint16_t pc, uint8_t opcode);
+
+    // Closes the last (partial) window and returns the trace
+    const MemTraceData &finish();
+
+private:
+    enum Kind { READ, WRITE, FETCH };
+
+    struct Counts {
+        uint64_t n[3] = {};
+        uint64_t first = 0, last = 0;
+        uint32_t seen_data = 0, seen_code = 0;   // window + 1 last touched
+    };
+
+    const RegisterFile &regs;
+    uint32_t shift = 0;
+    std::vector<Counts> counts;          // per line
+    MemTraceData data;
+    MemTraceData::Window current;
+    uint32_t window_id = 1;              // stamp for the open window
+    uint64_t in_window = 0;              // instructions in it
+
+    void touch(uint16_t addr, uint32_t len, Kind kind);
+    void touch_line(uint32_t line, Kind kind);
+    void close_window();
+};
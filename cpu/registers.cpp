@@ -5,25 +5,26 @@
 // =======================================
 // Constructor: initialize all registers
 // =======================================
-RegisterFile::RegisterFile() {
-    for (int i = 0; i < REG_COUNT; i++)
+template <class Layout>
+BasicRegisterFile<Layout>::BasicRegisterFile() {
+    for (int i = 0; i < Layout::REG_COUNT; i++)
         R[i] = 0;
 
     PC = 0;
 
-    // Stack grows downward → start at top
-    SP = 0xFFFE;
+    // Stack grows downward from STACK_TOP
+    SP = Layout::STACK_TOP;
 
-    flags.ZF = false;
-    flags.CF = false;
+    flags = Flags();
 }
 
 // =======================================
 // Dump register state (debug/diagnostic)
 // =======================================
-void RegisterFile::dump() const {
+template <class Layout>
+void BasicRegisterFile<Layout>::dump() const {
     std::cout << "---- Register Dump ----\n";
-    for (int i = 0; i < REG_COUNT; i++) {
+    for (int i = 0; i < Layout::REG_COUNT; i++) {
         std::cout << "R" << i << ": "
                   << R[i] << " (0x"
                   << std::hex << std::setw(4) << std::setfill('0') << R[i]
@@ -38,5 +39,9 @@ void RegisterFile::dump() const {
 
     std::cout << "ZF: " << flags.ZF
               << "  CF: " << flags.CF
+              << "  IF: " << flags.IF
               << "\n\n";
 }
+
+template class BasicRegisterFile<Layout64K>;
+template class BasicRegisterFile<Layout4K>;
@@ -4,19 +4,24 @@
 
 // =======================================
 // Register File for Software CPU
-// General purpose registers: R0–R3
+// General purpose registers: R0 .. REG_COUNT - 1
+// (R0–R5 on Layout64K)
 // Program Counter (PC)
 // Stack Pointer (SP)
-// Flags register (ZF, CF)
+// Flags register (ZF, CF, IF)
 // =======================================
 
-class RegisterFile {
+template <class Layout>
+class BasicRegisterFile {
 public:
-    uint16_t R[REG_COUNT];  // R0–R3
-    uint16_t PC;            // Program Counter
-    uint16_t SP;            // Stack Pointer
-    Flags flags;            // Flags (ZF, CF)
+    uint16_t R[Layout::REG_COUNT];  // R0–R5
+    uint16_t PC;                    // Program Counter
+    uint16_t SP;                    // Stack Pointer
+    Flags flags;                    // Flags (ZF, CF, IF)
 
-    RegisterFile();
+    // Power-on state: all zero, SP = STACK_TOP
+    BasicRegisterFile();
     void dump() const;
 };
+
+using RegisterFile = BasicRegisterFile<Layout64K>;
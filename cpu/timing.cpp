@@ -0,0 +1,432 @@
+#include "timing.h"
+#include "cpu_exec.h"
+#include "isa.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+template void CPU::step_with<TimingModel>(TimingModel &);
+template uint64_t CPU::run_with<TimingModel>(TimingModel &, uint64_t);
+
+// ================================================================
+// TimingConfig
+// ================================================================
+
+// Default costs: one cycle per instruction, more for the multi-cycle
+// ALU ops and the host-assisted block/print instructions. Memory
+// operands cost nothing extra unless they miss in the cache.
+TimingConfig::TimingConfig()
+{
+    cost.fill(1);
+    for (uint8_t op : { OP_MUL, OP_MULI })             cost[op] = 3;
+    for (uint8_t op : { OP_DIV, OP_DIVI, OP_MOD, OP_MODI }) cost[op] = 20;
+    for (uint8_t op : { OP_CALL, OP_RET })             cost[op] = 2;
+    for (uint8_t op : { OP_MEMCPY, OP_MEMSET })        cost[op] = 4;
+    for (uint8_t op : { OP_STRPRINT, OP_STRPRINTL })   cost[op] = 8;
+}
+
+static bool parse_number(std::string_view text, uint32_t &value)
+{
+    std::string s(text);
+    if (s.empty()) return false;
+    char *end = nullptr;
+    unsigned long v = std::strtoul(s.c_str(), &end, 0);
+    if (*end != '\0' || v > 0xFFFFFFFFul) return false;
+    value = static_cast<uint32_t>(v);
+    return true;
+}
+
+bool TimingConfig::set(std::string_view key, std::string_view value, std::string &error)
+{
+    if (key == "bp") {
+        if (value == "static")       predictor = Predictor::STATIC;
+        else if (value == "bimodal") predictor = Predictor::BIMODAL;
+        else {
+            error = "bad predictor '" + std::string(value) + "' (static or bimodal)";
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t *field = nullptr;
+    CacheConfig *cache = nullptr;
+    if (key.substr(0, 7) == "icache.")      cache = &icache;
+    else if (key.substr(0, 7) == "dcache.") cache = &dcache;
+
+    if (cache) {
+        std::string_view f = key.substr(7);
+        if (f == "size")           field = &cache->size;
+        else if (f == "line")      field = &cache->line;
+        else if (f == "ways")      field = &cache->ways;
+        else if (f == "miss")      field = &cache->miss;
+        else if (f == "writeback") field = &cache->writeback;
+    }
+    else if (key == "bp.entries") field = &bp_entries;
+    else if (key == "bp.ras")     field = &ras_depth;
+    else if (key == "bp.miss")    field = &mispredict;
+    else if (key == "io.latency") field = &io_latency;
+    else if (const InstrInfo *info = find_instruction(key)) field = &cost[info->opcode];
+
+    if (!field) {
+        error = "unknown key '" + std::string(key) + "'";
+        return false;
+    }
+    if (!parse_number(value, *field)) {
+        error = "bad value '" + std::string(value) + "' for " + std::string(key);
+        return false;
+    }
+    return true;
+}
+
+static std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+bool TimingConfig::load(const std::string &path, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string text;
+    for (int line_no = 1; std::getline(in, text); line_no++) {
+        std::string_view line(text);
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        std::string msg;
+        if (eq == std::string_view::npos)
+            msg = "expected key = value";
+        else
+            set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)), msg);
+
+        if (!msg.empty()) {
+            error = "line " + std::to_string(line_no) + ": " + msg;
+            return false;
+        }
+    }
+    return validate(error);
+}
+
+bool TimingConfig::validate(std::string &error) const
+{
+    const CacheConfig *caches[] = { &icache, &dcache };
+    const char *names[] = { "icache", "dcache" };
+    for (int i = 0; i < 2; i++) {
+        const CacheConfig &c = *caches[i];
+        if (c.size == 0) continue;
+        if (c.line == 0 || (c.line & (c.line - 1)) != 0 || c.line > 0x10000)
+            error = std::string(names[i]) + ".line must be a power of two";
+        else if (c.ways == 0 || c.size % (c.line * c.ways) != 0)
+            error = std::string(names[i]) + ".size must be a multiple of line * ways";
+        if (!error.empty()) return false;
+    }
+    if (bp_entries == 0) {
+        error = "bp.entries must be at least 1";
+        return false;
+    }
+    return true;
+}
+
+// ================================================================
+// CacheModel
+// ================================================================
+CacheModel::CacheModel(const CacheConfig &config) : config(config)
+{
+    if (config.size == 0) return;
+    while ((1u << line_shift) < config.line) line_shift++;
+    sets = config.size / (config.line * config.ways);
+    ways.resize(static_cast<size_t>(sets) * config.ways);
+}
+
+uint32_t CacheModel::access(uint16_t addr, uint16_t len, bool write)
+{
+    if (sets == 0 || len == 0) return 0;
+
+    // A range running past 0xFFFF wraps, like the CPU's addressing
+    uint32_t mask = (0x10000u >> line_shift) - 1;
+    uint32_t first = addr >> line_shift;
+    uint32_t last = (static_cast<uint32_t>(addr) + len - 1) >> line_shift;
+
+    uint32_t cycles = 0;
+    for (uint32_t l = first; l <= last; l++)
+        cycles += access_line(l & mask, write);
+    return cycles;
+}
+
+uint32_t CacheModel::access_line(uint32_t line, bool write)
+{
+    Way *set = &ways[static_cast<size_t>(line % sets) * config.ways];
+    uint32_t tag = line / sets;
+    clock++;
+
+    Way *victim = set;
+    for (uint32_t w = 0; w < config.ways; w++) {
+        Way &way = set[w];
+        if (way.used != 0 && way.tag == tag) {
+            way.used = clock;
+            way.dirty |= write;
+            hits++;
+            return 0;
+        }
+        if (way.used < victim->used) victim = &way;
+    }
+
+    misses++;
+    uint32_t cycles = config.miss;
+    if (victim->used != 0 && victim->dirty) {
+        writebacks++;
+        cycles += config.writeback;
+    }
+    *victim = { tag, clock, write };
+    return cycles;
+}
+
+// ================================================================
+// TimingModel
+// ================================================================
+TimingModel::TimingModel(const TimingConfig &config)
+    : icache(config.icache), dcache(config.dcache), config(config),
+      counters(config.bp_entries, 1),          // weakly not taken
+      ras(config.ras_depth),
+      funcs(1), func_slot(0x10000, 0)
+{
+    funcs[0].depth = 1;
+    frames.push_back({ 0, 0 });
+}
+
+uint32_t TimingModel::memory_cycles(CacheModel &cache, uint16_t addr, uint16_t len, bool write)
+{
+    if (addr >= IO_PAGE) return config.io_latency;
+    return cache.access(addr, len, write);
+}
+
+void TimingModel::fetch(uint16_t pc)
+{
+    pending += memory_cycles(icache, pc, 5, false);
+}
+
+void TimingModel::load(uint16_t addr, uint16_t len)
+{
+    pending += memory_cycles(dcache, addr, len, false);
+}
+
+void TimingModel::store(uint16_t addr, uint16_t len)
+{
+    pending += memory_cycles(dcache, addr, len, true);
+}
+
+// ----------------------------------------------------------------
+// Direct jumps and calls are always predicted. Conditional jumps
+// use the static rule or a table of 2-bit counters indexed by PC;
+// returns use the return address stack filled by CALL.
+// IRET is never predicted.
+// ----------------------------------------------------------------
+void TimingModel::branch(uint16_t pc, InstrType type, bool taken, uint16_t target)
+{
+    switch (type) {
+        case InstrType::JUMP_COND: {
+            cond_branches++;
+            bool predicted;
+            if (config.predictor == Predictor::STATIC) {
+                predicted = target <= pc;
+            } else {
+                uint8_t &c = counters[pc % counters.size()];
+                predicted = c >= 2;
+                if (taken && c < 3) c++;
+                if (!taken && c > 0) c--;
+            }
+            if (predicted != taken) {
+                cond_mispredicts++;
+                pending += config.mispredict;
+            }
+            break;
+        }
+
+        case InstrType::CALL:
+            if (!ras.empty()) {
+                ras[ras_top] = static_cast<uint16_t>(pc + 5);
+                ras_top = (ras_top + 1) % ras.size();
+                ras_count = std::min<uint32_t>(ras_count + 1, ras.size());
+            }
+            call_target = function_for(target) + 1;
+            break;
+
+        case InstrType::RET: {
+            returns++;
+            bool hit = false;
+            if (ras_count > 0) {
+                ras_top = (ras_top + ras.size() - 1) % ras.size();
+                ras_count--;
+                hit = ras[ras_top] == target;
+            }
+            if (!hit) {
+                return_mispredicts++;
+                pending += config.mispredict;
+            }
+            returning = true;
+            break;
+        }
+
+        // Interrupt entry never pushed the RAS: always a miss
+        case InstrType::IRET:
+            pending += config.mispredict;
+            break;
+
+        default:
+            break;
+    }
+}
+
+// ----------------------------------------------------------------
+// CALL is charged to the caller and RET to the callee, so the
+// function switch happens after the instruction is counted
+// ----------------------------------------------------------------
+void TimingModel::retire(uint16_t /*pc*/, uint8_t opcode)
+{
+    uint64_t c = config.cost[opcode] + pending;
+    pending = 0;
+    cycles += c;
+    instructions++;
+
+    FunctionStats &f = funcs[frames.back().func];
+    f.instructions++;
+    f.self_cycles += c;
+
+    if (call_target) {
+        enter(call_target - 1);
+        call_target = 0;
+    }
+    if (returning) {
+        leave();
+        returning = false;
+    }
+}
+
+uint32_t TimingModel::function_for(uint16_t entry)
+{
+    uint32_t &slot = func_slot[entry];
+    if (slot == 0) {
+        funcs.emplace_back();
+        funcs.back().entry = entry;
+        slot = static_cast<uint32_t>(funcs.size());
+    }
+    return slot - 1;
+}
+
+void TimingModel::enter(uint32_t func)
+{
+    funcs[func].calls++;
+    funcs[func].depth++;
+    frames.push_back({ func, cycles });
+}
+
+// A RET with no matching CALL (hand-built stack) is ignored
+void TimingModel::leave()
+{
+    if (frames.size() <= 1) return;
+    Frame frame = frames.back();
+    frames.pop_back();
+
+    FunctionStats &f = funcs[frame.func];
+    if (--f.depth == 0) f.total_cycles += cycles - frame.entered;
+}
+
+// ================================================================
+// Report
+// ================================================================
+static double percent(uint64_t part, uint64_t whole)
+{
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+static void cache_line(std::ostream &out, const char *name, const CacheConfig &c, const CacheModel &m)
+{
+    char buf[160];
+    if (c.size == 0) {
+        snprintf(buf, sizeof(buf), "%-14s perfect\n", name);
+    } else {
+        snprintf(buf, sizeof(buf),
+                 "%-14s %u B, %u-way, %u B lines: %llu accesses, %.2f%% miss, %llu writebacks\n",
+                 name, c.size, c.ways, c.line,
+                 (unsigned long long)(m.hits + m.misses), percent(m.misses, m.hits + m.misses),
+                 (unsigned long long)m.writebacks);
+    }
+    out << buf;
+}
+
+void TimingModel::report(std::ostream &out, const std::map<uint16_t, std::string> &names) const
+{
+    char buf[160];
+    out << "---- timing ----\n";
+    snprintf(buf, sizeof(buf), "%-14s %llu\n%-14s %llu\n%-14s %.3f\n",
+             "instructions", (unsigned long long)instructions,
+             "cycles", (unsigned long long)cycles,
+             "CPI", instructions ? double(cycles) / instructions : 0.0);
+    out << buf;
+
+    cache_line(out, "icache", config.icache, icache);
+    cache_line(out, "dcache", config.dcache, dcache);
+
+    if (config.predictor == Predictor::STATIC)
+        snprintf(buf, sizeof(buf), "static");
+    else
+        snprintf(buf, sizeof(buf), "bimodal, %u entries", config.bp_entries);
+    std::string kind = buf;
+    snprintf(buf, sizeof(buf), "%-14s %llu conditional (%s), %.2f%% mispredicted\n",
+             "branches", (unsigned long long)cond_branches, kind.c_str(),
+             percent(cond_mispredicts, cond_branches));
+    out << buf;
+    snprintf(buf, sizeof(buf), "%-14s %llu (RAS depth %u), %.2f%% mispredicted\n",
+             "returns", (unsigned long long)returns, config.ras_depth,
+             percent(return_mispredicts, returns));
+    out << buf;
+
+    // Functions still running (the top level, anything left by a
+    // missing RET) are charged up to now
+    std::vector<FunctionStats> rows = funcs;
+    std::vector<bool> open(rows.size(), false);
+    for (const Frame &frame : frames) {
+        if (open[frame.func]) continue;
+        open[frame.func] = true;
+        rows[frame.func].total_cycles += cycles - frame.entered;
+    }
+    std::stable_sort(rows.begin() + 1, rows.end(),
+                     [](const FunctionStats &a, const FunctionStats &b) {
+                         return a.self_cycles > b.self_cycles;
+                     });
+
+    snprintf(buf, sizeof(buf), "\n%-20s %8s %12s %12s %7s %12s %6s\n",
+             "function", "calls", "instrs", "self cycles", "self%", "total cycles", "CPI");
+    out << buf;
+    for (size_t i = 0; i < rows.size(); i++) {
+        const FunctionStats &f = rows[i];
+        if (i > 0 && f.instructions == 0) continue;
+
+        std::string name;
+        if (i == 0) {
+            name = "(top level)";
+        } else {
+            auto it = names.find(f.entry);
+            if (it != names.end()) {
+                name = it->second;
+            } else {
+                snprintf(buf, sizeof(buf), "0x%04X", f.entry);
+                name = buf;
+            }
+        }
+        snprintf(buf, sizeof(buf), "%-20s %8llu %12llu %12llu %6.2f%% %12llu %6.2f\n",
+                 name.c_str(), (unsigned long long)f.calls,
+                 (unsigned long long)f.instructions, (unsigned long long)f.self_cycles,
+                 percent(f.self_cycles, cycles), (unsigned long long)f.total_cycles,
+                 f.instructions ? double(f.self_cycles) / f.instructions : 0.0);
+        out << buf;
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "common.h"
+
+// ================================================================
+// TIMING MODEL
+// Estimates how long a guest program would take on a simple
+// in-order core: a base cost per opcode, plus instruction and data
+// cache misses, plus branch mispredictions.
+//
+// TimingModel is a hooks type for CPU::run_with() (see cpu.h), so
+// it only exists in the tools that ask for it; the plain emulator
+// is compiled without any of this.
+//
+//     TimingModel model(config);
+//     cpu.run_with(model, max_steps);
+//     model.report(std::cout, names);
+// ================================================================
+
+// ----------------------------------------------------------------
+// Cache geometry and costs. size = 0 models a perfect cache.
+// Addresses in the I/O page are never cached.
+// ----------------------------------------------------------------
+struct CacheConfig {
+    uint32_t size = 1024;      // bytes
+    uint32_t line = 16;        // bytes, power of two
+    uint32_t ways = 2;
+    uint32_t miss = 10;        // cycles added per missing line
+    uint32_t writeback = 5;    // cycles added per dirty line evicted
+};
+
+enum class Predictor { STATIC, BIMODAL };
+
+// ----------------------------------------------------------------
+// TimingConfig
+// Defaults below; load() overrides them from a text file of
+// "key = value" lines ('#' starts a comment):
+//
+//     MUL = 3              base cycles of an opcode, by mnemonic
+//     icache.size = 512    icache./dcache. size, line, ways, miss, writeback
+//     bp = static          static (backward taken) or bimodal
+//     bp.entries = 256     2-bit counters in the bimodal table
+//     bp.ras = 8           return address stack depth
+//     bp.miss = 3          cycles per mispredicted branch
+//     io.latency = 4       cycles per I/O page access
+// ----------------------------------------------------------------
+struct TimingConfig {
+    std::array<uint32_t, 256> cost;
+
+    CacheConfig icache;
+    CacheConfig dcache{ 2048, 16, 4, 10, 5 };
+
+    Predictor predictor = Predictor::BIMODAL;
+    uint32_t bp_entries = 256;
+    uint32_t ras_depth = 8;
+    uint32_t mispredict = 3;
+
+    uint32_t io_latency = 4;
+
+    TimingConfig();
+
+    // Apply one setting; false with error set if key or value is bad
+    bool set(std::string_view key, std::string_view value, std::string &error);
+
+    // Apply a config file; errors read "line N: ..."
+    bool load(const std::string &path, std::string &error);
+
+    // Geometry checks (power-of-two lines, whole sets, ...)
+    bool validate(std::string &error) const;
+};
+
+// ----------------------------------------------------------------
+// Set-associative, write-back, write-allocate cache with LRU
+// replacement. Only tags are kept; data stays in Memory.
+// ----------------------------------------------------------------
+class CacheModel {
+public:
+    explicit CacheModel(const CacheConfig &config);
+
+    // Cycles added by touching [addr, addr + len)
+    uint32_t access(uint16_t addr, uint16_t len, bool write);
+
+    uint64_t hits = 0, misses = 0, writebacks = 0;
+
+private:
+    struct Way {
+        uint32_t tag = 0;
+        uint64_t used = 0;     // LRU stamp; 0 = invalid
+        bool dirty = false;
+    };
+
+    CacheConfig config;
+    uint32_t sets = 0;
+    uint32_t line_shift = 0;
+    uint64_t clock = 0;
+    std::vector<Way> ways;     // sets x config.ways
+
+    uint32_t access_line(uint32_t line, bool write);
+};
+
+// ----------------------------------------------------------------
+// TimingModel: the CPU hooks plus the counters they feed
+// ----------------------------------------------------------------
+class TimingModel {
+public:
+    explicit TimingModel(const TimingConfig &config);
+
+    // ---- CPU hooks ----
+    void fetch(uint16_t pc);
+    void load(uint16_t addr, uint16_t len);
+    void store(uint16_t addr, uint16_t len);
+    void branch(uint16_t pc, InstrType type, bool taken, uint16_t target);
+    void retire(uint16_t pc, uint8_t opcode);
+
+    // ---- Results ----
+    struct FunctionStats {
+        uint16_t entry = 0;
+        uint64_t calls = 0;
+        uint64_t instructions = 0;
+        uint64_t self_cycles = 0;     // spent in the function's own code
+        uint64_t total_cycles = 0;    // including callees (recursion counted once)
+        uint32_t depth = 0;           // active frames
+    };
+
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cond_branches = 0, cond_mispredicts = 0;
+    uint64_t returns = 0, return_mispredicts = 0;
+
+    CacheModel icache, dcache;
+
+    const std::vector<FunctionStats> &functions() const { return funcs; }
+
+    // Summary plus a per-function table, busiest first. names maps
+    // entry addresses to symbols; others print as hex.
+    void report(std::ostream &out, const std::map<uint16_t, std::string> &names) const;
+
+private:
+    TimingConfig config;
+
+    uint64_t pending = 0;             // cycles of the current instruction so far
+
+    // Branch prediction state
+    std::vector<uint8_t> counters;    // 2-bit saturating
+    std::vector<uint16_t> ras;        // circular return address stack
+    uint32_t ras_top = 0, ras_count = 0;
+
+    // Call tracking. funcs[0] is the code reached without a CALL.
+    struct Frame {
+        uint32_t func;
+        uint64_t entered;             // cycles at entry
+    };
+    std::vector<FunctionStats> funcs;
+    std::vector<uint32_t> func_slot;  // entry address -> funcs index + 1
+    std::vector<Frame> frames;
+    uint32_t call_target = 0;         // funcs index + 1 of a CALL being retired
+    bool returning = false;
+
+    uint32_t memory_cycles(CacheModel &cache, uint16_t addr, uint16_t len, bool write);
+    uint32_t function_for(uint16_t entry);
+    void enter(uint32_t func);
+    void leave();
+};
@@ -0,0 +1,96 @@
+// ========================================================
+// client.cpp – emuc, run a program on a running emud
+// Same usage and output as ./emulator, but the program runs
+// on a warm CPU inside the daemon. .asm files are assembled
+// by the server.
+//
+// Usage: ./emuc [-s socket] [-n max_steps] <program.bin|program.asm>
+// ========================================================
+
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+#include "../cpu/registers.h"
+#include "protocol.h"
+
+int main(int argc, char** argv) {
+    std::string socket = EMUD_DEFAULT_SOCKET;
+    Request req;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        std::string flag = argv[arg];
+        if (flag == "-s") socket = argv[arg + 1];
+        else if (flag == "-n") req.max_steps = std::stoull(argv[arg + 1]);
+        else break;
+    }
+    if (argc - arg != 1) {
+        std::cerr << "Usage: ./emuc [-s socket] [-n max_steps] <program.bin|program.asm>\n";
+        return 1;
+    }
+
+    // The server resolves paths from its own working directory
+    std::string path = argv[arg];
+    char resolved[PATH_MAX];
+    if (!realpath(path.c_str(), resolved)) {
+        std::cerr << "ERROR: Could not open program file: " << path << "\n";
+        return 1;
+    }
+    req.payload = resolved;
+
+    bool is_asm = path.size() > 4 && path.compare(path.size() - 4, 4, ".asm") == 0;
+    req.kind = is_asm ? RequestKind::ASM_PATH : RequestKind::BIN_PATH;
+
+    int fd = connect_socket(socket);
+    if (fd < 0) {
+        std::cerr << "ERROR: cannot connect to emud at " << socket << "\n";
+        return 1;
+    }
+
+    ExitState st;
+    bool started = false;
+    auto start = [&] {
+        if (!started) std::cout << "Program loaded. Starting CPU...\n\n";
+        started = true;
+    };
+
+    bool ok = send_request(fd, req) &&
+              recv_response(fd, st, [&](std::string_view out) {
+                  start();
+                  std::cout.write(out.data(), out.size());
+                  std::cout.flush();
+              });
+    close(fd);
+
+    if (!ok) {
+        std::cerr << "ERROR: connection to emud lost\n";
+        return 1;
+    }
+    if (st.status == ExitStatus::ERROR) {
+        std::cerr << "ERROR: " << st.message << "\n";
+        return 1;
+    }
+    start();
+
+    switch (st.status) {
+        case ExitStatus::HALTED:       std::cout << "\nCPU HALTED.\n"; break;
+        case ExitStatus::STEP_LIMIT:   std::cout << "\nSTEP LIMIT REACHED.\n"; break;
+        case ExitStatus::OUTPUT_LIMIT: std::cout << "\nOUTPUT LIMIT REACHED.\n"; break;
+        case ExitStatus::FAULT:        std::cout << "\nCPU FAULT: " << st.message << "\n"; break;
+        default: break;
+    }
+
+    RegisterFile regs;
+    for (int i = 0; i < REG_COUNT; i++) regs.R[i] = st.R[i];
+    regs.PC = st.PC;
+    regs.SP = st.SP;
+    regs.flags.ZF = st.ZF;
+    regs.flags.CF = st.CF;
+    regs.dump();
+
+    std::cout << "Instructions executed: " << st.steps << "\n";
+    return st.status == ExitStatus::HALTED ? 0 : 2;
+}
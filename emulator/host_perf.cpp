@@ -0,0 +1,202 @@
+#include "host_perf.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *COUNTER_NAMES[HostPerf::COUNTERS] = {
+    "task-clock-ns", "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"
+};
+
+const char *HostPerf::counter_name(int counter) {
+    return COUNTER_NAMES[counter];
+}
+
+// ---------------------------------------------
+// Opening the counters
+// ---------------------------------------------
+static void describe(int counter, perf_event_attr &attr) {
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+
+    switch (counter) {
+        case HostPerf::TASK_CLOCK:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+        case HostPerf::CYCLES:        attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case HostPerf::INSTRUCTIONS:  attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case HostPerf::BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case HostPerf::LLC_MISSES:    attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case HostPerf::L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D
+                        | PERF_COUNT_HW_CACHE_OP_READ << 8
+                        | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+            break;
+    }
+
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;      // also what paranoid level 2 allows
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+}
+
+static std::string open_error(int err) {
+    switch (err) {
+        case EACCES:
+        case EPERM: {
+            int level = -1;
+            std::ifstream("/proc/sys/kernel/perf_event_paranoid") >> level;
+            return "not permitted (perf_event_paranoid=" + std::to_string(level) + ")";
+        }
+        case ENOENT:
+        case EOPNOTSUPP:
+        case EINVAL:
+            return "not supported by this host";
+        case ENOSYS:
+            return "perf_event_open not available";
+        default:
+            return std::strerror(err);
+    }
+}
+
+HostPerf::HostPerf() {
+    for (int c = 0; c < COUNTERS; c++) {
+        perf_event_attr attr;
+        describe(c, attr);
+        // This thread, any CPU, no group
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (fd < 0)
+            slots[c].error = open_error(errno);
+        else
+            slots[c].fd = static_cast<int>(fd);
+    }
+}
+
+HostPerf::~HostPerf() {
+    for (Slot &s : slots)
+        if (s.fd >= 0) close(s.fd);
+}
+
+bool HostPerf::hardware() const {
+    for (int c = CYCLES; c < COUNTERS; c++)
+        if (slots[c].fd >= 0) return true;
+    return false;
+}
+
+// ---------------------------------------------
+// Measuring
+// ---------------------------------------------
+void HostPerf::start() {
+    for (Slot &s : slots) {
+        if (s.fd < 0) continue;
+        ioctl(s.fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(s.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    t0 = std::chrono::steady_clock::now();
+}
+
+void HostPerf::stop(uint64_t guest_instructions) {
+    auto t1 = std::chrono::steady_clock::now();
+    for (Slot &s : slots)
+        if (s.fd >= 0) ioctl(s.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    seconds = std::chrono::duration<double>(t1 - t0).count();
+    guest = guest_instructions;
+
+    for (Slot &s : slots) {
+        if (s.fd < 0) continue;
+
+        // value, time enabled, time running
+        uint64_t data[3] = {};
+        if (read(s.fd, data, sizeof(data)) != sizeof(data)) {
+            s.error = "read failed";
+            close(s.fd);
+            s.fd = -1;
+            continue;
+        }
+        if (data[2] == 0) {
+            s.error = "never scheduled on the PMU";
+            close(s.fd);
+            s.fd = -1;
+            continue;
+        }
+        s.multiplexed = data[2] < data[1];
+        s.value = s.multiplexed
+                ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+                : data[0];
+    }
+}
+
+double HostPerf::per_guest(int counter) const {
+    if (guest == 0) return 0;
+    return static_cast<double>(slots[counter].value) / guest;
+}
+
+// ---------------------------------------------
+// Reports
+// ---------------------------------------------
+void HostPerf::report(std::ostream &out) const {
+    char buf[160];
+    double mips = seconds > 0 ? guest / seconds / 1e6 : 0;
+
+    out << "\n--- Host Counters (CPU run loop) ---\n";
+    snprintf(buf, sizeof(buf), "%-20s %14.6f s\n", "wall time", seconds);
+    out << buf;
+    snprintf(buf, sizeof(buf), "%-20s %14llu\n", "guest instructions", (unsigned long long)guest);
+    out << buf;
+    snprintf(buf, sizeof(buf), "%-20s %14.2f\n", "guest MIPS", mips);
+    out << buf;
+
+    snprintf(buf, sizeof(buf), "%-20s %14s %16s\n", "counter", "total", "per guest instr");
+    out << buf;
+    for (int c = 0; c < COUNTERS; c++) {
+        const Slot &s = slots[c];
+        if (s.fd < 0) {
+            snprintf(buf, sizeof(buf), "%-20s unavailable: %s\n", COUNTER_NAMES[c], s.error.c_str());
+        } else {
+            snprintf(buf, sizeof(buf), "%-20s %14llu %16.3f%s\n", COUNTER_NAMES[c],
+                     (unsigned long long)s.value, per_guest(c), s.multiplexed ? "  (scaled)" : "");
+        }
+        out << buf;
+    }
+
+    if (slots[CYCLES].fd >= 0 && slots[INSTRUCTIONS].fd >= 0 && slots[CYCLES].value) {
+        snprintf(buf, sizeof(buf), "%-20s %14.2f\n", "host IPC",
+                 static_cast<double>(slots[INSTRUCTIONS].value) / slots[CYCLES].value);
+        out << buf;
+    }
+}
+
+void HostPerf::report_json(std::ostream &out) const {
+    char num[64];
+    auto fixed = [&](double v, int digits) {
+        snprintf(num, sizeof(num), "%.*f", digits, v);
+        return std::string(num);
+    };
+
+    out << "{\n  \"wall_seconds\": " << fixed(seconds, 6)
+        << ",\n  \"guest_instructions\": " << guest
+        << ",\n  \"guest_mips\": " << fixed(seconds > 0 ? guest / seconds / 1e6 : 0, 3)
+        << ",\n  \"counters\": {";
+
+    for (int c = 0; c < COUNTERS; c++) {
+        const Slot &s = slots[c];
+        out << (c ? ",\n" : "\n") << "    \"" << COUNTER_NAMES[c] << "\": ";
+        if (s.fd < 0) {
+            // Error texts are ours: no escaping needed
+            out << "{ \"available\": false, \"error\": \"" << s.error << "\" }";
+        } else {
+            out << "{ \"available\": true, \"value\": " << s.value
+                << ", \"per_guest_instruction\": " << fixed(per_guest(c), 4)
+                << ", \"scaled\": " << (s.multiplexed ? "true" : "false") << " }";
+        }
+    }
+    out << "\n  }\n}\n";
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// ===============================================================
+// HostPerf – host hardware counters around a stretch of emulation
+// Opens Linux perf_event counters for the calling thread only
+// (user space, so the reader and timer threads and the kernel are
+// excluded) and reads them between start() and stop(), along with
+// wall time. Reports are normalized per retired guest instruction.
+//
+// Each counter is opened on its own: one the host or container
+// does not allow is reported as unavailable and the others still
+// count. When the PMU is oversubscribed the kernel multiplexes and
+// values are scaled by enabled/running time.
+// ===============================================================
+class HostPerf {
+public:
+    enum Counter {
+        TASK_CLOCK,          // ns on a host CPU (software; works
+                             // where the hardware PMU is hidden)
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_MISSES,          // L1 data cache read misses
+        LLC_MISSES,          // last-level cache misses
+        COUNTERS
+    };
+
+    HostPerf();
+    ~HostPerf();
+
+    HostPerf(const HostPerf &) = delete;
+    HostPerf &operator=(const HostPerf &) = delete;
+
+    void start();
+    // guest_instructions: retired between start() and stop()
+    void stop(uint64_t guest_instructions);
+
+    // True if at least one hardware counter opened
+    bool hardware() const;
+
+    void report(std::ostream &out) const;
+    void report_json(std::ostream &out) const;
+
+    static const char *counter_name(int counter);
+
+private:
+    struct Slot {
+        int fd = -1;
+        std::string error;       // why it is unavailable
+        uint64_t value = 0;      // scaled count
+        bool multiplexed = false;
+    };
+
+    Slot slots[COUNTERS];
+    uint64_t guest = 0;
+    double seconds = 0;
+    std::chrono::steady_clock::time_point t0;
+
+    // Scaled count per retired guest instruction
+    double per_guest(int counter) const;
+};
@@ -0,0 +1,118 @@
+// ========================================================
+// loadgen.cpp – emud request latency benchmark
+// Opens C persistent connections and sends N requests in
+// total for one program, then reports the latency
+// distribution (send → exit frame received) and throughput.
+//
+// Usage: ./emu_loadgen [-s socket] [-c connections] [-n requests] [-i] <program.bin>
+//   -i  send the program image inline instead of its path
+// ========================================================
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "protocol.h"
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    std::string socket = EMUD_DEFAULT_SOCKET;
+    int connections = 1;
+    int requests = 10000;
+    bool inline_image = false;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        std::string flag = argv[arg];
+        if (flag == "-i") inline_image = true;
+        else if (flag == "-s" && arg + 1 < argc) socket = argv[++arg];
+        else if (flag == "-c" && arg + 1 < argc) connections = std::atoi(argv[++arg]);
+        else if (flag == "-n" && arg + 1 < argc) requests = std::atoi(argv[++arg]);
+        else break;
+    }
+    if (argc - arg != 1 || connections < 1 || requests < 1) {
+        std::cerr << "Usage: ./emu_loadgen [-s socket] [-c connections] [-n requests] [-i] <program.bin>\n";
+        return 1;
+    }
+
+    Request req;
+    char resolved[PATH_MAX];
+    if (!realpath(argv[arg], resolved)) {
+        std::cerr << "ERROR: Could not open program file: " << argv[arg] << "\n";
+        return 1;
+    }
+    if (inline_image) {
+        std::ifstream file(resolved, std::ios::binary);
+        req.kind = RequestKind::IMAGE;
+        req.payload.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    } else {
+        req.kind = RequestKind::BIN_PATH;
+        req.payload = resolved;
+    }
+
+    // ----------------------------------------------------
+    // One thread per connection, requests split evenly
+    // ----------------------------------------------------
+    std::vector<std::vector<double>> latencies(connections);
+    std::atomic<int> failures{0};
+    std::atomic<int> not_halted{0};
+
+    auto client = [&](int c) {
+        int count = requests / connections + (c < requests % connections ? 1 : 0);
+        int fd = connect_socket(socket);
+        if (fd < 0) {
+            failures += count;
+            return;
+        }
+        latencies[c].reserve(count);
+
+        ExitState st;
+        for (int i = 0; i < count; i++) {
+            auto t0 = Clock::now();
+            if (!send_request(fd, req) || !recv_response(fd, st, [](std::string_view) {})) {
+                failures += count - i;
+                break;
+            }
+            latencies[c].push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+            if (st.status != ExitStatus::HALTED) not_halted++;
+        }
+        close(fd);
+    };
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < connections; c++) threads.emplace_back(client, c);
+    for (auto &t : threads) t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto &l : latencies) all.insert(all.end(), l.begin(), l.end());
+    if (all.empty()) {
+        std::cerr << "ERROR: no request completed (is emud running on " << socket << "?)\n";
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+
+    auto pct = [&](double p) { return all[std::min(all.size() - 1, (size_t)(p * all.size()))]; };
+    double sum = 0;
+    for (double v : all) sum += v;
+
+    std::cout << "Requests:    " << all.size() << " over " << connections << " connection(s)"
+              << (inline_image ? ", inline image" : ", by path") << "\n"
+              << "Failed:      " << failures << "  (not halted: " << not_halted << ")\n"
+              << "Throughput:  " << (int)(all.size() / seconds) << " req/s\n"
+              << "Latency us:  mean " << sum / all.size()
+              << "  p50 " << pct(0.50) << "  p90 " << pct(0.90)
+              << "  p99 " << pct(0.99) << "  max " << all.back() << "\n";
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,480 @@
+// ========================================================
+// lockstep.cpp – differential execution of two engines
+// Runs the same program on two CPU instances, each driven by
+// an execution engine from ENGINES below, and compares them
+// after every chunk of instructions:
+//   - RegisterFile (R0–R5, PC, SP, ZF, CF, IF), halted and fault
+//   - a rolling hash of every memory write (address + bytes)
+//   - a rolling hash of guest output (number/char ports, STRPRINT*)
+//   - the timer register and the PMU event counters
+// and the whole of memory once the program ends.
+//
+// The interrupt timer runs on the virtual clock (one microsecond
+// per instruction cycle, see Memory::tick_timer()), so interrupts
+// land on the same instruction on both sides.
+//
+// Chunks are one instruction (-g insn), one basic block of the
+// first engine (-g block, ends at any taken control transfer)
+// or N instructions (-g N). On the first mismatch both sides are
+// replayed from the start up to the failing chunk and stepped one
+// instruction at a time, so the report names the exact
+// instruction, with a register and memory diff.
+//
+// With several programs it runs them all and prints one line per
+// program; exit status is 1 if any diverged or failed to load.
+//
+// Usage: ./lockstep [-a engine] [-b engine] [-g insn|block|N]
+//                   [-n max_steps] program.bin|program.asm ...
+// ========================================================
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "cpu_exec.h"
+#include "isa.h"
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME  = 1099511628211ULL;
+
+static inline uint64_t fnv(uint64_t h, uint8_t byte) {
+    return (h ^ byte) * FNV_PRIME;
+}
+
+// ========================================================
+// LockstepHooks
+// Hashes each store once the instruction has retired, so the
+// hash covers the bytes actually written (and whatever a device
+// or block operation left there).
+// ========================================================
+struct LockstepHooks {
+    Memory *memory = nullptr;
+    uint64_t write_hash = FNV_OFFSET;
+
+    // Stores still to hash at the next retire. At most: an
+    // interrupt entry between instructions, the instruction's own
+    // store, a guarded access fault's handler entry (that
+    // instruction never retires) and the handler's first store.
+    // A handler that faults again before retiring anything can
+    // exceed this; those stores are counted, not hashed.
+    static const int MAX_STORES = 4;
+    uint16_t store_addr[MAX_STORES];
+    uint16_t store_len[MAX_STORES];
+    int stores = 0;
+    uint64_t dropped = 0;
+
+    void fetch(uint16_t) {}
+    void load(uint16_t, uint16_t) {}
+    void branch(uint16_t, InstrType, bool, uint16_t) {}
+
+    void store(uint16_t addr, uint16_t len) {
+        if (stores == MAX_STORES) {
+            dropped++;
+            return;
+        }
+        store_addr[stores] = addr;
+        store_len[stores] = len;
+        stores++;
+    }
+
+    void retire(uint16_t, uint8_t) {
+        for (int i = 0; i < stores; i++) {
+            uint16_t addr = store_addr[i];
+            write_hash = fnv(fnv(write_hash, addr & 0xFF), addr >> 8);
+            for (uint16_t n = 0; n < store_len[i]; n++)
+                write_hash = fnv(write_hash, memory->read8(addr + n));
+        }
+        stores = 0;
+    }
+};
+
+template void CPU::step_with<LockstepHooks>(LockstepHooks &);
+template uint64_t CPU::run_with<LockstepHooks>(LockstepHooks &, uint64_t);
+
+// Guest output sink that keeps only a hash and a byte count
+class HashBuf : public std::streambuf {
+public:
+    uint64_t hash = FNV_OFFSET;
+    uint64_t bytes = 0;
+
+protected:
+    int overflow(int c) override {
+        if (c != EOF) {
+            hash = fnv(hash, static_cast<uint8_t>(c));
+            bytes++;
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        for (std::streamsize i = 0; i < n; i++) hash = fnv(hash, static_cast<uint8_t>(s[i]));
+        bytes += n;
+        return n;
+    }
+};
+
+// ========================================================
+// ENGINES
+// Each runs up to n instructions (ticking the timer after
+// each, like CPU::run_for) and returns how many ran. "step"
+// is the reference: CPU::step()'s body one instruction at a
+// time. New execution paths are added here to certify them.
+// ========================================================
+struct Engine {
+    const char *name;
+    bool guarded;          // memory.enable_guard() first
+    uint64_t (*run)(CPU &cpu, LockstepHooks &hooks, uint64_t n);
+    const char *about;
+};
+
+static uint64_t engine_step(CPU &cpu, LockstepHooks &hooks, uint64_t n) {
+    uint64_t i = 0;
+    for (; i < n && !cpu.halted; i++) {
+        cpu.step_with(hooks);
+        cpu.memory.tick_timer();
+        cpu.poll_interrupt(hooks);
+    }
+    return i;
+}
+
+static uint64_t engine_run(CPU &cpu, LockstepHooks &hooks, uint64_t n) {
+    return cpu.run_with(hooks, n);
+}
+
+static const Engine ENGINES[] = {
+    { "step",    false, engine_step, "reference: CPU::step() one instruction per call" },
+    { "run",     false, engine_run,  "CPU::run_for() loop (predecoded fast path)" },
+    { "guarded", true,  engine_run,  "CPU::run_for() on page-protected memory (run_guarded)" },
+};
+
+static const Engine *find_engine(const std::string &name) {
+    for (const Engine &e : ENGINES)
+        if (name == e.name) return &e;
+    return nullptr;
+}
+
+// ========================================================
+// One side of the comparison
+// ========================================================
+struct Side {
+    const Engine *engine;
+    CPU cpu;
+    LockstepHooks hooks;
+    HashBuf output;
+    std::ostream out{&output};
+
+    explicit Side(const Engine *engine) : engine(engine) {
+        hooks.memory = &cpu.memory;
+        cpu.memory.set_output(out);
+        cpu.memory.irq.use_virtual_timer(true);
+    }
+
+    void load(const std::vector<uint8_t> &program) {
+        cpu.reset();
+        cpu.load_program(program, 0x0000);
+        hooks.write_hash = FNV_OFFSET;
+        hooks.stores = 0;
+        hooks.dropped = 0;
+        output.hash = FNV_OFFSET;
+        output.bytes = 0;
+    }
+
+    uint64_t run(uint64_t n) { return engine->run(cpu, hooks, n); }
+};
+
+static bool same_state(const Side &a, const Side &b) {
+    const RegisterFile &x = a.cpu.regs, &y = b.cpu.regs;
+    for (int i = 0; i < REG_COUNT; i++)
+        if (x.R[i] != y.R[i]) return false;
+    if (x.PC != y.PC || x.SP != y.SP ||
+        x.flags.ZF != y.flags.ZF || x.flags.CF != y.flags.CF ||
+        x.flags.IF != y.flags.IF)
+        return false;
+
+    if (a.cpu.halted != b.cpu.halted) return false;
+    if (a.cpu.fault != b.cpu.fault || a.cpu.fault_pc != b.cpu.fault_pc) return false;
+    if (a.hooks.write_hash != b.hooks.write_hash) return false;
+    if (a.output.hash != b.output.hash || a.output.bytes != b.output.bytes) return false;
+    if (a.cpu.memory.read8(IO_TIMER) != b.cpu.memory.read8(IO_TIMER)) return false;
+
+    for (int e = 0; e < PMU_EVENTS; e++)
+        if (a.cpu.memory.pmu.events[e] != b.cpu.memory.pmu.events[e]) return false;
+    return true;
+}
+
+static bool same_memory(Side &a, Side &b) {
+    if (std::memcmp(a.cpu.memory.ram_ptr(0, IO_PAGE), b.cpu.memory.ram_ptr(0, IO_PAGE), IO_PAGE) != 0)
+        return false;
+    for (uint32_t addr = IO_PAGE; addr < MEM_SIZE; addr++)
+        if (a.cpu.memory.read8(addr) != b.cpu.memory.read8(addr)) return false;
+    return true;
+}
+
+// ========================================================
+// Divergence report
+// ========================================================
+static int memory_diff(const Side &a, const Side &b);
+
+static void report_divergence(const Side &a, const Side &b, uint64_t index, uint16_t pc,
+                              const uint8_t instr[5])
+{
+    char line[160];
+    std::string text = disassemble(instr[0], instr[1] | (instr[2] << 8), instr[3] | (instr[4] << 8));
+    std::cout << "  diverged at instruction " << index << ", PC ";
+    snprintf(line, sizeof(line), "0x%04X: %s\n", pc, text.c_str());
+    std::cout << line;
+
+    snprintf(line, sizeof(line), "    %-17s %-18s %-18s\n", "", a.engine->name, b.engine->name);
+    std::cout << line;
+    auto row = [&](const char *name, uint64_t x, uint64_t y, int width) {
+        snprintf(line, sizeof(line), "    %-17s 0x%0*llX%*s 0x%0*llX%*s%s\n", name,
+                 width, (unsigned long long)x, 16 - width, "",
+                 width, (unsigned long long)y, 16 - width, "",
+                 x != y ? "  <--" : "");
+        std::cout << line;
+    };
+
+    const RegisterFile &x = a.cpu.regs, &y = b.cpu.regs;
+    for (int i = 0; i < REG_COUNT; i++) {
+        std::string name = "R" + std::to_string(i);
+        row(name.c_str(), x.R[i], y.R[i], 4);
+    }
+    row("PC", x.PC, y.PC, 4);
+    row("SP", x.SP, y.SP, 4);
+    row("ZF", x.flags.ZF, y.flags.ZF, 1);
+    row("CF", x.flags.CF, y.flags.CF, 1);
+    row("IF", x.flags.IF, y.flags.IF, 1);
+    row("halted", a.cpu.halted, b.cpu.halted, 1);
+    row("fault", a.cpu.fault, b.cpu.fault, 1);
+    row("fault PC", a.cpu.fault_pc, b.cpu.fault_pc, 4);
+    row("timer", a.cpu.memory.read8(IO_TIMER), b.cpu.memory.read8(IO_TIMER), 2);
+    row("write hash", a.hooks.write_hash, b.hooks.write_hash, 16);
+    row("output hash", a.output.hash, b.output.hash, 16);
+    row("output bytes", a.output.bytes, b.output.bytes, 8);
+    for (int e = 0; e < PMU_EVENTS; e++) {
+        std::string name = std::string("pmu ") + Pmu::event_name(e);
+        row(name.c_str(), a.cpu.memory.pmu.events[e], b.cpu.memory.pmu.events[e], 8);
+    }
+
+    memory_diff(a, b);
+}
+
+// First few differing bytes and the total; returns the total
+static int memory_diff(const Side &a, const Side &b)
+{
+    char line[160];
+    static const int MAX_SHOWN = 16;
+    int diffs = 0;
+    for (uint32_t addr = 0; addr < MEM_SIZE; addr++) {
+        uint8_t u = a.cpu.memory.read8(addr), v = b.cpu.memory.read8(addr);
+        if (u == v) continue;
+        if (diffs < MAX_SHOWN) {
+            snprintf(line, sizeof(line), "    mem 0x%04X        0x%02X               0x%02X\n", addr, u, v);
+            std::cout << line;
+        }
+        diffs++;
+    }
+    if (diffs > MAX_SHOWN) std::cout << "    ... " << diffs << " bytes differ\n";
+    else if (diffs == 0)   std::cout << "    memory identical\n";
+    return diffs;
+}
+
+// ========================================================
+// Compare one program. Returns true if the engines agree.
+// ========================================================
+enum class Granularity { INSN, BLOCK, EVERY_N };
+
+struct Options {
+    Granularity granularity = Granularity::BLOCK;
+    uint64_t every = 1;
+    uint64_t max_steps = 100000000;
+};
+
+static bool compare(Side &a, Side &b, const std::vector<uint8_t> &program,
+                    const Options &opt, const std::string &label)
+{
+    a.load(program);
+    b.load(program);
+
+    uint64_t done = 0, chunks = 0;
+    bool diverged = false;
+    while (done < opt.max_steps && !a.cpu.halted) {
+        // The first engine decides where the chunk ends
+        uint64_t k = 0;
+        if (opt.granularity == Granularity::BLOCK) {
+            while (done + k < opt.max_steps) {
+                uint16_t pc = a.cpu.regs.PC;
+                k += a.run(1);
+                if (a.cpu.halted || a.cpu.regs.PC != static_cast<uint16_t>(pc + 5)) break;
+            }
+        } else {
+            uint64_t n = opt.granularity == Granularity::INSN ? 1 : opt.every;
+            k = a.run(std::min(n, opt.max_steps - done));
+        }
+
+        uint64_t kb = b.run(k);
+        chunks++;
+        if (kb != k || !same_state(a, b)) {
+            diverged = true;
+            break;
+        }
+        done += k;
+    }
+
+    // Writes that bypass the hooks (host routines filling guest
+    // buffers, an engine writing RAM directly) only show up here
+    if (!diverged && !same_memory(a, b)) {
+        std::cout << "DIVERGED " << label << "\n"
+                  << "  memory differs after " << done << " instructions"
+                  << " (a write the hooks did not see)\n";
+        memory_diff(a, b);
+        return false;
+    }
+
+    // Both sides may agree and still have skipped the same stores
+    if (!diverged && (a.hooks.dropped || b.hooks.dropped)) {
+        std::cout << "ERROR    " << label << ": write hash incomplete, "
+                  << std::max(a.hooks.dropped, b.hooks.dropped) << " stores arrived with "
+                  << LockstepHooks::MAX_STORES << " already waiting to retire\n";
+        return false;
+    }
+
+    if (!diverged) {
+        std::cout << "PASS     " << label << "  (" << done << " instructions, "
+                  << chunks << " checks, " << (a.cpu.halted ? "halted" : "step limit") << ")\n";
+        return true;
+    }
+
+    // ----------------------------------------------------
+    // Replay to the start of the failing chunk, then find
+    // the instruction one step at a time
+    // ----------------------------------------------------
+    std::cout << "DIVERGED " << label << "\n";
+    a.load(program);
+    b.load(program);
+    for (uint64_t left = done; left > 0; ) {
+        uint64_t n = std::min<uint64_t>(left, 1 << 20);
+        a.run(n);
+        b.run(n);
+        left -= n;
+    }
+
+    uint64_t index = done;
+    for (;;) {
+        uint16_t pc = a.cpu.regs.PC;
+        uint8_t instr[5];
+        for (int i = 0; i < 5; i++) instr[i] = a.cpu.memory.read8(pc + i);
+
+        uint64_t ka = a.run(1), kb = b.run(1);
+        index++;
+        if (ka != kb || !same_state(a, b) || (ka == 0 && kb == 0)) {
+            report_divergence(a, b, index, pc, instr);
+            break;
+        }
+    }
+    return false;
+}
+
+// ========================================================
+// Program loading (.bin as is, .asm assembled)
+// ========================================================
+static bool load_program(const std::string &path, std::vector<uint8_t> &program, std::string &error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open";
+        return false;
+    }
+    program.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    bool is_asm = path.size() > 4 && path.compare(path.size() - 4, 4, ".asm") == 0;
+    if (is_asm) {
+        Assembler assembler;
+        std::vector<uint8_t> code;
+        std::string_view text(reinterpret_cast<const char*>(program.data()), program.size());
+        if (!assembler.assemble_source(text, code)) {
+            error = assembler.error();
+            return false;
+        }
+        program = std::move(code);
+    }
+    return true;
+}
+
+static void usage() {
+    std::cerr << "Usage: ./lockstep [-a engine] [-b engine] [-g insn|block|N]\n"
+                 "                  [-n max_steps] program.bin|program.asm ...\n"
+                 "Engines:\n";
+    for (const Engine &e : ENGINES)
+        std::cerr << "  " << e.name << std::string(8 - std::string(e.name).size(), ' ') << e.about << "\n";
+}
+
+int main(int argc, char** argv) {
+    std::string name_a = "step", name_b = "run";
+    Options opt;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        std::string flag = argv[arg], value = argv[arg + 1];
+        if (flag == "-a") name_a = value;
+        else if (flag == "-b") name_b = value;
+        else if (flag == "-n") opt.max_steps = std::stoull(value);
+        else if (flag == "-g") {
+            if (value == "insn")       opt.granularity = Granularity::INSN;
+            else if (value == "block") opt.granularity = Granularity::BLOCK;
+            else {
+                opt.granularity = Granularity::EVERY_N;
+                opt.every = std::stoull(value);
+                if (opt.every == 0) opt.every = 1;
+            }
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    const Engine *engine_a = find_engine(name_a), *engine_b = find_engine(name_b);
+    if (!engine_a || !engine_b || arg >= argc) {
+        if (arg < argc) std::cerr << "ERROR: unknown engine\n";
+        usage();
+        return 1;
+    }
+
+    // Two warm CPUs reused for the whole batch
+    auto a = std::make_unique<Side>(engine_a);
+    auto b = std::make_unique<Side>(engine_b);
+    for (Side *s : { a.get(), b.get() }) {
+        std::string err;
+        if (s->engine->guarded && !s->cpu.memory.enable_guard(GuardConfig(), err)) {
+            std::cerr << "ERROR: engine " << s->engine->name << ": " << err << "\n";
+            return 1;
+        }
+    }
+
+    int passed = 0, failed = 0;
+    std::vector<uint8_t> program;
+    for (; arg < argc; arg++) {
+        std::string error;
+        if (!load_program(argv[arg], program, error)) {
+            std::cout << "ERROR    " << argv[arg] << ": " << error << "\n";
+            failed++;
+            continue;
+        }
+        if (compare(*a, *b, program, opt, argv[arg])) passed++;
+        else failed++;
+    }
+
+    if (passed + failed > 1)
+        std::cout << "\n" << passed << " passed, " << failed << " failed ("
+                  << engine_a->name << " vs " << engine_b->name << ")\n";
+    return failed ? 1 : 0;
+}
@@ -8,7 +8,10 @@
 #include <fstream>           // For std::ifstream (loading binary)
 #include <vector>            // For std::vector container
 #include <string>            // For std::string
+#include <memory>            // For std::unique_ptr
+#include <cstdint>           // For UINT64_MAX
 #include "../cpu/cpu.h"      // Include CPU class
+#include "host_perf.h"       // Host hardware counters
 
 // ========================================================
 // read_binary_file()
@@ -42,20 +45,54 @@ std::vector<uint8_t> read_binary_file(const std::string &filename) {
 
 // ========================================================
 // main()
-// Usage: ./emulator program.bin
+// Usage: ./emulator [-p pmu.json] [-i input|-] [-G guards]
+//                   [-X banks] [--perf-stats]
+//                   [--perf-json out.json] program.bin
+// PMU regions marked by the guest are printed after the
+// dumps; -p also writes the counters and regions as JSON.
+// -i attaches a file, pipe or stdin ("-") to the input
+// device at 0xFF80. -G runs on page-protected memory, e.g.
+// -G stack=4096,unmap=0x9000:0x1000 (see GuardConfig).
+// -X attaches extended memory seen through the bank window
+// at 0xA000, e.g. -X size=1G or -X file=data.bin (see
+// BankConfig).
+// --perf-stats reports host hardware counters for the run
+// loop alone, per guest instruction; --perf-json also
+// writes them as JSON.
 // ========================================================
 int main(int argc, char** argv) {
 
     // ----------------------------------------------------
     // Check command-line arguments
     // ----------------------------------------------------
-    if (argc < 2) {
-        std::cerr << "Usage: ./emulator <program.bin>\n";
+    std::string pmu_json, input_path, guard_spec, bank_spec, perf_json;
+    bool perf_stats = false;
+    int arg = 1;
+    while (argc - arg > 1 && argv[arg][0] == '-') {
+        std::string flag = argv[arg];
+        if (flag == "--perf-stats") {
+            perf_stats = true;
+            arg++;
+            continue;
+        }
+        if (argc - arg < 3) break;
+        if (flag == "-p") pmu_json = argv[arg + 1];
+        else if (flag == "--perf-json") perf_json = argv[arg + 1], perf_stats = true;
+        else if (flag == "-i") input_path = argv[arg + 1];
+        else if (flag == "-G") guard_spec = argv[arg + 1];
+        else if (flag == "-X") bank_spec = argv[arg + 1];
+        else break;
+        arg += 2;
+    }
+
+    if (argc - arg != 1) {
+        std::cerr << "Usage: ./emulator [-p pmu.json] [-i input|-] [-G guards] [-X banks]"
+                     " [--perf-stats] [--perf-json out.json] <program.bin>\n";
         return 1;
     }
 
     // Store program filename
-    std::string program_path = argv[1];
+    std::string program_path = argv[arg];
 
     // ----------------------------------------------------
     // Load program into a byte vector
@@ -67,6 +104,32 @@ int main(int argc, char** argv) {
     // ----------------------------------------------------
     CPU cpu;
 
+    if (!guard_spec.empty()) {
+        GuardConfig guards;
+        std::string err;
+        if (!guards.parse(guard_spec, err) || !cpu.memory.enable_guard(guards, err)) {
+            std::cerr << "ERROR: " << err << "\n";
+            return 1;
+        }
+    }
+
+    if (!bank_spec.empty()) {
+        BankConfig config;
+        std::string err;
+        if (!config.parse(bank_spec, err) || !cpu.memory.enable_banks(config, err)) {
+            std::cerr << "ERROR: " << err << "\n";
+            return 1;
+        }
+    }
+
+    if (!input_path.empty()) {
+        std::string err;
+        if (!cpu.memory.input.open(input_path, err)) {
+            std::cerr << "ERROR: " << err << "\n";
+            return 1;
+        }
+    }
+
     // ----------------------------------------------------
     // Load program at address 0x0000
     // ----------------------------------------------------
@@ -76,9 +139,57 @@ int main(int argc, char** argv) {
 
     // ----------------------------------------------------
     // Begin execution loop
-    // CPU will run until HALT instruction terminates
+    // CPU will run until HALT instruction. With host
+    // counters, only the run loop itself is measured.
+    // ----------------------------------------------------
+    std::unique_ptr<HostPerf> perf;
+    if (perf_stats) {
+        perf.reset(new HostPerf());
+        perf->start();
+        perf->stop(cpu.run_for(UINT64_MAX));
+    } else {
+        cpu.run();
+    }
+
+    if (cpu.fault)
+        std::cout << "\nCPU FAULT: " << cpu.fault_message() << "\n";
+    else
+        std::cout << "\nCPU HALTED.\n";
+    cpu.regs.dump();
+    cpu.memory.dump(0, 0x0060);
+
+    // ----------------------------------------------------
+    // PMU region totals
+    // ----------------------------------------------------
+    if (cpu.memory.pmu.used())
+        cpu.memory.pmu.report(std::cout);
+
+    if (!pmu_json.empty()) {
+        std::ofstream json(pmu_json);
+        cpu.memory.pmu.report_json(json);
+        if (!json) {
+            std::cerr << "ERROR: cannot write " << pmu_json << "\n";
+            return 1;
+        }
+    }
+
+    // ----------------------------------------------------
+    // Host counters
     // ----------------------------------------------------
-    cpu.run();
+    if (perf) {
+        perf->report(std::cout);
+        if (!perf->hardware())
+            std::cout << "(no hardware counters on this host; perf_event_paranoid or a container may hide them)\n";
+    }
+
+    if (!perf_json.empty()) {
+        std::ofstream json(perf_json);
+        perf->report_json(json);
+        if (!json) {
+            std::cerr << "ERROR: cannot write " << perf_json << "\n";
+            return 1;
+        }
+    }
 
-    return 0; // Never reached, HALT calls exit()
+    return cpu.fault ? 2 : 0;
 }
@@ -0,0 +1,223 @@
+// ========================================================
+// memtrace_main.cpp – memtrace, record and render guest
+// memory traces (cpu/memtrace.h)
+// Runs a program under MemTrace and prints its footprint,
+// working set and stack depth; -o saves the trace as .mtrc.
+// -r reads a saved trace instead of running anything. Either
+// way the trace can be rendered as CSV:
+//   -c  per line: addr, reads, writes, fetches, first, last
+//   -s  per window: working set in lines and bytes, stack
+//   -m  heatmap: one row per window, one column per 1 KB
+//       region, data line accesses in each cell
+//
+// Usage: ./memtrace [-l line] [-w window] [-n max_steps]
+//                   [-i input] [-o trace.mtrc]
+//                   [-c lines.csv] [-s windows.csv]
+//                   [-m heatmap.csv] <program.bin|program.asm>
+//        ./memtrace -r trace.mtrc [-c ...] [-s ...] [-m ...]
+// ========================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "cpu.h"
+#include "memtrace.h"
+
+static bool read_program(const std::string &path, std::vector<uint8_t> &program) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR: Could not open program file: " << path << "\n";
+        return false;
+    }
+    program.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    bool is_asm = path.size() > 4 && path.compare(path.size() - 4, 4, ".asm") == 0;
+    if (!is_asm) return true;
+
+    Assembler assembler;
+    std::vector<uint8_t> code;
+    std::string_view text(reinterpret_cast<const char*>(program.data()), program.size());
+    if (!assembler.assemble_source(text, code)) {
+        std::cerr << "ERROR: " << path << ": " << assembler.error() << "\n";
+        return false;
+    }
+    program = std::move(code);
+    return true;
+}
+
+// ========================================================
+// Summary
+// ========================================================
+static void print_summary(const MemTraceData &t) {
+    uint64_t data_lines = 0, code_lines = 0;
+    for (const MemTraceData::Line &l : t.lines) {
+        if (l.reads || l.writes) data_lines++;
+        if (l.fetches) code_lines++;
+    }
+    uint32_t peak_data = 0, peak_code = 0, peak_stack = 0;
+    uint64_t sum_data = 0, sum_code = 0;
+    for (const MemTraceData::Window &w : t.windows) {
+        peak_data = std::max(peak_data, w.data_lines);
+        peak_code = std::max(peak_code, w.code_lines);
+        peak_stack = std::max<uint32_t>(peak_stack, w.max_stack);
+        sum_data += w.data_lines;
+        sum_code += w.code_lines;
+    }
+    size_t n = std::max<size_t>(t.windows.size(), 1);
+
+    char buf[160];
+    std::cout << "\n--- Memory Trace ---\n";
+    snprintf(buf, sizeof(buf), "instructions        %12llu  (%zu windows of %u, %u-byte lines)\n",
+             (unsigned long long)t.instructions, t.windows.size(), t.window, t.line);
+    std::cout << buf;
+    snprintf(buf, sizeof(buf), "footprint           %12llu bytes data, %llu bytes code\n",
+             (unsigned long long)(data_lines * t.line), (unsigned long long)(code_lines * t.line));
+    std::cout << buf;
+    snprintf(buf, sizeof(buf), "working set, data   %12llu bytes peak, %.0f mean\n",
+             (unsigned long long)peak_data * t.line, (double)sum_data / n * t.line);
+    std::cout << buf;
+    snprintf(buf, sizeof(buf), "working set, code   %12llu bytes peak, %.0f mean\n",
+             (unsigned long long)peak_code * t.line, (double)sum_code / n * t.line);
+    std::cout << buf;
+    snprintf(buf, sizeof(buf), "stack depth         %12u bytes peak\n", peak_stack);
+    std::cout << buf;
+
+    // Busiest data lines
+    std::vector<const MemTraceData::Line *> hot;
+    for (const MemTraceData::Line &l : t.lines)
+        if (l.reads || l.writes) hot.push_back(&l);
+    std::sort(hot.begin(), hot.end(), [](const MemTraceData::Line *a, const MemTraceData::Line *b) {
+        return a->reads + a->writes > b->reads + b->writes;
+    });
+    if (hot.size() > 8) hot.resize(8);
+    if (!hot.empty()) std::cout << "\nline        reads      writes       first        last\n";
+    for (const MemTraceData::Line *l : hot) {
+        snprintf(buf, sizeof(buf), "0x%04X %10llu  %10llu  %10llu  %10llu\n", l->addr,
+                 (unsigned long long)l->reads, (unsigned long long)l->writes,
+                 (unsigned long long)l->first, (unsigned long long)l->last);
+        std::cout << buf;
+    }
+}
+
+// ========================================================
+// CSV
+// ========================================================
+static bool write_lines(const std::string &path, const MemTraceData &t) {
+    std::ofstream out(path);
+    out << "addr,reads,writes,fetches,first,last\n";
+    for (const MemTraceData::Line &l : t.lines)
+        out << l.addr << "," << l.reads << "," << l.writes << "," << l.fetches << ","
+            << l.first << "," << l.last << "\n";
+    return static_cast<bool>(out);
+}
+
+static bool write_windows(const std::string &path, const MemTraceData &t) {
+    std::ofstream out(path);
+    out << "window,start,data_lines,data_bytes,code_lines,code_bytes,max_stack,end_stack\n";
+    for (size_t i = 0; i < t.windows.size(); i++) {
+        const MemTraceData::Window &w = t.windows[i];
+        out << i << "," << i * t.window << "," << w.data_lines << "," << w.data_lines * t.line
+            << "," << w.code_lines << "," << w.code_lines * t.line << "," << w.max_stack << ","
+            << w.end_stack << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+static bool write_heatmap(const std::string &path, const MemTraceData &t) {
+    std::ofstream out(path);
+    char col[16];
+    out << "window";
+    for (uint32_t r = 0; r < MemTraceData::HEAT_REGIONS; r++) {
+        snprintf(col, sizeof(col), ",0x%04X", r * MemTraceData::HEAT_REGION);
+        out << col;
+    }
+    out << "\n";
+    for (size_t i = 0; i < t.windows.size(); i++) {
+        out << i;
+        for (uint32_t h : t.windows[i].heat) out << "," << h;
+        out << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    uint32_t line = 64, window = 10000;
+    uint64_t max_steps = 0;                // 0 = until HALT
+    std::string input, trace_out, trace_in, lines_csv, windows_csv, heatmap_csv;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        std::string flag = argv[arg], value = argv[arg + 1];
+        if (flag == "-l") line = std::stoul(value);
+        else if (flag == "-w") window = std::stoul(value);
+        else if (flag == "-n") max_steps = std::stoull(value);
+        else if (flag == "-i") input = value;
+        else if (flag == "-o") trace_out = value;
+        else if (flag == "-r") trace_in = value;
+        else if (flag == "-c") lines_csv = value;
+        else if (flag == "-s") windows_csv = value;
+        else if (flag == "-m") heatmap_csv = value;
+        else break;
+    }
+    bool bad_line = line == 0 || line > MEM_SIZE || (line & (line - 1)) != 0;
+    if (argc - arg != (trace_in.empty() ? 1 : 0) || bad_line) {
+        std::cerr << "Usage: ./memtrace [-l line] [-w window] [-n max_steps] [-i input]\n"
+                     "                  [-o trace.mtrc] [-c lines.csv] [-s windows.csv]\n"
+                     "                  [-m heatmap.csv] <program.bin|program.asm>\n"
+                     "       ./memtrace -r trace.mtrc [-c ...] [-s ...] [-m ...]\n"
+                     "line: bytes, a power of two (default 64); window: instructions (10000)\n";
+        return 1;
+    }
+
+    std::string err;
+    MemTraceData trace;
+
+    if (!trace_in.empty()) {
+        if (!trace.load(trace_in, err)) {
+            std::cerr << "ERROR: " << err << "\n";
+            return 1;
+        }
+    } else {
+        std::vector<uint8_t> program;
+        if (!read_program(argv[arg], program)) return 1;
+
+        CPU cpu;
+        if (!input.empty() && !cpu.memory.input.open(input, err)) {
+            std::cerr << "ERROR: " << err << "\n";
+            return 1;
+        }
+        cpu.load_program(program, 0x0000);
+
+        MemTrace hooks(cpu.regs, line, window);
+        std::cout << "Program loaded. Starting CPU...\n\n";
+        cpu.run_with(hooks, max_steps ? max_steps : UINT64_MAX);
+
+        if (cpu.fault)
+            std::cout << "\nCPU FAULT: " << cpu.fault_message() << "\n";
+        else
+            std::cout << (cpu.halted ? "\nCPU HALTED.\n" : "\nSTEP LIMIT REACHED.\n");
+
+        trace = hooks.finish();
+        if (!trace_out.empty() && !trace.save(trace_out, err)) {
+            std::cerr << "ERROR: " << err << "\n";
+            return 1;
+        }
+    }
+
+    print_summary(trace);
+
+    if ((!lines_csv.empty() && !write_lines(lines_csv, trace)) ||
+        (!windows_csv.empty() && !write_windows(windows_csv, trace)) ||
+        (!heatmap_csv.empty() && !write_heatmap(heatmap_csv, trace))) {
+        std::cerr << "ERROR: cannot write CSV output\n";
+        return 1;
+    }
+    return 0;
+}
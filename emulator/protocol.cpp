@@ -0,0 +1,152 @@
+#include "protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ========================================================
+// Little-endian field helpers
+// ========================================================
+static void put(std::string &buf, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) buf.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+static uint64_t get(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+// ========================================================
+// Socket I/O (retries short reads/writes and EINTR)
+// ========================================================
+bool read_full(int fd, void *buf, size_t len) {
+    uint8_t *p = static_cast<uint8_t*>(buf);
+    while (len > 0) {
+        ssize_t n = ::read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool write_full(int fd, const void *buf, size_t len) {
+    const uint8_t *p = static_cast<const uint8_t*>(buf);
+    while (len > 0) {
+        ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// ========================================================
+// Requests
+// ========================================================
+static const int REQUEST_HEADER = 1 + 8 + 4 + 4;
+
+bool send_request(int fd, const Request &req) {
+    std::string buf;
+    buf.reserve(REQUEST_HEADER + req.payload.size());
+    put(buf, static_cast<uint8_t>(req.kind), 1);
+    put(buf, req.max_steps, 8);
+    put(buf, req.max_output, 4);
+    put(buf, req.payload.size(), 4);
+    buf += req.payload;
+    return write_full(fd, buf.data(), buf.size());
+}
+
+bool recv_request(int fd, Request &req) {
+    uint8_t h[REQUEST_HEADER];
+    if (!read_full(fd, h, sizeof(h))) return false;
+
+    req.kind = static_cast<RequestKind>(h[0]);
+    req.max_steps = get(h + 1, 8);
+    req.max_output = get(h + 9, 4);
+    uint32_t len = get(h + 13, 4);
+
+    // A path or a 64 KB image; anything bigger is not our client
+    if (len > MEM_SIZE + 4096) return false;
+    req.payload.resize(len);
+    return read_full(fd, &req.payload[0], len);
+}
+
+// ========================================================
+// Responses
+// ========================================================
+static const int EXIT_HEADER = 1 + 8 + 2 * (REG_COUNT + 2) + 2 + 4;
+
+void append_output(std::string &buf, std::string_view bytes) {
+    if (bytes.empty()) return;
+    buf.push_back('O');
+    put(buf, bytes.size(), 4);
+    buf.append(bytes.data(), bytes.size());
+}
+
+void append_exit(std::string &buf, const ExitState &st) {
+    buf.push_back('X');
+    put(buf, static_cast<uint8_t>(st.status), 1);
+    put(buf, st.steps, 8);
+    for (int i = 0; i < REG_COUNT; i++) put(buf, st.R[i], 2);
+    put(buf, st.PC, 2);
+    put(buf, st.SP, 2);
+    put(buf, st.ZF, 1);
+    put(buf, st.CF, 1);
+    put(buf, st.message.size(), 4);
+    buf += st.message;
+}
+
+bool recv_response(int fd, ExitState &st,
+                   const std::function<void(std::string_view)> &on_output) {
+    std::string chunk;
+    while (true) {
+        char tag;
+        if (!read_full(fd, &tag, 1)) return false;
+
+        if (tag == 'O') {
+            uint8_t len[4];
+            if (!read_full(fd, len, 4)) return false;
+            chunk.resize(get(len, 4));
+            if (!read_full(fd, &chunk[0], chunk.size())) return false;
+            on_output(chunk);
+            continue;
+        }
+        if (tag != 'X') return false;
+
+        uint8_t h[EXIT_HEADER];
+        if (!read_full(fd, h, sizeof(h))) return false;
+        const uint8_t *p = h;
+        st.status = static_cast<ExitStatus>(*p++);
+        st.steps = get(p, 8);                     p += 8;
+        for (int i = 0; i < REG_COUNT; i++, p += 2) st.R[i] = get(p, 2);
+        st.PC = get(p, 2);                        p += 2;
+        st.SP = get(p, 2);                        p += 2;
+        st.ZF = *p++;
+        st.CF = *p++;
+        st.message.resize(get(p, 4));
+        return read_full(fd, &st.message[0], st.message.size());
+    }
+}
+
+// ========================================================
+// Client side connect
+// ========================================================
+int connect_socket(const std::string &path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return -1;
+    std::strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "common.h"
+
+// ========================================================
+// protocol.h – emud wire format
+// Unix stream socket, little-endian integers. A connection
+// carries any number of requests, one after another.
+//
+// Request:
+//   kind:u8  max_steps:u64  max_output:u32  len:u32  payload[len]
+//     kind 0 = path of a .bin, 1 = path of a .asm (assembled
+//     by the server), 2 = the program image itself.
+//     max_steps / max_output of 0 mean "server default".
+//
+// Response: zero or more output frames, then one exit frame
+//   'O' len:u32 bytes[len]
+//   'X' status:u8 steps:u64 R0..R5:u16 PC:u16 SP:u16
+//       ZF:u8 CF:u8 len:u32 message[len]
+// ========================================================
+
+static const char *const EMUD_DEFAULT_SOCKET = "/tmp/emud.sock";
+
+enum class RequestKind : uint8_t { BIN_PATH = 0, ASM_PATH = 1, IMAGE = 2 };
+
+enum class ExitStatus : uint8_t {
+    HALTED       = 0,    // program executed HALT
+    STEP_LIMIT   = 1,    // stopped after max_steps instructions
+    OUTPUT_LIMIT = 2,    // stopped after max_output bytes of output
+    ERROR        = 3,    // could not load/assemble; see message
+    FAULT        = 4,    // unhandled guest fault; see message
+};
+
+struct Request {
+    RequestKind kind = RequestKind::BIN_PATH;
+    uint64_t max_steps = 0;
+    uint32_t max_output = 0;
+    std::string payload;
+};
+
+struct ExitState {
+    ExitStatus status = ExitStatus::HALTED;
+    uint64_t steps = 0;
+    uint16_t R[REG_COUNT] = {};
+    uint16_t PC = 0, SP = 0;
+    bool ZF = false, CF = false;
+    std::string message;
+};
+
+// Whole-buffer socket I/O; false on EOF or error
+bool read_full(int fd, void *buf, size_t len);
+bool write_full(int fd, const void *buf, size_t len);
+
+bool send_request(int fd, const Request &req);
+bool recv_request(int fd, Request &req);
+
+// Response frames are appended to a buffer so the server can
+// send a short run's output and exit state in one write
+void append_output(std::string &buf, std::string_view bytes);
+void append_exit(std::string &buf, const ExitState &st);
+
+// Reads frames until the exit frame; output is passed to
+// on_output as it arrives
+bool recv_response(int fd, ExitState &st,
+                   const std::function<void(std::string_view)> &on_output);
+
+// Connect to a server socket; -1 on failure
+int connect_socket(const std::string &path);
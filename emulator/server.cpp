@@ -0,0 +1,275 @@
+// ========================================================
+// server.cpp – emud, the emulator daemon
+// Listens on a Unix domain socket and runs programs on a pool
+// of warm CPU instances, one per worker thread. Each CPU is
+// reset right after its request finishes, so the next request
+// starts with no allocation and no process startup.
+//
+// Usage: ./emud [-s socket] [-j threads] [-n max_steps] [-m max_output]
+// ========================================================
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../cpu/cpu.h"
+#include "assembler.h"
+#include "protocol.h"
+
+// Server-wide limits; requests may only lower them
+struct Limits {
+    uint64_t max_steps = 100000000;
+    uint32_t max_output = 1 << 20;
+};
+
+// Instructions between checks for output to stream back
+static const uint64_t SLICE = 1 << 16;
+
+// ========================================================
+// Connection queue (accept loop → workers)
+// ========================================================
+class ConnectionQueue {
+public:
+    void push(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            fds.push(fd);
+        }
+        cv.notify_one();
+    }
+
+    int pop() {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return !fds.empty(); });
+        int fd = fds.front();
+        fds.pop();
+        return fd;
+    }
+
+private:
+    std::mutex mu;
+    std::condition_variable cv;
+    std::queue<int> fds;
+};
+
+// ========================================================
+// Worker: one warm CPU, serves whole connections
+// ========================================================
+class Worker {
+public:
+    explicit Worker(const Limits &limits) : limits(limits) {
+        cpu.memory.set_output(capture);
+        // Requests are bounded by steps, not time: a guest timer
+        // must not park the worker in WFI
+        cpu.memory.irq.use_virtual_timer(true);
+    }
+
+    void serve(int fd) {
+        Request req;
+        while (recv_request(fd, req)) {
+            std::string response;
+            handle(fd, req, response);
+            if (!write_full(fd, response.data(), response.size())) break;
+        }
+        close(fd);
+    }
+
+private:
+    CPU cpu;
+    std::ostringstream capture;
+    Assembler assembler;
+    Limits limits;
+
+    // Program image for a request, or an error message
+    bool load(const Request &req, std::vector<uint8_t> &image, std::string &error) {
+        if (req.kind == RequestKind::IMAGE) {
+            image.assign(req.payload.begin(), req.payload.end());
+        }
+        else {
+            std::ifstream file(req.payload, std::ios::binary);
+            if (!file) {
+                error = "cannot open " + req.payload;
+                return false;
+            }
+            std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+            if (req.kind == RequestKind::ASM_PATH) {
+                if (!assembler.assemble_source(text, image)) {
+                    error = req.payload + ": " + assembler.error();
+                    return false;
+                }
+            }
+            else if (req.kind == RequestKind::BIN_PATH) {
+                image.assign(text.begin(), text.end());
+            }
+            else {
+                error = "unknown request kind";
+                return false;
+            }
+        }
+
+        // Bytes at IO_PAGE and up would be device writes, not code
+        if (image.size() > (size_t)IO_PAGE) {
+            error = "program overlaps the I/O page (0xFF00)";
+            return false;
+        }
+        return true;
+    }
+
+    void handle(int fd, const Request &req, std::string &response) {
+        ExitState st;
+        std::vector<uint8_t> image;
+        if (!load(req, image, st.message)) {
+            st.status = ExitStatus::ERROR;
+            append_exit(response, st);
+            return;
+        }
+
+        uint64_t max_steps = limits.max_steps;
+        if (req.max_steps && req.max_steps < max_steps) max_steps = req.max_steps;
+        uint32_t max_output = limits.max_output;
+        if (req.max_output && req.max_output < max_output) max_output = req.max_output;
+
+        cpu.load_program(image, 0x0000);
+
+        // Run in slices; output produced by a long run is sent
+        // as it accumulates instead of at the end
+        uint32_t output_total = 0;
+        while (!cpu.halted && st.steps < max_steps) {
+            uint64_t slice = std::min(SLICE, max_steps - st.steps);
+            st.steps += cpu.run_for(slice);
+
+            std::string out = capture.str();
+            if (out.empty()) continue;
+            capture.str("");
+
+            if (output_total + out.size() > max_output) {
+                out.resize(max_output - output_total);
+                append_output(response, out);
+                st.status = ExitStatus::OUTPUT_LIMIT;
+                break;
+            }
+            output_total += out.size();
+            append_output(response, out);
+
+            if (!cpu.halted) {
+                write_full(fd, response.data(), response.size());
+                response.clear();
+            }
+        }
+
+        if (st.status != ExitStatus::OUTPUT_LIMIT)
+            st.status = cpu.halted ? ExitStatus::HALTED : ExitStatus::STEP_LIMIT;
+        if (cpu.fault) {
+            st.status = ExitStatus::FAULT;
+            st.message = cpu.fault_message();
+        }
+
+        for (int i = 0; i < REG_COUNT; i++) st.R[i] = cpu.regs.R[i];
+        st.PC = cpu.regs.PC;
+        st.SP = cpu.regs.SP;
+        st.ZF = cpu.regs.flags.ZF;
+        st.CF = cpu.regs.flags.CF;
+        append_exit(response, st);
+
+        // Pre-reset for the next request
+        cpu.reset();
+        capture.str("");
+    }
+};
+
+// ========================================================
+// Shutdown: remove the socket file
+// ========================================================
+static const char *socket_path = EMUD_DEFAULT_SOCKET;
+
+static void on_signal(int) {
+    unlink(socket_path);
+    _exit(0);
+}
+
+int main(int argc, char** argv) {
+    Limits limits;
+    unsigned threads = std::thread::hardware_concurrency();
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        std::string flag = argv[arg];
+        if (flag == "-s") socket_path = argv[arg + 1];
+        else if (flag == "-j") threads = std::stoul(argv[arg + 1]);
+        else if (flag == "-n") limits.max_steps = std::stoull(argv[arg + 1]);
+        else if (flag == "-m") limits.max_output = std::stoul(argv[arg + 1]);
+        else break;
+    }
+    if (arg != argc) {
+        std::cerr << "Usage: ./emud [-s socket] [-j threads] [-n max_steps] [-m max_output]\n";
+        return 1;
+    }
+    if (threads == 0) threads = 1;
+
+    // ----------------------------------------------------
+    // Listen
+    // ----------------------------------------------------
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(socket_path) >= sizeof(addr.sun_path)) {
+        std::cerr << "ERROR: socket path too long\n";
+        return 1;
+    }
+    std::strcpy(addr.sun_path, socket_path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listener < 0 ||
+        bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listener, 128) != 0) {
+        std::cerr << "ERROR: cannot listen on " << socket_path << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    // ----------------------------------------------------
+    // Worker pool: CPUs are built before the first request
+    // ----------------------------------------------------
+    ConnectionQueue queue;
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back([&queue, limits] {
+            Worker worker(limits);
+            while (true) worker.serve(queue.pop());
+        });
+    }
+
+    std::cout << "emud: listening on " << socket_path << " with "
+              << threads << " warm CPU(s)" << std::endl;
+
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "ERROR: accept: " << std::strerror(errno) << "\n";
+            break;
+        }
+        queue.push(fd);
+    }
+
+    unlink(socket_path);
+    for (auto &t : pool) t.detach();
+    return 1;
+}
@@ -0,0 +1,110 @@
+// ========================================================
+// timing_main.cpp – emutime, run a program under the
+// cycle-cost model (cpu/timing.h)
+// Runs like ./emulator, then prints estimated cycles, CPI,
+// cache and branch predictor statistics and a per-function
+// breakdown. Functions are named from the program's labels
+// (.asm input) or a linker map (-m).
+//
+// Usage: ./emutime [-c timing.cfg] [-m map.txt] [-n max_steps]
+//                  <program.bin|program.asm>
+// ========================================================
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "cpu.h"
+#include "timing.h"
+
+// "0x0123  name" lines, as written by ./linker -m
+static bool read_map(const std::string &path, std::map<uint16_t, std::string> &names)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string addr, name;
+    while (in >> addr >> name)
+        names.emplace(static_cast<uint16_t>(std::strtoul(addr.c_str(), nullptr, 0)), name);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    TimingConfig config;
+    std::string map_path;
+    uint64_t max_steps = 0;            // 0 = until HALT
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        std::string flag = argv[arg], value = argv[arg + 1];
+        std::string error;
+        if (flag == "-c") {
+            if (!config.load(value, error)) {
+                std::cerr << "ERROR: " << value << ": " << error << "\n";
+                return 1;
+            }
+        }
+        else if (flag == "-m") map_path = value;
+        else if (flag == "-n") max_steps = std::stoull(value);
+        else break;
+    }
+    if (argc - arg != 1) {
+        std::cerr << "Usage: ./emutime [-c timing.cfg] [-m map.txt] [-n max_steps]\n"
+                     "                 <program.bin|program.asm>\n";
+        return 1;
+    }
+
+    // ----------------------------------------------------
+    // Load the program; .asm is assembled here so its
+    // labels can name the functions
+    // ----------------------------------------------------
+    std::string path = argv[arg];
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR: Could not open program file: " << path << "\n";
+        return 1;
+    }
+    std::vector<uint8_t> program((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::map<uint16_t, std::string> names;
+    bool is_asm = path.size() > 4 && path.compare(path.size() - 4, 4, ".asm") == 0;
+    if (is_asm) {
+        Assembler assembler;
+        std::vector<uint8_t> code;
+        std::string_view text(reinterpret_cast<const char*>(program.data()), program.size());
+        if (!assembler.assemble_source(text, code)) {
+            std::cerr << "ERROR: " << path << ": " << assembler.error() << "\n";
+            return 1;
+        }
+        program = std::move(code);
+        for (const auto &s : assembler.symbols()) names.emplace(s.second, s.first);
+    }
+    if (!map_path.empty() && !read_map(map_path, names)) {
+        std::cerr << "ERROR: cannot read map file " << map_path << "\n";
+        return 1;
+    }
+
+    // ----------------------------------------------------
+    // Run under the model
+    // ----------------------------------------------------
+    CPU cpu;
+    cpu.load_program(program, 0x0000);
+    TimingModel model(config);
+
+    std::cout << "Program loaded. Starting CPU...\n\n";
+    cpu.run_with(model, max_steps ? max_steps : UINT64_MAX);
+
+    if (cpu.fault)
+        std::cout << "\nCPU FAULT: " << cpu.fault_message() << "\n";
+    else
+        std::cout << (cpu.halted ? "\nCPU HALTED.\n" : "\nSTEP LIMIT REACHED.\n");
+    cpu.regs.dump();
+    std::cout << "\n";
+    model.report(std::cout, names);
+    return 0;
+}
@@ -0,0 +1,464 @@
+// ========================================================
+// workloads.cpp – throughput suite over programs/workloads
+// golden.txt in the workload directory lists the runs:
+//
+//     sort 1000 "6 65360 35554 0 "
+//
+// workload name (<dir>/<name>.asm), SIZE, and the guest output
+// that run must produce (C escapes). Each workload is assembled
+// in memory, the word at its SIZE label is patched, and the
+// image is run on every engine in ENGINES below that this host
+// supports. A run whose output differs from golden.txt, that
+// faults or that hits the step limit fails.
+//
+// Each run is repeated until it has taken -t seconds in total
+// (at least MIN_RUNS times); the median repetition gives the
+// wall time and MIPS, so one noisy sample moves neither. -o
+// writes them as CSV, and -b compares MIPS with a CSV written
+// earlier on the same host: a drop of more than -r percent
+// (default 25) is reported as a regression. MIPS depend on the
+// host (and on its clock from one minute to the next), so no
+// baseline is compared unless -b names one, and regressions
+// only fail the run with -s. Exit status is 1 if anything
+// failed, or with -s regressed. -u rewrites golden.txt from the "step"
+// engine instead of checking it.
+//
+// Usage: ./workloads [-d dir] [-e engine,...] [-o results.csv]
+//                    [-b baseline.csv] [-r percent] [-t seconds]
+//                    [-n max_steps] [-s] [-u] [workload ...]
+// ========================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "cpu.h"
+
+// ========================================================
+// ENGINES
+// Ways of running a loaded CPU to completion; each returns
+// the instructions retired. Guarded engines get page-protected
+// memory before the program is loaded and are skipped where
+// the host cannot provide it.
+// ========================================================
+struct Engine {
+    const char *name;
+    bool guarded;
+    uint64_t (*run)(CPU &cpu, uint64_t max_steps);
+    const char *about;
+};
+
+static uint64_t engine_step(CPU &cpu, uint64_t max_steps) {
+    uint64_t i = 0;
+    for (; i < max_steps && !cpu.halted; i++) {
+        cpu.step();
+        cpu.memory.tick_timer();
+        cpu.poll_interrupt();
+    }
+    return i;
+}
+
+static uint64_t engine_run(CPU &cpu, uint64_t max_steps) {
+    return cpu.run_for(max_steps);
+}
+
+static const Engine ENGINES[] = {
+    { "step",    false, engine_step, "CPU::step() one instruction per call (reference)" },
+    { "run",     false, engine_run,  "CPU::run_for() loop (predecoded fast path)" },
+    { "guarded", true,  engine_run,  "CPU::run_for() on page-protected memory" },
+};
+
+// ========================================================
+// golden.txt
+// ========================================================
+struct Entry {
+    std::string workload;
+    uint16_t size = 0;
+    std::string output;
+};
+
+static bool unescape(const std::string &quoted, std::string &out) {
+    if (quoted.size() < 2 || quoted.front() != '"' || quoted.back() != '"') return false;
+    out.clear();
+    for (size_t i = 1; i + 1 < quoted.size(); i++) {
+        char c = quoted[i];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (++i + 1 >= quoted.size()) return false;
+        switch (quoted[i]) {
+            case 'n':  out += '\n'; break;
+            case 't':  out += '\t'; break;
+            case '\\': out += '\\'; break;
+            case '"':  out += '"'; break;
+            case 'x':
+                if (i + 3 >= quoted.size()) return false;
+                out += static_cast<char>(std::stoi(quoted.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+                break;
+            default:   return false;
+        }
+    }
+    return true;
+}
+
+static std::string escape(const std::string &s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        switch (c) {
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\\': out += "\\\\"; break;
+            case '"':  out += "\\\""; break;
+            default:
+                if (c >= 0x20 && c < 0x7F) {
+                    out += static_cast<char>(c);
+                } else {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\x%02X", c);
+                    out += buf;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+// Lines are "name size "output""; blank lines and # comments
+// are kept verbatim for -u
+static bool read_golden(const std::string &path, std::vector<Entry> &entries,
+                        std::vector<std::string> &lines, std::string &err) {
+    std::ifstream in(path);
+    if (!in) {
+        err = "cannot open " + path;
+        return false;
+    }
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        lines.push_back(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream fields(line);
+        Entry e;
+        unsigned long size = 0;
+        std::string quoted;
+        if (!(fields >> e.workload >> size) || size > 0xFFFF) {
+            err = path + ":" + std::to_string(n) + ": expected: workload size \"output\"";
+            return false;
+        }
+        std::getline(fields >> std::ws, quoted);
+        if (!unescape(quoted, e.output)) {
+            err = path + ":" + std::to_string(n) + ": bad output string";
+            return false;
+        }
+        e.size = static_cast<uint16_t>(size);
+        entries.push_back(e);
+    }
+    return true;
+}
+
+// ========================================================
+// Results CSV
+// ========================================================
+struct Result {
+    std::string workload;
+    uint16_t size = 0;
+    std::string engine;
+    uint64_t instructions = 0;
+    int runs = 0;
+    double seconds = 0;      // fastest run
+    double mips = 0;
+};
+
+static std::string key(const std::string &workload, uint16_t size, const std::string &engine) {
+    return workload + "," + std::to_string(size) + "," + engine;
+}
+
+static bool read_baseline(const std::string &path, std::map<std::string, double> &mips) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    std::getline(in, line);                        // header
+    while (std::getline(in, line)) {
+        // workload,size,engine,instructions,runs,seconds,mips
+        std::vector<std::string> f;
+        std::stringstream ss(line);
+        for (std::string field; std::getline(ss, field, ',');) f.push_back(field);
+        if (f.size() != 7) continue;
+        mips[f[0] + "," + f[1] + "," + f[2]] = std::stod(f[6]);
+    }
+    return true;
+}
+
+static bool write_results(const std::string &path, const std::vector<Result> &results) {
+    std::ofstream out(path);
+    out << "workload,size,engine,instructions,runs,seconds,mips\n";
+    char buf[256];
+    for (const Result &r : results) {
+        snprintf(buf, sizeof(buf), "%s,%u,%s,%llu,%d,%.6f,%.2f\n", r.workload.c_str(), r.size,
+                 r.engine.c_str(), (unsigned long long)r.instructions, r.runs, r.seconds, r.mips);
+        out << buf;
+    }
+    return static_cast<bool>(out);
+}
+
+// ========================================================
+// Running
+// ========================================================
+static bool build(const std::string &dir, const Entry &e, std::vector<uint8_t> &image,
+                  std::string &err) {
+    std::string path = dir + "/" + e.workload + ".asm";
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        err = "cannot open " + path;
+        return false;
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Assembler assembler;
+    if (!assembler.assemble_source(source, image)) {
+        err = path + ": " + assembler.error();
+        return false;
+    }
+    auto size = assembler.symbols().find("SIZE");
+    if (size == assembler.symbols().end() || size->second + 2u > image.size()) {
+        err = path + ": no SIZE word";
+        return false;
+    }
+    image[size->second] = e.size & 0xFF;
+    image[size->second + 1] = e.size >> 8;
+    return true;
+}
+
+struct Outcome {
+    bool ok = false;
+    std::string error;       // why not ok
+    std::string output;      // of the first run
+    uint64_t instructions = 0;
+    int runs = 0;
+    double median = 0;       // seconds
+};
+
+static const int MIN_RUNS = 5;
+
+static Outcome measure(CPU &cpu, const Engine &engine, const std::vector<uint8_t> &image,
+                       uint64_t max_steps, double min_seconds) {
+    Outcome o;
+    std::ostringstream out;
+    cpu.memory.set_output(out);
+
+    double total = 0;
+    std::vector<double> times;
+    while (o.runs < MIN_RUNS || total < min_seconds) {
+        cpu.reset();
+        out.str("");
+        cpu.load_program(image, 0x0000);
+
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t n = engine.run(cpu, max_steps);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        if (o.runs == 0) {
+            o.output = out.str();
+            o.instructions = n;
+            if (cpu.fault) {
+                o.error = "fault: " + cpu.fault_message();
+                break;
+            }
+            if (!cpu.halted) {
+                o.error = "step limit reached";
+                break;
+            }
+        }
+        times.push_back(seconds);
+        total += seconds;
+        o.runs++;
+    }
+    if (!times.empty()) {
+        std::sort(times.begin(), times.end());
+        size_t mid = times.size() / 2;
+        o.median = times.size() % 2 ? times[mid] : (times[mid - 1] + times[mid]) / 2;
+    }
+    cpu.memory.set_output(std::cout);
+    o.ok = o.error.empty();
+    return o;
+}
+
+static void usage() {
+    std::cerr << "Usage: ./workloads [-d dir] [-e engine,...] [-o results.csv]\n"
+                 "                   [-b baseline.csv] [-r percent] [-t seconds]\n"
+                 "                   [-n max_steps] [-s] [-u] [workload ...]\n"
+                 "Engines:\n";
+    for (const Engine &e : ENGINES) std::cerr << "  " << e.name << " – " << e.about << "\n";
+}
+
+int main(int argc, char** argv) {
+    std::string dir = "programs/workloads", results_path, baseline_path, engine_list;
+    double threshold = 25, min_seconds = 0.25;
+    uint64_t max_steps = 1000000000;
+    bool update = false, strict = false;
+
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        std::string flag = argv[arg];
+        if (flag == "-u") update = true;
+        else if (flag == "-s") strict = true;
+        else if (arg + 1 < argc && flag == "-d") dir = argv[++arg];
+        else if (arg + 1 < argc && flag == "-e") engine_list = argv[++arg];
+        else if (arg + 1 < argc && flag == "-o") results_path = argv[++arg];
+        else if (arg + 1 < argc && flag == "-b") baseline_path = argv[++arg];
+        else if (arg + 1 < argc && flag == "-r") threshold = std::stod(argv[++arg]);
+        else if (arg + 1 < argc && flag == "-t") min_seconds = std::stod(argv[++arg]);
+        else if (arg + 1 < argc && flag == "-n") max_steps = std::stoull(argv[++arg]);
+        else {
+            usage();
+            return 1;
+        }
+        arg++;
+    }
+    std::vector<std::string> only(argv + arg, argv + argc);
+
+    // ----------------------------------------------------
+    // Engines: -e, or all (just the reference for -u)
+    // ----------------------------------------------------
+    std::vector<const Engine *> engines;
+    if (update) engine_list = "step";
+    if (engine_list.empty()) {
+        for (const Engine &e : ENGINES) engines.push_back(&e);
+    } else {
+        std::stringstream ss(engine_list);
+        for (std::string name; std::getline(ss, name, ',');) {
+            auto e = std::find_if(std::begin(ENGINES), std::end(ENGINES),
+                                  [&](const Engine &x) { return name == x.name; });
+            if (e == std::end(ENGINES)) {
+                std::cerr << "ERROR: unknown engine " << name << "\n";
+                usage();
+                return 1;
+            }
+            engines.push_back(e);
+        }
+    }
+
+    std::string golden_path = dir + "/golden.txt", err;
+    std::vector<Entry> entries;
+    std::vector<std::string> lines;
+    if (!read_golden(golden_path, entries, lines, err)) {
+        std::cerr << "ERROR: " << err << "\n";
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baseline_path.empty() && !read_baseline(baseline_path, baseline)) {
+        std::cerr << "ERROR: cannot read " << baseline_path << "\n";
+        return 1;
+    }
+
+    // One CPU per engine, reused across runs so every run
+    // starts on warm host memory
+    std::vector<std::unique_ptr<CPU>> cpus;
+    for (const Engine *e : engines) {
+        cpus.push_back(std::make_unique<CPU>());
+        if (e->guarded && !cpus.back()->memory.enable_guard(GuardConfig(), err)) {
+            std::cerr << "note: engine " << e->name << " unavailable: " << err << "\n";
+            cpus.back().reset();
+        }
+    }
+
+    std::vector<Result> results;
+    int failed = 0, regressed = 0;
+    char buf[256];
+
+    for (Entry &e : entries) {
+        if (!only.empty() && std::find(only.begin(), only.end(), e.workload) == only.end())
+            continue;
+
+        std::vector<uint8_t> image;
+        if (!build(dir, e, image, err)) {
+            std::cout << "FAIL " << e.workload << " " << e.size << ": " << err << "\n";
+            failed++;
+            continue;
+        }
+
+        for (size_t k = 0; k < engines.size(); k++) {
+            const Engine &engine = *engines[k];
+            if (!cpus[k]) continue;
+
+            Outcome o = measure(*cpus[k], engine, image, max_steps, update ? 0 : min_seconds);
+            if (update && o.ok) {
+                e.output = o.output;
+                continue;
+            }
+            if (o.ok && o.output != e.output)
+                o.error = "output " + escape(o.output) + ", expected " + escape(e.output);
+
+            snprintf(buf, sizeof(buf), "%-8s %6u %-8s", e.workload.c_str(), e.size, engine.name);
+            if (!o.error.empty()) {
+                std::cout << buf << " FAIL: " << o.error << "\n";
+                failed++;
+                continue;
+            }
+
+            Result r;
+            r.workload = e.workload;
+            r.size = e.size;
+            r.engine = engine.name;
+            r.instructions = o.instructions;
+            r.runs = o.runs;
+            r.seconds = o.median;
+            r.mips = o.median > 0 ? o.instructions / o.median / 1e6 : 0;
+            results.push_back(r);
+
+            std::cout << buf;
+            snprintf(buf, sizeof(buf), " %12llu instr %10.3f ms %9.1f MIPS",
+                     (unsigned long long)r.instructions, r.seconds * 1e3, r.mips);
+            std::cout << buf;
+
+            auto base = baseline.find(key(r.workload, r.size, r.engine));
+            if (base != baseline.end() && base->second > 0) {
+                double change = (r.mips / base->second - 1) * 100;
+                bool slower = change < -threshold;
+                snprintf(buf, sizeof(buf), "  %+6.1f%%%s", change, slower ? "  REGRESSION" : "");
+                std::cout << buf;
+                if (slower) regressed++;
+            }
+            std::cout << "\n";
+        }
+    }
+
+    if (update) {
+        // Same lines, entries in order with fresh outputs
+        std::ofstream out(golden_path);
+        size_t next = 0;
+        for (const std::string &line : lines) {
+            if (line.empty() || line[0] == '#') {
+                out << line << "\n";
+                continue;
+            }
+            const Entry &e = entries[next++];
+            out << e.workload << " " << e.size << " " << escape(e.output) << "\n";
+        }
+        std::cout << "updated " << golden_path << "\n";
+        return failed ? 1 : 0;
+    }
+
+    if (!results_path.empty() && !write_results(results_path, results)) {
+        std::cerr << "ERROR: cannot write " << results_path << "\n";
+        return 1;
+    }
+
+    std::cout << "\n" << results.size() << " runs, " << failed << " failed";
+    if (!baseline.empty())
+        std::cout << ", " << regressed << " regressed by more than " << threshold << "%";
+    std::cout << "\n";
+    return failed || (strict && regressed) ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+#include "harness.h"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+FuzzHarness::FuzzHarness(Target target, uint64_t budget, uint8_t *map)
+    : target(target), budget(budget), coverage(map)
+{
+    if (!coverage) {
+        own_map.assign(MAP_SIZE, 0);
+        coverage = own_map.data();
+    }
+    cpu.coverage = coverage;
+    cpu.memory.set_output(discard);
+    cpu.memory.irq.use_virtual_timer(true);
+}
+
+// ------------------------------------------------------------
+// Assembler errors have no guest coverage; give each kind of
+// error ("unknown instruction", "invalid register", ...) its own
+// map slot so the mutator can still tell them apart
+// ------------------------------------------------------------
+static size_t error_slot(std::string_view msg) {
+    size_t colon = msg.find(": ");
+    if (colon != std::string_view::npos) msg.remove_prefix(colon + 2);   // "line N: "
+    msg = msg.substr(0, msg.find(':'));
+
+    uint32_t h = 2166136261u;
+    for (char c : msg) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h % FuzzHarness::MAP_SIZE;
+}
+
+FuzzHarness::Result FuzzHarness::run(const uint8_t *data, size_t size)
+{
+    Result r;
+    std::memset(coverage, 0, MAP_SIZE);
+    cpu.reset();
+
+    if (target == Target::ASM) {
+        std::string_view text(reinterpret_cast<const char*>(data), size);
+        if (!assembler.assemble_source(text, image)) {
+            r.assembled = false;
+            coverage[error_slot(assembler.error())] = 1;
+            return r;
+        }
+        data = image.data();
+        size = image.size();
+    }
+
+    // Anything past the I/O page would trigger device writes
+    // while loading, so only the RAM part of the image is used.
+    // The rest of RAM reads as HALT: a wild jump ends the run
+    // instead of sliding through zeroes for the whole budget.
+    size = std::min<size_t>(size, IO_PAGE);
+    uint8_t *ram = cpu.memory.ram_ptr(0, IO_PAGE);
+    std::memcpy(ram, data, size);
+    std::memset(ram + size, OP_HALT, IO_PAGE - size);
+
+    r.steps = cpu.run_for(budget);
+    r.halted = cpu.halted;
+    return r;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "assembler.h"
+#include "cpu.h"
+
+// ============================================================
+// FuzzHarness
+// Runs one input through a headless CPU with an instruction
+// budget. BIN inputs are the program image; ASM inputs go
+// through Assembler::assemble_source() first.
+//
+// Everything is allocated once: an iteration clears the
+// coverage map and resets the CPU and its RAM in place.
+// RAM outside the image reads as HALT, guest output is
+// discarded, and the interrupt timer is virtual, so WFI never
+// sleeps and runs are repeatable.
+// ============================================================
+class FuzzHarness {
+public:
+    enum class Target { BIN, ASM };
+
+    struct Result {
+        uint64_t steps = 0;
+        bool halted = false;
+        bool assembled = true;     // ASM only
+    };
+
+    static constexpr size_t MAP_SIZE = CPU::COVERAGE_SIZE;
+
+    // map: coverage buffer of MAP_SIZE bytes to fill, or nullptr
+    // for one owned by the harness
+    FuzzHarness(Target target, uint64_t budget, uint8_t *map = nullptr);
+
+    Result run(const uint8_t *data, size_t size);
+
+    // Edge hit counts of the last run
+    uint8_t *map() { return coverage; }
+
+private:
+    Target target;
+    uint64_t budget;
+    uint8_t *coverage;
+    std::vector<uint8_t> own_map;
+
+    CPU cpu;
+    std::ostream discard{nullptr};
+    Assembler assembler;
+    std::vector<uint8_t> image;
+};
@@ -0,0 +1,27 @@
+// ========================================================
+// libfuzzer.cpp – libFuzzer entry point (clang only)
+// Same harness as ./fuzzer. Guest edge coverage goes into
+// libFuzzer's extra-counters section, so both the emulator's
+// own (compiler-instrumented) branches and the guest program's
+// edges guide the search.
+//
+// Build: cmake -DFUZZ_LIBFUZZER=ON -DCMAKE_CXX_COMPILER=clang++
+// Run:   ./fuzz_bin_libfuzzer corpus_dir   (or fuzz_asm_libfuzzer)
+// ========================================================
+
+#include "harness.h"
+
+#ifndef FUZZ_TARGET_ASM
+#define FUZZ_TARGET_ASM 0
+#endif
+
+__attribute__((used, section("__libfuzzer_extra_counters")))
+static uint8_t guest_edges[FuzzHarness::MAP_SIZE];
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static FuzzHarness harness(FUZZ_TARGET_ASM ? FuzzHarness::Target::ASM
+                                               : FuzzHarness::Target::BIN,
+                               10000, guest_edges);
+    harness.run(data, size);
+    return 0;
+}
@@ -0,0 +1,227 @@
+// ========================================================
+// main.cpp – In-process coverage-guided fuzzer
+// Mutates .bin (or .asm) inputs and runs each through a warm
+// headless CPU with an instruction budget. Inputs that reach
+// new guest edges (CPU::coverage, AFL-style hit-count buckets)
+// join the corpus.
+//
+// Written to <outdir>:
+//   crash.bin       input that crashed the emulator (signal)
+//   timeout-N.bin   new-coverage inputs that used the whole budget
+//                   (the first 100)
+//   slowest.bin     halting input with the most instructions
+//   corpus/         final corpus, usable as seeds next time
+//
+// Usage: ./fuzzer [-t bin|asm] [-n iterations] [-s seconds] [-b budget]
+//                 [-m max_len] [-o outdir] [-r seed] [seed files...]
+// ========================================================
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "harness.h"
+#include "mutator.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Only the first few budget-exhausting inputs are written out
+static const uint64_t MAX_SAVED_TIMEOUTS = 100;
+
+// ========================================================
+// Crash capture: the input being run is written out from
+// the signal handler (open/write/_exit only)
+// ========================================================
+static const std::vector<uint8_t> *current_input = nullptr;
+static char crash_path[4096];
+
+static void on_crash(int sig) {
+    if (current_input) {
+        int fd = open(crash_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            ssize_t ignored = write(fd, current_input->data(), current_input->size());
+            (void)ignored;
+            close(fd);
+        }
+    }
+    const char msg[] = "\n==fuzzer== crash, input saved to crash.bin\n";
+    ssize_t ignored = write(2, msg, sizeof(msg) - 1);
+    (void)ignored;
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// ========================================================
+// Coverage feedback
+// Hit counts are folded into buckets (1, 2, 3, 4-7, 8-15,
+// 16-31, 32-127, 128+) so loops count once per order of
+// magnitude; an input is kept if it sets a new bucket bit.
+// ========================================================
+static uint8_t bucket(uint8_t hits) {
+    if (hits <= 3) return hits == 0 ? 0 : 1 << (hits - 1);
+    if (hits < 8)   return 8;
+    if (hits < 16)  return 16;
+    if (hits < 32)  return 32;
+    if (hits < 128) return 64;
+    return 128;
+}
+
+// Merges map into seen; returns the number of new bucket bits
+static int merge_coverage(const uint8_t *map, uint8_t *seen) {
+    int fresh = 0;
+    const uint64_t *words = reinterpret_cast<const uint64_t*>(map);
+    for (size_t w = 0; w < FuzzHarness::MAP_SIZE / 8; w++) {
+        if (words[w] == 0) continue;
+        for (size_t i = w * 8; i < w * 8 + 8; i++) {
+            uint8_t b = bucket(map[i]);
+            if (b & ~seen[i]) {
+                seen[i] |= b;
+                fresh++;
+            }
+        }
+    }
+    return fresh;
+}
+
+static bool write_file(const std::string &path, const std::vector<uint8_t> &data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    bool text = false;
+    uint64_t iterations = 0;          // 0 = until the time limit
+    double seconds = 10;
+    uint64_t budget = 10000;
+    size_t max_len = 4096;
+    std::string outdir = "fuzz-out";
+    uint64_t seed = 1;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        std::string flag = argv[arg], value = argv[arg + 1];
+        if (flag == "-t") text = (value == "asm");
+        else if (flag == "-n") iterations = std::stoull(value);
+        else if (flag == "-s") seconds = std::stod(value);
+        else if (flag == "-b") budget = std::stoull(value);
+        else if (flag == "-m") max_len = std::stoul(value);
+        else if (flag == "-o") outdir = value;
+        else if (flag == "-r") seed = std::stoull(value);
+        else {
+            std::cerr << "Usage: ./fuzzer [-t bin|asm] [-n iterations] [-s seconds] [-b budget]\n"
+                         "                [-m max_len] [-o outdir] [-r seed] [seed files...]\n";
+            return 1;
+        }
+    }
+
+    mkdir(outdir.c_str(), 0755);
+    mkdir((outdir + "/corpus").c_str(), 0755);
+    std::snprintf(crash_path, sizeof(crash_path), "%s/crash.bin", outdir.c_str());
+    for (int sig : { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT })
+        signal(sig, on_crash);
+
+    FuzzHarness harness(text ? FuzzHarness::Target::ASM : FuzzHarness::Target::BIN, budget);
+    Mutator mutator(seed, max_len, text);
+
+    // ----------------------------------------------------
+    // Seeds: given files, or a lone HALT
+    // ----------------------------------------------------
+    std::vector<std::vector<uint8_t>> corpus;
+    std::vector<uint8_t> seen(FuzzHarness::MAP_SIZE, 0);
+
+    for (; arg < argc; arg++) {
+        std::ifstream in(argv[arg], std::ios::binary);
+        if (!in) {
+            std::cerr << "ERROR: cannot open seed " << argv[arg] << "\n";
+            return 1;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (data.size() > max_len) data.resize(max_len);
+        corpus.push_back(std::move(data));
+    }
+    if (corpus.empty()) {
+        if (text) corpus.push_back({ 'H', 'A', 'L', 'T', '\n' });
+        else      corpus.push_back({ OP_HALT, 0, 0, 0, 0 });
+    }
+    for (const auto &input : corpus) {
+        current_input = &input;
+        harness.run(input.data(), input.size());
+        merge_coverage(harness.map(), seen.data());
+    }
+
+    // ----------------------------------------------------
+    // Fuzz loop. The candidate buffer is reused, so the
+    // only allocation is when an input joins the corpus.
+    // ----------------------------------------------------
+    std::vector<uint8_t> candidate;
+    candidate.reserve(max_len + 64);
+    current_input = &candidate;
+
+    uint64_t execs = 0, timeouts = 0, not_assembled = 0, slowest_steps = 0;
+    auto start = Clock::now(), last_report = start;
+
+    auto report = [&](const char *tag) {
+        double t = std::chrono::duration<double>(Clock::now() - start).count();
+        size_t edges = 0;
+        for (uint8_t b : seen) edges += (b != 0);
+        std::cout << tag << " #" << execs
+                  << "  exec/s: " << (uint64_t)(execs / (t > 0 ? t : 1))
+                  << "  corpus: " << corpus.size()
+                  << "  edges: " << edges
+                  << "  timeouts: " << timeouts
+                  << "  slowest: " << slowest_steps;
+        if (text) std::cout << "  rejected: " << not_assembled;
+        std::cout << std::endl;
+    };
+
+    while (iterations == 0 || execs < iterations) {
+        const std::vector<uint8_t> &parent = corpus[mutator.rand(corpus.size())];
+        candidate.assign(parent.begin(), parent.end());
+        mutator.mutate(candidate, corpus);
+
+        FuzzHarness::Result r = harness.run(candidate.data(), candidate.size());
+        execs++;
+        if (!r.assembled) not_assembled++;
+
+        if (merge_coverage(harness.map(), seen.data()) > 0) {
+            corpus.push_back(candidate);
+            if (!r.halted && r.assembled) {
+                if (timeouts < MAX_SAVED_TIMEOUTS)
+                    write_file(outdir + "/timeout-" + std::to_string(timeouts) + ".bin", candidate);
+                timeouts++;
+            }
+        }
+        if (r.halted && r.steps > slowest_steps) {
+            slowest_steps = r.steps;
+            write_file(outdir + "/slowest.bin", candidate);
+        }
+
+        // Clock checks are batched to keep them off the hot path
+        if ((execs & 1023) == 0) {
+            auto now = Clock::now();
+            if (std::chrono::duration<double>(now - last_report).count() >= 1.0) {
+                report("pulse");
+                last_report = now;
+            }
+            if (iterations == 0 && std::chrono::duration<double>(now - start).count() >= seconds)
+                break;
+        }
+    }
+
+    current_input = nullptr;
+    report("done ");
+
+    for (size_t i = 0; i < corpus.size(); i++)
+        write_file(outdir + "/corpus/" + std::to_string(i) + (text ? ".asm" : ".bin"), corpus[i]);
+    return 0;
+}
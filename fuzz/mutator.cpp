@@ -0,0 +1,235 @@
+#include "mutator.h"
+#include "isa.h"
+#include <algorithm>
+#include <cstring>
+
+// Operand values that tend to reach edge cases: zero, sign and
+// carry boundaries, the stack top and the device page
+static const uint16_t INTERESTING[] = {
+    0, 1, 2, 4, 5, 0x7F, 0x80, 0xFF, 0x100, 0x7FFF, 0x8000, 0x8001,
+    0xFFFE, 0xFFFF, IO_PAGE, IO_OUTPUT_NUM, IO_OUTPUT_CHAR,
+    IO_HCALL_ARG0, IO_HCALL_STATUS, IO_HCALL_CALL, 0xFEFF,
+};
+static const size_t N_INTERESTING = sizeof(INTERESTING) / sizeof(INTERESTING[0]);
+
+Mutator::Mutator(uint64_t seed, size_t max_len, bool text)
+    : state(seed ? seed : 0x9E3779B97F4A7C15ULL), max_len(max_len), text(text) {}
+
+// xorshift64*
+uint32_t Mutator::rand(uint32_t n)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return static_cast<uint32_t>((state * 0x2545F4914F6CDD1DULL) >> 32) % n;
+}
+
+uint16_t Mutator::interesting16()
+{
+    if (rand(4) == 0) return static_cast<uint16_t>(rand(0x10000));
+    return INTERESTING[rand(N_INTERESTING)];
+}
+
+// ------------------------------------------------------------
+// A valid encoding of a random ISA_TABLE instruction
+// ------------------------------------------------------------
+void Mutator::random_instruction(uint8_t out[5])
+{
+    const InstrInfo &info = ISA_TABLE[rand(ISA_SIZE)];
+    uint16_t op1 = 0, op2 = 0;
+    auto reg = [&] { return static_cast<uint16_t>(rand(REG_COUNT)); };
+
+    switch (info.enc) {
+        case Encoding::NONE:     break;
+        case Encoding::RD:
+        case Encoding::RS:       op1 = reg(); break;
+        case Encoding::ADDR:     op1 = rand(2) ? 5 * rand(64) : interesting16(); break;
+        case Encoding::RD_IMM:
+        case Encoding::RS_IMM:   op1 = reg(); op2 = interesting16(); break;
+        case Encoding::RD_RS:    op1 = reg(); op2 = reg(); break;
+        case Encoding::RD_MEM:
+        case Encoding::RS_MEM:   op1 = reg() | (reg() << 8); op2 = interesting16(); break;
+        case Encoding::RD_RS_RC: op1 = reg() | (reg() << 8); op2 = reg(); break;
+    }
+
+    out[0] = info.opcode;
+    out[1] = op1 & 0xFF;
+    out[2] = op1 >> 8;
+    out[3] = op2 & 0xFF;
+    out[4] = op2 >> 8;
+}
+
+// ------------------------------------------------------------
+// Same, as a line of assembly ("ADDI R2, 0x8000\n"), sometimes
+// with a label definition or a label operand
+// ------------------------------------------------------------
+void Mutator::random_line(std::vector<uint8_t> &line)
+{
+    uint8_t ins[5];
+    random_instruction(ins);
+    std::string s = disassemble(ins[0], ins[1] | (ins[2] << 8), ins[3] | (ins[4] << 8));
+
+    static const char *LABELS[] = { "a", "b", "c", "loop", "end" };
+    const char *label = LABELS[rand(5)];
+
+    switch (rand(8)) {
+        case 0:
+            s = std::string(label) + ": " + s;
+            break;
+        case 1: {
+            // Replace a trailing address operand with a label
+            size_t p = s.rfind("0x");
+            if (p != std::string::npos) s = s.substr(0, p) + label;
+            break;
+        }
+        case 2:
+            s = rand(2) ? ".word 1, " + std::string(label) : ".asciz \"hi\\n\"";
+            break;
+        default:
+            break;
+    }
+
+    line.assign(s.begin(), s.end());
+    line.push_back('\n');
+}
+
+// ============================================================
+// Havoc: 1–8 stacked mutations
+// ============================================================
+void Mutator::mutate(std::vector<uint8_t> &data,
+                     const std::vector<std::vector<uint8_t>> &corpus)
+{
+    int n = 1 << rand(4);
+    for (int i = 0; i < n; i++) {
+        if (text) mutate_text(data, corpus);
+        else      mutate_binary(data, corpus);
+    }
+    if (data.size() > max_len) data.resize(max_len);
+}
+
+void Mutator::mutate_binary(std::vector<uint8_t> &data,
+                            const std::vector<std::vector<uint8_t>> &corpus)
+{
+    size_t count = data.size() / 5;
+    switch (rand(8)) {
+        case 0:     // flip a bit
+            if (!data.empty()) data[rand(data.size())] ^= 1 << rand(8);
+            break;
+
+        case 1:     // random byte
+            if (!data.empty()) data[rand(data.size())] = rand(256);
+            break;
+
+        case 2: {   // interesting value into an operand field
+            if (count == 0) break;
+            size_t at = 5 * rand(count) + (rand(2) ? 1 : 3);
+            uint16_t v = interesting16();
+            data[at] = v & 0xFF;
+            data[at + 1] = v >> 8;
+            break;
+        }
+
+        case 3: {   // overwrite an instruction
+            if (count == 0) break;
+            random_instruction(&data[5 * rand(count)]);
+            break;
+        }
+
+        case 4: {   // insert an instruction
+            if (data.size() + 5 > max_len) break;
+            uint8_t ins[5];
+            random_instruction(ins);
+            data.insert(data.begin() + 5 * rand(count + 1), ins, ins + 5);
+            break;
+        }
+
+        case 5: {   // delete an instruction
+            if (count < 2) break;
+            size_t at = 5 * rand(count);
+            data.erase(data.begin() + at, data.begin() + at + 5);
+            break;
+        }
+
+        case 6: {   // duplicate a run of instructions
+            if (count == 0 || data.size() + 5 > max_len) break;
+            size_t from = rand(count), len = 1 + rand(std::min<size_t>(count - from, 8));
+            size_t to = 5 * rand(count + 1);
+            std::vector<uint8_t>::iterator src = data.begin() + 5 * from;
+            uint8_t tmp[40];
+            std::copy(src, src + 5 * len, tmp);
+            data.insert(data.begin() + to, tmp, tmp + 5 * len);
+            break;
+        }
+
+        case 7: {   // splice: our head + another input's tail
+            if (corpus.empty()) break;
+            const std::vector<uint8_t> &other = corpus[rand(corpus.size())];
+            size_t other_count = other.size() / 5;
+            if (other_count == 0) break;
+            size_t cut = 5 * rand(count + 1);
+            size_t from = 5 * rand(other_count);
+            data.resize(cut);
+            data.insert(data.end(), other.begin() + from, other.end());
+            break;
+        }
+    }
+}
+
+void Mutator::mutate_text(std::vector<uint8_t> &data,
+                          const std::vector<std::vector<uint8_t>> &corpus)
+{
+    // Line boundaries: start offsets of each line
+    auto line_start = [&](size_t k) {
+        size_t pos = 0;
+        while (k-- > 0) {
+            auto nl = std::find(data.begin() + pos, data.end(), '\n');
+            if (nl == data.end()) return data.size();
+            pos = nl - data.begin() + 1;
+        }
+        return pos;
+    };
+    size_t lines = std::count(data.begin(), data.end(), '\n') + 1;
+
+    std::vector<uint8_t> &line = line_buf;
+    switch (rand(6)) {
+        case 0:
+        case 1: {   // insert a random line
+            random_line(line);
+            size_t at = line_start(rand(lines + 1));
+            data.insert(data.begin() + at, line.begin(), line.end());
+            break;
+        }
+
+        case 2: {   // delete a line
+            size_t k = rand(lines);
+            size_t a = line_start(k), b = line_start(k + 1);
+            data.erase(data.begin() + a, data.begin() + b);
+            break;
+        }
+
+        case 3: {   // replace a line
+            size_t k = rand(lines);
+            size_t a = line_start(k), b = line_start(k + 1);
+            random_line(line);
+            data.erase(data.begin() + a, data.begin() + b);
+            data.insert(data.begin() + a, line.begin(), line.end());
+            break;
+        }
+
+        case 4:     // byte-level noise
+            if (!data.empty()) {
+                static const char CHARS[] = "R0123456789,[]+-:;.\"x \nABCDEFLMOVIJNZ";
+                data[rand(data.size())] = CHARS[rand(sizeof(CHARS) - 1)];
+            }
+            break;
+
+        case 5: {   // splice another input's lines
+            if (corpus.empty()) break;
+            const std::vector<uint8_t> &other = corpus[rand(corpus.size())];
+            size_t at = line_start(rand(lines + 1));
+            size_t from = rand(other.size() + 1);
+            data.insert(data.begin() + at, other.begin() + from, other.end());
+            break;
+        }
+    }
+}
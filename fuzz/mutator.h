@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================
+// Mutator
+// Built-in havoc mutator. Binary inputs are mutated with some
+// knowledge of the 5-byte instruction format (whole random
+// instructions, interesting 16-bit operands); text inputs with
+// whole random assembly lines built from the ISA table.
+// Mutates in place; no allocation once the buffer has grown.
+// ============================================================
+class Mutator {
+public:
+    Mutator(uint64_t seed, size_t max_len, bool text);
+
+    // Apply a few stacked mutations to data. corpus is used for
+    // splicing and may be empty.
+    void mutate(std::vector<uint8_t> &data,
+                const std::vector<std::vector<uint8_t>> &corpus);
+
+    uint32_t rand(uint32_t n);     // uniform in [0, n)
+
+private:
+    uint64_t state;
+    size_t max_len;
+    bool text;
+    std::vector<uint8_t> line_buf;
+
+    uint16_t interesting16();
+    void random_instruction(uint8_t out[5]);
+    void random_line(std::vector<uint8_t> &line);
+
+    void mutate_binary(std::vector<uint8_t> &data,
+                       const std::vector<std::vector<uint8_t>> &corpus);
+    void mutate_text(std::vector<uint8_t> &data,
+                     const std::vector<std::vector<uint8_t>> &corpus);
+};
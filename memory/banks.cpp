@@ -0,0 +1,156 @@
+#include "banks.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ---------------------------------------------
+// BankConfig
+// ---------------------------------------------
+static bool parse_size(const std::string &s, uint64_t &out) {
+    if (s.empty()) return false;
+    char *end = nullptr;
+    unsigned long long v = std::strtoull(s.c_str(), &end, 0);
+    std::string suffix = end;
+    if (suffix == "K" || suffix == "k") v <<= 10;
+    else if (suffix == "M" || suffix == "m") v <<= 20;
+    else if (suffix == "G" || suffix == "g") v <<= 30;
+    else if (!suffix.empty()) return false;
+    out = v;
+    return v != 0;
+}
+
+bool BankConfig::parse(const std::string &spec, std::string &err) {
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t comma = spec.find(',', pos);
+        if (comma == std::string::npos) comma = spec.size();
+        std::string item = spec.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+
+        if (key == "size") {
+            if (!parse_size(value, size)) {
+                err = "bad size: " + value;
+                return false;
+            }
+        } else if (key == "file" && !value.empty()) {
+            file = value;
+        } else {
+            err = "unknown extended memory option: " + item;
+            return false;
+        }
+    }
+    if (file.empty() && size == 0) {
+        err = "extended memory needs size=N or file=PATH";
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------
+// Construction
+// ---------------------------------------------
+BankedRam *BankedRam::create(const BankConfig &config, std::string &err) {
+    long host_page = sysconf(_SC_PAGESIZE);
+    if (host_page <= 0 || BANK_SIZE % host_page != 0 || BANK_WINDOW % host_page != 0) {
+        err = "host page size does not divide the bank window";
+        return nullptr;
+    }
+
+    BankedRam *b = new BankedRam();
+    b->page = host_page;
+    auto failed = [&](const std::string &what) {
+        err = what + ": " + std::strerror(errno);
+        delete b;
+        return nullptr;
+    };
+
+    if (config.file.empty()) {
+        b->fd = memfd_create("cpu-banks", MFD_CLOEXEC);
+        if (b->fd < 0) return failed("memfd_create");
+        // Whole banks; sparse until touched
+        b->region = (config.size + BANK_SIZE - 1) / BANK_SIZE * BANK_SIZE;
+    } else {
+        b->anonymous = false;
+        int flags = O_RDWR | O_CLOEXEC | (config.size ? O_CREAT : 0);
+        b->fd = open(config.file.c_str(), flags, 0644);
+        if (b->fd < 0) return failed(config.file);
+        struct stat st;
+        if (fstat(b->fd, &st) != 0) return failed(config.file);
+        b->region = static_cast<uint64_t>(st.st_size);
+        if (config.size > b->region) b->region = config.size;
+    }
+    if (b->region == 0) {
+        err = config.file + " is empty";
+        delete b;
+        return nullptr;
+    }
+    if (static_cast<uint64_t>(lseek(b->fd, 0, SEEK_END)) < b->region &&
+        ftruncate(b->fd, static_cast<off_t>(b->region)) != 0)
+        return failed("ftruncate");
+
+    uint64_t banks = (b->region + BANK_SIZE - 1) / BANK_SIZE;
+    b->banks = static_cast<uint32_t>(std::min<uint64_t>(banks, UINT32_MAX));
+
+    void *m = mmap(nullptr, MEM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) return failed("mmap");
+    b->mem = static_cast<uint8_t *>(m);
+
+    if (!b->select(0)) return failed("mmap bank 0");
+    return b;
+}
+
+BankedRam::~BankedRam() {
+    if (mem) munmap(mem, MEM_SIZE);
+    if (fd >= 0) close(fd);
+}
+
+// ---------------------------------------------
+// Switching
+// ---------------------------------------------
+bool BankedRam::map_anonymous(size_t offset, size_t len) {
+    void *m = mmap(mem + offset, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    return m != MAP_FAILED;
+}
+
+bool BankedRam::select(uint32_t b) {
+    uint64_t offset = static_cast<uint64_t>(b) * BANK_SIZE;
+
+    // A file's last bank may be short: map what the file has
+    // (whole pages) and fill the rest of the window with zeros
+    uint64_t backed = std::min<uint64_t>(BANK_SIZE, region - offset);
+    size_t mapped = (backed + page - 1) / page * page;
+
+    void *m = mmap(mem + BANK_WINDOW, mapped, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_FIXED, fd, static_cast<off_t>(offset));
+    if (m == MAP_FAILED) {
+        if (!map_anonymous(BANK_WINDOW, BANK_SIZE)) abort();   // window must stay mapped
+        bank = b;
+        return false;
+    }
+    if (mapped < BANK_SIZE && !map_anonymous(BANK_WINDOW + mapped, BANK_SIZE - mapped))
+        abort();
+    bank = b;
+    return true;
+}
+
+void BankedRam::reset() {
+    std::memset(mem, 0, BANK_WINDOW);
+    std::memset(mem + BANK_WINDOW + BANK_SIZE, 0, MEM_SIZE - BANK_WINDOW - BANK_SIZE);
+
+    // Dropping and regrowing a memfd zeroes it and frees its pages
+    if (anonymous) {
+        map_anonymous(BANK_WINDOW, BANK_SIZE);
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(region)) != 0) abort();
+    }
+    select(0);
+}
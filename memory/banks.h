@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "common.h"
+
+// ===============================================================
+// BankConfig – what Memory::enable_banks() attaches
+// Anonymous memory of size bytes, or the file at path (grown to
+// size bytes if it is smaller). Either way the region is split
+// into BANK_SIZE banks; a file's last partial bank reads as zero
+// past its end and writes there are lost.
+// ===============================================================
+struct BankConfig {
+    std::string file;
+    uint64_t size = 0;
+
+    // "size=256M" or "file=data.bin[,size=1G]" (K, M, G
+    // suffixes). False and err on a bad spec.
+    bool parse(const std::string &spec, std::string &err);
+};
+
+// ===============================================================
+// BankedRam – guest RAM with a bank-switched window
+// The 64 KB are one mmap'ed block; [BANK_WINDOW, BANK_WINDOW +
+// BANK_SIZE) of it is a shared mapping of the current bank of
+// the backing region (a memfd, or the file). select() maps
+// another bank over the window with MAP_FIXED: the host page
+// tables change, nothing is copied, and every access path
+// through mem[] (predecoded fast path, block operations,
+// ram_ptr) sees the new bank with no extra checks.
+// ===============================================================
+class BankedRam {
+public:
+    // nullptr and err if the host cannot do it
+    static BankedRam *create(const BankConfig &config, std::string &err);
+    ~BankedRam();
+
+    BankedRam(const BankedRam &) = delete;
+    BankedRam &operator=(const BankedRam &) = delete;
+
+    uint8_t *data() const { return mem; }
+    uint32_t count() const { return banks; }
+    uint32_t current() const { return bank; }
+
+    // Map bank b into the window. False if the host refused; the
+    // window is then anonymous zero pages (never left unmapped).
+    bool select(uint32_t b);
+
+    // Power-on state: RAM outside the window zeroed, bank 0
+    // mapped. Anonymous backing is zeroed too; a file keeps its
+    // contents.
+    void reset();
+
+private:
+    BankedRam() = default;
+
+    uint8_t *mem = nullptr;          // 64 KB of guest RAM
+    int fd = -1;
+    uint64_t region = 0;             // bytes in the backing region
+    bool anonymous = true;
+    uint32_t banks = 0;
+    uint32_t bank = 0;
+    size_t page = 0;                 // host page size
+
+    bool map_anonymous(size_t offset, size_t len);
+};
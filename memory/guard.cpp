@@ -0,0 +1,253 @@
+#include "guard.h"
+#include "memory.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// ---------------------------------------------
+// GuardConfig
+// ---------------------------------------------
+static bool parse_number(const std::string &s, uint32_t &out) {
+    if (s.empty()) return false;
+    char *end = nullptr;
+    unsigned long v = std::strtoul(s.c_str(), &end, 0);
+    if (*end != '\0' || v > 0x10000) return false;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+bool GuardConfig::parse(const std::string &spec, std::string &err) {
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t comma = spec.find(',', pos);
+        if (comma == std::string::npos) comma = spec.size();
+        std::string item = spec.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        if (item == "on") continue;
+
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+
+        if (key == "stack") {
+            if (!parse_number(value, stack_size) || stack_size == 0 || stack_size >= STACK_TOP) {
+                err = "bad stack size: " + value;
+                return false;
+            }
+        } else if (key == "unmap") {
+            size_t colon = value.find(':');
+            uint32_t addr, len;
+            if (colon == std::string::npos ||
+                !parse_number(value.substr(0, colon), addr) ||
+                !parse_number(value.substr(colon + 1), len) ||
+                len == 0 || addr + len > IO_PAGE) {
+                err = "bad range (addr:len below the I/O page): " + value;
+                return false;
+            }
+            unmapped.push_back({ static_cast<uint16_t>(addr), len });
+        } else {
+            err = "unknown guard option: " + item;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------
+// Signal handler state
+// Instances register in a fixed table the handler
+// can scan without locking; each thread running a
+// CPU has its own landing pad.
+// ---------------------------------------------
+static const int MAX_GUARDED = 64;
+static std::atomic<GuardedRam *> registry[MAX_GUARDED];
+static thread_local GuardedRam::Landing *landing = nullptr;
+static struct sigaction previous;
+static std::once_flag installed;
+
+void GuardedRam::enter(Landing &pad) {
+    pad.prev = landing;
+    landing = &pad;
+}
+
+void GuardedRam::leave(Landing &pad) {
+    landing = pad.prev;
+}
+
+void GuardedRam::on_segv(int sig, siginfo_t *info, void *context) {
+    uint8_t *addr = static_cast<uint8_t *>(info->si_addr);
+
+    for (auto &slot : registry) {
+        GuardedRam *g = slot.load(std::memory_order_acquire);
+        if (!g || addr < g->mem || addr >= g->mem + MEM_SIZE) continue;
+
+        if (g->trap(addr - g->mem)) return;
+        if (landing) siglongjmp(landing->env, 1);
+
+        static const char msg[] = "guarded guest memory accessed outside a CPU run loop\n";
+        ssize_t ignored = write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        (void)ignored;
+        abort();
+    }
+
+    // Not guest RAM (including our own guard pages): whoever was
+    // there before, or the default action on return
+    if (previous.sa_flags & SA_SIGINFO) {
+        previous.sa_sigaction(sig, info, context);
+    } else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+        previous.sa_handler(sig);
+    } else {
+        signal(sig, SIG_DFL);
+    }
+}
+
+// ---------------------------------------------
+// Construction
+// ---------------------------------------------
+GuardedRam *GuardedRam::create(const GuardConfig &config, uint8_t *code, std::string &err) {
+    long host_page = sysconf(_SC_PAGESIZE);
+    if (host_page <= 0 || MEM_SIZE % host_page != 0) {
+        err = "host page size does not divide guest memory";
+        return nullptr;
+    }
+
+    int slot = 0;
+    while (slot < MAX_GUARDED && registry[slot].load() != nullptr) slot++;
+    if (slot == MAX_GUARDED) {
+        err = "too many guarded memories";
+        return nullptr;
+    }
+
+    GuardedRam *g = new GuardedRam();
+    g->page = host_page;
+    g->map_len = MEM_SIZE + 2 * g->page;
+    void *m = mmap(nullptr, g->map_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) {
+        err = std::string("mmap: ") + std::strerror(errno);
+        delete g;
+        return nullptr;
+    }
+    g->map = static_cast<uint8_t *>(m);
+    g->mem = g->map + g->page;
+    g->code = code;
+
+    size_t count = MEM_SIZE / g->page;
+    g->pages.assign(count, PAGE_NONE);
+    g->configured.assign(count, PAGE_RW);
+
+    // The guard page sits under the stack's lowest byte
+    if (config.stack_size) {
+        size_t lowest = STACK_TOP - config.stack_size;
+        if (lowest >= g->page)
+            g->configured[lowest / g->page - 1] = PAGE_STACK;
+    }
+    for (const GuardConfig::Range &r : config.unmapped)
+        for (size_t p = r.addr / g->page; p * g->page < r.addr + r.len; p++)
+            g->configured[p] = PAGE_NONE;
+
+    // Never the page with the device registers
+    if (g->configured[IO_PAGE / g->page] != PAGE_RW) {
+        err = "guard range reaches the I/O page";
+        delete g;
+        return nullptr;
+    }
+
+    std::call_once(installed, [] {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = on_segv;
+        sa.sa_flags = SA_SIGINFO | SA_NODEFER;   // siglongjmp leaves no mask behind
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGSEGV, &sa, &previous);
+    });
+
+    g->reset();
+    registry[slot].store(g, std::memory_order_release);
+    return g;
+}
+
+GuardedRam::~GuardedRam() {
+    for (auto &slot : registry) {
+        GuardedRam *self = this;
+        slot.compare_exchange_strong(self, nullptr);
+    }
+    if (map) munmap(map, map_len);
+}
+
+// ---------------------------------------------
+// Page states
+// ---------------------------------------------
+void GuardedRam::set(size_t p, PageState state) {
+    if (pages[p] == state) return;
+    int prot = state == PAGE_CODE ? PROT_READ
+             : state == PAGE_NONE || state == PAGE_STACK ? PROT_NONE
+             : PROT_READ | PROT_WRITE;
+    mprotect(mem + p * page, page, prot);
+    pages[p] = state;
+}
+
+void GuardedRam::reset(const uint8_t *contents) {
+    mprotect(mem, MEM_SIZE, PROT_READ | PROT_WRITE);
+    std::fill(pages.begin(), pages.end(), PAGE_RW);
+    if (contents)
+        std::memcpy(mem, contents, MEM_SIZE);
+    else
+        std::memset(mem, 0, MEM_SIZE);
+    for (size_t p = 0; p < pages.size(); p++) set(p, configured[p]);
+}
+
+bool GuardedRam::protect_code(uint16_t addr) {
+    size_t p = addr / page;
+    if (pages[p] == PAGE_RW && (p + 1) * page <= IO_PAGE) set(p, PAGE_CODE);
+    return pages[p] == PAGE_CODE;
+}
+
+// Writable again; its decoded copies (and those of instructions
+// running into it from the page before) are stale
+void GuardedRam::open_page(size_t p) {
+    set(p, PAGE_SOFT);
+    size_t start = p * page;
+    size_t from = start >= 4 ? start - 4 : 0;
+    for (size_t a = from; a < start + page; a++) code[a] &= ~Memory::CODE_START;
+}
+
+void GuardedRam::open_code(uint16_t addr, uint32_t len) {
+    if (len == 0) return;
+    uint32_t last = std::min<uint32_t>(addr + len, MEM_SIZE) - 1;
+    for (size_t p = addr / page; p <= last / page; p++)
+        if (pages[p] == PAGE_CODE) open_page(p);
+}
+
+bool GuardedRam::accessible(uint16_t addr, uint32_t len) const {
+    if (len == 0) return true;
+    uint32_t last = std::min<uint32_t>(addr + len, MEM_SIZE) - 1;
+    for (size_t p = addr / page; p <= last / page; p++)
+        if (pages[p] == PAGE_NONE || pages[p] == PAGE_STACK) return false;
+    return true;
+}
+
+int32_t GuardedRam::first_guarded(uint16_t addr, uint32_t len) const {
+    if (len == 0) return -1;
+    uint32_t last = std::min<uint32_t>(addr + len, MEM_SIZE) - 1;
+    for (size_t p = addr / page; p <= last / page; p++)
+        if (pages[p] == PAGE_NONE || pages[p] == PAGE_STACK)
+            return std::max<uint32_t>(addr, p * page);
+    return -1;
+}
+
+// In the signal handler
+bool GuardedRam::trap(size_t offset) {
+    size_t p = offset / page;
+    if (pages[p] == PAGE_CODE) {
+        open_page(p);
+        return true;
+    }
+    fault_addr = static_cast<uint16_t>(offset);
+    fault_cause = pages[p] == PAGE_STACK ? FAULT_STACK : FAULT_ACCESS;
+    return false;
+}
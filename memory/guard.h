@@ -0,0 +1,112 @@
+#pragma once
+
+#include <csetjmp>
+#include <csignal>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common.h"
+
+// ===============================================================
+// GuardConfig – what Memory::enable_guard() protects
+// Ranges are widened to whole host pages and may not reach the
+// I/O page.
+// ===============================================================
+struct GuardConfig {
+    struct Range {
+        uint16_t addr;
+        uint32_t len;
+    };
+
+    // Bytes of stack below STACK_TOP; the page under them is
+    // inaccessible, so runaway recursion faults. 0 = no guard.
+    uint32_t stack_size = 0;
+
+    // Inaccessible ranges: any load, store or fetch faults
+    std::vector<Range> unmapped;
+
+    // "stack=4096,unmap=0x9000:0x1000,..." ("on" = code
+    // protection only). False and err on a bad spec.
+    bool parse(const std::string &spec, std::string &err);
+};
+
+// ===============================================================
+// GuardedRam – mmap'ed guest RAM with host page protection
+// The 64 KB sit between two PROT_NONE pages. Host page states:
+//   RW    plain RAM
+//   CODE  holds predecoded instructions, read-only: the first
+//         store traps, reopens the page and drops its decoded
+//         copies, then completes (the page becomes SOFT)
+//   SOFT  code and data share it; Memory's software marks cover
+//         its instructions from then on
+//   NONE / STACK  configured guards; an access becomes a guest
+//         fault through the running CPU's landing pad
+//
+// A SIGSEGV handler shared by all instances finds the owner from
+// the fault address. Faults outside guest RAM go to the previous
+// handler.
+// ===============================================================
+class GuardedRam {
+public:
+    // A CPU run loop registers one per thread; an access to a
+    // guard page siglongjmp()s to env (fault details in the
+    // GuardedRam). With no landing pad the process aborts.
+    struct Landing {
+        sigjmp_buf env;
+        Landing *prev = nullptr;
+    };
+    static void enter(Landing &pad);
+    static void leave(Landing &pad);
+
+    // code: Memory's predecode marks, cleared for reopened pages.
+    // nullptr and err if the host cannot do it.
+    static GuardedRam *create(const GuardConfig &config, uint8_t *code, std::string &err);
+    ~GuardedRam();
+
+    GuardedRam(const GuardedRam &) = delete;
+    GuardedRam &operator=(const GuardedRam &) = delete;
+
+    uint8_t *data() const { return mem; }
+
+    // Everything writable and zeroed (or copied from contents),
+    // then the configured guards applied again
+    void reset(const uint8_t *contents = nullptr);
+
+    // Write-protect the page holding addr for predecoded code.
+    // False if it must use software marks instead (SOFT page).
+    bool protect_code(uint16_t addr);
+
+    // The host is about to write [addr, addr + len) directly:
+    // reopen CODE pages in it
+    void open_code(uint16_t addr, uint32_t len);
+
+    // No guard page in [addr, addr + len)
+    bool accessible(uint16_t addr, uint32_t len) const;
+
+    // Lowest address of [addr, addr + len) on a guard page, or
+    // -1 (the range is clipped at the top of RAM)
+    int32_t first_guarded(uint16_t addr, uint32_t len) const;
+
+    // Last access fault (valid after a landing)
+    uint16_t fault_addr = 0;
+    FaultCause fault_cause = FAULT_NONE;
+
+private:
+    enum PageState : uint8_t { PAGE_RW, PAGE_CODE, PAGE_SOFT, PAGE_NONE, PAGE_STACK };
+
+    GuardedRam() = default;
+
+    uint8_t *map = nullptr;            // guard + RAM + guard
+    size_t map_len = 0;
+    uint8_t *mem = nullptr;
+    uint8_t *code = nullptr;
+    size_t page = 0;                   // host page size
+    std::vector<PageState> pages;      // one per host page of RAM
+    std::vector<PageState> configured;
+
+    void set(size_t p, PageState state);
+    void open_page(size_t p);
+    bool trap(size_t offset);          // true: retry the access
+
+    static void on_segv(int sig, siginfo_t *info, void *context);
+};
@@ -0,0 +1,108 @@
+#include "hypercall.h"
+#include <algorithm>
+#include <vector>
+
+// ---------------------------------------------
+// MUL32: 16 x 16 -> 32-bit product
+// ---------------------------------------------
+template <class Layout>
+static uint16_t hc_mul32(typename BasicMemory<Layout>::HyperCallArgs &a, BasicMemory<Layout> &) {
+    uint32_t p = (uint32_t)a[0] * a[1];
+    a[0] = p & 0xFFFF;
+    a[1] = p >> 16;
+    return 0;
+}
+
+// ---------------------------------------------
+// DIVMOD: quotient and remainder in one call
+// ---------------------------------------------
+template <class Layout>
+static uint16_t hc_divmod(typename BasicMemory<Layout>::HyperCallArgs &a, BasicMemory<Layout> &) {
+    if (a[1] == 0) return 1;
+    uint16_t q = a[0] / a[1];
+    uint16_t r = a[0] % a[1];
+    a[0] = q;
+    a[1] = r;
+    return 0;
+}
+
+// ---------------------------------------------
+// SORT16: sort an array of little-endian words
+// ---------------------------------------------
+template <class Layout>
+static uint16_t hc_sort16(typename BasicMemory<Layout>::HyperCallArgs &a, BasicMemory<Layout> &m) {
+    uint16_t count = a[1];
+    if (count > 0x7FFF) return 2;
+
+    uint8_t *p = m.ram_ptr(a[0], count * 2);
+    if (!p) return 2;
+
+    std::vector<uint16_t> words(count);
+    for (uint16_t i = 0; i < count; i++)
+        words[i] = p[2 * i] | (p[2 * i + 1] << 8);
+
+    std::sort(words.begin(), words.end());
+
+    for (uint16_t i = 0; i < count; i++) {
+        p[2 * i]     = words[i] & 0xFF;
+        p[2 * i + 1] = words[i] >> 8;
+    }
+    return 0;
+}
+
+// ---------------------------------------------
+// HASH32: FNV-1a over a byte range
+// ---------------------------------------------
+template <class Layout>
+static uint16_t hc_hash32(typename BasicMemory<Layout>::HyperCallArgs &a, BasicMemory<Layout> &m) {
+    const uint8_t *p = m.ram_ptr(a[0], a[1]);
+    if (!p) return 2;
+
+    uint32_t h = 2166136261u;
+    for (uint16_t i = 0; i < a[1]; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    a[0] = h & 0xFFFF;
+    a[1] = h >> 16;
+    return 0;
+}
+
+// ---------------------------------------------
+// FORMAT: unsigned value -> text in base 2..16
+// ---------------------------------------------
+template <class Layout>
+static uint16_t hc_format(typename BasicMemory<Layout>::HyperCallArgs &a, BasicMemory<Layout> &m) {
+    uint16_t value = a[0];
+    uint16_t base  = a[1];
+    if (base < 2 || base > 16) return 1;
+
+    char digits[17];
+    int n = 0;
+    do {
+        digits[n++] = "0123456789ABCDEF"[value % base];
+        value /= base;
+    } while (value != 0);
+
+    uint8_t *p = m.ram_ptr(a[2], n + 1);
+    if (!p) return 2;
+
+    for (int i = 0; i < n; i++)
+        p[i] = digits[n - 1 - i];
+    p[n] = 0;
+
+    a[0] = n;
+    return 0;
+}
+
+template <class Layout>
+void register_default_hypercalls(BasicMemory<Layout> &memory) {
+    memory.register_hypercall(HCALL_MUL32,  hc_mul32<Layout>);
+    memory.register_hypercall(HCALL_DIVMOD, hc_divmod<Layout>);
+    memory.register_hypercall(HCALL_SORT16, hc_sort16<Layout>);
+    memory.register_hypercall(HCALL_HASH32, hc_hash32<Layout>);
+    memory.register_hypercall(HCALL_FORMAT, hc_format<Layout>);
+}
+
+template void register_default_hypercalls(BasicMemory<Layout64K> &);
+template void register_default_hypercalls(BasicMemory<Layout4K> &);
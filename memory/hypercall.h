@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include "memory.h"
+
+// ===============================================================
+// Built-in hypercalls
+// Native routines the guest can invoke through the hypercall
+// device (see IO_HCALL_* in common.h). Arguments and results use
+// the ARG0..ARG3 slots.
+//
+//   ID  Name     Arguments                  Results
+//   --  -------  -------------------------  -----------------------
+//    1  MUL32    a, b                       lo, hi of a * b
+//    2  DIVMOD   a, b                       a / b, a % b  (status 1 if b == 0)
+//    3  SORT16   addr, count                words at addr sorted ascending
+//    4  HASH32   addr, len                  lo, hi of FNV-1a over bytes
+//    5  FORMAT   value, base, buf           length; NUL-terminated text at buf
+//
+// Routines that touch guest buffers return status 2 if the buffer
+// is not plain RAM.
+// ===============================================================
+
+static const uint8_t HCALL_MUL32  = 1;
+static const uint8_t HCALL_DIVMOD = 2;
+static const uint8_t HCALL_SORT16 = 3;
+static const uint8_t HCALL_HASH32 = 4;
+static const uint8_t HCALL_FORMAT = 5;
+
+// Install all of the above into memory
+template <class Layout>
+void register_default_hypercalls(BasicMemory<Layout> &memory);
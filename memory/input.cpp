@@ -0,0 +1,168 @@
+#include "input.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+static const size_t MASK = InputStream::BUFFER_SIZE - 1;
+static_assert((InputStream::BUFFER_SIZE & MASK) == 0, "BUFFER_SIZE must be a power of two");
+
+// Largest single read(2) the reader issues
+static const size_t CHUNK = 64 * 1024;
+
+InputStream::InputStream() {}
+
+InputStream::~InputStream() {
+    close();
+}
+
+// ---------------------------------------------
+// Attach / detach
+// ---------------------------------------------
+bool InputStream::open(const std::string &path, std::string &err) {
+    if (path == "-") {
+        attach(STDIN_FILENO, false);
+        return true;
+    }
+
+    int f = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (f < 0) {
+        err = path + ": " + std::strerror(errno);
+        return false;
+    }
+    attach(f, true);
+    return true;
+}
+
+void InputStream::attach(int new_fd, bool take_ownership) {
+    close();
+
+    if (pipe(wake_pipe) != 0) {
+        if (take_ownership) ::close(new_fd);
+        error = true;
+        return;
+    }
+
+    // Allocated on first use: most CPUs never attach a stream
+    if (buf.empty()) buf.resize(BUFFER_SIZE);
+
+    fd = new_fd;
+    owned = take_ownership;
+    head = 0;
+    tail = 0;
+    ended = false;
+    error = false;
+    stop = false;
+    reader = std::thread([this] { fill(); });
+}
+
+void InputStream::close() {
+    if (reader.joinable()) {
+        stop = true;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            space.notify_one();
+        }
+        char c = 0;
+        ssize_t ignored = write(wake_pipe[1], &c, 1);
+        (void)ignored;
+        reader.join();
+    }
+
+    for (int &p : wake_pipe) {
+        if (p >= 0) ::close(p);
+        p = -1;
+    }
+    if (owned && fd >= 0) ::close(fd);
+    fd = -1;
+    owned = false;
+    ended = true;
+}
+
+// ---------------------------------------------
+// Reader thread: read ahead until the buffer
+// is full, then wait for the guest to drain it
+// ---------------------------------------------
+void InputStream::fill() {
+    while (!stop) {
+        uint64_t t = tail.load();
+        size_t free_bytes = BUFFER_SIZE - (t - head.load());
+
+        if (free_bytes == 0) {
+            std::unique_lock<std::mutex> lock(m);
+            producer_waiting = true;
+            space.wait(lock, [&] { return stop || tail.load() - head.load() < BUFFER_SIZE; });
+            producer_waiting = false;
+            continue;
+        }
+
+        // Wait for data or close(); regular files are always ready
+        pollfd fds[2] = { { fd, POLLIN, 0 }, { wake_pipe[0], POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            error = true;
+            break;
+        }
+        if (stop) break;
+
+        size_t n = std::min({ free_bytes, BUFFER_SIZE - (t & MASK), CHUNK });
+        ssize_t got = ::read(fd, &buf[t & MASK], n);
+        if (got < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            error = true;
+            break;
+        }
+        if (got == 0) break;
+
+        tail = t + got;
+        if (consumer_waiting) {
+            std::lock_guard<std::mutex> lock(m);
+            data.notify_one();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    ended = true;
+    data.notify_one();
+}
+
+// ---------------------------------------------
+// Guest side
+// ---------------------------------------------
+size_t InputStream::read(uint8_t *dst, size_t len) {
+    size_t done = 0;
+
+    while (done < len) {
+        uint64_t h = head.load();
+        size_t avail = tail.load() - h;
+
+        if (avail == 0) {
+            if (ended) {
+                // The last bytes may land just before ended is set
+                if (tail.load() != h) continue;
+                break;
+            }
+            std::unique_lock<std::mutex> lock(m);
+            consumer_waiting = true;
+            data.wait(lock, [&] { return ended || tail.load() != head.load(); });
+            consumer_waiting = false;
+            continue;
+        }
+
+        // At most two copies: up to the end of the ring, then from 0
+        size_t n = std::min(avail, len - done);
+        size_t first = std::min(n, BUFFER_SIZE - (h & MASK));
+        std::memcpy(dst + done, &buf[h & MASK], first);
+        std::memcpy(dst + done + first, &buf[0], n - first);
+        done += n;
+
+        head = h + n;
+        if (producer_waiting) {
+            std::lock_guard<std::mutex> lock(m);
+            space.notify_one();
+        }
+    }
+    return done;
+}
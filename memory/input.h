@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ===============================================================
+// InputStream – host side of the input device (IO_IN_* in common.h)
+// A reader thread fills a large ring buffer from a file, pipe or
+// stdin ahead of the guest, so guest reads are a memcpy out of
+// the buffer instead of a syscall each.
+//
+// One producer (the reader thread), one consumer (the CPU
+// thread): head and tail are running byte counts, and the
+// mutex/condition variables are only touched when one side has
+// to wait for the other.
+//
+// With nothing attached the stream is empty: reads return 0 and
+// at_eof() is true.
+// ===============================================================
+class InputStream {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    InputStream();
+    ~InputStream();                    // stops the reader thread
+
+    InputStream(const InputStream &) = delete;
+    InputStream &operator=(const InputStream &) = delete;
+
+    // Open path for reading ("-" = stdin). Replaces any open stream.
+    bool open(const std::string &path, std::string &err);
+
+    // Read from an open descriptor; owned descriptors are closed
+    // along with the stream
+    void attach(int fd, bool owned);
+
+    void close();
+
+    // Up to len bytes into dst, blocking until len bytes arrived
+    // or the stream ended; returns the count
+    size_t read(uint8_t *dst, size_t len);
+
+    // Bytes that read() can return without blocking
+    size_t available() const { return tail.load() - head.load(); }
+
+    // Ended and drained: read() will return 0
+    bool at_eof() const { return ended.load() && available() == 0; }
+
+    // The host read failed (the stream ended early)
+    bool failed() const { return error.load(); }
+
+private:
+    std::vector<uint8_t> buf;
+    std::atomic<uint64_t> head{0};     // consumed
+    std::atomic<uint64_t> tail{0};     // produced
+
+    std::atomic<bool> ended{true};
+    std::atomic<bool> error{false};
+
+    int fd = -1;
+    bool owned = false;
+    int wake_pipe[2] = { -1, -1 };     // interrupts the reader's poll()
+    std::thread reader;
+    std::atomic<bool> stop{false};
+
+    std::mutex m;
+    std::condition_variable data;      // consumer waits for bytes
+    std::condition_variable space;     // producer waits for room
+    std::atomic<bool> consumer_waiting{false};
+    std::atomic<bool> producer_waiting{false};
+
+    void fill();
+};
@@ -0,0 +1,168 @@
+#include "interrupts.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// ---------------------------------------------
+// TimerService
+// One thread for the whole process. Each armed controller has
+// one entry in a min-heap of deadlines; the thread sleeps until
+// the earliest, raises IRQ_TIMER and pushes the next deadline.
+// A controller's entry is removed under the lock when it is
+// re-armed, stopped or destroyed, so the thread never sees a
+// dangling one.
+// ---------------------------------------------
+class TimerService {
+public:
+    static TimerService &instance() {
+        static TimerService service;
+        return service;
+    }
+
+    // period_us = 0 stops the timer
+    void arm(InterruptController &irq, uint32_t period_us) {
+        std::lock_guard<std::mutex> lock(m);
+        remove(irq);
+        irq.timer_period = period_us;
+        if (period_us == 0) return;
+
+        if (!thread.joinable()) thread = std::thread([this] { loop(); });
+        push({ Clock::now() + std::chrono::microseconds(period_us), &irq });
+        changed.notify_one();
+    }
+
+    ~TimerService() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+        }
+        changed.notify_one();
+        if (thread.joinable()) thread.join();
+    }
+
+private:
+    struct Entry {
+        Clock::time_point due;
+        InterruptController *irq;
+    };
+
+    static bool later(const Entry &a, const Entry &b) { return a.due > b.due; }
+
+    std::mutex m;
+    std::condition_variable changed;
+    std::vector<Entry> heap;
+    std::thread thread;
+    bool stop = false;
+
+    void push(const Entry &e) {
+        heap.push_back(e);
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+
+    void remove(InterruptController &irq) {
+        auto end = std::remove_if(heap.begin(), heap.end(),
+                                  [&](const Entry &e) { return e.irq == &irq; });
+        if (end == heap.end()) return;
+        heap.erase(end, heap.end());
+        std::make_heap(heap.begin(), heap.end(), later);
+    }
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(m);
+        while (!stop) {
+            if (heap.empty()) {
+                changed.wait(lock);
+                continue;
+            }
+            Entry next = heap.front();
+            if (Clock::now() < next.due) {
+                changed.wait_until(lock, next.due);
+                continue;
+            }
+
+            std::pop_heap(heap.begin(), heap.end(), later);
+            heap.pop_back();
+
+            InterruptController &irq = *next.irq;
+            irq.raise(IRQ_TIMER);
+
+            // Periodic; a guest that fell far behind skips the
+            // missed ticks instead of getting a burst
+            auto period = std::chrono::microseconds(irq.timer_period);
+            Clock::time_point due = next.due + period;
+            if (due < Clock::now()) due = Clock::now() + period;
+            push({ due, &irq });
+        }
+    }
+};
+
+// ---------------------------------------------
+// InterruptController
+// ---------------------------------------------
+InterruptController::~InterruptController() {
+    arm_timer(0);
+}
+
+int InterruptController::acknowledge() {
+    uint32_t ready = pending.load() & mask;
+    if (ready == 0) return -1;
+
+    int line = 0;
+    while (!(ready & (1u << line))) line++;
+    pending.fetch_and(~(1u << line));
+    return line;
+}
+
+void InterruptController::raise(int line) {
+    if (line < 0 || line >= IRQ_LINES) return;
+    pending.fetch_or(1u << line);
+
+    // Taking the lock orders this with a waiter between its
+    // predicate check and going to sleep
+    { std::lock_guard<std::mutex> lock(wait_lock); }
+    wake.notify_all();
+}
+
+void InterruptController::clear(uint8_t lines) {
+    pending.fetch_and(~static_cast<uint32_t>(lines));
+}
+
+void InterruptController::wait() {
+    bool timer_wakes = timer_armed && (mask & (1u << IRQ_TIMER));
+    if (virtual_timer && timer_wakes && !deliverable()) {
+        virtual_left = timer_period;
+        raise(IRQ_TIMER);
+        return;
+    }
+    if (!timer_wakes && external_sources == 0) return;
+
+    std::unique_lock<std::mutex> lock(wait_lock);
+    wake.wait(lock, [this] { return deliverable(); });
+}
+
+void InterruptController::arm_timer(uint32_t period_us) {
+    if (virtual_timer) {
+        timer_period = virtual_left = period_us;
+        timer_armed = period_us != 0;
+        return;
+    }
+
+    // A controller that never armed the timer never starts the thread
+    if (period_us == 0 && !timer_armed) return;
+    TimerService::instance().arm(*this, period_us);
+    timer_armed = period_us != 0;
+}
+
+void InterruptController::use_virtual_timer(bool on) {
+    arm_timer(0);
+    virtual_timer = on;
+}
+
+void InterruptController::reset() {
+    arm_timer(0);
+    pending = 0;
+    mask = 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "common.h"
+
+// ===============================================================
+// Interrupt controller (IO_IRQ_* in common.h)
+// Pending lines are bits in an atomic word, so the timer thread
+// and host code can raise interrupts from any thread. The CPU
+// checks deliverable() between instructions; WFI blocks in
+// wait() until a line is pending instead of spinning.
+//
+// Timer deadlines of every controller in the process live in one
+// shared timer thread (a next-deadline heap), so an idle guest
+// costs nothing until its deadline comes.
+// ===============================================================
+class InterruptController {
+public:
+    InterruptController() = default;
+    ~InterruptController();            // stops the timer
+
+    InterruptController(const InterruptController &) = delete;
+    InterruptController &operator=(const InterruptController &) = delete;
+
+    // -----------------------------------------------------------
+    // CPU side
+    // -----------------------------------------------------------
+    // A line is pending and enabled in the mask
+    bool deliverable() const {
+        return (pending.load(std::memory_order_relaxed) & mask) != 0;
+    }
+
+    // Lowest deliverable line, now cleared; -1 if none
+    int acknowledge();
+
+    // Block until deliverable(). Returns at once if nothing could
+    // ever wake us (no timer armed on an enabled line and no
+    // external sources).
+    void wait();
+
+    uint8_t pending_lines() const { return static_cast<uint8_t>(pending.load()); }
+
+    // -----------------------------------------------------------
+    // Guest registers (through Memory::write8)
+    // -----------------------------------------------------------
+    void clear(uint8_t lines);
+    void set_mask(uint8_t lines) { mask = lines; }
+    void arm_timer(uint32_t period_us);          // 0 = stop
+
+    // -----------------------------------------------------------
+    // Host side, any thread
+    // -----------------------------------------------------------
+    void raise(int line);
+
+    // Hosts that raise() from another thread register themselves,
+    // so WFI waits for them even with no timer armed
+    void add_source()    { external_sources++; }
+    void remove_source() { external_sources--; }
+
+    // Power-on state: timer stopped, nothing pending or enabled
+    // (the timer mode below is kept)
+    void reset();
+
+    // -----------------------------------------------------------
+    // Virtual timer, for runs that must be repeatable (lockstep):
+    // the period counts advance() calls instead of microseconds,
+    // no thread is involved, and WFI skips ahead to the deadline.
+    // -----------------------------------------------------------
+    void use_virtual_timer(bool on);
+    void advance() {
+        if (virtual_timer && timer_armed && --virtual_left == 0) {
+            virtual_left = timer_period;
+            raise(IRQ_TIMER);
+        }
+    }
+
+private:
+    friend class TimerService;
+
+    std::atomic<uint32_t> pending{0};
+    uint8_t mask = 0;
+    std::atomic<bool> timer_armed{false};
+    std::atomic<int> external_sources{0};
+
+    // Guarded by the timer service's lock (host timer)
+    uint32_t timer_period = 0;
+
+    bool virtual_timer = false;
+    uint32_t virtual_left = 0;
+
+    std::mutex wait_lock;
+    std::condition_variable wake;
+};
@@ -1,98 +1,546 @@
 #include "memory.h"
 #include <iomanip>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
 
 // ---------------------------------------------
 // Constructor – initialize memory + I/O
 // ---------------------------------------------
-Memory::Memory() : mem(MEM_SIZE, 0) {
-    mem[IO_OUTPUT_NUM]  = 0;
-    mem[IO_TIMER]       = 0;
-    mem[IO_OUTPUT_CHAR] = 0;
+template <class Layout>
+BasicMemory<Layout>::BasicMemory()
+    : ram(Layout::MEM_SIZE, 0), mem(ram.data()), code(Layout::MEM_SIZE, 0), hypercalls(HCALL_MAX) {
+    mem[Layout::io(IO_OUTPUT_NUM)]  = 0;
+    mem[Layout::io(IO_TIMER)]       = 0;
+    mem[Layout::io(IO_OUTPUT_CHAR)] = 0;
+}
+
+// ---------------------------------------------
+// Reset – zero RAM and device registers
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::reset() {
+    if (guard)
+        guard->reset();
+    else if (banks)
+        banks->reset();
+    else
+        std::fill(mem, mem + Layout::MEM_SIZE, 0);
+    if (code_lo <= code_hi)
+        std::fill(&code[code_lo], &code[code_hi] + 1, 0);
+    code_lo = Layout::MEM_SIZE;
+    code_hi = 0;
+    pmu.reset();
+    irq.reset();
+    if (banks) bank_sync(BANK_OK);
 }
 
 // ---------------------------------------------
 // Read 8-bit value
 // ---------------------------------------------
-uint8_t Memory::read8(uint16_t addr) const {
-    return mem[addr];
+template <class Layout>
+uint8_t BasicMemory<Layout>::read8(uint16_t addr) const {
+    return mem[addr & Layout::MEM_MASK];
 }
 
 // ---------------------------------------------
 // Read 16-bit little-endian value
 // ---------------------------------------------
-uint16_t Memory::read16(uint16_t addr) const {
-    uint16_t lo = mem[addr];
-    uint16_t hi = mem[addr + 1];
+// On guarded memory the low byte must be read first, so a trap
+// reports addr: the fences keep the compiler from reordering
+// these loads with each other or with the next read16()
+template <class Layout>
+uint16_t BasicMemory<Layout>::read16(uint16_t addr) const {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    uint16_t lo = mem[addr & Layout::MEM_MASK];
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    uint16_t hi = mem[(addr + 1) & Layout::MEM_MASK];
     return (hi << 8) | lo;
 }
 
 // ---------------------------------------------
 // Write 8-bit value
 // ---------------------------------------------
-void Memory::write8(uint16_t addr, uint8_t value) {
+template <class Layout>
+void BasicMemory<Layout>::write8(uint16_t addr, uint8_t value) {
 
-    // Timer register
-    if (addr == IO_TIMER) {
-        mem[addr] = value;
-        return;
-    }
+    addr &= Layout::MEM_MASK;
+    mem[addr] = value;
+    if (code[addr]) uncode(addr);           // predecoded instruction bytes
+    if (addr < Layout::IO_PAGE) return;     // plain RAM
 
-    // Character output (low byte as ASCII)
-    if (addr == IO_OUTPUT_CHAR) {
-        char c = static_cast<char>(value);
-        std::cout << c << std::flush;
-        mem[addr] = value;
-        return;
-    }
+    switch (addr) {
+        // Hypercall trigger (low byte = function ID)
+        case Layout::io(IO_HCALL_CALL):
+            invoke_hypercall(value);
+            break;
 
-    // Default write
-    mem[addr] = value;
+        // Character output (low byte as ASCII)
+        case Layout::io(IO_OUTPUT_CHAR):
+            *out << static_cast<char>(value) << std::flush;
+            break;
+
+        // PMU: control, region markers (low byte = region ID),
+        // name (fires on the high byte of a 16-bit store)
+        case Layout::io(IO_PMU_CTRL):
+            if (value == PMU_CTRL_LATCH) pmu_latch();
+            if (value == PMU_CTRL_CLEAR) pmu.clear_counters();
+            break;
+
+        case Layout::io(IO_PMU_BEGIN):
+            pmu.begin(value);
+            break;
+
+        case Layout::io(IO_PMU_END):
+            pmu.end(value);
+            break;
+
+        case Layout::io(IO_PMU_NAME) + 1:
+            pmu_name();
+            break;
+
+        // Interrupt controller
+        case Layout::io(IO_IRQ_PENDING):
+            irq.clear(value);
+            irq_sync();
+            break;
+
+        case Layout::io(IO_IRQ_MASK):
+            irq.set_mask(value);
+            break;
+
+        case Layout::io(IO_IRQ_RAISE):
+            irq.raise(value);
+            irq_sync();
+            break;
+
+        case Layout::io(IO_IRQ_TIMER_HI) + 1:
+            irq.arm_timer(read16(Layout::io(IO_IRQ_TIMER_LO)) |
+                          (uint32_t)read16(Layout::io(IO_IRQ_TIMER_HI)) << 16);
+            break;
+
+        // Input device
+        case Layout::io(IO_IN_CTRL):
+            input_command(value);
+            break;
+
+        // Extended memory (fires on the high byte of a 16-bit store)
+        case Layout::io(IO_BANK_LO) + 1:
+            bank_select();
+            break;
+
+        default:                    // timer and plain device registers
+            break;
+    }
 }
 
 // ---------------------------------------------
 // Write 16-bit little-endian value
 // ---------------------------------------------
-void Memory::write16(uint16_t addr, uint16_t value) {
+template <class Layout>
+void BasicMemory<Layout>::write16(uint16_t addr, uint16_t value) {
+
+    addr &= Layout::MEM_MASK;
 
     // Numeric output port – print decimal number
-    if (addr == IO_OUTPUT_NUM) {
-        std::cout << std::dec << value << " " << std::flush;
+    if (addr == Layout::io(IO_OUTPUT_NUM)) {
+        *out << std::dec << value << " " << std::flush;
         mem[addr]     = value & 0xFF;
         mem[addr + 1] = (value >> 8) & 0xFF;
         return;
     }
 
     // Character output port – use low byte as char
-    if (addr == IO_OUTPUT_CHAR) {
+    if (addr == Layout::io(IO_OUTPUT_CHAR)) {
         char c = static_cast<char>(value & 0xFF);
-        std::cout << c << std::flush;
+        *out << c << std::flush;
         mem[addr]     = value & 0xFF;
         mem[addr + 1] = (value >> 8) & 0xFF;
         return;
     }
 
-    // Normal RAM write
+    // Normal RAM write; both bytes or neither
+    probe(addr, 2);
     write8(addr,     value & 0xFF);
     write8(addr + 1, (value >> 8) & 0xFF);
 }
 
 // ---------------------------------------------
-// Tick timer – increment timer register
+// True if [addr, addr + len) stays in plain RAM
+// (no wrap-around, no I/O page); addr is masked
+// ---------------------------------------------
+template <class Layout>
+static bool ram_range(uint16_t addr, uint16_t len) {
+    return (uint32_t)addr + len <= Layout::IO_PAGE;
+}
+
+// ---------------------------------------------
+// Block copy (memmove semantics in RAM)
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::copy_block(uint16_t dst, uint16_t src, uint16_t len) {
+    dst &= Layout::MEM_MASK;
+    src &= Layout::MEM_MASK;
+    probe(src, len);
+    probe(dst, len);
+
+    if (ram_range<Layout>(dst, len) && ram_range<Layout>(src, len)) {
+        code_written(dst, len);
+        std::memmove(&mem[dst], &mem[src], len);
+        return;
+    }
+
+    // Slow path: device-aware, byte by byte
+    for (uint16_t i = 0; i < len; i++)
+        write8(dst + i, read8(src + i));
+}
+
+// ---------------------------------------------
+// Block fill
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::fill_block(uint16_t dst, uint8_t value, uint16_t len) {
+    dst &= Layout::MEM_MASK;
+    probe(dst, len);
+
+    if (ram_range<Layout>(dst, len)) {
+        code_written(dst, len);
+        std::memset(&mem[dst], value, len);
+        return;
+    }
+
+    for (uint16_t i = 0; i < len; i++)
+        write8(dst + i, value);
+}
+
+// ---------------------------------------------
+// Print NUL-terminated string
+// ---------------------------------------------
+template <class Layout>
+uint16_t BasicMemory<Layout>::print_string(uint16_t addr) {
+    addr &= Layout::MEM_MASK;
+    if (addr >= Layout::IO_PAGE) return 0;
+
+    const char *p = reinterpret_cast<const char*>(&mem[addr]);
+    const void *nul = std::memchr(p, 0, Layout::IO_PAGE - addr);
+    size_t len = nul ? static_cast<const char*>(nul) - p : Layout::IO_PAGE - addr;
+
+    out->write(p, len);
+    out->flush();
+    return static_cast<uint16_t>(len + (nul != nullptr));
+}
+
+// ---------------------------------------------
+// Print length-prefixed string
+// ---------------------------------------------
+template <class Layout>
+uint16_t BasicMemory<Layout>::print_counted(uint16_t addr) {
+    uint16_t len = read16(addr);
+    uint16_t start = (addr + 2) & Layout::MEM_MASK;
+
+    if (!ram_range<Layout>(start, len)) {
+        if (start >= Layout::IO_PAGE) return 0;
+        len = Layout::IO_PAGE - start;
+    }
+
+    probe(start, len);
+    out->write(reinterpret_cast<const char*>(&mem[start]), len);
+    out->flush();
+    return len;
+}
+
+// ---------------------------------------------
+// Hypercall registration / dispatch
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::register_hypercall(uint8_t id, HyperCall fn) {
+    hypercalls[id] = std::move(fn);
+}
+
+template <class Layout>
+void BasicMemory<Layout>::invoke_hypercall(uint8_t id) {
+    uint16_t status = 0xFFFF;
+
+    if (hypercalls[id]) {
+        HyperCallArgs args;
+        for (int i = 0; i < HCALL_ARGS; i++)
+            args[i] = read16(Layout::io(IO_HCALL_ARG0) + 2 * i);
+
+        status = hypercalls[id](args, *this);
+
+        for (int i = 0; i < HCALL_ARGS; i++)
+            set16(Layout::io(IO_HCALL_ARG0) + 2 * i, args[i]);
+    }
+
+    set16(Layout::io(IO_HCALL_STATUS), status);
+}
+
+// ---------------------------------------------
+// PMU registers
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::pmu_latch() {
+    for (int e = 0; e < PMU_EVENTS; e++) {
+        uint32_t v = static_cast<uint32_t>(pmu.events[e]);
+        for (int i = 0; i < 4; i++)
+            mem[Layout::io(IO_PMU_COUNTERS) + 4 * e + i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+template <class Layout>
+void BasicMemory<Layout>::pmu_name() {
+    static const size_t MAX_NAME = 32;
+    uint16_t addr = read16(Layout::io(IO_PMU_NAME)) & Layout::MEM_MASK;
+    std::string name;
+    while (addr < Layout::IO_PAGE && mem[addr] != 0 && name.size() < MAX_NAME)
+        name += static_cast<char>(mem[addr++]);
+    pmu.name(name);
+}
+
+// ---------------------------------------------
+// Interrupt controller. PENDING in guest memory
+// is refreshed whenever the CPU looks at it.
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::irq_sync() {
+    mem[Layout::io(IO_IRQ_PENDING)] = irq.pending_lines();
+}
+
+template <class Layout>
+int BasicMemory<Layout>::acknowledge_interrupt() {
+    int line = irq.acknowledge();
+    irq_sync();
+    return line;
+}
+
+template <class Layout>
+void BasicMemory<Layout>::wait_for_interrupt() {
+    irq.wait();
+    irq_sync();
+}
+
+// ---------------------------------------------
+// Input device commands
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::set16(uint16_t addr, uint16_t value) {
+    mem[addr]     = value & 0xFF;
+    mem[addr + 1] = (value >> 8) & 0xFF;
+}
+
+template <class Layout>
+void BasicMemory<Layout>::input_command(uint8_t cmd) {
+    size_t count = 0;
+    uint8_t b[2] = { 0, 0 };
+
+    switch (cmd) {
+        case IN_CMD_READ8:
+        case IN_CMD_READ16:
+            count = input.read(b, cmd == IN_CMD_READ8 ? 1 : 2);
+            set16(Layout::io(IO_IN_DATA), count ? b[0] | b[1] << 8 : 0xFFFF);
+            break;
+
+        case IN_CMD_BULK: {
+            uint16_t addr = read16(Layout::io(IO_IN_ADDR)) & Layout::MEM_MASK;
+            uint16_t len = read16(Layout::io(IO_IN_LEN));
+            if (addr >= Layout::IO_PAGE) break;
+            if (!ram_range<Layout>(addr, len)) len = Layout::IO_PAGE - addr;
+            probe(addr, len);
+            code_written(addr, len);
+            count = input.read(&mem[addr], len);
+            break;
+        }
+
+        case IN_CMD_POLL:
+            break;
+
+        default:
+            return;
+    }
+
+    uint16_t status = (input.available() ? IN_READY : 0) |
+                      (input.at_eof() ? IN_EOF : 0) |
+                      (input.failed() ? IN_ERROR : 0);
+    set16(Layout::io(IO_IN_COUNT), static_cast<uint16_t>(count));
+    set16(Layout::io(IO_IN_STATUS), status);
+}
+
+// ---------------------------------------------
+// Guarded backing
+// ---------------------------------------------
+
+// Read the first guarded byte (the host traps there); the range
+// may wrap past 0xFFFF
+template <class Layout>
+void BasicMemory<Layout>::probe_guard(uint16_t addr, uint32_t len) const {
+    uint32_t first = std::min<uint32_t>(len, Layout::MEM_SIZE - addr);
+    int32_t bad = guard->first_guarded(addr, first);
+    if (bad < 0 && len > first) bad = guard->first_guarded(0, len - first);
+    if (bad >= 0) (void)static_cast<const volatile uint8_t *>(mem)[bad];
+}
+template <class Layout>
+bool BasicMemory<Layout>::enable_guard(const GuardConfig &config, std::string &err) {
+    if constexpr (Layout::MEM_SIZE != Layout64K::MEM_SIZE || Layout::IO_PAGE != Layout64K::IO_PAGE) {
+        err = "guarded memory needs the 64 KB layout";
+        return false;
+    }
+    if (banks) {
+        err = "guarded memory cannot be combined with extended memory";
+        return false;
+    }
+    std::unique_ptr<GuardedRam> g(GuardedRam::create(config, code.data(), err));
+    if (!g) return false;
+
+    // Existing contents move over under the guards; predecoded
+    // code is re-marked as it runs
+    g->reset(mem);
+    uint8_t *data = g->data();
+    std::fill(code.begin(), code.end(), 0);
+    code_lo = Layout::MEM_SIZE;
+    code_hi = 0;
+
+    guard = std::move(g);
+    mem = data;
+    ram.clear();
+    ram.shrink_to_fit();
+    return true;
+}
+
+// ---------------------------------------------
+// Extended memory
+// ---------------------------------------------
+template <class Layout>
+bool BasicMemory<Layout>::enable_banks(const BankConfig &config, std::string &err) {
+    if constexpr (Layout::MEM_SIZE != Layout64K::MEM_SIZE || Layout::IO_PAGE != Layout64K::IO_PAGE ||
+                  Layout::STACK_TOP > BANK_WINDOW) {
+        err = "extended memory needs the 64 KB layout";
+        return false;
+    }
+    if (guard) {
+        err = "extended memory cannot be combined with guarded memory";
+        return false;
+    }
+    std::unique_ptr<BankedRam> b(BankedRam::create(config, err));
+    if (!b) return false;
+
+    // RAM around the window moves over; the window is bank 0
+    uint8_t *data = b->data();
+    std::memcpy(data, mem, BANK_WINDOW);
+    std::memcpy(data + BANK_WINDOW + BANK_SIZE, mem + BANK_WINDOW + BANK_SIZE,
+                Layout::MEM_SIZE - BANK_WINDOW - BANK_SIZE);
+    std::fill(code.begin(), code.end(), 0);
+    code_lo = Layout::MEM_SIZE;
+    code_hi = 0;
+
+    banks = std::move(b);
+    mem = data;
+    ram.clear();
+    ram.shrink_to_fit();
+    bank_sync(BANK_OK);
+    return true;
+}
+
+template <class Layout>
+void BasicMemory<Layout>::bank_sync(uint16_t status) {
+    uint32_t count = banks ? banks->count() : 0;
+    uint32_t bank = banks ? banks->current() : 0;
+    set16(Layout::io(IO_BANK_LO), bank & 0xFFFF);
+    set16(Layout::io(IO_BANK_HI), bank >> 16);
+    set16(Layout::io(IO_BANK_COUNT_LO), count & 0xFFFF);
+    set16(Layout::io(IO_BANK_COUNT_HI), count >> 16);
+    set16(Layout::io(IO_BANK_STATUS), status);
+}
+
+template <class Layout>
+void BasicMemory<Layout>::bank_select() {
+    if (!banks) {
+        set16(Layout::io(IO_BANK_STATUS), BANK_NONE);
+        return;
+    }
+    uint32_t bank = read16(Layout::io(IO_BANK_LO)) | (uint32_t)read16(Layout::io(IO_BANK_HI)) << 16;
+    if (bank >= banks->count()) {
+        bank_sync(BANK_RANGE);
+        return;
+    }
+    if (bank == banks->current()) {
+        set16(Layout::io(IO_BANK_STATUS), BANK_OK);
+        return;
+    }
+
+    // Instructions decoded from the old bank
+    code_written(BANK_WINDOW, BANK_SIZE);
+    bank_sync(banks->select(bank) ? BANK_OK : BANK_FAILED);
+}
+
+// Callers may write through the pointer
+template <class Layout>
+uint8_t *BasicMemory<Layout>::ram_ptr(uint16_t addr, uint16_t len) {
+    addr &= Layout::MEM_MASK;
+    if (!ram_range<Layout>(addr, len) || !accessible(addr, len)) return nullptr;
+    code_written(addr, len);
+    return &mem[addr];
+}
+
+// ---------------------------------------------
+// Predecode marks
 // ---------------------------------------------
-void Memory::tick_timer() {
-    mem[IO_TIMER]++;     // simple free-running 8-bit timer
+template <class Layout>
+void BasicMemory<Layout>::mark_decoded(uint16_t pc) {
+    pc &= Layout::MEM_MASK;
+    if ((uint32_t)pc + 5 > Layout::IO_PAGE) return;
+
+    code[pc] |= CODE_START;
+    for (int i = 0; i < 5; i++)
+        if (!guard || !guard->protect_code(pc + i)) code[pc + i] |= CODE_COVER;
+    code_lo = std::min<uint32_t>(code_lo, pc);
+    code_hi = std::max<uint32_t>(code_hi, pc + 4);
+}
+
+// A write to addr stales every instruction that covers it,
+// i.e. any starting in [addr - 4, addr]
+template <class Layout>
+void BasicMemory<Layout>::uncode(uint16_t addr) {
+    for (int i = 0; i < 5 && i <= addr; i++)
+        code[addr - i] &= ~CODE_START;
+    code[addr] &= ~CODE_COVER;
+}
+
+// Bulk writes that bypass write8(); called before the write
+template <class Layout>
+void BasicMemory<Layout>::code_written(uint16_t addr, uint32_t len) {
+    if (guard) guard->open_code(addr, len);
+
+    uint32_t lo = std::max<uint32_t>(addr, code_lo);
+    uint32_t hi = std::min<uint32_t>(addr + len, code_hi + 1);
+    for (uint32_t a = lo; a < hi; a++)
+        if (code[a]) uncode(a);
+}
+
+// ---------------------------------------------
+// Tick timer – increment timer register; one
+// instruction on the virtual interrupt clock
+// ---------------------------------------------
+template <class Layout>
+void BasicMemory<Layout>::tick_timer() {
+    mem[Layout::io(IO_TIMER)]++;     // simple free-running 8-bit timer
+    pmu.events[PMU_INSTRUCTIONS]++;
+    irq.advance();
 }
 
 // ---------------------------------------------
 // Dump memory [start, end]
 // ---------------------------------------------
-void Memory::dump(uint16_t start, uint16_t end) const {
+template <class Layout>
+void BasicMemory<Layout>::dump(uint16_t start, uint16_t end) const {
     std::cout << "\n--- Memory Dump ---\n";
     for (uint16_t addr = start; addr <= end; addr++) {
         std::cout << "0x"
                   << std::hex << std::setw(4) << std::setfill('0') << addr
                   << ": 0x"
-                  << std::setw(2) << (int)mem[addr]
+                  << std::setw(2) << (int)mem[addr & Layout::MEM_MASK]
                   << std::dec << "\n";
     }
 }
+
+template class BasicMemory<Layout64K>;
+template class BasicMemory<Layout4K>;
@@ -3,47 +3,206 @@
 #include <cstdint>      // Provides fixed-size integer types (uint8_t, uint16_t)
 #include <vector>       // Used for implementing RAM storage
 #include <iostream>     // Needed for I/O-mapped output
+#include <array>
+#include <functional>
+#include <memory>
 #include "common.h"     // Contains memory size constants & I/O addresses
+#include "pmu.h"        // Performance monitoring unit (0xFF30)
+#include "interrupts.h" // Interrupt controller (0xFF60)
+#include "input.h"      // Input stream (0xFF80)
+#include "guard.h"      // Page-protected backing for mem
+#include "banks.h"      // Bank-switched backing for mem (0xFF90)
 
 // ===============================================================
 // Memory Class
-// Implements 64 KB of byte-addressable RAM
+// Implements Layout::MEM_SIZE bytes (64 KB for Memory) of
+// byte-addressable RAM; 16-bit addresses are masked with MEM_MASK
 // Also handles memory-mapped I/O (OUTPUT and TIMER registers)
 // ===============================================================
-class Memory {
+template <class Layout>
+class BasicMemory {
+public:
+    // -----------------------------------------------------------
+    // Hypercall handler
+    // args   → the four ARG slots; overwrite them to return results
+    // memory → guest memory, for routines working on buffers
+    // Returns the value placed in IO_HCALL_STATUS (0 = success)
+    // -----------------------------------------------------------
+    using HyperCallArgs = std::array<uint16_t, HCALL_ARGS>;
+    using HyperCall = std::function<uint16_t(HyperCallArgs &args, BasicMemory &memory)>;
+
 private:
     // -----------------------------------------------------------
     // mem[]
-    // Vector representing CPU RAM (size = MEM_SIZE, from common.h)
-    // Each entry is a single byte (uint8_t)
+    // CPU RAM (size = Layout::MEM_SIZE), one byte per entry.
+    // Points into ram, or into the mapping of a GuardedRam or
+    // BankedRam once enable_guard() or enable_banks() has been
+    // called.
+    // -----------------------------------------------------------
+    std::vector<uint8_t> ram;
+    uint8_t *mem;
+    std::unique_ptr<GuardedRam> guard;
+    std::unique_ptr<BankedRam> banks;
+
+    // -----------------------------------------------------------
+    // code[]
+    // Predecode marks, one byte per address: CODE_START where the
+    // CPU holds a validated decoded copy of the instruction,
+    // CODE_COVER on all five of its bytes unless a write-protected
+    // page guards them instead. [code_lo, code_hi] bounds the
+    // marked bytes so reset and block writes stay cheap.
     // -----------------------------------------------------------
-    std::vector<uint8_t> mem;
+    std::vector<uint8_t> code;
+    uint32_t code_lo = Layout::MEM_SIZE, code_hi = 0;
+
+    // Registered hypercalls, indexed by function ID
+    std::vector<HyperCall> hypercalls;
+
+    // Where the output ports and STRPRINT write (std::cout by default)
+    std::ostream *out = &std::cout;
+
+    void invoke_hypercall(uint8_t id);
+    void pmu_latch();
+    void pmu_name();
+    void irq_sync();
+    void input_command(uint8_t cmd);
+    void bank_select();
+    void bank_sync(uint16_t status);
+    void set16(uint16_t addr, uint16_t value);
+    void uncode(uint16_t addr);
+    void probe_guard(uint16_t addr, uint32_t len) const;
+    void code_written(uint16_t addr, uint32_t len);
 
 public:
+    static const uint8_t CODE_START = 1;
+    static const uint8_t CODE_COVER = 2;
+
+    // -----------------------------------------------------------
+    // Performance monitoring unit. The CPU bumps pmu.events as it
+    // executes; guest register writes land here through write8().
+    // -----------------------------------------------------------
+    Pmu pmu;
+
+    // -----------------------------------------------------------
+    // Interrupt controller. Hosts may call irq.raise() from any
+    // thread; the CPU polls it between instructions.
+    // -----------------------------------------------------------
+    InterruptController irq;
+
+    // Next interrupt to take (cleared from PENDING), or -1
+    int acknowledge_interrupt();
+
+    // WFI: block until an enabled interrupt is pending
+    void wait_for_interrupt();
+
+    // -----------------------------------------------------------
+    // Input device source. Open a file, pipe or stdin with
+    // input.open(path, err); it stays attached across reset().
+    // -----------------------------------------------------------
+    InputStream input;
 
     // -----------------------------------------------------------
     // Constructor
     // Initializes RAM and I/O-mapped registers
     // -----------------------------------------------------------
-    Memory();
+    BasicMemory();
+
+    // -----------------------------------------------------------
+    // reset()
+    // Clears RAM, device registers and the PMU back to power-on
+    // state. Hypercalls and the output and input streams are kept.
+    // -----------------------------------------------------------
+    void reset();
+
+    // -----------------------------------------------------------
+    // set_output(stream)
+    // Redirects guest output (number/char ports, STRPRINT*),
+    // e.g. into a std::ostringstream to capture it.
+    // -----------------------------------------------------------
+    void set_output(std::ostream &stream) { out = &stream; }
+
+    // -----------------------------------------------------------
+    // Predecode tracking (see CPU::predecode)
+    // is_decoded(pc): the CPU's decoded copy of pc is current.
+    // mark_decoded(pc): the CPU has just validated and decoded
+    // pc; any later write to its five bytes clears the mark, so
+    // self-modified code is decoded and checked again. Code in
+    // or wrapping into the I/O page is never marked, since device
+    // registers change without a write.
+    // forget_decoded(): clears every mark, as if all code had been
+    // written (the CPU is about to switch decoded tables).
+    // -----------------------------------------------------------
+    bool is_decoded(uint16_t pc) const { return code[pc & Layout::MEM_MASK] & CODE_START; }
+    void mark_decoded(uint16_t pc);
+    void forget_decoded() { code_written(0, Layout::MEM_SIZE); }
+
+    // -----------------------------------------------------------
+    // enable_guard(config, err)
+    // Moves RAM into an mmap'ed block between guard pages (see
+    // GuardedRam). Predecoded code pages become read-only, so
+    // self-modifying stores are caught by the MMU, and configured
+    // unmapped and stack guard pages fault. Only CPU run loops can
+    // turn those faults into guest faults; other accesses to them
+    // abort the process. Contents are kept. False and err if the
+    // host does not allow it (or the layout is not Layout64K).
+    // -----------------------------------------------------------
+    bool enable_guard(const GuardConfig &config, std::string &err);
+    GuardedRam *guarded() const { return guard.get(); }
+
+    // -----------------------------------------------------------
+    // enable_banks(config, err)
+    // Moves RAM into a BankedRam: the guest then sees extended
+    // memory one bank at a time through the window at
+    // BANK_WINDOW, switched by the bank registers at 0xFF90.
+    // Contents outside the window are kept; the window shows
+    // bank 0. Switching drops predecoded code in the window. Not
+    // combined with enable_guard(). False and err if the host
+    // does not allow it (or the layout is not Layout64K).
+    // -----------------------------------------------------------
+    bool enable_banks(const BankConfig &config, std::string &err);
+    BankedRam *banked() const { return banks.get(); }
+
+    // False if [addr, addr + len) touches a guard page
+    bool accessible(uint16_t addr, uint32_t len) const {
+        return !guard || guard->accessible(addr, len);
+    }
+
+    // -----------------------------------------------------------
+    // probe(addr, len)
+    // On guarded memory, an access to [addr, addr + len) (wrapping
+    // at 0xFFFF) that would trap traps here, at its lowest guarded
+    // address, before anything is written. Multi-byte writes and
+    // block operations probe first, so a faulting instruction
+    // leaves memory as it was and FAULT_ADDR is the first bad byte.
+    // -----------------------------------------------------------
+    void probe(uint16_t addr, uint32_t len) const {
+        if (guard) probe_guard(addr, len);
+    }
 
     // -----------------------------------------------------------
     // Read a single byte from memory
-    // addr → 16-bit address (0–65535)
+    // addr → 16-bit address (0–65535, masked to the RAM size)
     // Returns uint8_t value stored at that address
     // -----------------------------------------------------------
     uint8_t read8(uint16_t addr) const;
 
     // -----------------------------------------------------------
     // Read a 16-bit word (little-endian: low byte at addr, high byte at addr+1)
+    // addr+1 wraps to 0x0000 like write16
     // -----------------------------------------------------------
     uint16_t read16(uint16_t addr) const;
 
     // -----------------------------------------------------------
     // Write a single byte to memory
-    // Includes special handling for I/O-mapped ports:
-    //   - 0xFF00 → OUTPUT port (prints to console)
+    // Includes special handling for I/O-mapped ports (Layout64K
+    // addresses; io() moves them on other layouts):
     //   - 0xFF01 → TIMER register
+    //   - 0xFF10 → character OUTPUT port (prints to console)
+    //   - 0xFF2A → hypercall trigger
+    //   - 0xFF30.. → PMU control, region and name registers
+    //   - 0xFF60.. → interrupt controller
+    //   - 0xFF80   → input device command
+    //   - 0xFF90   → bank select
     // -----------------------------------------------------------
     void write8(uint16_t addr, uint8_t value);
 
@@ -52,10 +211,46 @@ public:
     // -----------------------------------------------------------
     void write16(uint16_t addr, uint16_t value);
 
+    // -----------------------------------------------------------
+    // Block operations (MEMCPY / MEMSET)
+    // RAM-only ranges go straight to host memmove/memset.
+    // Ranges that touch the I/O page or wrap past the top fall
+    // back to byte-wise write8() so device side effects still fire.
+    // -----------------------------------------------------------
+    void copy_block(uint16_t dst, uint16_t src, uint16_t len);
+    void fill_block(uint16_t dst, uint8_t value, uint16_t len);
+
+    // -----------------------------------------------------------
+    // String output (STRPRINT / STRPRINTL)
+    // Prints with one buffered write + flush.
+    // print_string: NUL-terminated, stops at the I/O page; returns
+    //   the bytes read, the NUL included
+    // print_counted: 16-bit length word followed by the bytes;
+    //   returns how many bytes after the word were printed
+    // -----------------------------------------------------------
+    uint16_t print_string(uint16_t addr);
+    uint16_t print_counted(uint16_t addr);
+
+    // -----------------------------------------------------------
+    // register_hypercall(id, fn)
+    // Installs (or replaces) the host routine for function ID id.
+    // Pass an empty function to remove it.
+    // -----------------------------------------------------------
+    void register_hypercall(uint8_t id, HyperCall fn);
+
+    // -----------------------------------------------------------
+    // ram_ptr(addr, len)
+    // Direct pointer to [addr, addr + len) if it is plain RAM,
+    // nullptr if it wraps, reaches the I/O page or a guard page.
+    // For host routines that work on whole guest buffers.
+    // -----------------------------------------------------------
+    uint8_t *ram_ptr(uint16_t addr, uint16_t len);
+
     // -----------------------------------------------------------
     // tick_timer()
     // Called by CPU once per instruction cycle
-    // Increments memory[IO_TIMER]
+    // Increments memory[IO_TIMER] and the PMU instruction count,
+    // and advances the virtual interrupt timer (if in use)
     // -----------------------------------------------------------
     void tick_timer();
 
@@ -66,3 +261,5 @@ public:
     // -----------------------------------------------------------
     void dump(uint16_t start, uint16_t end) const;
 };
+
+using Memory = BasicMemory<Layout64K>;
@@ -0,0 +1,137 @@
+#include "pmu.h"
+#include <cstdio>
+
+static const char *EVENT_NAMES[PMU_EVENTS] = {
+    "instructions", "branches", "loads", "stores", "calls", "mmio_writes"
+};
+
+const char *Pmu::event_name(int event) {
+    return EVENT_NAMES[event];
+}
+
+// ---------------------------------------------
+// Region markers
+// ---------------------------------------------
+void Pmu::begin(uint8_t id) {
+    Region &r = regions[id];
+    if (r.depth++ == 0) {
+        for (int e = 0; e < PMU_EVENTS; e++) r.start[e] = events[e];
+        r.entries++;
+    }
+    last_begun = id;
+    any_region = true;
+}
+
+void Pmu::end(uint8_t id) {
+    Region &r = regions[id];
+    if (r.depth == 0) return;
+    if (--r.depth == 0)
+        for (int e = 0; e < PMU_EVENTS; e++) r.total[e] += events[e] - r.start[e];
+}
+
+void Pmu::name(const std::string &text) {
+    regions[last_begun].name = text;
+}
+
+void Pmu::clear_counters() {
+    // Open regions keep measuring from the new zero
+    for (Region &r : regions) {
+        if (r.depth == 0) continue;
+        for (int e = 0; e < PMU_EVENTS; e++) {
+            r.total[e] += events[e] - r.start[e];
+            r.start[e] = 0;
+        }
+    }
+    for (uint64_t &e : events) e = 0;
+}
+
+void Pmu::reset() {
+    for (uint64_t &e : events) e = 0;
+    for (Region &r : regions) r = Region();
+    last_begun = 0;
+    any_region = false;
+}
+
+// ---------------------------------------------
+// Reports
+// ---------------------------------------------
+void Pmu::totals(const Region &r, uint64_t out[PMU_EVENTS]) const {
+    for (int e = 0; e < PMU_EVENTS; e++)
+        out[e] = r.total[e] + (r.depth > 0 ? events[e] - r.start[e] : 0);
+}
+
+std::string Pmu::label(int id) const {
+    return regions[id].name.empty() ? "region " + std::to_string(id) : regions[id].name;
+}
+
+void Pmu::report(std::ostream &out) const {
+    char buf[128];
+    out << "\n--- PMU Regions ---\n";
+    snprintf(buf, sizeof(buf), "%-20s %8s", "region", "entries");
+    out << buf;
+    for (int e = 0; e < PMU_EVENTS; e++) {
+        snprintf(buf, sizeof(buf), " %12s", EVENT_NAMES[e]);
+        out << buf;
+    }
+    out << "\n";
+
+    for (int id = 0; id < PMU_REGIONS; id++) {
+        const Region &r = regions[id];
+        if (r.entries == 0) continue;
+
+        uint64_t t[PMU_EVENTS];
+        totals(r, t);
+        std::string name = label(id) + (r.depth > 0 ? " (open)" : "");
+        snprintf(buf, sizeof(buf), "%-20s %8llu", name.c_str(), (unsigned long long)r.entries);
+        out << buf;
+        for (int e = 0; e < PMU_EVENTS; e++) {
+            snprintf(buf, sizeof(buf), " %12llu", (unsigned long long)t[e]);
+            out << buf;
+        }
+        out << "\n";
+    }
+}
+
+// Names come from guest memory, so escape anything unusual
+static std::string json_string(const std::string &s) {
+    std::string r = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            r += '\\';
+            r += c;
+        } else if (c < 0x20 || c >= 0x7F) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            r += esc;
+        } else {
+            r += c;
+        }
+    }
+    return r + "\"";
+}
+
+void Pmu::report_json(std::ostream &out) const {
+    out << "{\n  \"counters\": {";
+    for (int e = 0; e < PMU_EVENTS; e++)
+        out << (e ? ", " : " ") << "\"" << EVENT_NAMES[e] << "\": " << events[e];
+    out << " },\n  \"regions\": [";
+
+    bool first = true;
+    for (int id = 0; id < PMU_REGIONS; id++) {
+        const Region &r = regions[id];
+        if (r.entries == 0) continue;
+
+        uint64_t t[PMU_EVENTS];
+        totals(r, t);
+        out << (first ? "\n" : ",\n")
+            << "    { \"id\": " << id
+            << ", \"name\": " << json_string(label(id))
+            << ", \"entries\": " << r.entries
+            << ", \"open\": " << (r.depth > 0 ? "true" : "false");
+        for (int e = 0; e < PMU_EVENTS; e++)
+            out << ", \"" << EVENT_NAMES[e] << "\": " << t[e];
+        out << " }";
+        first = false;
+    }
+    out << (first ? "]\n}\n" : "\n  ]\n}\n");
+}
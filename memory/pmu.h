@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "common.h"
+
+// ===============================================================
+// Performance monitoring unit (IO_PMU_* in common.h)
+// Free-running event counters bumped by the interpreter as it
+// executes, plus up to PMU_REGIONS guest-marked regions whose
+// per-event totals the host prints at exit.
+//
+// Counters are 64-bit on the host; the guest sees the low 32 bits
+// of each as a LO/HI word pair after latching them with PMU_CTRL.
+// ===============================================================
+
+enum PmuEvent {
+    PMU_INSTRUCTIONS,   // retired instructions
+    PMU_BRANCHES,       // taken JMP/Jcc, CALL, RET
+    PMU_LOADS,          // LOAD, LOADX, POP
+    PMU_STORES,         // STORE, STOREX, PUSH
+    PMU_CALLS,          // CALL
+    PMU_MMIO_WRITES,    // stores into the I/O page
+    PMU_EVENTS
+};
+
+static_assert(IO_PMU_COUNTERS + 4 * PMU_EVENTS <= IO_FAULT_ADDR, "PMU counter window overlaps FAULT_ADDR");
+
+static const int PMU_REGIONS = 256;
+
+class Pmu {
+public:
+    uint64_t events[PMU_EVENTS] = {};
+
+    // -----------------------------------------------------------
+    // Region markers. begin/end nest per ID (recursion counts the
+    // outermost pair only); end without begin is ignored.
+    // -----------------------------------------------------------
+    void begin(uint8_t id);
+    void end(uint8_t id);
+
+    // Names the region most recently passed to begin()
+    void name(const std::string &text);
+
+    // Zero the counters (PMU_CTRL_CLEAR); regions keep their totals
+    void clear_counters();
+
+    // Back to power-on state: counters and regions
+    void reset();
+
+    // True once the guest has marked any region
+    bool used() const { return any_region; }
+
+    // Per-region totals; regions still open are counted up to now
+    void report(std::ostream &out) const;
+    void report_json(std::ostream &out) const;
+
+    static const char *event_name(int event);
+
+private:
+    struct Region {
+        std::string name;
+        uint64_t entries = 0;
+        uint32_t depth = 0;
+        uint64_t start[PMU_EVENTS] = {};
+        uint64_t total[PMU_EVENTS] = {};
+    };
+
+    std::vector<Region> regions = std::vector<Region>(PMU_REGIONS);
+    uint8_t last_begun = 0;
+    bool any_region = false;
+
+    // Totals including the open part of a running region
+    void totals(const Region &r, uint64_t out[PMU_EVENTS]) const;
+    std::string label(int id) const;
+};
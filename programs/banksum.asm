@@ -0,0 +1,45 @@
+; =============================================================
+; BANKSUM — 32-bit sum of every word in extended memory
+; (bank registers at 0xFF90, window at 0xA000, see docs/ISA.md)
+;
+;   ./emulator -X file=data.bin banksum.bin
+;
+; Maps each 16 KB bank into the window in turn and adds up its
+; 8192 words. Prints the bank count, then the sum as high and
+; low words. Handles up to 65535 banks (1 GB).
+; =============================================================
+
+        LOAD R5, [0xFF94]       ; COUNT_LO
+        CMPI R5, 0
+        JZ none
+        MOVI R4, 0              ; R4 = bank
+        MOVI R2, 0              ; R2 = sum, low word
+        MOVI R3, 0              ; R3 = sum, high word
+
+bank:   STORE R4, [0xFF90]      ; BANK_LO: map it
+        MOVI R0, 0xA000         ; R0 = cursor, R1 = words left
+        MOVI R1, 8192
+word:   LOAD R5, [R0]
+        ADD R2, R5
+        JNC next
+        ADDI R3, 1
+next:   ADDI R0, 2
+        SUBI R1, 1
+        JNZ word
+
+        ADDI R4, 1
+        LOAD R5, [0xFF94]
+        CMP R4, R5
+        JNZ bank
+
+        STORE R5, [0xFF00]
+        STORE R3, [0xFF00]
+        STORE R2, [0xFF00]
+        HALT
+
+none:   MOVI R0, message
+        STRPRINT R0
+        HALT
+
+message:
+        .asciz "no extended memory (run with -X)\n"
@@ -0,0 +1,42 @@
+; =============================================================
+; BUSY POLL — waits for timer ticks without WFI (0xFF60)
+;
+; Arms the interval timer at 200 us and spins on a counter the
+; handler bumps, never sleeping. Prints 5 once five ticks have
+; arrived, then stops the timer and halts. Under a virtual timer
+; (emud, the fuzzer, lockstep, binopt) the period is 200
+; instructions, so this only ends if every instruction the spin
+; loop retires advances that clock.
+; =============================================================
+
+        MOVI R0, on_timer
+        STORE R0, [0xFF70]      ; vector for line 0 (timer)
+        MOVI R0, 1
+        STORE R0, [0xFF62]      ; MASK: timer only
+
+        MOVI R0, 200            ; 200 us
+        STORE R0, [0xFF66]      ; TIMER LO
+        MOVI R0, 0
+        STORE R0, [0xFF68]      ; TIMER HI, arms it
+        EI
+
+spin:   LOAD R1, [ticks]
+        CMPI R1, 5
+        JNZ spin
+
+        DI
+        STORE R1, [0xFF00]
+        MOVI R0, 0
+        STORE R0, [0xFF68]      ; period 0 stops the timer
+        HALT
+
+; Timer handler: ticks++ (preserves R0 and the flags via IRET)
+on_timer:
+        PUSH R0
+        LOAD R0, [ticks]
+        ADDI R0, 1
+        STORE R0, [ticks]
+        POP R0
+        IRET
+
+ticks:  .word 0
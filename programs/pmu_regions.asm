@@ -0,0 +1,63 @@
+; =============================================================
+; PMU REGIONS — measures two sections of code with the
+; performance monitoring unit (0xFF30, see docs/ISA.md)
+;
+;   region 1 "sum"   : loop adding 1..100
+;   region 2 "fact"  : recursive 6!
+;
+; Prints both results, then the instruction count read back
+; from the latched counter window. The emulator prints the
+; per-region totals after the register and memory dumps.
+; =============================================================
+
+        ; ---- region 1: sum 1..100 ----
+        MOVI R0, 1
+        STORE R0, [0xFF32]      ; BEGIN 1
+        MOVI R0, sum_name
+        STORE R0, [0xFF36]      ; NAME
+
+        MOVI R1, 0
+        MOVI R2, 100
+sum:    ADD R1, R2
+        SUBI R2, 1
+        JNZ sum
+
+        MOVI R0, 1
+        STORE R0, [0xFF34]      ; END 1
+        STORE R1, [0xFF00]
+
+        ; ---- region 2: 6! ----
+        MOVI R0, 2
+        STORE R0, [0xFF32]      ; BEGIN 2
+        MOVI R0, fact_name
+        STORE R0, [0xFF36]      ; NAME
+
+        MOVI R0, 6
+        CALL fact
+
+        MOVI R1, 2
+        STORE R1, [0xFF34]      ; END 2
+        STORE R0, [0xFF00]
+
+        ; ---- latch and print the low word of the instruction count ----
+        MOVI R0, 1
+        STORE R0, [0xFF30]
+        LOAD R0, [0xFF40]
+        STORE R0, [0xFF00]
+        HALT
+
+; R0 = R0! (R0 >= 0)
+fact:   CMPI R0, 0
+        JNZ fact_rec
+        MOVI R0, 1
+        RET
+fact_rec:
+        PUSH R0
+        SUBI R0, 1
+        CALL fact
+        POP R1
+        MUL R0, R1
+        RET
+
+sum_name:  .asciz "sum"
+fact_name: .asciz "fact"
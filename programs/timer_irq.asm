@@ -0,0 +1,41 @@
+; =============================================================
+; TIMER IRQ — interrupt-driven idle loop (0xFF60, see docs/ISA.md)
+;
+; Arms the interval timer at 100 ms and sleeps in WFI between
+; ticks; the handler counts them. Prints 1..10, one per tick,
+; then stops the timer and halts. The host thread is asleep for
+; nearly the whole second this takes.
+; =============================================================
+
+        MOVI R0, on_timer
+        STORE R0, [0xFF70]      ; vector for line 0 (timer)
+        MOVI R0, 1
+        STORE R0, [0xFF62]      ; MASK: timer only
+
+        MOVI R0, 0x86A0         ; 100000 us = 0x000186A0
+        STORE R0, [0xFF66]      ; TIMER LO
+        MOVI R0, 0x0001
+        STORE R0, [0xFF68]      ; TIMER HI, arms it
+        EI
+
+idle:   WFI
+        LOAD R1, [ticks]
+        STORE R1, [0xFF00]
+        CMPI R1, 10
+        JNZ idle
+
+        DI
+        MOVI R0, 0
+        STORE R0, [0xFF68]      ; period 0 stops the timer
+        HALT
+
+; Timer handler: ticks++ (preserves R0 and the flags via IRET)
+on_timer:
+        PUSH R0
+        LOAD R0, [ticks]
+        ADDI R0, 1
+        STORE R0, [ticks]
+        POP R0
+        IRET
+
+ticks:  .word 0
@@ -0,0 +1,43 @@
+; =============================================================
+; WC — counts lines and bytes of the input stream
+; (input device at 0xFF80, see docs/ISA.md)
+;
+;   ./emulator -i file.txt wc.bin      or      ... | ./emulator -i - wc.bin
+;
+; Reads in 4 KB bulk transfers into a buffer at 0x4000 and
+; prints the line count, then the byte count as high and low
+; words.
+; =============================================================
+
+        MOVI R0, 0x4000
+        STORE R0, [0xFF84]      ; ADDR
+        MOVI R0, 4096
+        STORE R0, [0xFF86]      ; LEN
+        MOVI R3, 0              ; lines
+        MOVI R4, 0              ; bytes, low word
+        MOVI R5, 0              ; bytes, high word
+
+chunk:  MOVI R0, 3
+        STORE R0, [0xFF80]      ; BULK
+        LOAD R0, [0xFF88]       ; COUNT, 0 at end of input
+        CMPI R0, 0
+        JZ done
+        ADD R4, R0
+        JNC scan
+        ADDI R5, 1
+
+scan:   MOVI R1, 0x4000         ; R1 = cursor, R0 = bytes left
+byte:   LOAD R2, [R1]
+        ANDI R2, 0xFF
+        CMPI R2, 10
+        JNZ other
+        ADDI R3, 1
+other:  ADDI R1, 1
+        SUBI R0, 1
+        JNZ byte
+        JMP chunk
+
+done:   STORE R3, [0xFF00]
+        STORE R5, [0xFF00]
+        STORE R4, [0xFF00]
+        HALT
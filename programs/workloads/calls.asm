@@ -0,0 +1,36 @@
+; =============================================================
+; CALLS — naive recursive Fibonacci
+; fib(SIZE) with one CALL per node of the recursion tree and
+; callee-saved registers on the stack, the way compiled code
+; does it. Prints fib(SIZE) modulo 65536 and the number of calls.
+; SIZE: 0 .. 24; the runner patches the word at SIZE.
+; =============================================================
+
+        LOAD R0, [SIZE]
+        MOVI R5, 0              ; R5 = calls
+        CALL fib
+        STORE R0, [0xFF00]
+        STORE R5, [0xFF00]
+        HALT
+
+; -------------------------------------------------------------
+; fib(R0) → R0. Keeps R1–R4; counts calls in R5.
+; -------------------------------------------------------------
+fib:    ADDI R5, 1
+        CMPI R0, 2
+        JC base                 ; n < 2
+        PUSH R1
+        PUSH R0
+        SUBI R0, 1
+        CALL fib
+        MOV  R1, R0             ; R1 = fib(n - 1)
+        POP  R0
+        PUSH R1
+        SUBI R0, 2
+        CALL fib
+        POP  R1
+        ADD  R0, R1
+        POP  R1
+base:   RET
+
+SIZE:   .word 18
@@ -0,0 +1,66 @@
+; =============================================================
+; MEMCPY — block copies against a word-at-a-time copy loop
+; Fills SIZE bytes at 0x1000 from a 16-bit LCG, then for 32
+; rounds k = 32..1: MEMCPY the buffer from offset (6k & 62) to
+; 0x4000, MEMSET the tail it left with k, and copy it back word
+; by word adding k. Prints a rolling hash (h = h*31 + w) of the
+; final buffer.
+; SIZE: 64 .. 12000 bytes, even; the runner patches the word at
+; SIZE.
+; =============================================================
+
+        LOAD R5, [SIZE]         ; R5 = n
+        MOVI R0, 0x1000
+        MOV  R1, R5
+        DIVI R1, 2              ; R1 = words left
+        MOVI R2, 99             ; R2 = LCG state
+fill:   MULI R2, 25173
+        ADDI R2, 13849
+        STORE R2, [R0]
+        ADDI R0, 2
+        SUBI R1, 1
+        JNZ fill
+
+        MOVI R4, 32             ; R4 = k
+round:  MOV  R3, R4
+        MULI R3, 6
+        ANDI R3, 62             ; R3 = offset
+        MOVI R0, 0x4000
+        MOVI R1, 0x1000
+        ADD  R1, R3
+        MOV  R2, R5
+        SUB  R2, R3             ; R2 = n - offset
+        MEMCPY R0, R1, R2
+        ADD  R0, R2
+        MEMSET R0, R4, R3       ; the last offset bytes = k
+
+        MOVI R0, 0x4000
+        MOVI R1, 0x1000
+        MOV  R2, R5
+        DIVI R2, 2
+back:   LOAD R3, [R0]
+        ADD  R3, R4
+        STORE R3, [R1]
+        ADDI R0, 2
+        ADDI R1, 2
+        SUBI R2, 1
+        JNZ back
+
+        SUBI R4, 1
+        JNZ round
+
+        MOVI R0, 0x1000
+        MOV  R1, R5
+        DIVI R1, 2
+        MOVI R2, 0
+hash:   LOAD R3, [R0]
+        MULI R2, 31
+        ADD  R2, R3
+        ADDI R0, 2
+        SUBI R1, 1
+        JNZ hash
+
+        STORE R2, [0xFF00]
+        HALT
+
+SIZE:   .word 4096
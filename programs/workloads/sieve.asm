@@ -0,0 +1,57 @@
+; =============================================================
+; SIEVE — primes below SIZE by the sieve of Eratosthenes
+; One word per number at 0x1000 (MEMSET marks them all as
+; candidates); prints the number of primes, their sum modulo
+; 65536 and the largest one.
+; SIZE: 3 .. 12000; the runner patches the word at SIZE.
+; =============================================================
+
+        LOAD R5, [SIZE]         ; R5 = n
+        MOVI R0, 0x1000
+        MOVI R1, 1
+        MOV  R2, R5
+        ADD  R2, R2
+        MEMSET R0, R1, R2       ; every word 0x0101: candidate
+
+        MOVI R0, 2              ; R0 = p
+        MOVI R3, 0              ; R3 = primes found
+        MOVI R4, 0              ; R4 = 0, stored to strike
+next:   CMP  R0, R5
+        JNC done                ; p >= n
+        MOV  R1, R0
+        ADD  R1, R1
+        LOAD R2, [R1+0x1000]
+        CMPI R2, 0
+        JZ skip
+
+        ADDI R3, 1              ; p is prime
+        LOAD R2, [SUM]
+        ADD  R2, R0
+        STORE R2, [SUM]
+        STORE R0, [LAST]
+
+        MOV  R1, R0             ; R1 = m, from p*p
+        MUL  R1, R0
+        JC skip
+        CMP  R1, R5
+        JNC skip
+strike: MOV  R2, R1
+        ADD  R2, R2
+        STORE R4, [R2+0x1000]
+        ADD  R1, R0
+        CMP  R1, R5
+        JC strike               ; while m < n
+
+skip:   ADDI R0, 1
+        JMP next
+
+done:   STORE R3, [0xFF00]
+        LOAD R0, [SUM]
+        STORE R0, [0xFF00]
+        LOAD R0, [LAST]
+        STORE R0, [0xFF00]
+        HALT
+
+SUM:    .word 0
+LAST:   .word 0
+SIZE:   .word 1000
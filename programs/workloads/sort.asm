@@ -0,0 +1,66 @@
+; =============================================================
+; SORT — insertion sort of SIZE pseudo-random words
+; Fills an array at 0x1000 from a 16-bit LCG (x = x*25173 +
+; 13849), sorts it in place (unsigned) and prints the smallest
+; and largest element, a rolling hash of the sorted array
+; (h = h*31 + a[i]) and the number of out-of-order pairs (0).
+; SIZE: 2 .. 12000 words; the runner patches the word at SIZE.
+; =============================================================
+
+        LOAD R5, [SIZE]         ; R5 = n
+
+        MOVI R0, 0x1000         ; R0 = cursor, R1 = left
+        MOV  R1, R5
+        MOVI R2, 12345          ; R2 = LCG state
+fill:   MULI R2, 25173
+        ADDI R2, 13849
+        STORE R2, [R0]
+        ADDI R0, 2
+        SUBI R1, 1
+        JNZ fill
+
+; ---- a[1..n) inserted one at a time --------------------------
+        MOVI R0, 0x1002         ; R0 = &a[i]
+        MOV  R1, R5
+        SUBI R1, 1              ; R1 = elements left
+outer:  LOAD R2, [R0]           ; R2 = key
+        MOV  R3, R0             ; R3 = &a[j + 1]
+inner:  CMPI R3, 0x1000
+        JZ place
+        LOAD R4, [R3-2]
+        CMP  R2, R4             ; key < a[j]: shift a[j] up
+        JNC place
+        STORE R4, [R3]
+        SUBI R3, 2
+        JMP inner
+place:  STORE R2, [R3]
+        ADDI R0, 2
+        SUBI R1, 1
+        JNZ outer
+
+; ---- check and hash ------------------------------------------
+        MOVI R0, 0x1000
+        MOV  R1, R5
+        MOVI R2, 0              ; R2 = hash
+        MOVI R3, 0              ; R3 = out-of-order pairs
+        MOVI R4, 0              ; R4 = previous element
+check:  LOAD R5, [R0]
+        CMP  R5, R4
+        JNC ordered
+        ADDI R3, 1
+ordered:
+        MULI R2, 31
+        ADD  R2, R5
+        MOV  R4, R5
+        ADDI R0, 2
+        SUBI R1, 1
+        JNZ check
+
+        LOAD R0, [0x1000]
+        STORE R0, [0xFF00]      ; smallest
+        STORE R4, [0xFF00]      ; largest
+        STORE R2, [0xFF00]
+        STORE R3, [0xFF00]
+        HALT
+
+SIZE:   .word 1000
@@ -0,0 +1,91 @@
+; =============================================================
+; STRINGS — byte-at-a-time text processing
+; Generates SIZE bytes of lowercase words and spaces at 0x1000
+; (NUL-terminated, from a 16-bit LCG), counts the words and
+; hashes the text (h = h*33 ^ c), copies it to 0x4000 with the
+; first letter of every word capitalized, then measures and
+; hashes the copy. Prints length, words and both hashes.
+; SIZE: 1 .. 12000 bytes; the runner patches the word at SIZE.
+; =============================================================
+
+        LOAD R5, [SIZE]         ; R5 = n
+        MOVI R0, 0x1000         ; R0 = cursor, R1 = left
+        MOV  R1, R5
+        MOVI R2, 777            ; R2 = LCG state
+gen:    MULI R2, 25173
+        ADDI R2, 13849
+        MOV  R3, R2
+        DIVI R3, 256
+        MODI R3, 32
+        CMPI R3, 26
+        JC letter
+        MOVI R3, 32             ; 6 in 32 are spaces
+        JMP put
+letter: ADDI R3, 97
+put:    STORE R3, [R0]          ; high byte: NUL until the next store
+        ADDI R0, 1
+        SUBI R1, 1
+        JNZ gen
+
+; ---- count words, hash ---------------------------------------
+        MOVI R0, 0x1000
+        MOVI R1, 0              ; R1 = words
+        MOVI R2, 5381           ; R2 = hash
+        MOVI R4, 32             ; R4 = previous byte
+scan:   LOAD R3, [R0]
+        ANDI R3, 0xFF
+        CMPI R3, 0
+        JZ scanned
+        MULI R2, 33
+        XOR  R2, R3
+        CMPI R4, 32
+        JNZ inword
+        CMPI R3, 32
+        JZ inword
+        ADDI R1, 1              ; space → letter
+inword: MOV  R4, R3
+        ADDI R0, 1
+        JMP scan
+scanned:
+        STORE R1, [WORDS]
+
+; ---- capitalizing copy ---------------------------------------
+        MOVI R0, 0x1000
+        MOVI R1, 0x4000
+        MOVI R4, 32
+copy:   LOAD R3, [R0]
+        ANDI R3, 0xFF
+        CMPI R4, 32
+        JNZ keep
+        CMPI R3, 97
+        JC keep                 ; not a lowercase letter
+        SUBI R3, 32
+keep:   STORE R3, [R1]
+        MOV  R4, R3
+        ADDI R0, 1
+        ADDI R1, 1
+        CMPI R3, 0
+        JNZ copy
+
+; ---- strlen and hash of the copy -----------------------------
+        MOVI R0, 0x4000
+        MOVI R5, 5381
+len:    LOAD R3, [R0]
+        ANDI R3, 0xFF
+        CMPI R3, 0
+        JZ measured
+        MULI R5, 33
+        XOR  R5, R3
+        ADDI R0, 1
+        JMP len
+measured:
+        SUBI R0, 0x4000
+        STORE R0, [0xFF00]      ; length
+        LOAD R1, [WORDS]
+        STORE R1, [0xFF00]
+        STORE R2, [0xFF00]
+        STORE R5, [0xFF00]
+        HALT
+
+WORDS:  .word 0
+SIZE:   .word 1000
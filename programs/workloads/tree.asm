@@ -0,0 +1,119 @@
+; =============================================================
+; TREE — binary search tree built, walked and searched
+; Inserts SIZE distinct keys from a 16-bit LCG into a BST of
+; 6-byte nodes (key, left, right) at 0x1000, walks it in order
+; with a recursive CALL per node (counting nodes, hashing keys
+; as h = h*31 + key and tracking the depth), then looks every
+; key up again. Prints count, hash, depth and lookup steps.
+; SIZE: 1 .. 3000 nodes; the runner patches the word at SIZE.
+; =============================================================
+
+        LOAD R5, [SIZE]         ; R5 = n
+        MOVI R0, 0x1000         ; R0 = next free node
+        MOVI R2, 4242           ; R2 = LCG state
+insert: MULI R2, 25173
+        ADDI R2, 13849
+        STORE R2, [R0]
+        MOVI R1, 0
+        STORE R1, [R0+2]
+        STORE R1, [R0+4]
+        LOAD R1, [ROOT]
+        CMPI R1, 0
+        JNZ descend
+        STORE R0, [ROOT]
+        JMP inserted
+descend:
+        LOAD R3, [R1]
+        CMP  R2, R3             ; smaller keys go left
+        JNC right
+        LOAD R3, [R1+2]
+        CMPI R3, 0
+        JZ setleft
+        MOV  R1, R3
+        JMP descend
+setleft:
+        STORE R0, [R1+2]
+        JMP inserted
+right:  LOAD R3, [R1+4]
+        CMPI R3, 0
+        JZ setright
+        MOV  R1, R3
+        JMP descend
+setright:
+        STORE R0, [R1+4]
+inserted:
+        ADDI R0, 6
+        SUBI R5, 1
+        JNZ insert
+
+        LOAD R0, [ROOT]
+        MOVI R1, 1
+        CALL walk
+
+; ---- look every key up again ---------------------------------
+        LOAD R5, [SIZE]
+        MOVI R2, 4242
+        MOVI R4, 0              ; R4 = nodes visited
+lookup: MULI R2, 25173
+        ADDI R2, 13849
+        LOAD R1, [ROOT]
+find:   ADDI R4, 1
+        LOAD R3, [R1]
+        CMP  R2, R3
+        JZ found
+        JNC goright
+        LOAD R1, [R1+2]
+        JMP find
+goright:
+        LOAD R1, [R1+4]
+        JMP find
+found:  SUBI R5, 1
+        JNZ lookup
+
+        LOAD R0, [COUNT]
+        STORE R0, [0xFF00]
+        LOAD R0, [HASH]
+        STORE R0, [0xFF00]
+        LOAD R0, [DEPTH]
+        STORE R0, [0xFF00]
+        STORE R4, [0xFF00]
+        HALT
+
+; -------------------------------------------------------------
+; walk(R0 = node, R1 = depth): in-order visit of the subtree.
+; Keeps R1; clobbers R0, R2, R3.
+; -------------------------------------------------------------
+walk:   CMPI R0, 0
+        JZ leaf
+        LOAD R2, [DEPTH]
+        CMP  R2, R1
+        JNC shallower
+        STORE R1, [DEPTH]
+shallower:
+        PUSH R0
+        LOAD R0, [R0+2]
+        ADDI R1, 1
+        CALL walk
+        SUBI R1, 1
+        POP  R0
+
+        LOAD R2, [HASH]
+        MULI R2, 31
+        LOAD R3, [R0]
+        ADD  R2, R3
+        STORE R2, [HASH]
+        LOAD R2, [COUNT]
+        ADDI R2, 1
+        STORE R2, [COUNT]
+
+        LOAD R0, [R0+4]
+        ADDI R1, 1
+        CALL walk
+        SUBI R1, 1
+leaf:   RET
+
+ROOT:   .word 0
+COUNT:  .word 0
+HASH:   .word 0
+DEPTH:  .word 0
+SIZE:   .word 1000
@@ -0,0 +1,3 @@
+; ADDI R2, [R1] used to assemble as ADDI R2, 0
+        ADDI R2, [R1]
+        HALT
@@ -0,0 +1,4 @@
+; Only LOAD and STORE take a [..] operand: an immediate
+; instruction must reject it rather than drop the base register
+        MOVI R0, [R1+4]
+        HALT
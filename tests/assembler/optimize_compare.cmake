@@ -0,0 +1,40 @@
+# ================================================================
+# optimize_compare.cmake – the -O pass must not change behaviour
+# Assembles PROGRAM with and without -O, runs both images on the
+# emulator and fails unless the guest output (everything before
+# the register dump) is the same and the program halted.
+#
+#   cmake -DASSEMBLER=... -DEMULATOR=... -DPROGRAM=x.asm
+#         -DWORK_DIR=dir [-DEMU_ARGS=-i|input.txt] -P optimize_compare.cmake
+#
+# EMU_ARGS separates emulator arguments with '|'.
+# ================================================================
+
+string(REPLACE "|" ";" emu_args "${EMU_ARGS}")
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+foreach(mode plain optimized)
+    set(flags)
+    if(mode STREQUAL "optimized")
+        set(flags -O)
+    endif()
+
+    execute_process(COMMAND ${ASSEMBLER} ${flags} ${PROGRAM} ${WORK_DIR}/${mode}.bin
+                    RESULT_VARIABLE rc OUTPUT_VARIABLE log ERROR_VARIABLE log)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "${mode}: assembly failed:\n${log}")
+    endif()
+
+    execute_process(COMMAND ${EMULATOR} ${emu_args} ${WORK_DIR}/${mode}.bin
+                    RESULT_VARIABLE rc OUTPUT_VARIABLE out ERROR_VARIABLE err)
+    string(FIND "${out}" "---- Register Dump ----" cut)
+    if(NOT rc EQUAL 0 OR cut EQUAL -1 OR NOT out MATCHES "CPU HALTED")
+        message(FATAL_ERROR "${mode}: did not halt (exit ${rc}):\n${out}${err}")
+    endif()
+    string(SUBSTRING "${out}" 0 ${cut} output_${mode})
+endforeach()
+
+if(NOT output_plain STREQUAL output_optimized)
+    message(FATAL_ERROR "output differs with -O\n"
+                        "--- plain:\n${output_plain}\n--- -O:\n${output_optimized}")
+endif()
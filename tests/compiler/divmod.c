@@ -0,0 +1,13 @@
+/* Division and remainder truncate toward zero for every sign */
+int n[4] = {17, -17, 17, -17};
+int d[4] = {5, 5, -5, -5};
+
+int main(void) {
+    int i;
+    unsigned u = 65000;
+    for (i = 0; i < 4; i++)
+        printf("%d/%d=%d %d%%%d=%d\n", n[i], d[i], n[i] / d[i], n[i], d[i], n[i] % d[i]);
+    printf("%u %u %u\n", u / 7, u % 7, u % 16);
+    printf("%d %d\n", -32767 / 2, -100 % 8);
+    return 0;
+}
@@ -0,0 +1,31 @@
+/* Invariant work inside loops: run once before the loop, same result */
+int a[16];
+
+int fill(int w, int h, int count) {
+    int i = 0;
+    int total = 0;
+    int scale;
+    int off;
+    while (i < count) {
+        scale = w * h;
+        off = scale + a[15];
+        a[i] = off + i;
+        total = total + a[i];
+        i++;
+    }
+    return total;
+}
+
+int main(void) {
+    int k = 10;
+    int n = 0;
+    int r;
+    int t;
+    int s = 0;
+    for (r = 0; r < 3; r++) {
+        t = k * 4 + n;
+        s = s + t;
+    }
+    printf("%d %d %d\n", s, fill(3, 4, 16), fill(2, 5, 0));
+    return 0;
+}
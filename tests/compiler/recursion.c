@@ -0,0 +1,23 @@
+/* Recursion through the SP-relative frame, with callee-saved homes */
+int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+int ackermann(int m, int n) {
+    if (m == 0) return n + 1;
+    if (n == 0) return ackermann(m - 1, 1);
+    return ackermann(m - 1, ackermann(m, n - 1));
+}
+
+int sum_to(int n) {
+    int rest;
+    if (n == 0) return 0;
+    rest = sum_to(n - 1);
+    return n + rest;
+}
+
+int main(void) {
+    printf("%d %d %d\n", fib(15), ackermann(2, 3), sum_to(100));
+    return 0;
+}
@@ -0,0 +1,52 @@
+# ================================================================
+# run_c.cmake – compile, assemble and run one C test program
+# Builds SOURCE with the optimizer on and with -O0, runs both
+# images on the emulator and fails unless each prints exactly
+# the contents of EXPECTED and halts. With HOISTED=N the
+# optimized build must also report N loop invariants hoisted.
+#
+#   cmake -DCOMPILER=... -DASSEMBLER=... -DEMULATOR=...
+#         -DSOURCE=x.c -DEXPECTED=x.expected -DWORK_DIR=dir
+#         [-DHOISTED=N] -P run_c.cmake
+# ================================================================
+
+file(READ ${EXPECTED} expected)
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+foreach(mode optimized O0)
+    set(flags -v)
+    if(mode STREQUAL "O0")
+        set(flags -O0)
+    endif()
+
+    execute_process(COMMAND ${COMPILER} ${flags} ${SOURCE} ${WORK_DIR}/${mode}.asm
+                    RESULT_VARIABLE rc OUTPUT_VARIABLE report ERROR_VARIABLE log)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "${mode}: compilation failed:\n${log}")
+    endif()
+    if(mode STREQUAL "optimized" AND DEFINED HOISTED AND
+       NOT report MATCHES "loop invariants hoisted: +${HOISTED}\n")
+        message(FATAL_ERROR "expected ${HOISTED} loop invariants hoisted:\n${report}")
+    endif()
+
+    execute_process(COMMAND ${ASSEMBLER} ${WORK_DIR}/${mode}.asm ${WORK_DIR}/${mode}.bin
+                    RESULT_VARIABLE rc OUTPUT_VARIABLE log ERROR_VARIABLE log)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "${mode}: assembly failed:\n${log}")
+    endif()
+
+    execute_process(COMMAND ${EMULATOR} ${WORK_DIR}/${mode}.bin
+                    RESULT_VARIABLE rc OUTPUT_VARIABLE out ERROR_VARIABLE err)
+    string(FIND "${out}" "Starting CPU...\n\n" begin)
+    string(FIND "${out}" "\nCPU HALTED." end)
+    if(NOT rc EQUAL 0 OR begin EQUAL -1 OR end EQUAL -1)
+        message(FATAL_ERROR "${mode}: did not halt (exit ${rc}):\n${out}${err}")
+    endif()
+    math(EXPR begin "${begin} + 17")
+    math(EXPR length "${end} - ${begin}")
+    string(SUBSTRING "${out}" ${begin} ${length} output)
+
+    if(NOT output STREQUAL expected)
+        message(FATAL_ERROR "${mode}: wrong output\n--- expected:\n${expected}--- got:\n${output}")
+    endif()
+endforeach()
@@ -0,0 +1,18 @@
+/* Signed compares are lowered onto the unsigned hardware flags */
+int v[6] = {-32768, -300, -1, 0, 1, 32767};
+
+int less(int a, int b) { return a < b; }
+
+int main(void) {
+    int i;
+    int j;
+    unsigned big = 40000;
+    unsigned small = 3;
+    for (i = 0; i < 6; i++) {
+        for (j = 0; j < 6; j++)
+            printf("%d", less(v[i], v[j]) + (v[i] >= v[j]) * 2);
+        printf("\n");
+    }
+    printf("%d %d %d\n", big > small, v[2] < v[4], v[0] > v[5]);
+    return 0;
+}
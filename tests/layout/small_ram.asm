@@ -0,0 +1,44 @@
+; =============================================================
+; SMALL RAM — runs on Layout4K (common.h): 4 KB of RAM mirrored
+; through the address space, devices at 0x0F00, stack from
+; 0x0800, registers R0-R3. tests/layout/small_ram.cpp checks
+; the output and the final state.
+; =============================================================
+
+        MOVI R0, 42
+        STORE R0, [0x0F00]      ; number port
+        MOVI R1, 7
+        STORE R1, [0x1200]      ; 0x0200 seen through the mirror
+        LOAD R2, [0x0200]
+        STORE R2, [0x0F00]
+
+        CALL square             ; return PC pushed at 0x07FE
+        STORE R0, [0x0F00]
+
+        MOVI R0, message
+        STRPRINT R0
+
+        MOVI R0, 300            ; MUL32: 300 * 300 = 0x00015F90
+        STORE R0, [0x0F20]
+        STORE R0, [0x0F22]
+        MOVI R0, 1
+        STORE R0, [0x0F2A]
+        LOAD R3, [0x0F22]       ; high word
+        STORE R3, [0x0F00]
+
+        MOVI R0, on_fault
+        STORE R0, [0x0F6A]      ; FAULT_VECTOR
+bad:    MOV R0, R5              ; no R5 here: register fault
+        HALT
+
+on_fault:
+        LOAD R0, [0x0F6E]       ; FAULT_CAUSE
+        STORE R0, [0x0F00]
+        HALT
+
+square: MUL R1, R1
+        MOV R0, R1
+        RET
+
+message:
+        .asciz "4K "
@@ -0,0 +1,82 @@
+// ========================================================
+// small_ram.cpp – runs small_ram.asm on BasicCPU<Layout4K>
+// Checks the guest output and final state on the reference
+// path (step()) and the predecoded path (run_for()), and
+// that the 64 KB machine does not reuse the 4 KB machine's
+// decoded image. Exit status 1 on any mismatch.
+//
+// Usage: ./layout_small_ram small_ram.asm
+// ========================================================
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "assembler.h"
+#include "cpu.h"
+
+static int failures = 0;
+
+static void check(bool ok, const std::string &what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+// One run; reference = step() one instruction at a time
+static void run(const std::vector<uint8_t> &image, uint16_t bad_pc, bool reference) {
+    const char *engine = reference ? "step: " : "run: ";
+    BasicCPU<Layout4K> cpu;
+    std::ostringstream out;
+    cpu.memory.set_output(out);
+    cpu.load_program(image, 0);
+
+    if (reference) {
+        for (int i = 0; i < 1000 && !cpu.halted; i++) {
+            cpu.step();
+            cpu.memory.tick_timer();
+            cpu.poll_interrupt();
+        }
+    } else {
+        cpu.run_for(1000);
+    }
+
+    check(cpu.halted && cpu.fault == FAULT_NONE, engine + std::string("halts normally"));
+    check(out.str() == "42 7 49 4K 1 2 ", engine + ("output \"" + out.str() + "\""));
+    check(cpu.regs.SP == Layout4K::STACK_TOP - 4, engine + std::string("fault entry pushed below 0x0800"));
+    check(cpu.memory.read16(Layout4K::io(IO_FAULT_PC)) == bad_pc, engine + std::string("FAULT_PC names MOV R0, R5"));
+    check(cpu.memory.read16(0x0200) == 7 && cpu.memory.read16(0xF200) == 7, engine + std::string("RAM is mirrored"));
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: ./layout_small_ram small_ram.asm\n";
+        return 1;
+    }
+    std::ifstream file(argv[1]);
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Assembler assembler;
+    std::vector<uint8_t> image;
+    if (!file || !assembler.assemble_source(source, image)) {
+        std::cerr << "ERROR: " << argv[1] << ": " << assembler.error() << "\n";
+        return 1;
+    }
+    uint16_t bad_pc = assembler.symbols().at("bad");
+
+    run(image, bad_pc, true);
+    run(image, bad_pc, false);
+
+    // Same bytes on the 64 KB machine: decoded for its own layout
+    uint64_t builds = CodeCache::shared().builds();
+    CPU big;
+    big.load_program(image, 0);
+    check(CodeCache::shared().builds() == builds + 1, "Layout64K builds its own decoded image");
+
+    if (failures) return 1;
+    std::cout << "layout 4K: ok\n";
+    return 0;
+}